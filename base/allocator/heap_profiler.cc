@@ -0,0 +1,462 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/allocator/heap_profiler.h"
+
+#include <execinfo.h>
+#include <math.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+
+#include "base/allocator/allocator_extension.h"
+#include "base/atomicops.h"
+#include "base/compiler_specific.h"
+#include "base/debug/elf_symbolizer_linux.h"
+#include "base/debug/proc_maps_linux.h"
+#include "base/format_macros.h"
+#include "base/logging.h"
+#include "base/strings/string_util.h"
+#include "base/strings/stringprintf.h"
+#include "base/time/time.h"
+
+namespace base {
+namespace allocator {
+
+namespace {
+
+// Everything below is reached from malloc() and free(), so it must not
+// allocate: the tables are mmap'ed once and never freed, and the per-thread
+// state uses __thread, since pthread keys allocate when first used. All
+// globals are zero-initialized to avoid static initializers.
+
+// Distinct call stacks recorded; further ones are dropped. About 2.5 MB.
+const size_t kMaxCallSites = 1 << 13;
+
+// Live sampled allocations tracked; further ones are dropped. 1 MB.
+const size_t kMaxLiveSamples = 1 << 16;
+
+// Longest probe sequence in the live table before giving up.
+const size_t kMaxLiveProbes = 64;
+
+// Size of the filter that lets free() skip the live table.
+const size_t kFilterSize = 1 << 14;
+
+// Frames of the profiler and the shim at the top of recorded stacks.
+const int kSkippedFrames = 3;
+
+// Values of LiveSample::ptr besides live pointers.
+const subtle::AtomicWord kEmptySlot = 0;
+const subtle::AtomicWord kDeletedSlot = 1;
+
+struct CallSiteEntry {
+  // Hash of the stack, 0 while the entry is unused.
+  subtle::AtomicWord hash;
+  // Set once |depth| and |frames| are written.
+  subtle::Atomic32 ready;
+  int32 depth;
+  const void* frames[HeapProfiler::kMaxStackDepth];
+  subtle::AtomicWord alloc_count;
+  subtle::AtomicWord alloc_bytes;
+  subtle::AtomicWord free_count;
+  subtle::AtomicWord free_bytes;
+};
+
+struct LiveSample {
+  subtle::AtomicWord ptr;
+  size_t size;
+  CallSiteEntry* call_site;
+};
+
+subtle::Atomic32 g_shim_installed;
+subtle::Atomic32 g_running;
+subtle::AtomicWord g_sampling_interval;
+subtle::Atomic32 g_dropped_samples;
+
+// Published once by the first Start(), never freed.
+CallSiteEntry* g_call_sites;
+LiveSample* g_live_samples;
+
+// Counts the live samples whose pointers hash to each entry. free() only
+// searches the live table when the entry of its pointer isn't zero.
+subtle::Atomic32 g_filter[kFilterSize];
+
+// Bytes left to allocate on this thread before the next sample, and the state
+// of its random number generator, 0 until seeded.
+__thread intptr_t t_bytes_until_sample
+    __attribute__((tls_model("initial-exec")));
+__thread uint64 t_random_state __attribute__((tls_model("initial-exec")));
+// Set while the profiler runs on this thread, so that allocations made by
+// backtrace() aren't sampled.
+__thread bool t_in_profiler __attribute__((tls_model("initial-exec")));
+
+uintptr_t HashPointer(const void* ptr) {
+  // Allocations are at least 8 byte aligned.
+  uintptr_t value = reinterpret_cast<uintptr_t>(ptr) >> 3;
+#if defined(ARCH_CPU_64_BITS)
+  return value * 0x9E3779B97F4A7C15ULL >> 16;
+#else
+  return value * 0x9E3779B9U >> 8;
+#endif
+}
+
+uintptr_t HashStack(const void* const* frames, int depth) {
+  uintptr_t hash = depth;
+  for (int i = 0; i < depth; ++i)
+    hash = hash * 31 + reinterpret_cast<uintptr_t>(frames[i]);
+  // 0 marks unused entries.
+  return hash | 1;
+}
+
+// Returns the distance to the next sample, exponentially distributed with
+// mean |interval|, which makes the samples a Poisson process over the bytes
+// allocated.
+intptr_t NextSampleDistance(intptr_t interval) {
+  // xorshift64*.
+  t_random_state ^= t_random_state >> 12;
+  t_random_state ^= t_random_state << 25;
+  t_random_state ^= t_random_state >> 27;
+  uint64 random = t_random_state * 2685821657736338717ULL;
+  // In (0, 1].
+  double uniform = ((random >> 11) + 1) * (1.0 / (1ULL << 53));
+  double distance = -log(uniform) * interval;
+  return static_cast<intptr_t>(std::min<double>(distance + 1, kint32max));
+}
+
+// Returns the call site of the stack, creating it if needed, or NULL if the
+// table is full.
+CallSiteEntry* InternCallSite(const void* const* frames, int depth) {
+  uintptr_t hash = HashStack(frames, depth);
+  for (size_t probe = 0; probe < kMaxCallSites; ++probe) {
+    CallSiteEntry* entry = &g_call_sites[(hash + probe) & (kMaxCallSites - 1)];
+    subtle::AtomicWord entry_hash = subtle::Acquire_Load(&entry->hash);
+    if (entry_hash == 0) {
+      entry_hash = subtle::Acquire_CompareAndSwap(&entry->hash, 0, hash);
+      if (entry_hash == 0) {
+        entry->depth = depth;
+        memcpy(entry->frames, frames, depth * sizeof(frames[0]));
+        subtle::Release_Store(&entry->ready, 1);
+        return entry;
+      }
+    }
+    if (static_cast<uintptr_t>(entry_hash) != hash)
+      continue;
+    // Another thread may still be writing the frames.
+    while (!subtle::Acquire_Load(&entry->ready)) {
+    }
+    if (entry->depth == depth &&
+        !memcmp(entry->frames, frames, depth * sizeof(frames[0]))) {
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+bool InsertLiveSample(void* ptr, size_t size, CallSiteEntry* call_site) {
+  uintptr_t hash = HashPointer(ptr);
+  for (size_t probe = 0; probe < kMaxLiveProbes; ++probe) {
+    LiveSample* sample =
+        &g_live_samples[(hash + probe) & (kMaxLiveSamples - 1)];
+    subtle::AtomicWord old = subtle::NoBarrier_Load(&sample->ptr);
+    if (old != kEmptySlot && old != kDeletedSlot)
+      continue;
+    if (subtle::NoBarrier_CompareAndSwap(
+            &sample->ptr, old, reinterpret_cast<subtle::AtomicWord>(ptr)) !=
+        old) {
+      continue;
+    }
+    // |ptr| can't be freed before its malloc() returns, so RemoveLiveSample()
+    // can't see these fields before they are written.
+    sample->size = size;
+    sample->call_site = call_site;
+    subtle::NoBarrier_AtomicIncrement(&g_filter[hash & (kFilterSize - 1)], 1);
+    return true;
+  }
+  return false;
+}
+
+void RemoveLiveSample(void* ptr) {
+  uintptr_t hash = HashPointer(ptr);
+  subtle::AtomicWord value = reinterpret_cast<subtle::AtomicWord>(ptr);
+  for (size_t probe = 0; probe < kMaxLiveProbes; ++probe) {
+    LiveSample* sample =
+        &g_live_samples[(hash + probe) & (kMaxLiveSamples - 1)];
+    subtle::AtomicWord current = subtle::NoBarrier_Load(&sample->ptr);
+    if (current == kEmptySlot)
+      return;
+    if (current != value)
+      continue;
+    CallSiteEntry* call_site = sample->call_site;
+    subtle::NoBarrier_AtomicIncrement(&call_site->free_count, 1);
+    subtle::NoBarrier_AtomicIncrement(&call_site->free_bytes, sample->size);
+    subtle::NoBarrier_AtomicIncrement(&g_filter[hash & (kFilterSize - 1)], -1);
+    subtle::NoBarrier_Store(&sample->ptr, kDeletedSlot);
+    return;
+  }
+}
+
+NOINLINE void SampleAllocation(void* ptr, size_t size) {
+  intptr_t interval = subtle::NoBarrier_Load(&g_sampling_interval);
+  if (!t_random_state) {
+    // First allocation of this thread: draw its first distance instead of
+    // sampling it, which would favour allocations made early by threads.
+    t_random_state = (reinterpret_cast<uintptr_t>(&t_random_state) ^
+        TimeTicks::Now().ToInternalValue()) | 1;
+    t_bytes_until_sample = NextSampleDistance(interval);
+    return;
+  }
+  t_bytes_until_sample = NextSampleDistance(interval);
+
+  void* frames[HeapProfiler::kMaxStackDepth + kSkippedFrames];
+  int depth = backtrace(frames, arraysize(frames)) - kSkippedFrames;
+  CallSiteEntry* call_site =
+      depth > 0 ? InternCallSite(frames + kSkippedFrames, depth) : NULL;
+  if (!call_site || !InsertLiveSample(ptr, size, call_site)) {
+    subtle::NoBarrier_AtomicIncrement(&g_dropped_samples, 1);
+    return;
+  }
+  subtle::NoBarrier_AtomicIncrement(&call_site->alloc_count, 1);
+  subtle::NoBarrier_AtomicIncrement(&call_site->alloc_bytes, size);
+}
+
+void* MapTable(size_t size) {
+  void* table = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  return table == MAP_FAILED ? NULL : table;
+}
+
+// pprof's heap_v2 unsampling: a sample of an allocation of |size| bytes was
+// taken with probability 1 - exp(-size / interval).
+double ScaleFactor(uint64 count, uint64 bytes) {
+  if (!count || !bytes)
+    return 1.0;
+  double average_size = static_cast<double>(bytes) / count;
+  double interval = static_cast<double>(HeapProfiler::sampling_interval());
+  return 1.0 / (1.0 - exp(-average_size / interval));
+}
+
+bool CompareLiveBytes(const HeapProfiler::CallSite& a,
+                      const HeapProfiler::CallSite& b) {
+  return a.live_bytes > b.live_bytes;
+}
+
+void AppendCallSiteCounts(uint64 live_count,
+                          uint64 live_bytes,
+                          uint64 alloc_count,
+                          uint64 alloc_bytes,
+                          std::string* out) {
+  StringAppendF(out, "%6" PRIu64 ": %8" PRIu64 " [%6" PRIu64 ": %8" PRIu64
+                "] @", live_count, live_bytes, alloc_count, alloc_bytes);
+}
+
+}  // namespace
+
+HeapProfiler::CallSite::CallSite()
+    : alloc_count(0),
+      alloc_bytes(0),
+      live_count(0),
+      live_bytes(0) {
+}
+
+HeapProfiler::CallSite::~CallSite() {
+}
+
+// static
+bool HeapProfiler::Start(size_t sampling_interval) {
+  DCHECK_GT(sampling_interval, 0u);
+  if (!subtle::Acquire_Load(&g_shim_installed)) {
+    DLOG(WARNING) << "Heap profiling needs the allocator shim";
+    return false;
+  }
+
+  if (!g_call_sites) {
+    // The first call to backtrace() loads libgcc, which allocates.
+    void* frames[1];
+    backtrace(frames, arraysize(frames));
+
+    CallSiteEntry* call_sites = static_cast<CallSiteEntry*>(
+        MapTable(kMaxCallSites * sizeof(CallSiteEntry)));
+    LiveSample* live_samples = static_cast<LiveSample*>(
+        MapTable(kMaxLiveSamples * sizeof(LiveSample)));
+    if (!call_sites || !live_samples) {
+      DPLOG(ERROR) << "mmap";
+      return false;
+    }
+    g_live_samples = live_samples;
+    g_call_sites = call_sites;
+  }
+
+  subtle::NoBarrier_Store(&g_sampling_interval, sampling_interval);
+  if (!thunks::GetGetStatsFunction())
+    SetGetStatsFunction(&HeapProfiler::GetStats);
+  subtle::Release_Store(&g_running, 1);
+  return true;
+}
+
+// static
+void HeapProfiler::Stop() {
+  subtle::Release_Store(&g_running, 0);
+}
+
+// static
+bool HeapProfiler::IsRunning() {
+  return !!subtle::Acquire_Load(&g_running);
+}
+
+// static
+size_t HeapProfiler::sampling_interval() {
+  return subtle::NoBarrier_Load(&g_sampling_interval);
+}
+
+// static
+void HeapProfiler::GetCallSites(std::vector<CallSite>* call_sites) {
+  call_sites->clear();
+  if (!g_call_sites)
+    return;
+  for (size_t i = 0; i < kMaxCallSites; ++i) {
+    const CallSiteEntry& entry = g_call_sites[i];
+    if (!subtle::Acquire_Load(&entry.ready))
+      continue;
+    CallSite call_site;
+    call_site.stack.assign(entry.frames, entry.frames + entry.depth);
+    call_site.alloc_count = subtle::NoBarrier_Load(&entry.alloc_count);
+    call_site.alloc_bytes = subtle::NoBarrier_Load(&entry.alloc_bytes);
+    // Frees may be counted before the allocations they match, as the
+    // counters are read one after the other.
+    call_site.live_count = call_site.alloc_count - std::min<uint64>(
+        call_site.alloc_count, subtle::NoBarrier_Load(&entry.free_count));
+    call_site.live_bytes = call_site.alloc_bytes - std::min<uint64>(
+        call_site.alloc_bytes, subtle::NoBarrier_Load(&entry.free_bytes));
+    call_sites->push_back(call_site);
+  }
+}
+
+// static
+uint64 HeapProfiler::EstimateCount(uint64 count, uint64 bytes) {
+  return static_cast<uint64>(count * ScaleFactor(count, bytes) + 0.5);
+}
+
+// static
+uint64 HeapProfiler::EstimateBytes(uint64 count, uint64 bytes) {
+  return static_cast<uint64>(bytes * ScaleFactor(count, bytes) + 0.5);
+}
+
+// static
+std::string HeapProfiler::GetHeapDump() {
+  std::vector<CallSite> call_sites;
+  GetCallSites(&call_sites);
+
+  CallSite total;
+  for (size_t i = 0; i < call_sites.size(); ++i) {
+    total.live_count += call_sites[i].live_count;
+    total.live_bytes += call_sites[i].live_bytes;
+    total.alloc_count += call_sites[i].alloc_count;
+    total.alloc_bytes += call_sites[i].alloc_bytes;
+  }
+
+  std::string dump = "heap profile: ";
+  AppendCallSiteCounts(total.live_count, total.live_bytes, total.alloc_count,
+                       total.alloc_bytes, &dump);
+  StringAppendF(&dump, " heap_v2/%" PRIuS "\n", sampling_interval());
+  for (size_t i = 0; i < call_sites.size(); ++i) {
+    const CallSite& call_site = call_sites[i];
+    AppendCallSiteCounts(call_site.live_count, call_site.live_bytes,
+                         call_site.alloc_count, call_site.alloc_bytes, &dump);
+    for (size_t j = 0; j < call_site.stack.size(); ++j)
+      StringAppendF(&dump, " %p", call_site.stack[j]);
+    dump += "\n";
+  }
+
+  std::string proc_maps;
+  if (debug::ReadProcMaps(&proc_maps)) {
+    dump += "\nMAPPED_LIBRARIES:\n";
+    dump += proc_maps;
+  }
+  return dump;
+}
+
+// static
+void HeapProfiler::GetStats(char* buffer, int buffer_length) {
+  const size_t kTopCallSites = 10;
+  const size_t kFramesPerCallSite = 4;
+
+  std::vector<CallSite> call_sites;
+  GetCallSites(&call_sites);
+  uint64 live_count = 0;
+  uint64 live_bytes = 0;
+  uint64 alloc_count = 0;
+  uint64 alloc_bytes = 0;
+  for (size_t i = 0; i < call_sites.size(); ++i) {
+    const CallSite& call_site = call_sites[i];
+    live_count += EstimateCount(call_site.live_count, call_site.live_bytes);
+    live_bytes += EstimateBytes(call_site.live_count, call_site.live_bytes);
+    alloc_count += EstimateCount(call_site.alloc_count, call_site.alloc_bytes);
+    alloc_bytes += EstimateBytes(call_site.alloc_count, call_site.alloc_bytes);
+  }
+
+  std::string stats = StringPrintf(
+      "Heap profiler (%s, one sample per %" PRIuS " bytes)\n"
+      "Live:      %12" PRIu64 " bytes in %10" PRIu64 " allocations\n"
+      "Allocated: %12" PRIu64 " bytes in %10" PRIu64 " allocations\n"
+      "Dropped samples: %d\n",
+      IsRunning() ? "running" : "stopped", sampling_interval(),
+      live_bytes, live_count, alloc_bytes, alloc_count,
+      subtle::NoBarrier_Load(&g_dropped_samples));
+
+  size_t top = std::min(kTopCallSites, call_sites.size());
+  std::partial_sort(call_sites.begin(), call_sites.begin() + top,
+                    call_sites.end(), &CompareLiveBytes);
+  debug::ElfSymbolizer symbolizer;
+  for (size_t i = 0; i < top && call_sites[i].live_bytes; ++i) {
+    const CallSite& call_site = call_sites[i];
+    StringAppendF(&stats, "%12" PRIu64 " bytes live at ",
+                  EstimateBytes(call_site.live_count, call_site.live_bytes));
+    size_t frames = std::min(kFramesPerCallSite, call_site.stack.size());
+    for (size_t j = 0; j < frames; ++j) {
+      // Step back into the call instruction.
+      debug::ElfSymbolizer::Frame frame;
+      symbolizer.Symbolize(
+          reinterpret_cast<uintptr_t>(call_site.stack[j]) - 1, &frame);
+      if (j)
+        stats += " < ";
+      if (frame.symbol)
+        stats += debug::ElfSymbolizer::Demangle(frame.symbol);
+      else
+        StringAppendF(&stats, "%p", call_site.stack[j]);
+    }
+    stats += "\n";
+  }
+
+  strlcpy(buffer, stats.c_str(), buffer_length);
+}
+
+// static
+void HeapProfiler::RecordAlloc(void* ptr, size_t size) {
+  if (!subtle::NoBarrier_Load(&g_running))
+    return;
+  t_bytes_until_sample -= size;
+  if (t_bytes_until_sample > 0 || t_in_profiler)
+    return;
+
+  t_in_profiler = true;
+  SampleAllocation(ptr, size);
+  t_in_profiler = false;
+}
+
+// static
+void HeapProfiler::RecordFree(void* ptr) {
+  if (!subtle::NoBarrier_Load(
+          &g_filter[HashPointer(ptr) & (kFilterSize - 1)])) {
+    return;
+  }
+  RemoveLiveSample(ptr);
+}
+
+// static
+void HeapProfiler::SetShimInstalled() {
+  subtle::Release_Store(&g_shim_installed, 1);
+}
+
+}  // namespace allocator
+}  // namespace base
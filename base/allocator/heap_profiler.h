@@ -0,0 +1,103 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// A sampling heap profiler for the system allocator. The allocator shim
+// (malloc_interposition_linux.cc) reports every allocation and free. One
+// allocation per |sampling_interval| bytes on average is sampled, picked by a
+// Poisson process so that allocations of every size are represented in
+// proportion to the bytes they allocate. Sampled allocations record their
+// call stack.
+//
+// Unsampled allocations cost a thread-local subtraction, frees a lookup in a
+// small table. Sampled ones are recorded into fixed-size tables without
+// locks. The profile is available as heap dumps by call site, and through
+// base::allocator::GetStats() while profiling.
+
+#ifndef BASE_ALLOCATOR_HEAP_PROFILER_H_
+#define BASE_ALLOCATOR_HEAP_PROFILER_H_
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+
+namespace base {
+namespace allocator {
+
+class BASE_EXPORT HeapProfiler {
+ public:
+  // Average number of bytes allocated between two samples.
+  static const size_t kDefaultSamplingInterval = 512 * 1024;
+
+  // Deepest call stack recorded, in frames.
+  static const int kMaxStackDepth = 32;
+
+  // The samples of one allocation call stack.
+  struct CallSite {
+    CallSite();
+    ~CallSite();
+
+    // Return addresses, innermost first.
+    std::vector<const void*> stack;
+
+    // Sampled allocations ever made and their bytes.
+    uint64 alloc_count;
+    uint64 alloc_bytes;
+
+    // Sampled allocations still live and their bytes.
+    uint64 live_count;
+    uint64 live_bytes;
+  };
+
+  // Starts sampling, keeping what was sampled before. Only allocations made
+  // through the allocator shim are seen; returns false if the binary isn't
+  // linked with it. Also routes base::allocator::GetStats() to the profiler.
+  static bool Start(size_t sampling_interval);
+
+  // Stops sampling new allocations. Frees of sampled allocations are still
+  // accounted for.
+  static void Stop();
+
+  static bool IsRunning();
+
+  // Average distance between samples, in bytes.
+  static size_t sampling_interval();
+
+  // Returns the sampled call sites. The counts are of samples; scale them
+  // with EstimateCount() and EstimateBytes().
+  static void GetCallSites(std::vector<CallSite>* call_sites);
+
+  // Returns the estimated number of allocations and bytes that |count|
+  // samples of |bytes| bytes in total stand for.
+  static uint64 EstimateCount(uint64 count, uint64 bytes);
+  static uint64 EstimateBytes(uint64 count, uint64 bytes);
+
+  // Returns the samples in the legacy pprof heap profile format (heap_v2),
+  // followed by the memory map of the process for offline symbolization:
+  // pprof <binary> <file>. Live samples are reported as in use.
+  static std::string GetHeapDump();
+
+  // Prints a summary and the call sites holding most live bytes, for
+  // base::allocator::GetStats().
+  static void GetStats(char* buffer, int buffer_length);
+
+  // Called by the allocator shim for every allocation and free. Must not be
+  // called for NULL.
+  static void RecordAlloc(void* ptr, size_t size);
+  static void RecordFree(void* ptr);
+
+  // Called once by the allocator shim when it's linked in.
+  static void SetShimInstalled();
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(HeapProfiler);
+};
+
+}  // namespace allocator
+}  // namespace base
+
+#endif  // BASE_ALLOCATOR_HEAP_PROFILER_H_
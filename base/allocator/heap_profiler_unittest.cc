@@ -0,0 +1,163 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Must be linked with base_malloc_interposition.
+
+#include "base/allocator/heap_profiler.h"
+
+#include <stdlib.h>
+
+#include "base/allocator/allocator_extension.h"
+#include "base/compiler_specific.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace allocator {
+
+// Not in an anonymous namespace, so that the symbols are easy to recognize.
+NOINLINE void* HeapProfilerTestAllocate(size_t size) {
+  return malloc(size);
+}
+
+NOINLINE void* HeapProfilerTestLeak(size_t size) {
+  return malloc(size);
+}
+
+NOINLINE void* HeapProfilerTestReallocLeak(void* ptr, size_t size) {
+  return realloc(ptr, size);
+}
+
+namespace {
+
+const size_t kAllocationSize = 1024;
+const int kAllocations = 20000;
+
+// Returns the samples of the call sites whose innermost frame is in
+// |function|.
+HeapProfiler::CallSite SamplesIn(const void* function) {
+  std::vector<HeapProfiler::CallSite> call_sites;
+  HeapProfiler::GetCallSites(&call_sites);
+  HeapProfiler::CallSite total;
+  uintptr_t start = reinterpret_cast<uintptr_t>(function);
+  for (size_t i = 0; i < call_sites.size(); ++i) {
+    uintptr_t pc = reinterpret_cast<uintptr_t>(call_sites[i].stack[0]);
+    // The return address of the call to malloc().
+    if (pc <= start || pc > start + 64)
+      continue;
+    total.alloc_count += call_sites[i].alloc_count;
+    total.alloc_bytes += call_sites[i].alloc_bytes;
+    total.live_count += call_sites[i].live_count;
+    total.live_bytes += call_sites[i].live_bytes;
+  }
+  return total;
+}
+
+class HeapProfilerTest : public testing::Test {
+ protected:
+  virtual void SetUp() OVERRIDE {
+    ASSERT_TRUE(HeapProfiler::Start(64 * 1024));
+  }
+
+  virtual void TearDown() OVERRIDE {
+    HeapProfiler::Stop();
+  }
+};
+
+TEST_F(HeapProfilerTest, EstimatesAllocatedBytes) {
+  HeapProfiler::CallSite before =
+      SamplesIn(reinterpret_cast<void*>(&HeapProfilerTestAllocate));
+  for (int i = 0; i < kAllocations; ++i)
+    free(HeapProfilerTestAllocate(kAllocationSize));
+  HeapProfiler::CallSite after =
+      SamplesIn(reinterpret_cast<void*>(&HeapProfilerTestAllocate));
+
+  uint64 count = after.alloc_count - before.alloc_count;
+  uint64 bytes = after.alloc_bytes - before.alloc_bytes;
+  EXPECT_EQ(count * kAllocationSize, bytes);
+  // About 312 samples are expected; allow for 4 standard deviations.
+  EXPECT_GT(count, 240u);
+  EXPECT_LT(count, 390u);
+  // Everything was freed.
+  EXPECT_EQ(before.live_count, after.live_count);
+
+  uint64 estimate = HeapProfiler::EstimateBytes(count, bytes);
+  EXPECT_GT(estimate, kAllocations * kAllocationSize * 3 / 4);
+  EXPECT_LT(estimate, kAllocations * kAllocationSize * 5 / 4);
+}
+
+TEST_F(HeapProfilerTest, TracksLiveAllocations) {
+  std::vector<void*> leaks;
+  for (int i = 0; i < kAllocations; ++i)
+    leaks.push_back(HeapProfilerTestLeak(kAllocationSize));
+  HeapProfiler::CallSite live =
+      SamplesIn(reinterpret_cast<void*>(&HeapProfilerTestLeak));
+  EXPECT_GT(live.live_count, 0u);
+  EXPECT_EQ(live.live_count * kAllocationSize, live.live_bytes);
+
+  // Frees are accounted for after Stop().
+  HeapProfiler::Stop();
+  for (size_t i = 0; i < leaks.size(); ++i)
+    free(leaks[i]);
+  HeapProfiler::CallSite freed =
+      SamplesIn(reinterpret_cast<void*>(&HeapProfilerTestLeak));
+  EXPECT_EQ(0u, freed.live_count);
+  EXPECT_EQ(live.alloc_count, freed.alloc_count);
+}
+
+TEST_F(HeapProfilerTest, FailedReallocKeepsAllocation) {
+  std::vector<void*> leaks;
+  for (int i = 0; i < kAllocations; ++i)
+    leaks.push_back(HeapProfilerTestReallocLeak(NULL, kAllocationSize));
+  HeapProfiler::CallSite live =
+      SamplesIn(reinterpret_cast<void*>(&HeapProfilerTestReallocLeak));
+  EXPECT_GT(live.live_count, 0u);
+
+  // Too large to succeed: the blocks stay live, and so do their samples.
+  for (size_t i = 0; i < leaks.size(); ++i)
+    EXPECT_TRUE(realloc(leaks[i], static_cast<size_t>(-1) / 2) == NULL);
+  HeapProfiler::CallSite after_failure =
+      SamplesIn(reinterpret_cast<void*>(&HeapProfilerTestReallocLeak));
+  EXPECT_EQ(live.live_count, after_failure.live_count);
+
+  for (size_t i = 0; i < leaks.size(); ++i)
+    free(leaks[i]);
+  HeapProfiler::CallSite freed =
+      SamplesIn(reinterpret_cast<void*>(&HeapProfilerTestReallocLeak));
+  EXPECT_EQ(0u, freed.live_count);
+}
+
+TEST_F(HeapProfilerTest, EstimateSmallAllocations) {
+  // A sample of an allocation much smaller than the interval stands for
+  // interval / size allocations.
+  EXPECT_NEAR(64 * 1024 / 16,
+              static_cast<double>(HeapProfiler::EstimateCount(1, 16)), 1.0);
+  // Allocations larger than the interval are nearly always sampled.
+  EXPECT_EQ(1u, HeapProfiler::EstimateCount(1, 16 * 1024 * 1024));
+  EXPECT_EQ(0u, HeapProfiler::EstimateCount(0, 0));
+}
+
+TEST_F(HeapProfilerTest, HeapDump) {
+  void* leak = HeapProfilerTestLeak(1024 * 1024);
+  std::string dump = HeapProfiler::GetHeapDump();
+  free(leak);
+  EXPECT_EQ(0u, dump.find("heap profile: "));
+  EXPECT_NE(std::string::npos, dump.find(" heap_v2/65536\n"));
+  EXPECT_NE(std::string::npos, dump.find("\nMAPPED_LIBRARIES:\n"));
+  EXPECT_NE(std::string::npos, dump.find("] @ 0x"));
+}
+
+TEST_F(HeapProfilerTest, GetStats) {
+  void* leak = HeapProfilerTestLeak(4 * 1024 * 1024);
+  char buffer[4096];
+  base::allocator::GetStats(buffer, sizeof(buffer));
+  free(leak);
+  std::string stats(buffer);
+  EXPECT_EQ(0u, stats.find("Heap profiler (running"));
+  EXPECT_NE(std::string::npos,
+            stats.find("base::allocator::HeapProfilerTestLeak(unsigned long)"));
+}
+
+}  // namespace
+}  // namespace allocator
+}  // namespace base
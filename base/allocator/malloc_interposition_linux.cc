@@ -0,0 +1,125 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Allocator shim for glibc: defines the malloc family, forwarding to glibc's
+// own implementation (__libc_malloc() and friends) and reporting every
+// allocation and free to the HeapProfiler. Symbols of the executable take
+// precedence over those of libc.so, so linking this file in is enough to
+// intercept all allocations of the process, including those of shared
+// libraries and of operator new.
+//
+// Built as the base_malloc_interposition library, which executables link in
+// addition to base.
+
+#include <errno.h>
+#include <stddef.h>
+
+#include "base/allocator/heap_profiler.h"
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void __libc_free(void* ptr);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void* __libc_valloc(size_t size);
+void* __libc_pvalloc(size_t size);
+}
+
+namespace {
+
+__attribute__((constructor)) void InstallShim() {
+  base::allocator::HeapProfiler::SetShimInstalled();
+}
+
+}  // namespace
+
+// The profiler skips a fixed number of frames to find the caller, so each of
+// these functions calls it directly rather than through a helper or another
+// of them.
+#define RECORD_ALLOC(ptr, size) \
+  if (ptr) \
+    base::allocator::HeapProfiler::RecordAlloc(ptr, size)
+
+#define RECORD_FREE(ptr) \
+  if (ptr) \
+    base::allocator::HeapProfiler::RecordFree(ptr)
+
+extern "C" {
+
+void* malloc(size_t size) {
+  void* ptr = __libc_malloc(size);
+  RECORD_ALLOC(ptr, size);
+  return ptr;
+}
+
+void free(void* ptr) {
+  RECORD_FREE(ptr);
+  __libc_free(ptr);
+}
+
+void* calloc(size_t n, size_t size) {
+  void* ptr = __libc_calloc(n, size);
+  // __libc_calloc() fails on overflow, so the product is only used when it
+  // didn't.
+  RECORD_ALLOC(ptr, n * size);
+  return ptr;
+}
+
+void* realloc(void* old_ptr, size_t size) {
+  if (old_ptr && !size) {
+    // glibc frees |old_ptr| and returns NULL. Record the free first, as free()
+    // does, since once the block is released another thread may be given it.
+    RECORD_FREE(old_ptr);
+    return __libc_realloc(old_ptr, size);
+  }
+  void* ptr = __libc_realloc(old_ptr, size);
+  // If realloc() fails, |old_ptr| is still live and stays recorded. If it
+  // moved the block, another thread may have been given |old_ptr| already;
+  // were that allocation sampled too, this free would remove one of the two
+  // samples of |old_ptr|, which have the same size only by chance.
+  if (ptr) {
+    RECORD_FREE(old_ptr);
+    RECORD_ALLOC(ptr, size);
+  }
+  return ptr;
+}
+
+void* memalign(size_t alignment, size_t size) {
+  void* ptr = __libc_memalign(alignment, size);
+  RECORD_ALLOC(ptr, size);
+  return ptr;
+}
+
+int posix_memalign(void** result, size_t alignment, size_t size) {
+  // Must be a power of two multiple of sizeof(void*).
+  if (!alignment || alignment % sizeof(void*) || alignment & (alignment - 1))
+    return EINVAL;
+  void* ptr = __libc_memalign(alignment, size);
+  if (!ptr)
+    return ENOMEM;
+  RECORD_ALLOC(ptr, size);
+  *result = ptr;
+  return 0;
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+  void* ptr = __libc_memalign(alignment, size);
+  RECORD_ALLOC(ptr, size);
+  return ptr;
+}
+
+void* valloc(size_t size) {
+  void* ptr = __libc_valloc(size);
+  RECORD_ALLOC(ptr, size);
+  return ptr;
+}
+
+void* pvalloc(size_t size) {
+  void* ptr = __libc_pvalloc(size);
+  RECORD_ALLOC(ptr, size);
+  return ptr;
+}
+
+}  // extern "C"
@@ -0,0 +1,138 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_CONTAINERS_BOUNDED_MPMC_QUEUE_H_
+#define BASE_CONTAINERS_BOUNDED_MPMC_QUEUE_H_
+
+// A lock-free ring buffer with many producers and many consumers, after
+// Dmitry Vyukov's bounded MPMC queue. Each cell has a sequence number which
+// says whether it is free for the producer or full for the consumer of a
+// given position, so a push or pop is one compare-and-swap on the position
+// and a store to the cell, and producers and consumers only contend with
+// their own kind.
+//
+//   BoundedMPMCQueue<Task*> queue(1024);
+//   if (!queue.TryPush(task))
+//     ...  // Full.
+//   Task* task;
+//   if (queue.TryPop(&task))
+//     task->Run();
+//
+// T is copied in and out, so it should be cheap to copy, such as a pointer.
+// Neither call blocks; callers which want to wait for room or for an element
+// need a WaitableEvent or ConditionVariable of their own.
+
+#include <stddef.h>
+
+#include "base/atomicops.h"
+#include "base/basictypes.h"
+#include "base/logging.h"
+#include "base/memory/scoped_ptr.h"
+
+namespace base {
+
+template <typename T>
+class BoundedMPMCQueue {
+ public:
+  // |capacity| must be a power of two, at least 2.
+  explicit BoundedMPMCQueue(size_t capacity)
+      : cells_(new Cell[capacity]),
+        mask_(capacity - 1),
+        enqueue_position_(0),
+        dequeue_position_(0) {
+    DCHECK(capacity >= 2 && (capacity & (capacity - 1)) == 0) << capacity;
+    for (size_t i = 0; i < capacity; ++i)
+      subtle::NoBarrier_Store(&cells_[i].sequence, i);
+  }
+
+  // Pushes |value|, or returns false if the queue is full.
+  bool TryPush(const T& value) {
+    Cell* cell;
+    subtle::AtomicWord position =
+        subtle::NoBarrier_Load(&enqueue_position_);
+    for (;;) {
+      cell = &cells_[position & mask_];
+      const subtle::AtomicWord sequence =
+          subtle::Acquire_Load(&cell->sequence);
+      const intptr_t difference = sequence - position;
+      if (difference == 0) {
+        // The cell is free for this position; claim it.
+        const subtle::AtomicWord claimed = subtle::NoBarrier_CompareAndSwap(
+            &enqueue_position_, position, position + 1);
+        if (claimed == position)
+          break;
+        position = claimed;
+      } else if (difference < 0) {
+        // The cell still holds the value pushed a lap ago.
+        return false;
+      } else {
+        // Another producer claimed the position.
+        position = subtle::NoBarrier_Load(&enqueue_position_);
+      }
+    }
+    cell->value = value;
+    // Hands the cell to the consumer of this position.
+    subtle::Release_Store(&cell->sequence, position + 1);
+    return true;
+  }
+
+  // Pops the oldest value into |value|, or returns false if the queue is
+  // empty.
+  bool TryPop(T* value) {
+    Cell* cell;
+    subtle::AtomicWord position =
+        subtle::NoBarrier_Load(&dequeue_position_);
+    for (;;) {
+      cell = &cells_[position & mask_];
+      const subtle::AtomicWord sequence =
+          subtle::Acquire_Load(&cell->sequence);
+      const intptr_t difference = sequence - (position + 1);
+      if (difference == 0) {
+        const subtle::AtomicWord claimed = subtle::NoBarrier_CompareAndSwap(
+            &dequeue_position_, position, position + 1);
+        if (claimed == position)
+          break;
+        position = claimed;
+      } else if (difference < 0) {
+        // Nothing has been pushed at this position yet.
+        return false;
+      } else {
+        position = subtle::NoBarrier_Load(&dequeue_position_);
+      }
+    }
+    *value = cell->value;
+    // Frees the cell for the producer of the position a lap on.
+    subtle::Release_Store(&cell->sequence, position + mask_ + 1);
+    return true;
+  }
+
+  size_t capacity() const { return mask_ + 1; }
+
+ private:
+  struct Cell {
+    volatile subtle::AtomicWord sequence;
+    T value;
+  };
+
+  // Each counter is on a cache line of its own, so that producers and
+  // consumers don't invalidate each other's lines, nor the read-mostly
+  // |cells_| and |mask_|.
+  enum { kCacheLineSize = 64 };
+  typedef char Padding[kCacheLineSize];
+
+  Padding padding0_;
+  const scoped_ptr<Cell[]> cells_;
+  const size_t mask_;
+  Padding padding1_;
+  volatile subtle::AtomicWord enqueue_position_;
+  Padding padding2_;
+  volatile subtle::AtomicWord dequeue_position_;
+  Padding padding3_;
+
+  DISALLOW_COPY_AND_ASSIGN(BoundedMPMCQueue);
+};
+
+}  // namespace base
+
+#endif  // BASE_CONTAINERS_BOUNDED_MPMC_QUEUE_H_
@@ -0,0 +1,122 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/containers/bounded_mpmc_queue.h"
+
+#include <vector>
+
+#include "base/threading/simple_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace {
+
+const int kPerProducer = 100000;
+
+// Pushes the values |first| to |first| + kPerProducer - 1, waiting for room.
+class Producer : public DelegateSimpleThread::Delegate {
+ public:
+  Producer(BoundedMPMCQueue<int>* queue, int first)
+      : queue_(queue), first_(first) {}
+
+  virtual void Run() OVERRIDE {
+    for (int i = first_; i < first_ + kPerProducer; ++i) {
+      while (!queue_->TryPush(i))
+        PlatformThread::YieldCurrentThread();
+    }
+  }
+
+ private:
+  BoundedMPMCQueue<int>* queue_;
+  const int first_;
+};
+
+// Pops |count| values, counting each in |seen|, and checks that the values
+// of each producer come out in order.
+class Consumer : public DelegateSimpleThread::Delegate {
+ public:
+  Consumer(BoundedMPMCQueue<int>* queue, int producers, int count)
+      : queue_(queue), last_(producers, -1), count_(count) {}
+
+  virtual void Run() OVERRIDE {
+    for (int i = 0; i < count_; ++i) {
+      int value;
+      while (!queue_->TryPop(&value))
+        PlatformThread::YieldCurrentThread();
+      int& last = last_[value / kPerProducer];
+      EXPECT_GT(value, last);
+      last = value;
+      seen_.push_back(value);
+    }
+  }
+
+  const std::vector<int>& seen() const { return seen_; }
+
+ private:
+  BoundedMPMCQueue<int>* queue_;
+  std::vector<int> last_;
+  const int count_;
+  std::vector<int> seen_;
+};
+
+TEST(BoundedMPMCQueueTest, Basic) {
+  BoundedMPMCQueue<int> queue(4);
+  EXPECT_EQ(4u, queue.capacity());
+  int value;
+  EXPECT_FALSE(queue.TryPop(&value));
+  for (int lap = 0; lap < 3; ++lap) {
+    for (int i = 0; i < 4; ++i)
+      EXPECT_TRUE(queue.TryPush(i));
+    EXPECT_FALSE(queue.TryPush(4));
+    for (int i = 0; i < 4; ++i) {
+      ASSERT_TRUE(queue.TryPop(&value));
+      EXPECT_EQ(i, value);
+    }
+    EXPECT_FALSE(queue.TryPop(&value));
+  }
+}
+
+TEST(BoundedMPMCQueueTest, ManyProducersAndConsumers) {
+  const int kProducers = 3;
+  const int kConsumers = 2;
+  BoundedMPMCQueue<int> queue(64);
+
+  std::vector<Producer*> producers;
+  std::vector<Consumer*> consumers;
+  std::vector<DelegateSimpleThread*> threads;
+  for (int i = 0; i < kConsumers; ++i) {
+    consumers.push_back(new Consumer(&queue, kProducers,
+                                     kProducers * kPerProducer / kConsumers));
+    threads.push_back(new DelegateSimpleThread(consumers.back(), "consumer"));
+  }
+  for (int i = 0; i < kProducers; ++i) {
+    producers.push_back(new Producer(&queue, i * kPerProducer));
+    threads.push_back(new DelegateSimpleThread(producers.back(), "producer"));
+  }
+  for (size_t i = 0; i < threads.size(); ++i)
+    threads[i]->Start();
+  for (size_t i = 0; i < threads.size(); ++i) {
+    threads[i]->Join();
+    delete threads[i];
+  }
+
+  // Every value came out exactly once.
+  std::vector<bool> seen(kProducers * kPerProducer, false);
+  for (int i = 0; i < kConsumers; ++i) {
+    for (size_t j = 0; j < consumers[i]->seen().size(); ++j) {
+      const int value = consumers[i]->seen()[j];
+      EXPECT_FALSE(seen[value]);
+      seen[value] = true;
+    }
+    delete consumers[i];
+  }
+  for (int i = 0; i < kProducers; ++i)
+    delete producers[i];
+  EXPECT_EQ(std::vector<bool>(kProducers * kPerProducer, true), seen);
+  int value;
+  EXPECT_FALSE(queue.TryPop(&value));
+}
+
+}  // namespace
+}  // namespace base
@@ -0,0 +1,163 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_CONTAINERS_MPSC_QUEUE_H_
+#define BASE_CONTAINERS_MPSC_QUEUE_H_
+
+// An intrusive, lock-free, unbounded queue with many producers and a single
+// consumer, after Dmitry Vyukov's. A push is one atomic exchange and never
+// waits for other threads; a pop takes no atomic read-modify-write at all.
+// Use it to hand work to a single thread, such as the incoming queue of a
+// message loop, where a Lock around a std::queue is contended.
+//
+// As with LinkedList, the elements extend MPSCQueueNode, which gives them
+// the next pointer, so pushing never allocates:
+//
+//   class Task : public MPSCQueueNode<Task> {
+//     ...
+//   };
+//
+//   MPSCQueue<Task> queue;
+//   queue.Push(task);  // On any thread.
+//   ...
+//   while (Task* task = queue.Pop())  // On the consumer thread only.
+//     task->Run();
+//
+// The queue doesn't own its elements. An element may be in one queue at a
+// time, and may be pushed again once popped.
+//
+// A producer swaps itself in as the head before linking the previous head
+// to it, so for an instant the element it pushed can't be reached from the
+// tail. Pop() then returns NULL even though the queue isn't empty; the
+// producer is about to finish, so a consumer which was woken for the element
+// should try again rather than sleep.
+
+#include "base/atomicops.h"
+#include "base/basictypes.h"
+#include "build/build_config.h"
+
+namespace base {
+
+namespace internal {
+
+// An exchange with the ordering of a full barrier, which atomicops lacks.
+// On x86 the locked exchange is a barrier already.
+inline subtle::AtomicWord Barrier_AtomicExchange(
+    volatile subtle::AtomicWord* ptr,
+    subtle::AtomicWord new_value) {
+#if defined(ARCH_CPU_X86_FAMILY)
+  return subtle::NoBarrier_AtomicExchange(ptr, new_value);
+#else
+  subtle::MemoryBarrier();
+  subtle::AtomicWord old_value = subtle::NoBarrier_AtomicExchange(ptr,
+                                                                  new_value);
+  subtle::MemoryBarrier();
+  return old_value;
+#endif
+}
+
+}  // namespace internal
+
+template <typename T>
+class MPSCQueue;
+
+template <typename T>
+class MPSCQueueNode {
+ public:
+  MPSCQueueNode() : next_(0) {}
+
+ private:
+  friend class MPSCQueue<T>;
+
+  MPSCQueueNode* next() const {
+    return reinterpret_cast<MPSCQueueNode*>(subtle::Acquire_Load(&next_));
+  }
+  void set_next(MPSCQueueNode* next) {
+    subtle::Release_Store(&next_, reinterpret_cast<subtle::AtomicWord>(next));
+  }
+
+  volatile subtle::AtomicWord next_;
+
+  DISALLOW_COPY_AND_ASSIGN(MPSCQueueNode);
+};
+
+template <typename T>
+class MPSCQueue {
+ public:
+  MPSCQueue()
+      : head_(reinterpret_cast<subtle::AtomicWord>(&stub_)),
+        tail_(&stub_) {
+  }
+
+  // Pushes |node|, which must not be in a queue. May be called on any
+  // thread.
+  void Push(MPSCQueueNode<T>* node) {
+    node->set_next(NULL);
+    // Producers are serialized by the exchange; each then links the element
+    // pushed before it to its own.
+    MPSCQueueNode<T>* previous = reinterpret_cast<MPSCQueueNode<T>*>(
+        internal::Barrier_AtomicExchange(
+            &head_, reinterpret_cast<subtle::AtomicWord>(node)));
+    previous->set_next(node);
+  }
+
+  // Pops the oldest element, or returns NULL if there is none, or if the
+  // next one is still being pushed; see above. Must only be called on one
+  // thread at a time.
+  T* Pop() {
+    MPSCQueueNode<T>* tail = tail_;
+    MPSCQueueNode<T>* next = tail->next();
+    if (tail == &stub_) {
+      // The stub separates the consumer from the producers when the queue
+      // is empty. Skip it.
+      if (!next)
+        return NULL;
+      tail_ = next;
+      tail = next;
+      next = next->next();
+    }
+    if (next) {
+      tail_ = next;
+      return static_cast<T*>(tail);
+    }
+
+    // |tail| is the last element linked. Unless a producer has swapped in a
+    // newer head and not yet linked it, push the stub behind |tail| so that
+    // |tail| can be popped without leaving the queue without a node.
+    if (tail != reinterpret_cast<MPSCQueueNode<T>*>(
+                    subtle::Acquire_Load(&head_))) {
+      return NULL;
+    }
+    Push(&stub_);
+    next = tail->next();
+    if (next) {
+      tail_ = next;
+      return static_cast<T*>(tail);
+    }
+    return NULL;
+  }
+
+  // Returns true if there is nothing to pop. Only meaningful on the consumer
+  // thread; a push may be under way.
+  bool empty() const {
+    return tail_ == &stub_ && !stub_.next() &&
+           subtle::Acquire_Load(&head_) ==
+               reinterpret_cast<subtle::AtomicWord>(&stub_);
+  }
+
+ private:
+  // Where producers push, the newest element.
+  volatile subtle::AtomicWord head_;
+  // Keep the producers' cache line away from the consumer's.
+  char padding_[64 - sizeof(subtle::AtomicWord)];
+  // Where the consumer pops, the oldest element. Only the consumer uses it.
+  MPSCQueueNode<T>* tail_;
+  MPSCQueueNode<T> stub_;
+
+  DISALLOW_COPY_AND_ASSIGN(MPSCQueue);
+};
+
+}  // namespace base
+
+#endif  // BASE_CONTAINERS_MPSC_QUEUE_H_
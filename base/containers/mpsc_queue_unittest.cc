@@ -0,0 +1,104 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/containers/mpsc_queue.h"
+
+#include <vector>
+
+#include "base/threading/simple_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace {
+
+class Node : public MPSCQueueNode<Node> {
+ public:
+  Node() : producer(0), sequence(0) {}
+
+  int producer;
+  int sequence;
+};
+
+// Pushes |nodes| in order.
+class Producer : public DelegateSimpleThread::Delegate {
+ public:
+  Producer(MPSCQueue<Node>* queue, Node* nodes, int count)
+      : queue_(queue), nodes_(nodes), count_(count) {}
+
+  virtual void Run() OVERRIDE {
+    for (int i = 0; i < count_; ++i)
+      queue_->Push(&nodes_[i]);
+  }
+
+ private:
+  MPSCQueue<Node>* queue_;
+  Node* nodes_;
+  int count_;
+};
+
+TEST(MPSCQueueTest, Basic) {
+  MPSCQueue<Node> queue;
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(NULL, queue.Pop());
+
+  Node nodes[3];
+  queue.Push(&nodes[0]);
+  queue.Push(&nodes[1]);
+  EXPECT_FALSE(queue.empty());
+  EXPECT_EQ(&nodes[0], queue.Pop());
+  queue.Push(&nodes[2]);
+  EXPECT_EQ(&nodes[1], queue.Pop());
+  EXPECT_EQ(&nodes[2], queue.Pop());
+  EXPECT_EQ(NULL, queue.Pop());
+  EXPECT_TRUE(queue.empty());
+
+  // Popped nodes may be pushed again.
+  queue.Push(&nodes[1]);
+  queue.Push(&nodes[0]);
+  EXPECT_EQ(&nodes[1], queue.Pop());
+  EXPECT_EQ(&nodes[0], queue.Pop());
+  EXPECT_EQ(NULL, queue.Pop());
+}
+
+TEST(MPSCQueueTest, ManyProducers) {
+  const int kProducers = 4;
+  const int kPerProducer = 100000;
+  std::vector<Node> nodes(kProducers * kPerProducer);
+  MPSCQueue<Node> queue;
+
+  std::vector<Producer*> producers;
+  std::vector<DelegateSimpleThread*> threads;
+  for (int p = 0; p < kProducers; ++p) {
+    Node* first = &nodes[p * kPerProducer];
+    for (int i = 0; i < kPerProducer; ++i) {
+      first[i].producer = p;
+      first[i].sequence = i;
+    }
+    producers.push_back(new Producer(&queue, first, kPerProducer));
+    threads.push_back(new DelegateSimpleThread(producers.back(), "producer"));
+    threads.back()->Start();
+  }
+
+  // Each producer's nodes come out in the order it pushed them.
+  std::vector<int> next(kProducers, 0);
+  int popped = 0;
+  while (popped < kProducers * kPerProducer) {
+    Node* node = queue.Pop();
+    if (!node)
+      continue;
+    ASSERT_EQ(next[node->producer], node->sequence);
+    ++next[node->producer];
+    ++popped;
+  }
+  EXPECT_EQ(NULL, queue.Pop());
+
+  for (int p = 0; p < kProducers; ++p) {
+    threads[p]->Join();
+    delete threads[p];
+    delete producers[p];
+  }
+}
+
+}  // namespace
+}  // namespace base
@@ -0,0 +1,182 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Throughput of the lock-free queues against a Lock around a std::queue,
+// with varying numbers of producer and consumer threads.
+
+#include <queue>
+#include <vector>
+
+#include "base/containers/bounded_mpmc_queue.h"
+#include "base/containers/mpsc_queue.h"
+#include "base/memory/scoped_vector.h"
+#include "base/strings/stringprintf.h"
+#include "base/synchronization/lock.h"
+#include "base/test/perf_log.h"
+#include "base/threading/platform_thread.h"
+#include "base/threading/simple_thread.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+const int kItems = 2000000;
+
+struct Item : public MPSCQueueNode<Item> {
+  Item() : stop(false) {}
+
+  // Tells the consumer which pops it to return.
+  bool stop;
+};
+
+// The queues, with the same interface: Push() returns false if full, and
+// Pop() returns NULL if empty.
+class LockedQueue {
+ public:
+  bool Push(Item* item) {
+    AutoLock lock(lock_);
+    queue_.push(item);
+    return true;
+  }
+
+  Item* Pop() {
+    AutoLock lock(lock_);
+    if (queue_.empty())
+      return NULL;
+    Item* item = queue_.front();
+    queue_.pop();
+    return item;
+  }
+
+ private:
+  Lock lock_;
+  std::queue<Item*> queue_;
+};
+
+class RingQueue {
+ public:
+  RingQueue() : queue_(1024) {}
+
+  bool Push(Item* item) { return queue_.TryPush(item); }
+
+  Item* Pop() {
+    Item* item;
+    return queue_.TryPop(&item) ? item : NULL;
+  }
+
+ private:
+  BoundedMPMCQueue<Item*> queue_;
+};
+
+class IntrusiveQueue {
+ public:
+  bool Push(Item* item) {
+    queue_.Push(item);
+    return true;
+  }
+
+  Item* Pop() { return queue_.Pop(); }
+
+ private:
+  MPSCQueue<Item> queue_;
+};
+
+template <typename Queue>
+class Producer : public DelegateSimpleThread::Delegate {
+ public:
+  Producer(Queue* queue, int count) : queue_(queue), items_(count) {}
+
+  virtual void Run() OVERRIDE {
+    for (size_t i = 0; i < items_.size(); ++i) {
+      while (!queue_->Push(&items_[i]))
+        PlatformThread::YieldCurrentThread();
+    }
+  }
+
+ private:
+  Queue* queue_;
+  std::vector<Item> items_;
+};
+
+template <typename Queue>
+class Consumer : public DelegateSimpleThread::Delegate {
+ public:
+  explicit Consumer(Queue* queue) : queue_(queue) {}
+
+  virtual void Run() OVERRIDE {
+    for (;;) {
+      Item* item = queue_->Pop();
+      if (!item)
+        PlatformThread::YieldCurrentThread();
+      else if (item->stop)
+        return;
+    }
+  }
+
+ private:
+  Queue* queue_;
+};
+
+template <typename Queue>
+void RunQueue(const char* name, int producers, int consumers) {
+  Queue queue;
+  ScopedVector<DelegateSimpleThread::Delegate> delegates;
+  ScopedVector<DelegateSimpleThread> producer_threads;
+  ScopedVector<DelegateSimpleThread> consumer_threads;
+  for (int i = 0; i < producers; ++i) {
+    delegates.push_back(new Producer<Queue>(&queue, kItems / producers));
+    producer_threads.push_back(
+        new DelegateSimpleThread(delegates.back(), "producer"));
+  }
+  for (int i = 0; i < consumers; ++i) {
+    delegates.push_back(new Consumer<Queue>(&queue));
+    consumer_threads.push_back(
+        new DelegateSimpleThread(delegates.back(), "consumer"));
+  }
+
+  const TimeTicks start = TimeTicks::Now();
+  for (size_t i = 0; i < consumer_threads.size(); ++i)
+    consumer_threads[i]->Start();
+  for (size_t i = 0; i < producer_threads.size(); ++i)
+    producer_threads[i]->Start();
+  for (size_t i = 0; i < producer_threads.size(); ++i)
+    producer_threads[i]->Join();
+  // The queues are FIFO, so the stops come after every item.
+  std::vector<Item> stops(consumers);
+  for (int i = 0; i < consumers; ++i) {
+    stops[i].stop = true;
+    while (!queue.Push(&stops[i]))
+      PlatformThread::YieldCurrentThread();
+  }
+  for (size_t i = 0; i < consumer_threads.size(); ++i)
+    consumer_threads[i]->Join();
+  const TimeDelta elapsed = TimeTicks::Now() - start;
+
+  LogPerfResult(StringPrintf("queue_%s_%dp_%dc", name, producers,
+                             consumers).c_str(),
+                kItems / elapsed.InSecondsF(), "items/s");
+}
+
+}  // namespace
+
+TEST(QueuePerfTest, SingleConsumer) {
+  const int kProducers[] = { 1, 2, 4, 8 };
+  for (size_t i = 0; i < arraysize(kProducers); ++i) {
+    RunQueue<LockedQueue>("locked", kProducers[i], 1);
+    RunQueue<IntrusiveQueue>("mpsc", kProducers[i], 1);
+    RunQueue<RingQueue>("mpmc", kProducers[i], 1);
+  }
+}
+
+TEST(QueuePerfTest, ManyConsumers) {
+  const int kThreads[][2] = { { 1, 2 }, { 2, 2 }, { 4, 4 }, { 1, 8 } };
+  for (size_t i = 0; i < arraysize(kThreads); ++i) {
+    RunQueue<LockedQueue>("locked", kThreads[i][0], kThreads[i][1]);
+    RunQueue<RingQueue>("mpmc", kThreads[i][0], kThreads[i][1]);
+  }
+}
+
+}  // namespace base
@@ -0,0 +1,439 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/debug/elf_symbolizer_linux.h"
+
+#include <elf.h>
+#include <link.h>
+
+#include <algorithm>
+
+#if defined(__GLIBCXX__)
+#include <cxxabi.h>
+#endif
+
+#include "base/files/file_path.h"
+#include "base/files/memory_mapped_file.h"
+#include "base/format_macros.h"
+#include "base/logging.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/stl_util.h"
+#include "base/strings/stringprintf.h"
+
+namespace base {
+namespace debug {
+
+namespace {
+
+#if __WORDSIZE == 64
+const unsigned char kElfClass = ELFCLASS64;
+#define ELFW_ST_TYPE ELF64_ST_TYPE
+#else
+const unsigned char kElfClass = ELFCLASS32;
+#define ELFW_ST_TYPE ELF32_ST_TYPE
+#endif
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// ElfSymbolizer::Module
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// The function symbols of one ELF file, sorted by address. The names point
+// into the mapped file, which stays mapped for the lifetime of the module.
+class ElfSymbolizer::Module {
+ public:
+  struct Symbol {
+    uintptr_t address;
+    uintptr_t size;
+    const char* name;
+
+    bool operator<(const Symbol& other) const {
+      return address < other.address;
+    }
+  };
+
+  explicit Module(const std::string& path) : path_(path) {}
+
+  // Maps the file and reads its symbols. Returns false if it isn't an ELF
+  // file of this architecture.
+  bool Load();
+
+  const std::string& path() const { return path_; }
+
+  // Converts an offset into the file into the address it was linked at.
+  bool OffsetToAddress(uintptr_t offset, uintptr_t* address) const;
+
+  // Returns the symbol holding the link-time |address|, or NULL.
+  const Symbol* FindSymbol(uintptr_t address) const;
+
+ private:
+  struct Segment {
+    uintptr_t offset;
+    uintptr_t address;
+    uintptr_t size;
+  };
+
+  template <typename T>
+  const T* At(uintptr_t offset, size_t count) const {
+    if (offset > file_.length() ||
+        count > (file_.length() - offset) / sizeof(T)) {
+      return NULL;
+    }
+    return reinterpret_cast<const T*>(file_.data() + offset);
+  }
+
+  void ReadSymbolTable(const ElfW(Shdr)* sections,
+                       size_t num_sections,
+                       const ElfW(Shdr)& table);
+
+  std::string path_;
+  MemoryMappedFile file_;
+  std::vector<Segment> segments_;
+  std::vector<Symbol> symbols_;
+
+  DISALLOW_COPY_AND_ASSIGN(Module);
+};
+
+bool ElfSymbolizer::Module::Load() {
+  if (!file_.Initialize(FilePath(path_)))
+    return false;
+
+  const ElfW(Ehdr)* header = At<ElfW(Ehdr)>(0, 1);
+  if (!header || memcmp(header->e_ident, ELFMAG, SELFMAG) != 0 ||
+      header->e_ident[EI_CLASS] != kElfClass ||
+      header->e_phentsize != sizeof(ElfW(Phdr)) ||
+      (header->e_shnum && header->e_shentsize != sizeof(ElfW(Shdr)))) {
+    return false;
+  }
+
+  const ElfW(Phdr)* program_headers =
+      At<ElfW(Phdr)>(header->e_phoff, header->e_phnum);
+  if (!program_headers)
+    return false;
+  for (size_t i = 0; i < header->e_phnum; ++i) {
+    if (program_headers[i].p_type != PT_LOAD)
+      continue;
+    Segment segment;
+    segment.offset = program_headers[i].p_offset;
+    segment.address = program_headers[i].p_vaddr;
+    segment.size = program_headers[i].p_filesz;
+    segments_.push_back(segment);
+  }
+
+  // Stripped binaries only have .dynsym, others have .symtab as well. Read
+  // both; the duplicates are removed below.
+  const ElfW(Shdr)* sections =
+      At<ElfW(Shdr)>(header->e_shoff, header->e_shnum);
+  if (sections) {
+    for (size_t i = 0; i < header->e_shnum; ++i) {
+      if (sections[i].sh_type == SHT_SYMTAB ||
+          sections[i].sh_type == SHT_DYNSYM) {
+        ReadSymbolTable(sections, header->e_shnum, sections[i]);
+      }
+    }
+  }
+
+  std::sort(symbols_.begin(), symbols_.end());
+  // Keep one symbol per address, the one with a size if any.
+  size_t kept = 0;
+  for (size_t i = 0; i < symbols_.size(); ++i) {
+    if (kept && symbols_[kept - 1].address == symbols_[i].address) {
+      if (!symbols_[kept - 1].size)
+        symbols_[kept - 1] = symbols_[i];
+      continue;
+    }
+    symbols_[kept++] = symbols_[i];
+  }
+  symbols_.resize(kept);
+  return true;
+}
+
+void ElfSymbolizer::Module::ReadSymbolTable(const ElfW(Shdr)* sections,
+                                            size_t num_sections,
+                                            const ElfW(Shdr)& table) {
+  if (table.sh_entsize != sizeof(ElfW(Sym)) || table.sh_link >= num_sections)
+    return;
+  const ElfW(Shdr)& string_table = sections[table.sh_link];
+  const ElfW(Sym)* symbols = At<ElfW(Sym)>(
+      table.sh_offset, table.sh_size / sizeof(ElfW(Sym)));
+  const char* strings = At<char>(string_table.sh_offset, string_table.sh_size);
+  if (!symbols || !strings || !string_table.sh_size ||
+      strings[string_table.sh_size - 1] != '\0') {
+    return;
+  }
+
+  size_t count = table.sh_size / sizeof(ElfW(Sym));
+  for (size_t i = 0; i < count; ++i) {
+    const ElfW(Sym)& symbol = symbols[i];
+    if (ELFW_ST_TYPE(symbol.st_info) != STT_FUNC ||
+        symbol.st_shndx == SHN_UNDEF || !symbol.st_value ||
+        symbol.st_name >= string_table.sh_size) {
+      continue;
+    }
+    Symbol entry;
+    entry.address = symbol.st_value;
+    entry.size = symbol.st_size;
+    entry.name = strings + symbol.st_name;
+    symbols_.push_back(entry);
+  }
+}
+
+bool ElfSymbolizer::Module::OffsetToAddress(uintptr_t offset,
+                                            uintptr_t* address) const {
+  for (size_t i = 0; i < segments_.size(); ++i) {
+    if (offset >= segments_[i].offset &&
+        offset - segments_[i].offset < segments_[i].size) {
+      *address = offset - segments_[i].offset + segments_[i].address;
+      return true;
+    }
+  }
+  return false;
+}
+
+const ElfSymbolizer::Module::Symbol* ElfSymbolizer::Module::FindSymbol(
+    uintptr_t address) const {
+  Symbol key;
+  key.address = address;
+  std::vector<Symbol>::const_iterator it =
+      std::upper_bound(symbols_.begin(), symbols_.end(), key);
+  if (it == symbols_.begin())
+    return NULL;
+  --it;
+  // Symbols without a size extend to the next symbol.
+  if (it->size && address - it->address >= it->size)
+    return NULL;
+  return &*it;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// ElfSymbolizer
+//
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+bool CompareRegionStartAddress(const MappedMemoryRegion& a,
+                               const MappedMemoryRegion& b) {
+  return a.start < b.start;
+}
+
+// Sorts by address, to visit the addresses of a batch in order.
+struct CompareAddressesAt {
+  explicit CompareAddressesAt(const uintptr_t* addresses)
+      : addresses(addresses) {
+  }
+  bool operator()(size_t a, size_t b) const {
+    return addresses[a] < addresses[b];
+  }
+  const uintptr_t* addresses;
+};
+
+}  // namespace
+
+ElfSymbolizer::Frame::Frame()
+    : address(0),
+      module(NULL),
+      module_offset(0),
+      symbol(NULL),
+      symbol_offset(0) {
+}
+
+ElfSymbolizer::ElfSymbolizer() : current_process_(true) {
+  ReadCurrentProcessRegions();
+}
+
+ElfSymbolizer::ElfSymbolizer(const std::vector<MappedMemoryRegion>& regions)
+    : current_process_(false) {
+  SetRegions(regions);
+}
+
+ElfSymbolizer::~ElfSymbolizer() {
+  STLDeleteValues(&modules_);
+}
+
+bool ElfSymbolizer::Symbolize(uintptr_t address, Frame* frame) {
+  CodeRegion* region = FindRegion(address);
+  if (!region && current_process_) {
+    // Maybe in a library loaded since the map was read.
+    ReadCurrentProcessRegions();
+    region = FindRegion(address);
+  }
+  if (region)
+    LoadModule(region);
+  return Lookup(region, address, frame);
+}
+
+void ElfSymbolizer::SymbolizeBatch(const uintptr_t* addresses,
+                                   size_t count,
+                                   Frame* frames) {
+  std::vector<size_t> order(count);
+  for (size_t i = 0; i < count; ++i)
+    order[i] = i;
+  std::sort(order.begin(), order.end(), CompareAddressesAt(addresses));
+
+  // Reread the memory map at most once for the whole batch.
+  if (current_process_) {
+    for (size_t i = 0; i < count; ++i) {
+      if (!FindRegion(addresses[i])) {
+        ReadCurrentProcessRegions();
+        break;
+      }
+    }
+  }
+
+  // Walk the sorted addresses and the sorted regions together.
+  size_t next_region = 0;
+  for (size_t i = 0; i < count; ++i) {
+    uintptr_t address = addresses[order[i]];
+    while (next_region < regions_.size() &&
+           regions_[next_region].end <= address) {
+      ++next_region;
+    }
+    CodeRegion* region = NULL;
+    if (next_region < regions_.size() &&
+        regions_[next_region].start <= address) {
+      region = &regions_[next_region];
+      LoadModule(region);
+    }
+    Lookup(region, address, &frames[order[i]]);
+  }
+}
+
+bool ElfSymbolizer::SymbolizeIfLoaded(uintptr_t address, Frame* frame) const {
+  return Lookup(FindRegion(address), address, frame);
+}
+
+void ElfSymbolizer::LoadAllModules() {
+  if (current_process_)
+    ReadCurrentProcessRegions();
+  for (size_t i = 0; i < regions_.size(); ++i)
+    LoadModule(&regions_[i]);
+}
+
+// static
+std::string ElfSymbolizer::FormatFrame(const Frame& frame) {
+  std::string result = frame.module ? frame.module : "";
+  if (frame.symbol) {
+    result += "(";
+    result += Demangle(frame.symbol);
+    StringAppendF(&result, "+0x%" PRIxPTR ")", frame.symbol_offset);
+  } else if (frame.module) {
+    StringAppendF(&result, "(+0x%" PRIxPTR ")", frame.module_offset);
+  }
+  StringAppendF(&result, " [0x%" PRIxPTR "]", frame.address);
+  return result;
+}
+
+// static
+std::string ElfSymbolizer::Demangle(const char* symbol) {
+#if defined(__GLIBCXX__)
+  int status = 0;
+  scoped_ptr_malloc<char> demangled(
+      abi::__cxa_demangle(symbol, NULL, 0, &status));
+  if (status == 0 && demangled.get())
+    return demangled.get();
+#endif
+  return symbol;
+}
+
+void ElfSymbolizer::ReadCurrentProcessRegions() {
+  std::string proc_maps;
+  std::vector<MappedMemoryRegion> regions;
+  // A partially parsed map is still better than none.
+  if (ReadProcMaps(&proc_maps))
+    ParseProcMaps(proc_maps, &regions);
+  SetRegions(regions);
+}
+
+void ElfSymbolizer::SetRegions(const std::vector<MappedMemoryRegion>& regions) {
+  std::vector<MappedMemoryRegion> sorted;
+  for (size_t i = 0; i < regions.size(); ++i) {
+    if (regions[i].permissions & MappedMemoryRegion::EXECUTE)
+      sorted.push_back(regions[i]);
+  }
+  std::sort(sorted.begin(), sorted.end(), CompareRegionStartAddress);
+
+  regions_.clear();
+  for (size_t i = 0; i < sorted.size(); ++i) {
+    CodeRegion region;
+    region.start = sorted[i].start;
+    region.end = sorted[i].end;
+    region.offset = sorted[i].offset;
+    region.path = sorted[i].path;
+    std::map<std::string, Module*>::const_iterator it =
+        modules_.find(region.path);
+    region.module = it != modules_.end() ? it->second : NULL;
+    regions_.push_back(region);
+  }
+}
+
+ElfSymbolizer::CodeRegion* ElfSymbolizer::FindRegion(uintptr_t address) {
+  return const_cast<CodeRegion*>(
+      static_cast<const ElfSymbolizer*>(this)->FindRegion(address));
+}
+
+const ElfSymbolizer::CodeRegion* ElfSymbolizer::FindRegion(
+    uintptr_t address) const {
+  size_t low = 0;
+  size_t high = regions_.size();
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (address < regions_[middle].start)
+      high = middle;
+    else if (address >= regions_[middle].end)
+      low = middle + 1;
+    else
+      return &regions_[middle];
+  }
+  return NULL;
+}
+
+void ElfSymbolizer::LoadModule(CodeRegion* region) {
+  // Anonymous and pseudo regions like [vdso] have no file to read.
+  if (region->module || region->path.empty() || region->path[0] != '/')
+    return;
+
+  Module*& module = modules_[region->path];
+  if (!module) {
+    module = new Module(region->path);
+    if (!module->Load())
+      DLOG(WARNING) << "No symbols for " << region->path;
+  }
+  region->module = module;
+}
+
+bool ElfSymbolizer::Lookup(const CodeRegion* region,
+                           uintptr_t address,
+                           Frame* frame) const {
+  *frame = Frame();
+  frame->address = address;
+  if (!region)
+    return false;
+
+  uintptr_t offset = address - region->start + region->offset;
+  frame->module_offset = offset;
+  const Module* module = region->module;
+  if (!module)
+    return false;
+
+  frame->module = module->path().c_str();
+  uintptr_t link_address;
+  if (!module->OffsetToAddress(offset, &link_address))
+    return false;
+  frame->module_offset = link_address;
+
+  const Module::Symbol* symbol = module->FindSymbol(link_address);
+  if (!symbol)
+    return false;
+  frame->symbol = symbol->name;
+  frame->symbol_offset = link_address - symbol->address;
+  return true;
+}
+
+}  // namespace debug
+}  // namespace base
@@ -0,0 +1,123 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_DEBUG_ELF_SYMBOLIZER_LINUX_H_
+#define BASE_DEBUG_ELF_SYMBOLIZER_LINUX_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/debug/proc_maps_linux.h"
+
+namespace base {
+namespace debug {
+
+// Resolves code addresses to function names using the ELF symbol tables of
+// the mapped modules. Each module is mapped and its .symtab and .dynsym are
+// read, sorted and cached the first time one of its addresses is looked up;
+// later lookups in that module are binary searches.
+//
+// Lookups in modules already loaded neither allocate nor open files, see
+// SymbolizeIfLoaded(). Not thread-safe.
+class BASE_EXPORT ElfSymbolizer {
+ public:
+  struct Frame {
+    Frame();
+
+    uintptr_t address;
+
+    // Path of the file mapped at |address|, or NULL if there is none. Owned
+    // by the symbolizer.
+    const char* module;
+
+    // |address| relative to |module| as accepted by addr2line: its link-time
+    // address if the module could be read, otherwise its file offset.
+    uintptr_t module_offset;
+
+    // The mangled name of the function holding |address|, or NULL if it isn't
+    // known. Owned by the symbolizer.
+    const char* symbol;
+    uintptr_t symbol_offset;
+  };
+
+  // Symbolizes addresses of the current process, whose memory map is read
+  // now and again whenever an address outside of it is looked up.
+  ElfSymbolizer();
+
+  // Symbolizes addresses of the process that had |regions| mapped, e.g. as
+  // parsed from a /proc/<pid>/maps saved with a profile. The modules must
+  // still exist at the same paths.
+  explicit ElfSymbolizer(const std::vector<MappedMemoryRegion>& regions);
+
+  ~ElfSymbolizer();
+
+  // Resolves |address|, loading the symbols of its module if needed. Returns
+  // false if no symbol holds |address|; |frame| still has the module then.
+  bool Symbolize(uintptr_t address, Frame* frame);
+
+  // Resolves |count| addresses into |frames|. Faster than calling Symbolize()
+  // for each when they are many: the addresses are sorted, so every region is
+  // looked up and every module loaded once.
+  void SymbolizeBatch(const uintptr_t* addresses, size_t count, Frame* frames);
+
+  // Like Symbolize(), but never loads a module and never rereads the memory
+  // map, returning false instead. Async-signal-safe.
+  bool SymbolizeIfLoaded(uintptr_t address, Frame* frame) const;
+
+  // Loads the symbols of every executable region, so that SymbolizeIfLoaded()
+  // finds everything mapped so far.
+  void LoadAllModules();
+
+  // Returns "module(symbol+0xoffset) [0xaddress]", the format of
+  // backtrace_symbols(), with the symbol demangled.
+  static std::string FormatFrame(const Frame& frame);
+
+  // Returns the demangled |symbol|, or |symbol| if it isn't a mangled name.
+  static std::string Demangle(const char* symbol);
+
+ private:
+  class Module;
+
+  // An executable region with the module it maps.
+  struct CodeRegion {
+    uintptr_t start;
+    uintptr_t end;
+    unsigned long long offset;
+    std::string path;
+    // NULL until loaded. Points into |modules_|.
+    Module* module;
+  };
+
+  void ReadCurrentProcessRegions();
+  void SetRegions(const std::vector<MappedMemoryRegion>& regions);
+
+  // Returns the region holding |address|, or NULL.
+  CodeRegion* FindRegion(uintptr_t address);
+  const CodeRegion* FindRegion(uintptr_t address) const;
+
+  // Loads the module of |region| unless already attempted.
+  void LoadModule(CodeRegion* region);
+
+  bool Lookup(const CodeRegion* region, uintptr_t address, Frame* frame) const;
+
+  // Whether regions are reread when an address isn't found in any.
+  bool current_process_;
+
+  // Sorted by start address.
+  std::vector<CodeRegion> regions_;
+
+  // Modules by path, including those that failed to load. Kept across
+  // rereads of the memory map.
+  std::map<std::string, Module*> modules_;
+
+  DISALLOW_COPY_AND_ASSIGN(ElfSymbolizer);
+};
+
+}  // namespace debug
+}  // namespace base
+
+#endif  // BASE_DEBUG_ELF_SYMBOLIZER_LINUX_H_
@@ -0,0 +1,127 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/debug/elf_symbolizer_linux.h"
+
+#include <stdlib.h>
+
+#include "base/compiler_specific.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace debug {
+
+// Not in an anonymous namespace, so that the symbol is easy to recognize.
+NOINLINE int ElfSymbolizerTestFunction(int value) {
+  return value * 3 + 1;
+}
+
+namespace {
+
+uintptr_t TestFunctionAddress() {
+  return reinterpret_cast<uintptr_t>(&ElfSymbolizerTestFunction);
+}
+
+}  // namespace
+
+TEST(ElfSymbolizerTest, Symbolize) {
+  ElfSymbolizer symbolizer;
+  ElfSymbolizer::Frame frame;
+  ASSERT_TRUE(symbolizer.Symbolize(TestFunctionAddress() + 1, &frame));
+  EXPECT_EQ(TestFunctionAddress() + 1, frame.address);
+  ASSERT_TRUE(frame.module);
+  ASSERT_TRUE(frame.symbol);
+  EXPECT_EQ("base::debug::ElfSymbolizerTestFunction(int)",
+            ElfSymbolizer::Demangle(frame.symbol));
+  EXPECT_EQ(1u, frame.symbol_offset);
+
+  // A function of a shared library.
+  ASSERT_TRUE(symbolizer.Symbolize(reinterpret_cast<uintptr_t>(&abort),
+                                   &frame));
+  EXPECT_STREQ("abort", frame.symbol);
+}
+
+TEST(ElfSymbolizerTest, UnknownAddress) {
+  ElfSymbolizer symbolizer;
+  ElfSymbolizer::Frame frame;
+  EXPECT_FALSE(symbolizer.Symbolize(16, &frame));
+  EXPECT_EQ(16u, frame.address);
+  EXPECT_FALSE(frame.module);
+  EXPECT_FALSE(frame.symbol);
+  EXPECT_EQ(" [0x10]", ElfSymbolizer::FormatFrame(frame));
+}
+
+TEST(ElfSymbolizerTest, BatchMatchesSingleLookups) {
+  const uintptr_t addresses[] = {
+    reinterpret_cast<uintptr_t>(&abort),
+    TestFunctionAddress() + 2,
+    16,
+    TestFunctionAddress(),
+    reinterpret_cast<uintptr_t>(&malloc),
+  };
+  const size_t kCount = arraysize(addresses);
+  ElfSymbolizer::Frame frames[kCount];
+  ElfSymbolizer batch_symbolizer;
+  batch_symbolizer.SymbolizeBatch(addresses, kCount, frames);
+
+  ElfSymbolizer symbolizer;
+  for (size_t i = 0; i < kCount; ++i) {
+    ElfSymbolizer::Frame frame;
+    symbolizer.Symbolize(addresses[i], &frame);
+    EXPECT_EQ(frame.address, frames[i].address);
+    EXPECT_EQ(ElfSymbolizer::FormatFrame(frame),
+              ElfSymbolizer::FormatFrame(frames[i]));
+  }
+}
+
+TEST(ElfSymbolizerTest, SymbolizeIfLoaded) {
+  ElfSymbolizer symbolizer;
+  ElfSymbolizer::Frame frame;
+  EXPECT_FALSE(symbolizer.SymbolizeIfLoaded(TestFunctionAddress(), &frame));
+  EXPECT_FALSE(frame.symbol);
+
+  symbolizer.LoadAllModules();
+  ASSERT_TRUE(symbolizer.SymbolizeIfLoaded(TestFunctionAddress(), &frame));
+  EXPECT_EQ("base::debug::ElfSymbolizerTestFunction(int)",
+            ElfSymbolizer::Demangle(frame.symbol));
+  EXPECT_EQ(0u, frame.symbol_offset);
+}
+
+TEST(ElfSymbolizerTest, SavedRegions) {
+  std::string proc_maps;
+  ASSERT_TRUE(ReadProcMaps(&proc_maps));
+  std::vector<MappedMemoryRegion> regions;
+  ASSERT_TRUE(ParseProcMaps(proc_maps, &regions));
+
+  ElfSymbolizer symbolizer(regions);
+  ElfSymbolizer::Frame frame;
+  ASSERT_TRUE(symbolizer.Symbolize(TestFunctionAddress(), &frame));
+  EXPECT_EQ("base::debug::ElfSymbolizerTestFunction(int)",
+            ElfSymbolizer::Demangle(frame.symbol));
+
+  // Addresses outside of the saved regions are not resolved.
+  ElfSymbolizer empty_symbolizer((std::vector<MappedMemoryRegion>()));
+  EXPECT_FALSE(empty_symbolizer.Symbolize(TestFunctionAddress(), &frame));
+}
+
+TEST(ElfSymbolizerTest, FormatFrame) {
+  ElfSymbolizer symbolizer;
+  ElfSymbolizer::Frame frame;
+  ASSERT_TRUE(symbolizer.Symbolize(TestFunctionAddress() + 4, &frame));
+  std::string formatted = ElfSymbolizer::FormatFrame(frame);
+  EXPECT_NE(std::string::npos,
+            formatted.find("(base::debug::ElfSymbolizerTestFunction(int)"
+                           "+0x4) [0x"));
+  EXPECT_EQ(0u, formatted.find(frame.module));
+}
+
+TEST(ElfSymbolizerTest, Demangle) {
+  EXPECT_EQ("base::debug::ElfSymbolizerTestFunction(int)",
+            ElfSymbolizer::Demangle(
+                "_ZN4base5debug25ElfSymbolizerTestFunctionEi"));
+  EXPECT_EQ("abort", ElfSymbolizer::Demangle("abort"));
+}
+
+}  // namespace debug
+}  // namespace base
@@ -16,6 +16,10 @@
 
 #if defined(ENABLE_PROFILING) && !defined(NO_TCMALLOC)
 #include "third_party/tcmalloc/chromium/src/gperftools/profiler.h"
+#elif defined(ENABLE_PROFILING) && defined(OS_LINUX)
+#include "base/debug/sampling_profiler_linux.h"
+#include "base/files/file_path.h"
+#include "base/lazy_instance.h"
 #endif
 
 namespace base {
@@ -52,6 +56,52 @@ void RestartProfilingAfterFork() {
   ProfilerRegisterThread();
 }
 
+#elif defined(ENABLE_PROFILING) && defined(OS_LINUX)
+
+// Without tcmalloc, fall back to the built-in SamplingProfiler.
+
+static int profile_count = 0;
+
+// The file the running profile is written to by StopProfiling().
+static LazyInstance<std::string>::Leaky profile_name =
+    LAZY_INSTANCE_INITIALIZER;
+
+const int kProfilingIntervalMs = 10;
+
+void StartProfiling(const std::string& name) {
+  ++profile_count;
+  std::string full_name(name);
+  std::string pid = StringPrintf("%d", GetCurrentProcId());
+  std::string count = StringPrintf("%d", profile_count);
+  ReplaceSubstringsAfterOffset(&full_name, 0, "{pid}", pid);
+  ReplaceSubstringsAfterOffset(&full_name, 0, "{count}", count);
+  profile_name.Get() = full_name;
+  SamplingProfiler::GetInstance()->Start(
+      SamplingProfiler::PROCESS_CPU_TIME,
+      TimeDelta::FromMilliseconds(kProfilingIntervalMs),
+      SamplingProfiler::kDefaultMaxSamples);
+}
+
+void StopProfiling() {
+  SamplingProfiler* profiler = SamplingProfiler::GetInstance();
+  if (!profiler->IsRunning())
+    return;
+  profiler->Stop();
+  profiler->WritePprofProfile(FilePath(profile_name.Get()));
+}
+
+void FlushProfiling() {
+  // Samples can only be read once the profiler is stopped.
+}
+
+bool BeingProfiled() {
+  return SamplingProfiler::GetInstance()->IsRunning();
+}
+
+void RestartProfilingAfterFork() {
+  // Interval timers aren't inherited by the child, which isn't profiled.
+}
+
 #else
 
 void StartProfiling(const std::string& name) {
@@ -13,7 +13,8 @@
 // The Profiler functions allow usage of the underlying sampling based
 // profiler. If the application has not been built with the necessary
 // flags (-DENABLE_PROFILING and not -DNO_TCMALLOC) then these functions
-// are noops.
+// are noops, except on Linux where -DENABLE_PROFILING -DNO_TCMALLOC uses the
+// built-in SamplingProfiler.
 namespace base {
 namespace debug {
 
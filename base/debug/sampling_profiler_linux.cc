@@ -0,0 +1,441 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/debug/sampling_profiler_linux.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <ucontext.h>
+
+#include <algorithm>
+
+#include "base/debug/elf_symbolizer_linux.h"
+#include "base/debug/proc_maps_linux.h"
+#include "base/file_util.h"
+#include "base/files/file_path.h"
+#include "base/format_macros.h"
+#include "base/logging.h"
+#include "base/memory/singleton.h"
+#include "base/strings/stringprintf.h"
+
+// Older glibc headers don't name the thread id of SIGEV_THREAD_ID.
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+namespace base {
+namespace debug {
+
+namespace {
+
+// Largest distance accepted between two consecutive frame pointers. Anything
+// further apart is assumed to be a register that doesn't hold a frame pointer
+// rather than a huge frame.
+const uintptr_t kMaxFrameSize = 100000;
+
+// Set by the first Start(), for the signal handler.
+SamplingProfiler* g_profiler = NULL;
+
+// Bounds of the stack of this thread, recorded by RegisterCurrentThread() for
+// the signal handler, which can't look them up itself. |t_stack_high| is 0
+// while the thread isn't registered. __thread, unlike pthread keys, is safe to
+// read in a signal handler.
+__thread uintptr_t t_stack_low __attribute__((tls_model("initial-exec")));
+__thread uintptr_t t_stack_high __attribute__((tls_model("initial-exec")));
+
+void RecordStackBounds() {
+  pthread_attr_t attr;
+  if (pthread_getattr_np(pthread_self(), &attr) != 0)
+    return;
+  void* stack_address = NULL;
+  size_t stack_size = 0;
+  if (pthread_attr_getstack(&attr, &stack_address, &stack_size) == 0) {
+    t_stack_low = reinterpret_cast<uintptr_t>(stack_address);
+    t_stack_high = t_stack_low + stack_size;
+  }
+  pthread_attr_destroy(&attr);
+}
+
+// Extracts the pc, frame pointer and stack pointer of the interrupted thread.
+// Returns false on architectures without a frame pointer convention we know.
+bool GetRegisters(const void* ucontext,
+                  uintptr_t* pc,
+                  uintptr_t* fp,
+                  uintptr_t* sp) {
+  const mcontext_t& context =
+      static_cast<const ucontext_t*>(ucontext)->uc_mcontext;
+#if defined(ARCH_CPU_X86_64)
+  *pc = context.gregs[REG_RIP];
+  *fp = context.gregs[REG_RBP];
+  *sp = context.gregs[REG_RSP];
+  return true;
+#elif defined(ARCH_CPU_X86)
+  *pc = context.gregs[REG_EIP];
+  *fp = context.gregs[REG_EBP];
+  *sp = context.gregs[REG_ESP];
+  return true;
+#elif defined(ARCH_CPU_ARM64)
+  *pc = context.pc;
+  *fp = context.regs[29];
+  *sp = context.sp;
+  return true;
+#else
+  return false;
+#endif
+}
+
+// Returns true if a frame, the saved frame pointer and return address, can be
+// read at |fp| without leaving the stack of the thread.
+bool IsOnStack(uintptr_t fp, uintptr_t stack_low, uintptr_t stack_high) {
+  return fp >= stack_low && fp < stack_high &&
+         stack_high - fp >= 2 * sizeof(uintptr_t) &&
+         !(fp & (sizeof(uintptr_t) - 1));
+}
+
+// Returns true if |next| can be the frame pointer of the caller of the frame
+// at |fp|: stacks grow down, so it must be above it.
+bool IsCallerFrame(uintptr_t fp, uintptr_t next) {
+  return next > fp && next - fp <= kMaxFrameSize;
+}
+
+// Async-signal-safe. Writes the pc and the return addresses found by
+// following the frame pointer chain to |frames|, returns the number written.
+// The chain is only followed on registered threads, and never off their
+// stack: in code built without frame pointers the register holds anything.
+int UnwindStack(const void* ucontext, uintptr_t* frames, int max_depth) {
+  uintptr_t pc, fp, sp;
+  if (!GetRegisters(ucontext, &pc, &fp, &sp))
+    return 0;
+
+  int depth = 0;
+  frames[depth++] = pc;
+  // The frame pointer of the interrupted function must lie on the live part
+  // of its stack. If it doesn't, the function doesn't keep one and nothing
+  // more can be found.
+  const uintptr_t stack_high = t_stack_high;
+  const uintptr_t stack_low = std::max(t_stack_low, sp);
+  if (!stack_high || !IsOnStack(fp, stack_low, stack_high))
+    return depth;
+
+  while (depth < max_depth) {
+    const uintptr_t* frame = reinterpret_cast<const uintptr_t*>(fp);
+    uintptr_t next = frame[0];
+    uintptr_t return_address = frame[1];
+    if (!return_address)
+      break;
+    frames[depth++] = return_address;
+    if (!IsCallerFrame(fp, next) || !IsOnStack(next, stack_low, stack_high))
+      break;
+    fp = next;
+  }
+  return depth;
+}
+
+// Appends the function of |frame|, or its module and offset if the function
+// isn't known. Semicolons separate frames in folded stacks, so C++ names
+// can't contain any.
+void AppendFrame(const ElfSymbolizer::Frame& frame, std::string* out) {
+  if (frame.symbol) {
+    std::string name = ElfSymbolizer::Demangle(frame.symbol);
+    std::replace(name.begin(), name.end(), ';', ':');
+    *out += name;
+  } else if (frame.module) {
+    *out += FilePath(frame.module).BaseName().value();
+    StringAppendF(out, "+0x%" PRIxPTR, frame.module_offset);
+  } else {
+    StringAppendF(out, "0x%" PRIxPTR, frame.address);
+  }
+}
+
+}  // namespace
+
+// static
+SamplingProfiler* SamplingProfiler::GetInstance() {
+  return Singleton<SamplingProfiler,
+                   LeakySingletonTraits<SamplingProfiler> >::get();
+}
+
+SamplingProfiler::SamplingProfiler()
+    : mode_(PROCESS_CPU_TIME),
+      handler_installed_(false),
+      running_(false),
+      recording_(0),
+      active_handlers_(0),
+      samples_(NULL),
+      max_samples_(0),
+      next_sample_(0),
+      dropped_samples_(0) {
+}
+
+SamplingProfiler::~SamplingProfiler() {
+  delete[] samples_;
+}
+
+bool SamplingProfiler::Start(Mode mode,
+                             TimeDelta interval,
+                             size_t max_samples) {
+  AutoLock lock(lock_);
+  DCHECK(!running_) << "Sampling profiler already started";
+  DCHECK_GT(interval.InMicroseconds(), 0);
+
+  if (!handler_installed_) {
+    // The handler stays installed for good: a SIGPROF still pending after
+    // Stop() would otherwise terminate the process.
+    g_profiler = this;
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = &SamplingProfiler::OnSignal;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, NULL) != 0) {
+      DPLOG(ERROR) << "sigaction";
+      return false;
+    }
+    handler_installed_ = true;
+  }
+
+  max_samples = std::min<size_t>(max_samples, kint32max);
+  delete[] samples_;
+  samples_ = new Sample[max_samples];
+  max_samples_ = max_samples;
+  subtle::NoBarrier_Store(&next_sample_, 0);
+  subtle::NoBarrier_Store(&dropped_samples_, 0);
+  mode_ = mode;
+  interval_ = interval;
+  subtle::Release_Store(&recording_, 1);
+  running_ = true;
+
+  RecordStackBounds();
+  bool armed = mode_ == PROCESS_CPU_TIME ? ArmProcessTimer(interval_) :
+      RegisterCurrentThreadWhileLocked();
+  if (!armed) {
+    StopWhileLocked();
+    return false;
+  }
+  return true;
+}
+
+void SamplingProfiler::Stop() {
+  AutoLock lock(lock_);
+  StopWhileLocked();
+}
+
+bool SamplingProfiler::IsRunning() const {
+  return !!subtle::Acquire_Load(&recording_);
+}
+
+void SamplingProfiler::RegisterCurrentThread() {
+  RecordStackBounds();
+  AutoLock lock(lock_);
+  if (running_ && mode_ == THREAD_CPU_TIME)
+    RegisterCurrentThreadWhileLocked();
+}
+
+void SamplingProfiler::UnregisterCurrentThread() {
+  t_stack_high = 0;
+  AutoLock lock(lock_);
+  std::map<PlatformThreadId, timer_t>::iterator it =
+      thread_timers_.find(PlatformThread::CurrentId());
+  if (it == thread_timers_.end())
+    return;
+  timer_delete(it->second);
+  thread_timers_.erase(it);
+}
+
+size_t SamplingProfiler::num_samples() const {
+  DCHECK(!IsRunning());
+  return std::min<size_t>(subtle::NoBarrier_Load(&next_sample_),
+                          max_samples_);
+}
+
+size_t SamplingProfiler::num_dropped_samples() const {
+  DCHECK(!IsRunning());
+  return subtle::NoBarrier_Load(&dropped_samples_);
+}
+
+SamplingProfiler::StackCounts SamplingProfiler::GetStackCounts() const {
+  StackCounts counts;
+  size_t count = num_samples();
+  for (size_t i = 0; i < count; ++i) {
+    const Sample& sample = samples_[i];
+    if (sample.depth)
+      ++counts[Stack(sample.frames, sample.frames + sample.depth)];
+  }
+  return counts;
+}
+
+bool SamplingProfiler::WritePprofProfile(const FilePath& path) const {
+  std::string maps;
+  if (!ReadProcMaps(&maps))
+    return false;
+
+  // Header: header words, version, sampling period in microseconds, padding.
+  std::vector<uintptr_t> data;
+  data.push_back(0);
+  data.push_back(3);
+  data.push_back(0);
+  data.push_back(static_cast<uintptr_t>(interval_.InMicroseconds()));
+  data.push_back(0);
+  StackCounts counts = GetStackCounts();
+  for (StackCounts::const_iterator it = counts.begin(); it != counts.end();
+       ++it) {
+    data.push_back(static_cast<uintptr_t>(it->second));
+    data.push_back(it->first.size());
+    data.insert(data.end(), it->first.begin(), it->first.end());
+  }
+  // Trailer: a single sample of depth one at pc 0.
+  data.push_back(0);
+  data.push_back(1);
+  data.push_back(0);
+
+  FILE* file = file_util::OpenFile(path, "wb");
+  if (!file)
+    return false;
+  fwrite(&data[0], sizeof(uintptr_t), data.size(), file);
+  fwrite(maps.data(), 1, maps.size(), file);
+  bool success = !ferror(file);
+  return file_util::CloseFile(file) && success;
+}
+
+std::string SamplingProfiler::GetFoldedStacks() const {
+  StackCounts counts = GetStackCounts();
+
+  // Symbolize all frames in one batch. Return addresses point past the call;
+  // step back into it so that the frame resolves to the caller.
+  std::vector<uintptr_t> addresses;
+  for (StackCounts::const_iterator it = counts.begin(); it != counts.end();
+       ++it) {
+    const Stack& stack = it->first;
+    for (size_t i = 0; i < stack.size(); ++i)
+      addresses.push_back(i ? stack[i] - 1 : stack[i]);
+  }
+  // The frames point into |symbolizer|.
+  ElfSymbolizer symbolizer;
+  std::vector<ElfSymbolizer::Frame> frames(addresses.size());
+  if (!addresses.empty())
+    symbolizer.SymbolizeBatch(&addresses[0], addresses.size(), &frames[0]);
+
+  // Different pcs in the same functions fold into the same line.
+  std::map<std::string, int64> folded_counts;
+  size_t next_frame = 0;
+  for (StackCounts::const_iterator it = counts.begin(); it != counts.end();
+       ++it) {
+    std::string line;
+    size_t depth = it->first.size();
+    for (size_t i = depth; i-- > 0;) {
+      AppendFrame(frames[next_frame + i], &line);
+      if (i)
+        line += ";";
+    }
+    next_frame += depth;
+    folded_counts[line] += it->second;
+  }
+
+  std::string folded;
+  for (std::map<std::string, int64>::const_iterator it =
+           folded_counts.begin();
+       it != folded_counts.end(); ++it) {
+    StringAppendF(&folded, "%s %" PRId64 "\n", it->first.c_str(), it->second);
+  }
+  return folded;
+}
+
+bool SamplingProfiler::ArmProcessTimer(TimeDelta interval) {
+  struct itimerval timer;
+  timer.it_interval.tv_sec = interval.InSeconds();
+  timer.it_interval.tv_usec =
+      (interval - TimeDelta::FromSeconds(timer.it_interval.tv_sec))
+          .InMicroseconds();
+  timer.it_value = timer.it_interval;
+  if (setitimer(ITIMER_PROF, &timer, NULL) != 0) {
+    DPLOG(ERROR) << "setitimer";
+    return false;
+  }
+  return true;
+}
+
+bool SamplingProfiler::RegisterCurrentThreadWhileLocked() {
+  PlatformThreadId thread_id = PlatformThread::CurrentId();
+  if (thread_timers_.count(thread_id))
+    return true;
+
+  struct sigevent event;
+  memset(&event, 0, sizeof(event));
+  event.sigev_notify = SIGEV_THREAD_ID;
+  event.sigev_signo = SIGPROF;
+  event.sigev_notify_thread_id = thread_id;
+  timer_t timer;
+  if (timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &timer) != 0) {
+    DPLOG(ERROR) << "timer_create";
+    return false;
+  }
+
+  struct itimerspec spec;
+  spec.it_interval.tv_sec = interval_.InSeconds();
+  spec.it_interval.tv_nsec =
+      (interval_ - TimeDelta::FromSeconds(spec.it_interval.tv_sec))
+          .InMicroseconds() * Time::kNanosecondsPerMicrosecond;
+  spec.it_value = spec.it_interval;
+  if (timer_settime(timer, 0, &spec, NULL) != 0) {
+    DPLOG(ERROR) << "timer_settime";
+    timer_delete(timer);
+    return false;
+  }
+  thread_timers_[thread_id] = timer;
+  return true;
+}
+
+void SamplingProfiler::StopWhileLocked() {
+  if (!running_)
+    return;
+
+  struct itimerval timer;
+  memset(&timer, 0, sizeof(timer));
+  setitimer(ITIMER_PROF, &timer, NULL);
+  for (std::map<PlatformThreadId, timer_t>::iterator it =
+           thread_timers_.begin();
+       it != thread_timers_.end(); ++it) {
+    timer_delete(it->second);
+  }
+  thread_timers_.clear();
+
+  // A handler either sees |recording_| cleared, or is seen here and waited
+  // for. Afterwards the samples are no longer written to.
+  subtle::NoBarrier_Store(&recording_, 0);
+  subtle::MemoryBarrier();
+  while (subtle::Acquire_Load(&active_handlers_))
+    PlatformThread::YieldCurrentThread();
+  running_ = false;
+}
+
+void SamplingProfiler::RecordSample(void* ucontext) {
+  if (static_cast<size_t>(subtle::NoBarrier_Load(&next_sample_)) >=
+      max_samples_) {
+    subtle::NoBarrier_AtomicIncrement(&dropped_samples_, 1);
+    return;
+  }
+  size_t index = subtle::NoBarrier_AtomicIncrement(&next_sample_, 1) - 1;
+  if (index >= max_samples_) {
+    subtle::NoBarrier_AtomicIncrement(&dropped_samples_, 1);
+    return;
+  }
+
+  Sample& sample = samples_[index];
+  sample.depth = UnwindStack(ucontext, sample.frames, kMaxStackDepth);
+}
+
+// static
+void SamplingProfiler::OnSignal(int signal, siginfo_t* info, void* ucontext) {
+  int saved_errno = errno;
+  SamplingProfiler* profiler = g_profiler;
+  subtle::Barrier_AtomicIncrement(&profiler->active_handlers_, 1);
+  if (subtle::Acquire_Load(&profiler->recording_))
+    profiler->RecordSample(ucontext);
+  subtle::Barrier_AtomicIncrement(&profiler->active_handlers_, -1);
+  errno = saved_errno;
+}
+
+}  // namespace debug
+}  // namespace base
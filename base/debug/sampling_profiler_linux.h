@@ -0,0 +1,151 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// A built-in sampling CPU profiler. A SIGPROF handler unwinds the interrupted
+// thread by following frame pointers and appends the stack to a preallocated
+// buffer; nothing in the handler allocates, locks or calls into libc. The
+// samples are aggregated and written out after Stop().
+//
+// Only code compiled with frame pointers (-fno-omit-frame-pointer) unwinds
+// past its own frame; elsewhere a sample holds just the interrupted pc and
+// whatever part of the chain could be followed. The chain is never followed
+// off the stack of the interrupted thread, so only threads that registered
+// (see RegisterCurrentThread()) and thereby recorded their stack bounds are
+// unwound at all; others are sampled at their pc only.
+
+#ifndef BASE_DEBUG_SAMPLING_PROFILER_LINUX_H_
+#define BASE_DEBUG_SAMPLING_PROFILER_LINUX_H_
+
+#include <signal.h>
+#include <time.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/atomicops.h"
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/platform_thread.h"
+#include "base/time/time.h"
+
+template <typename Type>
+struct DefaultSingletonTraits;
+
+namespace base {
+
+class FilePath;
+
+namespace debug {
+
+class BASE_EXPORT SamplingProfiler {
+ public:
+  enum Mode {
+    // One setitimer(ITIMER_PROF) timer for the whole process. The kernel
+    // delivers SIGPROF to whichever thread is consuming CPU.
+    PROCESS_CPU_TIME,
+
+    // A CLOCK_THREAD_CPUTIME_ID timer per registered thread, see
+    // RegisterCurrentThread(). Only registered threads are sampled, each at
+    // exactly |interval| of its own CPU time.
+    THREAD_CPU_TIME,
+  };
+
+  // Deepest stack recorded, in frames.
+  static const int kMaxStackDepth = 64;
+
+  // Default number of samples kept per session, about 5 MB.
+  static const size_t kDefaultMaxSamples = 10000;
+
+  // Samples are aggregated by stack into these.
+  typedef std::vector<uintptr_t> Stack;
+  typedef std::map<Stack, int64> StackCounts;
+
+  static SamplingProfiler* GetInstance();
+
+  // Installs the SIGPROF handler and starts sampling every |interval| of CPU
+  // time, discarding the samples of the previous session. Samples past
+  // |max_samples| are dropped and counted. The calling thread is registered.
+  // Returns false if a timer can't be created.
+  bool Start(Mode mode, TimeDelta interval, size_t max_samples);
+
+  // Stops sampling and waits for signal handlers still running. The samples
+  // stay available until the next Start().
+  void Stop();
+
+  bool IsRunning() const;
+
+  // Registering records the stack bounds of the calling thread, which its
+  // samples need to be unwound, and in THREAD_CPU_TIME mode starts sampling
+  // it. Threads must unregister before they exit.
+  void RegisterCurrentThread();
+  void UnregisterCurrentThread();
+
+  // Accessors for the samples of the last session. Must not be called while
+  // running.
+  size_t num_samples() const;
+  size_t num_dropped_samples() const;
+  TimeDelta interval() const { return interval_; }
+
+  // Returns the number of samples of each distinct stack. Stacks start at the
+  // interrupted pc, followed by return addresses.
+  StackCounts GetStackCounts() const;
+
+  // Writes the samples in the legacy gperftools CPU profile format followed
+  // by the contents of /proc/self/maps, which is what pprof needs to
+  // symbolize the profile offline: pprof <binary> <path>.
+  bool WritePprofProfile(const FilePath& path) const;
+
+  // Returns the samples as folded stacks, one "frame;frame;... count" line per
+  // distinct stack with the outermost frame first, as consumed by
+  // flamegraph.pl. Frames are function names, or "module+0xoffset" for
+  // addresses ElfSymbolizer can't resolve, which addr2line can look up
+  // offline.
+  std::string GetFoldedStacks() const;
+
+ private:
+  friend struct DefaultSingletonTraits<SamplingProfiler>;
+
+  struct Sample {
+    int depth;
+    uintptr_t frames[kMaxStackDepth];
+  };
+
+  SamplingProfiler();
+  ~SamplingProfiler();
+
+  bool ArmProcessTimer(TimeDelta interval);
+  bool RegisterCurrentThreadWhileLocked();
+  void StopWhileLocked();
+
+  // Async-signal-safe.
+  void RecordSample(void* ucontext);
+
+  static void OnSignal(int signal, siginfo_t* info, void* ucontext);
+
+  // Protects the members below that are not touched by the signal handler.
+  Lock lock_;
+  Mode mode_;
+  TimeDelta interval_;
+  std::map<PlatformThreadId, timer_t> thread_timers_;
+  bool handler_installed_;
+  bool running_;
+
+  // Members used by the signal handler. |samples_| is only replaced while
+  // no handler runs, see StopWhileLocked().
+  subtle::Atomic32 recording_;
+  subtle::Atomic32 active_handlers_;
+  Sample* samples_;
+  size_t max_samples_;
+  subtle::Atomic32 next_sample_;
+  subtle::Atomic32 dropped_samples_;
+
+  DISALLOW_COPY_AND_ASSIGN(SamplingProfiler);
+};
+
+}  // namespace debug
+}  // namespace base
+
+#endif  // BASE_DEBUG_SAMPLING_PROFILER_LINUX_H_
@@ -0,0 +1,166 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/debug/sampling_profiler_linux.h"
+
+#include "base/file_util.h"
+#include "base/files/file_path.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/threading/simple_thread.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace debug {
+
+namespace {
+
+const TimeDelta kInterval = TimeDelta::FromMilliseconds(1);
+
+// Keeps the CPU busy for |duration| of thread CPU time, or wall time where
+// thread time isn't supported.
+NOINLINE void BurnCpu(TimeDelta duration) {
+  bool thread_now = TimeTicks::IsThreadNowSupported();
+  TimeTicks end = (thread_now ? TimeTicks::ThreadNow() : TimeTicks::Now()) +
+      duration;
+  volatile int sink = 0;
+  while ((thread_now ? TimeTicks::ThreadNow() : TimeTicks::Now()) < end) {
+    for (int i = 0; i < 10000; ++i)
+      sink += i;
+  }
+}
+
+class BurnCpuDelegate : public DelegateSimpleThread::Delegate {
+ public:
+  explicit BurnCpuDelegate(bool registered) : registered_(registered) {}
+
+  virtual void Run() OVERRIDE {
+    if (registered_)
+      SamplingProfiler::GetInstance()->RegisterCurrentThread();
+    BurnCpu(TimeDelta::FromMilliseconds(100));
+    if (registered_)
+      SamplingProfiler::GetInstance()->UnregisterCurrentThread();
+  }
+
+ private:
+  bool registered_;
+
+  DISALLOW_COPY_AND_ASSIGN(BurnCpuDelegate);
+};
+
+}  // namespace
+
+TEST(SamplingProfilerTest, ProcessCpuTime) {
+  SamplingProfiler* profiler = SamplingProfiler::GetInstance();
+  ASSERT_TRUE(profiler->Start(SamplingProfiler::PROCESS_CPU_TIME, kInterval,
+                              SamplingProfiler::kDefaultMaxSamples));
+  EXPECT_TRUE(profiler->IsRunning());
+  BurnCpu(TimeDelta::FromMilliseconds(200));
+  profiler->Stop();
+  EXPECT_FALSE(profiler->IsRunning());
+
+  // Allow for a coarse kernel tick.
+  EXPECT_GT(profiler->num_samples(), 10u);
+  EXPECT_EQ(0u, profiler->num_dropped_samples());
+
+  size_t total = 0;
+  SamplingProfiler::StackCounts counts = profiler->GetStackCounts();
+  for (SamplingProfiler::StackCounts::const_iterator it = counts.begin();
+       it != counts.end(); ++it) {
+    EXPECT_FALSE(it->first.empty());
+    EXPECT_LE(it->first.size(),
+              static_cast<size_t>(SamplingProfiler::kMaxStackDepth));
+    total += it->second;
+  }
+  EXPECT_EQ(profiler->num_samples(), total);
+}
+
+TEST(SamplingProfilerTest, ThreadCpuTimeSamplesOnlyRegisteredThreads) {
+  SamplingProfiler* profiler = SamplingProfiler::GetInstance();
+  ASSERT_TRUE(profiler->Start(SamplingProfiler::THREAD_CPU_TIME, kInterval,
+                              SamplingProfiler::kDefaultMaxSamples));
+  profiler->UnregisterCurrentThread();
+
+  BurnCpuDelegate unregistered_delegate(false);
+  DelegateSimpleThread unregistered(&unregistered_delegate, "Unregistered");
+  unregistered.Start();
+  unregistered.Join();
+  BurnCpu(TimeDelta::FromMilliseconds(50));
+  profiler->Stop();
+  EXPECT_EQ(0u, profiler->num_samples());
+
+  ASSERT_TRUE(profiler->Start(SamplingProfiler::THREAD_CPU_TIME, kInterval,
+                              SamplingProfiler::kDefaultMaxSamples));
+  profiler->UnregisterCurrentThread();
+  BurnCpuDelegate registered_delegate(true);
+  DelegateSimpleThread registered(&registered_delegate, "Registered");
+  registered.Start();
+  registered.Join();
+  profiler->Stop();
+  EXPECT_GT(profiler->num_samples(), 10u);
+}
+
+TEST(SamplingProfilerTest, DropsSamplesPastCapacity) {
+  SamplingProfiler* profiler = SamplingProfiler::GetInstance();
+  ASSERT_TRUE(profiler->Start(SamplingProfiler::PROCESS_CPU_TIME, kInterval,
+                              5));
+  BurnCpu(TimeDelta::FromMilliseconds(100));
+  profiler->Stop();
+  EXPECT_EQ(5u, profiler->num_samples());
+  EXPECT_GT(profiler->num_dropped_samples(), 0u);
+}
+
+// The samples are symbolized and unwound far enough to find the function
+// burning the CPU, whether interrupted in it or in a function it calls.
+TEST(SamplingProfilerTest, StacksContainBurnCpu) {
+  SamplingProfiler* profiler = SamplingProfiler::GetInstance();
+  ASSERT_TRUE(profiler->Start(SamplingProfiler::THREAD_CPU_TIME, kInterval,
+                              SamplingProfiler::kDefaultMaxSamples));
+  profiler->UnregisterCurrentThread();
+  BurnCpuDelegate delegate(true);
+  DelegateSimpleThread thread(&delegate, "Registered");
+  thread.Start();
+  thread.Join();
+  profiler->Stop();
+  ASSERT_GT(profiler->num_samples(), 10u);
+
+  std::string folded = profiler->GetFoldedStacks();
+  EXPECT_NE(std::string::npos, folded.find("BurnCpu")) << folded;
+}
+
+TEST(SamplingProfilerTest, Output) {
+  SamplingProfiler* profiler = SamplingProfiler::GetInstance();
+  ASSERT_TRUE(profiler->Start(SamplingProfiler::PROCESS_CPU_TIME, kInterval,
+                              SamplingProfiler::kDefaultMaxSamples));
+  BurnCpu(TimeDelta::FromMilliseconds(100));
+  profiler->Stop();
+  ASSERT_GT(profiler->num_samples(), 0u);
+
+  std::string folded = profiler->GetFoldedStacks();
+  ASSERT_FALSE(folded.empty());
+  EXPECT_EQ('\n', folded[folded.size() - 1]);
+  // Every line ends with a count.
+  std::string first_line = folded.substr(0, folded.find('\n'));
+  size_t space = first_line.rfind(' ');
+  ASSERT_NE(std::string::npos, space);
+  EXPECT_GT(atoi(first_line.c_str() + space + 1), 0);
+
+  ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  FilePath path = temp_dir.path().AppendASCII("cpu.prof");
+  ASSERT_TRUE(profiler->WritePprofProfile(path));
+  std::string profile;
+  ASSERT_TRUE(ReadFileToString(path, &profile));
+  ASSERT_GT(profile.size(), 5 * sizeof(uintptr_t));
+  const uintptr_t* header = reinterpret_cast<const uintptr_t*>(profile.data());
+  EXPECT_EQ(0u, header[0]);
+  EXPECT_EQ(3u, header[1]);
+  EXPECT_EQ(0u, header[2]);
+  EXPECT_EQ(1000u, header[3]);
+  // The memory map follows the samples.
+  EXPECT_NE(std::string::npos, profile.find("r-xp"));
+}
+
+}  // namespace debug
+}  // namespace base
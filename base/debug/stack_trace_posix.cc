@@ -36,6 +36,12 @@
 #include "base/third_party/symbolize/symbolize.h"
 #endif
 
+#if defined(OS_LINUX) && !defined(USE_SYMBOLIZE)
+#include "base/debug/elf_symbolizer_linux.h"
+#include "base/lazy_instance.h"
+#include "base/synchronization/lock.h"
+#endif
+
 namespace base {
 namespace debug {
 
@@ -122,6 +128,73 @@ void OutputPointer(void* pointer, BacktraceOutputHandler* handler) {
   handler->HandleOutput("]");
 }
 
+#if defined(OS_LINUX) && !defined(USE_SYMBOLIZE)
+// backtrace_symbols() reads the symbol tables anew for every frame, which is
+// slow when printing many stacks. ElfSymbolizer reads each module once per
+// process.
+struct SymbolizerCache {
+  Lock lock;
+  scoped_ptr<ElfSymbolizer> symbolizer;
+};
+
+LazyInstance<SymbolizerCache>::Leaky g_symbolizer_cache =
+    LAZY_INSTANCE_INITIALIZER;
+
+bool SymbolizeWithCache(void *const *trace,
+                        int size,
+                        BacktraceOutputHandler* handler) {
+  SymbolizerCache* cache = g_symbolizer_cache.Pointer();
+  AutoLock lock(cache->lock);
+  if (!cache->symbolizer)
+    cache->symbolizer.reset(new ElfSymbolizer);
+
+  std::vector<uintptr_t> addresses(size);
+  for (int i = 0; i < size; ++i)
+    addresses[i] = reinterpret_cast<uintptr_t>(trace[i]);
+  std::vector<ElfSymbolizer::Frame> frames(size);
+  cache->symbolizer->SymbolizeBatch(&addresses[0], size, &frames[0]);
+  for (int i = 0; i < size; ++i) {
+    handler->HandleOutput(ElfSymbolizer::FormatFrame(frames[i]).c_str());
+    handler->HandleOutput("\n");
+  }
+  return true;
+}
+
+// Async-signal safe. Symbolizes with the modules the cache already loaded,
+// unless the cache is in use, for instance by the thread that crashed.
+bool SymbolizeWithLoadedModules(void *const *trace,
+                                int size,
+                                BacktraceOutputHandler* handler) {
+  SymbolizerCache* cache = g_symbolizer_cache.Pointer();
+  if (!cache->lock.Try())
+    return false;
+  if (!cache->symbolizer) {
+    cache->lock.Release();
+    return false;
+  }
+  for (int i = 0; i < size; ++i) {
+    char buf[1024] = { '\0' };
+    ElfSymbolizer::Frame frame;
+    cache->symbolizer->SymbolizeIfLoaded(reinterpret_cast<uintptr_t>(trace[i]),
+                                         &frame);
+    if (frame.module)
+      handler->HandleOutput(frame.module);
+    if (frame.symbol) {
+      handler->HandleOutput("(");
+      handler->HandleOutput(frame.symbol);
+      handler->HandleOutput("+0x");
+      internal::itoa_r(frame.symbol_offset, buf, sizeof(buf), 16, 0);
+      handler->HandleOutput(buf);
+      handler->HandleOutput(")");
+    }
+    OutputPointer(trace[i], handler);
+    handler->HandleOutput("\n");
+  }
+  cache->lock.Release();
+  return true;
+}
+#endif  // defined(OS_LINUX) && !defined(USE_SYMBOLIZE)
+
 void ProcessBacktrace(void *const *trace,
                       int size,
                       BacktraceOutputHandler* handler) {
@@ -148,9 +221,16 @@ void ProcessBacktrace(void *const *trace,
 #else
   bool printed = false;
 
+#if defined(OS_LINUX)
+  if (in_signal_handler == 0)
+    printed = SymbolizeWithCache(trace, size, handler);
+  else
+    printed = SymbolizeWithLoadedModules(trace, size, handler);
+#endif
+
   // Below part is async-signal unsafe (uses malloc), so execute it only
   // when we are not executing the signal handler.
-  if (in_signal_handler == 0) {
+  if (!printed && in_signal_handler == 0) {
     scoped_ptr_malloc<char*> trace_symbols(backtrace_symbols(trace, size));
     if (trace_symbols.get()) {
       for (int i = 0; i < size; ++i) {
@@ -0,0 +1,66 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Converts the files written by BinaryTraceRecorder into a JSON trace that can
+// be loaded into about:tracing.
+//
+// Usage: trace_binary_to_json <trace directory> <output.json>
+
+#include <stdio.h>
+
+#include <string>
+
+#include "base/at_exit.h"
+#include "base/bind.h"
+#include "base/debug/trace_event_binary.h"
+#include "base/file_util.h"
+#include "base/files/file_path.h"
+
+namespace {
+
+void WriteChunk(FILE* file, const std::string& chunk) {
+  fwrite(chunk.data(), 1, chunk.size(), file);
+}
+
+void AddFragment(base::debug::TraceResultBuffer* buffer,
+                 const std::string& fragment) {
+  buffer->AddFragment(fragment);
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+  base::AtExitManager at_exit_manager;
+
+  if (argc != 3) {
+    fprintf(stderr, "Usage: %s <trace directory> <output.json>\n", argv[0]);
+    return 1;
+  }
+
+  base::FilePath output_path(argv[2]);
+  FILE* output = file_util::OpenFile(output_path, "w");
+  if (!output) {
+    fprintf(stderr, "Cannot open %s\n", argv[2]);
+    return 1;
+  }
+
+  base::debug::TraceResultBuffer result_buffer;
+  result_buffer.SetOutputCallback(base::Bind(&WriteChunk, output));
+  result_buffer.Start();
+  bool found = base::debug::ConvertBinaryTraceToJSON(
+      base::FilePath(argv[1]),
+      base::Bind(&AddFragment, base::Unretained(&result_buffer)));
+  result_buffer.Finish();
+
+  bool success = !ferror(output);
+  if (!file_util::CloseFile(output) || !success) {
+    fprintf(stderr, "Failed to write %s\n", argv[2]);
+    return 1;
+  }
+  if (!found) {
+    fprintf(stderr, "No binary trace found in %s\n", argv[1]);
+    return 1;
+  }
+  return 0;
+}
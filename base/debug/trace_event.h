@@ -194,10 +194,13 @@
 
 #include "base/atomicops.h"
 #include "base/debug/trace_event_impl.h"
-#include "base/debug/trace_event_memory.h"
-#include "base/debug/trace_event_system_stats_monitor.h"
 #include "build/build_config.h"
 
+// Memory tracing (trace_event_memory.h) needs tcmalloc's heap profiler and a
+// message loop, neither of which is part of this library, so TRACE_EVENT
+// scopes don't record memory tags.
+#define INTERNAL_TRACE_MEMORY(category, name)
+
 // By default, const char* argument values are assumed to have long-lived scope
 // and will not be copied. Use this macro to force a const char* to be copied.
 #define TRACE_STR_COPY(str) \
@@ -0,0 +1,690 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/debug/trace_event_binary.h"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+
+#include "base/bits.h"
+#include "base/debug/trace_event.h"
+#include "base/files/file_enumerator.h"
+#include "base/files/memory_mapped_file.h"
+#include "base/format_macros.h"
+#include "base/hash.h"
+#include "base/logging.h"
+#include "base/memory/singleton.h"
+#include "base/process/process_handle.h"
+#include "base/stl_util.h"
+#include "base/strings/string_util.h"
+#include "base/strings/stringprintf.h"
+#include "base/threading/platform_thread.h"
+#include "base/threading/thread_id_name_manager.h"
+
+namespace base {
+namespace debug {
+
+namespace {
+
+// Interning stops once the strings file holds this many strings, so that
+// TRACE_EVENT_COPY_* events with unique names can't grow it without bound.
+const uint32 kMaxInternedStrings = 1 << 20;
+
+// Number of entries in each of the per-thread caches of string ids.
+const size_t kStringCacheSize = 256;
+
+// Copied strings at least this long bypass the per-thread cache and are
+// looked up in the recorder's table every time.
+const size_t kCopiedStringCacheLength = 56;
+
+// Number of events per fragment handed out by ConvertBinaryTraceToJSON().
+const size_t kConvertBatchSize = 1000;
+
+const char kConvertablePlaceholder[] = "[convertable]";
+
+// Layout of the strings file: a StringsFileHeader followed by one
+// StringsFileEntry plus |length| characters per interned string.
+struct StringsFileHeader {
+  uint32 magic;
+  uint32 version;
+};
+
+struct StringsFileEntry {
+  uint32 id;
+  uint32 length;
+};
+
+FilePath::StringType StringsFileName(ProcessId pid) {
+  return StringPrintf("trace_%d.strings", static_cast<int>(pid));
+}
+
+FilePath::StringType RingFileName(ProcessId pid, int ring_number) {
+  return StringPrintf("trace_%d_%d.bin", static_cast<int>(pid), ring_number);
+}
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// BinaryTraceRecorder::ThreadRing
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// The ring file of one thread, and its cache of string ids. Owned by the
+// thread through BinaryTraceRecorder::thread_ring_.
+class BinaryTraceRecorder::ThreadRing {
+ public:
+  ThreadRing(BinaryTraceRecorder* recorder, int session);
+  ~ThreadRing();
+
+  // Creates and maps the ring file. On failure the ring stays invalid, and
+  // events of this thread are dropped for the rest of the session.
+  void Initialize(const FilePath& path, size_t capacity, int thread_id);
+  bool IsValid() const { return header_ != NULL; }
+
+  int session() const { return session_; }
+
+  BinaryTraceRecord* NextRecord() {
+    return &records_[header_->record_count & (header_->capacity - 1)];
+  }
+
+  void CommitRecord() {
+    // Keep the compiler from moving the record stores past the count update.
+    subtle::MemoryBarrier();
+    header_->record_count++;
+  }
+
+  // Returns the id of the string at |str|, which must have static lifetime.
+  uint32 GetStaticStringId(const char* str);
+
+  // Returns the id of the string at |str|, which may be freed right after.
+  // Looked up by content, so that the recorder's lock is only taken the first
+  // time the thread sees a string.
+  uint32 GetCopiedStringId(const char* str);
+
+  void Sync();
+
+  static void OnThreadExit(void* ring);
+
+ private:
+  struct CachedString {
+    const char* str;
+    uint32 id;
+  };
+
+  struct CachedCopiedString {
+    uint32 id;
+    uint32 length;
+    char str[kCopiedStringCacheLength];
+  };
+
+  BinaryTraceRecorder* recorder_;
+  int session_;
+  PlatformFile file_;
+  size_t mapping_size_;
+  BinaryTraceFileHeader* header_;
+  BinaryTraceRecord* records_;
+  CachedString string_cache_[kStringCacheSize];
+  CachedCopiedString copied_string_cache_[kStringCacheSize];
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadRing);
+};
+
+BinaryTraceRecorder::ThreadRing::ThreadRing(BinaryTraceRecorder* recorder,
+                                            int session)
+    : recorder_(recorder),
+      session_(session),
+      file_(kInvalidPlatformFileValue),
+      mapping_size_(0),
+      header_(NULL),
+      records_(NULL) {
+  memset(string_cache_, 0, sizeof(string_cache_));
+  memset(copied_string_cache_, 0, sizeof(copied_string_cache_));
+}
+
+BinaryTraceRecorder::ThreadRing::~ThreadRing() {
+  {
+    AutoLock lock(recorder_->lock_);
+    std::vector<ThreadRing*>::iterator it =
+        std::find(recorder_->rings_.begin(), recorder_->rings_.end(), this);
+    if (it != recorder_->rings_.end())
+      recorder_->rings_.erase(it);
+  }
+  if (header_)
+    munmap(header_, mapping_size_);
+  if (file_ != kInvalidPlatformFileValue)
+    ClosePlatformFile(file_);
+}
+
+void BinaryTraceRecorder::ThreadRing::Initialize(const FilePath& path,
+                                                 size_t capacity,
+                                                 int thread_id) {
+  file_ = CreatePlatformFile(
+      path,
+      PLATFORM_FILE_CREATE_ALWAYS | PLATFORM_FILE_READ | PLATFORM_FILE_WRITE,
+      NULL, NULL);
+  if (file_ == kInvalidPlatformFileValue) {
+    DLOG(ERROR) << "Failed to create " << path.value();
+    return;
+  }
+
+  size_t size =
+      sizeof(BinaryTraceFileHeader) + capacity * sizeof(BinaryTraceRecord);
+  if (!TruncatePlatformFile(file_, size)) {
+    DLOG(ERROR) << "Failed to resize " << path.value();
+    return;
+  }
+  void* mapping =
+      mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file_, 0);
+  if (mapping == MAP_FAILED) {
+    DPLOG(ERROR) << "mmap " << path.value();
+    return;
+  }
+
+  mapping_size_ = size;
+  header_ = static_cast<BinaryTraceFileHeader*>(mapping);
+  records_ = reinterpret_cast<BinaryTraceRecord*>(header_ + 1);
+  header_->magic = kBinaryTraceMagic;
+  header_->version = kBinaryTraceVersion;
+  header_->process_id = static_cast<int32>(GetCurrentProcId());
+  header_->thread_id = thread_id;
+  header_->record_size = sizeof(BinaryTraceRecord);
+  header_->capacity = static_cast<uint32>(capacity);
+  header_->record_count = 0;
+  const char* thread_name =
+      ThreadIdNameManager::GetInstance()->GetName(thread_id);
+  strlcpy(header_->thread_name, thread_name ? thread_name : "",
+          sizeof(header_->thread_name));
+}
+
+uint32 BinaryTraceRecorder::ThreadRing::GetStaticStringId(const char* str) {
+  if (!str)
+    return kBinaryTraceNullStringId;
+
+  CachedString& entry = string_cache_[
+      (reinterpret_cast<uintptr_t>(str) >> 3) % kStringCacheSize];
+  if (entry.str != str) {
+    entry.id = recorder_->InternString(str);
+    entry.str = str;
+  }
+  return entry.id;
+}
+
+uint32 BinaryTraceRecorder::ThreadRing::GetCopiedStringId(const char* str) {
+  if (!str)
+    return kBinaryTraceNullStringId;
+
+  size_t length = strlen(str);
+  if (length >= kCopiedStringCacheLength)
+    return recorder_->InternString(str);
+
+  CachedCopiedString& entry =
+      copied_string_cache_[Hash(str, length) % kStringCacheSize];
+  if (entry.id == kBinaryTraceNullStringId || entry.length != length ||
+      memcmp(entry.str, str, length) != 0) {
+    entry.id = recorder_->InternString(str);
+    entry.length = static_cast<uint32>(length);
+    memcpy(entry.str, str, length);
+  }
+  return entry.id;
+}
+
+void BinaryTraceRecorder::ThreadRing::Sync() {
+  if (header_)
+    msync(header_, mapping_size_, MS_ASYNC);
+}
+
+// static
+void BinaryTraceRecorder::ThreadRing::OnThreadExit(void* ring) {
+  delete static_cast<ThreadRing*>(ring);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// BinaryTraceRecorder
+//
+////////////////////////////////////////////////////////////////////////////////
+
+// static
+BinaryTraceRecorder* BinaryTraceRecorder::GetInstance() {
+  return Singleton<BinaryTraceRecorder,
+                   LeakySingletonTraits<BinaryTraceRecorder> >::get();
+}
+
+BinaryTraceRecorder::BinaryTraceRecorder()
+    : session_(0),
+      records_per_thread_(kDefaultRecordsPerThread),
+      next_ring_number_(0),
+      strings_file_(kInvalidPlatformFileValue),
+      thread_ring_(&ThreadRing::OnThreadExit) {
+}
+
+BinaryTraceRecorder::~BinaryTraceRecorder() {
+}
+
+bool BinaryTraceRecorder::Start(const FilePath& directory,
+                                size_t records_per_thread) {
+  AutoLock lock(lock_);
+  DCHECK(!(session_ & 1)) << "Binary trace recording already started";
+
+  FilePath strings_path = directory.Append(StringsFileName(GetCurrentProcId()));
+  PlatformFile strings_file = CreatePlatformFile(
+      strings_path, PLATFORM_FILE_CREATE_ALWAYS | PLATFORM_FILE_WRITE,
+      NULL, NULL);
+  if (strings_file == kInvalidPlatformFileValue) {
+    DLOG(ERROR) << "Failed to create " << strings_path.value();
+    return false;
+  }
+  StringsFileHeader header = { kBinaryTraceStringsMagic, kBinaryTraceVersion };
+  if (WritePlatformFileAtCurrentPos(strings_file,
+                                    reinterpret_cast<const char*>(&header),
+                                    sizeof(header)) != sizeof(header)) {
+    ClosePlatformFile(strings_file);
+    return false;
+  }
+
+  directory_ = directory;
+  records_per_thread_ = static_cast<size_t>(1) << bits::Log2Ceiling(
+      static_cast<uint32>(std::max<size_t>(records_per_thread, 2)));
+  next_ring_number_ = 0;
+  strings_file_ = strings_file;
+  string_ids_.clear();
+  rings_.clear();
+  subtle::Release_Store(&session_, session_ + 1);
+  return true;
+}
+
+void BinaryTraceRecorder::Stop() {
+  AutoLock lock(lock_);
+  if (!(session_ & 1))
+    return;
+  subtle::Release_Store(&session_, session_ + 1);
+
+  for (size_t i = 0; i < rings_.size(); ++i)
+    rings_[i]->Sync();
+  rings_.clear();
+  ClosePlatformFile(strings_file_);
+  strings_file_ = kInvalidPlatformFileValue;
+}
+
+bool BinaryTraceRecorder::IsRecording() const {
+  return !!(subtle::Acquire_Load(&session_) & 1);
+}
+
+void BinaryTraceRecorder::Sync() {
+  AutoLock lock(lock_);
+  for (size_t i = 0; i < rings_.size(); ++i)
+    rings_[i]->Sync();
+  if (strings_file_ != kInvalidPlatformFileValue)
+    FlushPlatformFile(strings_file_);
+}
+
+BinaryTraceRecorder::ThreadRing* BinaryTraceRecorder::GetThreadRing(
+    int session) {
+  ThreadRing* ring = static_cast<ThreadRing*>(thread_ring_.Get());
+  if (ring && ring->session() == session)
+    return ring;
+
+  // First event of this thread in this session. Release the ring of an
+  // earlier session before mapping a new one.
+  delete ring;
+  thread_ring_.Set(NULL);
+
+  FilePath path;
+  size_t capacity;
+  {
+    AutoLock lock(lock_);
+    // The session ended while this event was being added.
+    if (session_ != session)
+      return NULL;
+    path = directory_.Append(
+        RingFileName(GetCurrentProcId(), next_ring_number_++));
+    capacity = records_per_thread_;
+  }
+
+  ring = new ThreadRing(this, session);
+  ring->Initialize(path, capacity,
+                   static_cast<int>(PlatformThread::CurrentId()));
+  thread_ring_.Set(ring);
+  if (ring->IsValid()) {
+    AutoLock lock(lock_);
+    if (session_ == session)
+      rings_.push_back(ring);
+  }
+  return ring;
+}
+
+uint32 BinaryTraceRecorder::InternString(const char* str) {
+  if (!str)
+    return kBinaryTraceNullStringId;
+
+  std::string value(str);
+  AutoLock lock(lock_);
+  hash_map<std::string, uint32>::const_iterator it = string_ids_.find(value);
+  if (it != string_ids_.end())
+    return it->second;
+
+  if (strings_file_ == kInvalidPlatformFileValue ||
+      string_ids_.size() >= kMaxInternedStrings) {
+    return kBinaryTraceNullStringId;
+  }
+
+  uint32 id = static_cast<uint32>(string_ids_.size()) + 1;
+  std::string entry(sizeof(StringsFileEntry), '\0');
+  StringsFileEntry* entry_header =
+      reinterpret_cast<StringsFileEntry*>(string_as_array(&entry));
+  entry_header->id = id;
+  entry_header->length = static_cast<uint32>(value.size());
+  entry.append(value);
+  if (WritePlatformFileAtCurrentPos(strings_file_, entry.data(),
+                                    static_cast<int>(entry.size())) !=
+      static_cast<int>(entry.size())) {
+    return kBinaryTraceNullStringId;
+  }
+  string_ids_[value] = id;
+  return id;
+}
+
+void BinaryTraceRecorder::AddTraceEvent(int thread_id,
+                                        const TimeTicks& timestamp,
+                                        const TimeTicks& thread_timestamp,
+                                        char phase,
+                                        const char* category_group,
+                                        const char* name,
+                                        unsigned long long id,
+                                        int num_args,
+                                        const char** arg_names,
+                                        const unsigned char* arg_types,
+                                        const unsigned long long* arg_values,
+                                        unsigned char flags) {
+  int session = subtle::Acquire_Load(&session_);
+  if (!(session & 1))
+    return;
+  ThreadRing* ring = GetThreadRing(session);
+  if (!ring || !ring->IsValid())
+    return;
+
+  // Copied strings may be freed right after this call, so they are cached
+  // by content rather than by address.
+  bool copy = !!(flags & TRACE_EVENT_FLAG_COPY);
+  BinaryTraceRecord* record = ring->NextRecord();
+  record->timestamp = timestamp.ToInternalValue();
+  record->thread_timestamp = thread_timestamp.ToInternalValue();
+  record->id = id;
+  record->category_id = ring->GetStaticStringId(category_group);
+  record->name_id = copy ? ring->GetCopiedStringId(name) :
+      ring->GetStaticStringId(name);
+  record->thread_id = thread_id;
+  record->phase = phase;
+  record->flags = flags;
+
+  // Clamp num_args since it may have been set by a third_party library.
+  num_args = std::min(num_args, kTraceMaxNumArgs);
+  int i = 0;
+  for (; i < num_args; ++i) {
+    record->arg_name_ids[i] = copy ? ring->GetCopiedStringId(arg_names[i]) :
+        ring->GetStaticStringId(arg_names[i]);
+    record->arg_types[i] = arg_types[i];
+    switch (arg_types[i]) {
+      case TRACE_VALUE_TYPE_STRING:
+        record->arg_types[i] = copy ? TRACE_VALUE_TYPE_COPY_STRING :
+            TRACE_VALUE_TYPE_STRING;
+        record->arg_values[i] = copy ?
+            ring->GetCopiedStringId(
+                reinterpret_cast<const char*>(arg_values[i])) :
+            ring->GetStaticStringId(
+                reinterpret_cast<const char*>(arg_values[i]));
+        break;
+      case TRACE_VALUE_TYPE_COPY_STRING:
+        record->arg_values[i] = ring->GetCopiedStringId(
+            reinterpret_cast<const char*>(arg_values[i]));
+        break;
+      case TRACE_VALUE_TYPE_CONVERTABLE:
+        record->arg_types[i] = TRACE_VALUE_TYPE_STRING;
+        record->arg_values[i] =
+            ring->GetStaticStringId(kConvertablePlaceholder);
+        break;
+      default:
+        record->arg_values[i] = arg_values[i];
+        break;
+    }
+  }
+  for (; i < kTraceMaxNumArgs; ++i) {
+    record->arg_name_ids[i] = kBinaryTraceNullStringId;
+    record->arg_types[i] = TRACE_VALUE_TYPE_UINT;
+    record->arg_values[i] = 0;
+  }
+
+  ring->CommitRecord();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// ConvertBinaryTraceToJSON
+//
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+bool IsStringValueType(unsigned char type) {
+  return type == TRACE_VALUE_TYPE_STRING ||
+         type == TRACE_VALUE_TYPE_COPY_STRING;
+}
+
+class BinaryTraceStrings {
+ public:
+  bool Load(const FilePath& path) {
+    MemoryMappedFile file;
+    if (!file.Initialize(path) || file.length() < sizeof(StringsFileHeader))
+      return false;
+    const StringsFileHeader* header =
+        reinterpret_cast<const StringsFileHeader*>(file.data());
+    if (header->magic != kBinaryTraceStringsMagic ||
+        header->version != kBinaryTraceVersion) {
+      return false;
+    }
+
+    // Index 0 is kBinaryTraceNullStringId.
+    strings_.resize(1);
+    size_t offset = sizeof(StringsFileHeader);
+    while (offset + sizeof(StringsFileEntry) <= file.length()) {
+      StringsFileEntry entry;
+      memcpy(&entry, file.data() + offset, sizeof(entry));
+      offset += sizeof(entry);
+      // A torn entry at the end of a crashed process' file.
+      if (entry.length > file.length() - offset)
+        break;
+      if (entry.id >= strings_.size())
+        strings_.resize(entry.id + 1);
+      strings_[entry.id].assign(
+          reinterpret_cast<const char*>(file.data() + offset), entry.length);
+      offset += entry.length;
+    }
+    return true;
+  }
+
+  // Returns NULL for kBinaryTraceNullStringId and unknown ids.
+  const char* Get(uint64 id) const {
+    if (id == kBinaryTraceNullStringId || id >= strings_.size())
+      return NULL;
+    return strings_[id].c_str();
+  }
+
+ private:
+  std::vector<std::string> strings_;
+};
+
+// Mirrors TraceEvent::AppendAsJSON().
+void AppendRecordAsJSON(const BinaryTraceRecord& record,
+                        int process_id,
+                        const BinaryTraceStrings& strings,
+                        std::string* out) {
+  const char* category = strings.Get(record.category_id);
+  const char* name = strings.Get(record.name_id);
+  StringAppendF(out,
+      "{\"cat\":\"%s\",\"pid\":%i,\"tid\":%i,\"ts\":%" PRId64 ","
+      "\"ph\":\"%c\",\"name\":\"%s\",\"args\":{",
+      category ? category : "",
+      process_id,
+      record.thread_id,
+      record.timestamp,
+      record.phase,
+      name ? name : "");
+
+  for (int i = 0; i < kTraceMaxNumArgs; ++i) {
+    const char* arg_name = strings.Get(record.arg_name_ids[i]);
+    if (!arg_name)
+      break;
+    if (i > 0)
+      *out += ",";
+    *out += "\"";
+    *out += arg_name;
+    *out += "\":";
+
+    TraceEvent::TraceValue value;
+    if (IsStringValueType(record.arg_types[i]))
+      value.as_string = strings.Get(record.arg_values[i]);
+    else
+      value.as_uint = record.arg_values[i];
+    TraceEvent::AppendValueAsJSON(record.arg_types[i], value, out);
+  }
+  *out += "}";
+
+  if (record.thread_timestamp)
+    StringAppendF(out, ",\"tts\":%" PRId64, record.thread_timestamp);
+
+  if (record.flags & TRACE_EVENT_FLAG_HAS_ID)
+    StringAppendF(out, ",\"id\":\"0x%" PRIx64 "\"", record.id);
+
+  if (record.phase == TRACE_EVENT_PHASE_INSTANT) {
+    char scope = '?';
+    switch (record.flags & TRACE_EVENT_FLAG_SCOPE_MASK) {
+      case TRACE_EVENT_SCOPE_GLOBAL:
+        scope = TRACE_EVENT_SCOPE_NAME_GLOBAL;
+        break;
+
+      case TRACE_EVENT_SCOPE_PROCESS:
+        scope = TRACE_EVENT_SCOPE_NAME_PROCESS;
+        break;
+
+      case TRACE_EVENT_SCOPE_THREAD:
+        scope = TRACE_EVENT_SCOPE_NAME_THREAD;
+        break;
+    }
+    StringAppendF(out, ",\"s\":\"%c\"", scope);
+  }
+
+  *out += "}";
+}
+
+void AppendThreadNameAsJSON(const BinaryTraceFileHeader& header,
+                            std::string* out) {
+  std::string thread_name(header.thread_name,
+                          strnlen(header.thread_name,
+                                  sizeof(header.thread_name)));
+  StringAppendF(out,
+      "{\"cat\":\"__metadata\",\"pid\":%i,\"tid\":%i,\"ts\":0,"
+      "\"ph\":\"%c\",\"name\":\"thread_name\",\"args\":{\"name\":",
+      header.process_id, header.thread_id, TRACE_EVENT_PHASE_METADATA);
+  TraceEvent::TraceValue value;
+  value.as_string = thread_name.c_str();
+  TraceEvent::AppendValueAsJSON(TRACE_VALUE_TYPE_COPY_STRING, value, out);
+  *out += "}}";
+}
+
+class FragmentWriter {
+ public:
+  explicit FragmentWriter(const TraceResultBuffer::OutputCallback& cb)
+      : cb_(cb),
+        count_(0) {
+  }
+
+  ~FragmentWriter() {
+    if (count_)
+      cb_.Run(fragment_);
+  }
+
+  // Returns the string to append the next event to.
+  std::string* Next() {
+    if (count_ == kConvertBatchSize) {
+      cb_.Run(fragment_);
+      fragment_.clear();
+      count_ = 0;
+    }
+    if (count_++)
+      fragment_ += ",";
+    return &fragment_;
+  }
+
+ private:
+  TraceResultBuffer::OutputCallback cb_;
+  std::string fragment_;
+  size_t count_;
+};
+
+bool ConvertRingFile(const FilePath& path,
+                     const BinaryTraceStrings& strings,
+                     FragmentWriter* writer) {
+  MemoryMappedFile file;
+  if (!file.Initialize(path) || file.length() < sizeof(BinaryTraceFileHeader))
+    return false;
+  const BinaryTraceFileHeader* header =
+      reinterpret_cast<const BinaryTraceFileHeader*>(file.data());
+  if (header->magic != kBinaryTraceMagic ||
+      header->version != kBinaryTraceVersion ||
+      header->record_size != sizeof(BinaryTraceRecord) ||
+      !header->capacity || (header->capacity & (header->capacity - 1)) ||
+      header->capacity > (file.length() - sizeof(BinaryTraceFileHeader)) /
+          sizeof(BinaryTraceRecord) ||
+      header->record_count < 0) {
+    DLOG(WARNING) << "Ignoring malformed binary trace " << path.value();
+    return false;
+  }
+
+  const BinaryTraceRecord* records =
+      reinterpret_cast<const BinaryTraceRecord*>(header + 1);
+  int64 end = header->record_count;
+  int64 begin = std::max<int64>(0, end - header->capacity);
+  for (int64 i = begin; i < end; ++i) {
+    AppendRecordAsJSON(records[i & (header->capacity - 1)],
+                       header->process_id, strings, writer->Next());
+  }
+  if (header->thread_name[0])
+    AppendThreadNameAsJSON(*header, writer->Next());
+  return true;
+}
+
+}  // namespace
+
+bool ConvertBinaryTraceToJSON(const FilePath& directory,
+                              const TraceResultBuffer::OutputCallback& cb) {
+  FragmentWriter writer(cb);
+  bool found_trace = false;
+
+  FileEnumerator strings_files(directory, false, FileEnumerator::FILES,
+                               FILE_PATH_LITERAL("trace_*.strings"));
+  for (FilePath strings_path = strings_files.Next(); !strings_path.empty();
+       strings_path = strings_files.Next()) {
+    BinaryTraceStrings strings;
+    if (!strings.Load(strings_path))
+      continue;
+
+    // "trace_<pid>.strings" goes with "trace_<pid>_*.bin".
+    FilePath::StringType pattern =
+        strings_path.BaseName().RemoveExtension().value() +
+        FILE_PATH_LITERAL("_*.bin");
+    FileEnumerator ring_files(directory, false, FileEnumerator::FILES,
+                              pattern);
+    for (FilePath ring_path = ring_files.Next(); !ring_path.empty();
+         ring_path = ring_files.Next()) {
+      if (ConvertRingFile(ring_path, strings, &writer))
+        found_trace = true;
+    }
+  }
+  return found_trace;
+}
+
+}  // namespace debug
+}  // namespace base
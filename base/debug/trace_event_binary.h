@@ -0,0 +1,170 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Binary trace recording. Instead of keeping TraceEvent objects in memory and
+// formatting them as JSON on Flush(), BinaryTraceRecorder writes every event
+// as a fixed-size record into a memory-mapped ring file owned by the thread
+// that traced it. Category, name and string argument values are interned and
+// only their ids are stored, so recording an event is a few stores into the
+// mapping. The files are shared mappings, so whatever was recorded survives a
+// crash of the process. ConvertBinaryTraceToJSON() turns the files into the
+// JSON produced by TraceLog::Flush() offline.
+//
+// Files written into the trace directory, <pid> being the process id:
+//   trace_<pid>.strings     Interned strings, appended as they are first seen.
+//   trace_<pid>_<n>.bin     One ring of BinaryTraceRecords per thread.
+
+#ifndef BASE_DEBUG_TRACE_EVENT_BINARY_H_
+#define BASE_DEBUG_TRACE_EVENT_BINARY_H_
+
+#include <string>
+#include <vector>
+
+#include "base/atomicops.h"
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/containers/hash_tables.h"
+#include "base/debug/trace_event_impl.h"
+#include "base/files/file_path.h"
+#include "base/platform_file.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/thread_local_storage.h"
+#include "base/time/time.h"
+
+template <typename Type>
+struct DefaultSingletonTraits;
+
+namespace base {
+namespace debug {
+
+const uint32 kBinaryTraceMagic = 0x54425243;  // "CRBT"
+const uint32 kBinaryTraceStringsMagic = 0x53425243;  // "CRBS"
+const uint32 kBinaryTraceVersion = 1;
+
+// String id stored for NULL strings and for strings that could not be
+// interned because the string table is full.
+const uint32 kBinaryTraceNullStringId = 0;
+
+// Start of every per-thread ring file. Only the owning thread writes to it.
+struct BinaryTraceFileHeader {
+  uint32 magic;
+  uint32 version;
+  int32 process_id;
+  int32 thread_id;
+  uint32 record_size;
+  // Number of record slots following the header. Always a power of two.
+  uint32 capacity;
+  // Number of records ever written; record i lives in slot i % capacity.
+  // Updated after the record itself, so a torn record is never counted.
+  int64 record_count;
+  char thread_name[40];
+};
+COMPILE_ASSERT(sizeof(BinaryTraceFileHeader) == 72,
+               binary_trace_file_header_size_is_part_of_the_file_format);
+
+// One trace event. String values (names, categories and arguments of type
+// TRACE_VALUE_TYPE_STRING or TRACE_VALUE_TYPE_COPY_STRING) are string ids.
+// Like TraceEvent, the arguments end at the first null argument name.
+struct BinaryTraceRecord {
+  int64 timestamp;
+  int64 thread_timestamp;
+  uint64 id;
+  uint64 arg_values[kTraceMaxNumArgs];
+  uint32 category_id;
+  uint32 name_id;
+  uint32 arg_name_ids[kTraceMaxNumArgs];
+  int32 thread_id;
+  char phase;
+  unsigned char flags;
+  unsigned char arg_types[kTraceMaxNumArgs];
+};
+COMPILE_ASSERT(sizeof(BinaryTraceRecord) == 64,
+               binary_trace_record_size_is_part_of_the_file_format);
+
+class BASE_EXPORT BinaryTraceRecorder {
+ public:
+  // Default number of records in the ring of each thread, 4 MB per thread.
+  static const size_t kDefaultRecordsPerThread = 1 << 16;
+
+  static BinaryTraceRecorder* GetInstance();
+
+  // Starts a recording session into |directory|, which must exist. Each
+  // thread keeps its most recent |records_per_thread| events, rounded up to a
+  // power of two. Returns false if the strings file can't be created.
+  bool Start(const FilePath& directory, size_t records_per_thread);
+
+  // Ends the session. Threads still holding a mapped ring keep it until they
+  // trace again or exit, so racing writers never touch unmapped memory.
+  void Stop();
+
+  bool IsRecording() const;
+
+  // Schedules write-back of all rings of the current session. Not needed for
+  // crash safety, only to survive a crash of the machine.
+  void Sync();
+
+  // Called by TraceLog when RECORD_BINARY is enabled. |category_group| and
+  // |name| must be static strings unless |flags| has TRACE_EVENT_FLAG_COPY,
+  // the same rules as for the TRACE_EVENT macros. Convertable arguments are
+  // recorded as a placeholder string.
+  void AddTraceEvent(int thread_id,
+                     const TimeTicks& timestamp,
+                     const TimeTicks& thread_timestamp,
+                     char phase,
+                     const char* category_group,
+                     const char* name,
+                     unsigned long long id,
+                     int num_args,
+                     const char** arg_names,
+                     const unsigned char* arg_types,
+                     const unsigned long long* arg_values,
+                     unsigned char flags);
+
+ private:
+  friend struct DefaultSingletonTraits<BinaryTraceRecorder>;
+  class ThreadRing;
+
+  BinaryTraceRecorder();
+  ~BinaryTraceRecorder();
+
+  ThreadRing* GetThreadRing(int session);
+
+  // Returns the id of |str|, appending it to the strings file when new.
+  // Takes |lock_|, so the tracing threads only call it when |str| misses
+  // the cache of their ThreadRing.
+  uint32 InternString(const char* str);
+
+  // Protects everything below.
+  mutable Lock lock_;
+
+  // Incremented by Start() and Stop(); odd while recording. Read without the
+  // lock by the tracing threads.
+  subtle::Atomic32 session_;
+
+  FilePath directory_;
+  size_t records_per_thread_;
+  int next_ring_number_;
+  PlatformFile strings_file_;
+  hash_map<std::string, uint32> string_ids_;
+
+  // Rings of the current session, for Sync().
+  std::vector<ThreadRing*> rings_;
+
+  ThreadLocalStorage::Slot thread_ring_;
+
+  DISALLOW_COPY_AND_ASSIGN(BinaryTraceRecorder);
+};
+
+// Converts all binary traces in |directory| into the JSON trace event
+// fragments produced by TraceLog::Flush(), handing them to |cb| in chunks.
+// Use TraceResultBuffer to wrap them into a complete trace. Returns false if
+// no valid trace was found.
+BASE_EXPORT bool ConvertBinaryTraceToJSON(
+    const FilePath& directory,
+    const TraceResultBuffer::OutputCallback& cb);
+
+}  // namespace debug
+}  // namespace base
+
+#endif  // BASE_DEBUG_TRACE_EVENT_BINARY_H_
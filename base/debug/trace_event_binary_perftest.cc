@@ -0,0 +1,70 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/debug/trace_event_binary.h"
+
+#include "base/bind.h"
+#include "base/debug/trace_event.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/test/perf_time_logger.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace debug {
+
+namespace {
+
+const int kNumEvents = 1000000;
+
+class TraceEventBinaryPerfTest : public testing::Test {
+ protected:
+  virtual void SetUp() OVERRIDE {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    TraceLog::DeleteForTesting();
+  }
+
+  virtual void TearDown() OVERRIDE {
+    TraceLog::DeleteForTesting();
+  }
+
+  void TraceEvents(const char* test_name, TraceLog::Options options) {
+    TraceLog::GetInstance()->SetEnabled(CategoryFilter("*"), options);
+    PerfTimeLogger timer(test_name);
+    for (int i = 0; i < kNumEvents; ++i)
+      TRACE_EVENT_INSTANT1("perf", "event", TRACE_EVENT_SCOPE_THREAD, "i", i);
+    timer.Done();
+    TraceLog::GetInstance()->SetDisabled();
+  }
+
+  ScopedTempDir temp_dir_;
+};
+
+}  // namespace
+
+TEST_F(TraceEventBinaryPerfTest, InMemory) {
+  TraceEvents("trace_event_in_memory", TraceLog::RECORD_CONTINUOUSLY);
+}
+
+TEST_F(TraceEventBinaryPerfTest, Binary) {
+  ASSERT_TRUE(BinaryTraceRecorder::GetInstance()->Start(
+      temp_dir_.path(), BinaryTraceRecorder::kDefaultRecordsPerThread));
+  TraceEvents("trace_event_binary",
+              static_cast<TraceLog::Options>(TraceLog::RECORD_CONTINUOUSLY |
+                                             TraceLog::RECORD_BINARY));
+  BinaryTraceRecorder::GetInstance()->Stop();
+
+  TraceResultBuffer::SimpleOutput json_output;
+  TraceResultBuffer trace_buffer;
+  trace_buffer.SetOutputCallback(json_output.GetCallback());
+  PerfTimeLogger timer("trace_event_binary_convert");
+  trace_buffer.Start();
+  EXPECT_TRUE(ConvertBinaryTraceToJSON(
+      temp_dir_.path(),
+      Bind(&TraceResultBuffer::AddFragment, Unretained(&trace_buffer))));
+  trace_buffer.Finish();
+  timer.Done();
+}
+
+}  // namespace debug
+}  // namespace base
@@ -0,0 +1,220 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/debug/trace_event_binary.h"
+
+#include "base/bind.h"
+#include "base/debug/trace_event.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/json/json_reader.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/scoped_vector.h"
+#include "base/strings/stringprintf.h"
+#include "base/threading/simple_thread.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace debug {
+
+namespace {
+
+class TraceEventBinaryTest : public testing::Test {
+ protected:
+  virtual void SetUp() OVERRIDE {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    TraceLog::DeleteForTesting();
+  }
+
+  virtual void TearDown() OVERRIDE {
+    BinaryTraceRecorder::GetInstance()->Stop();
+    TraceLog::DeleteForTesting();
+  }
+
+  void BeginTrace(size_t records_per_thread) {
+    ASSERT_TRUE(BinaryTraceRecorder::GetInstance()->Start(
+        temp_dir_.path(), records_per_thread));
+    TraceLog::GetInstance()->SetEnabled(
+        CategoryFilter("*"),
+        static_cast<TraceLog::Options>(TraceLog::RECORD_UNTIL_FULL |
+                                       TraceLog::RECORD_BINARY));
+  }
+
+  void EndTrace() {
+    TraceLog::GetInstance()->SetDisabled();
+    BinaryTraceRecorder::GetInstance()->Stop();
+  }
+
+  // Converts the recorded files and returns the parsed events.
+  scoped_ptr<ListValue> ConvertTrace() {
+    TraceResultBuffer::SimpleOutput json_output;
+    TraceResultBuffer trace_buffer;
+    trace_buffer.SetOutputCallback(json_output.GetCallback());
+    trace_buffer.Start();
+    EXPECT_TRUE(ConvertBinaryTraceToJSON(
+        temp_dir_.path(),
+        Bind(&TraceResultBuffer::AddFragment, Unretained(&trace_buffer))));
+    trace_buffer.Finish();
+
+    scoped_ptr<Value> root(JSONReader::Read(json_output.json_output));
+    ListValue* events = NULL;
+    if (!root.get() || !root->GetAsList(&events))
+      return scoped_ptr<ListValue>();
+    ignore_result(root.release());
+    return scoped_ptr<ListValue>(events);
+  }
+
+  // Returns the events named |name|, in the order they were converted.
+  std::vector<const DictionaryValue*> FindEvents(const ListValue& events,
+                                                 const std::string& name) {
+    std::vector<const DictionaryValue*> found;
+    for (size_t i = 0; i < events.GetSize(); ++i) {
+      const DictionaryValue* event = NULL;
+      std::string event_name;
+      if (events.GetDictionary(i, &event) &&
+          event->GetString("name", &event_name) && event_name == name) {
+        found.push_back(event);
+      }
+    }
+    return found;
+  }
+
+  ScopedTempDir temp_dir_;
+};
+
+class TraceManyEventsDelegate : public DelegateSimpleThread::Delegate {
+ public:
+  explicit TraceManyEventsDelegate(int num_events) : num_events_(num_events) {}
+
+  virtual void Run() OVERRIDE {
+    for (int i = 0; i < num_events_; ++i) {
+      TRACE_EVENT_INSTANT1("binary", "thread event", TRACE_EVENT_SCOPE_THREAD,
+                           "i", i);
+    }
+  }
+
+ private:
+  int num_events_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceManyEventsDelegate);
+};
+
+}  // namespace
+
+TEST_F(TraceEventBinaryTest, EventsAreConverted) {
+  BeginTrace(1024);
+  {
+    TRACE_EVENT2("binary", "scoped", "int", -3, "str", "static value");
+    std::string copied_name = "copied";
+    TRACE_EVENT_COPY_INSTANT1("binary", copied_name.c_str(),
+                              TRACE_EVENT_SCOPE_PROCESS,
+                              "arg", std::string("copied value"));
+    TRACE_EVENT_ASYNC_BEGIN0("binary", "async", 5);
+  }
+  EndTrace();
+
+  scoped_ptr<ListValue> events = ConvertTrace();
+  ASSERT_TRUE(events.get());
+
+  std::vector<const DictionaryValue*> scoped = FindEvents(*events, "scoped");
+  ASSERT_EQ(2u, scoped.size());
+  std::string value;
+  int int_value = 0;
+  EXPECT_TRUE(scoped[0]->GetString("ph", &value));
+  EXPECT_EQ("B", value);
+  EXPECT_TRUE(scoped[0]->GetString("cat", &value));
+  EXPECT_EQ("binary", value);
+  EXPECT_TRUE(scoped[0]->GetInteger("args.int", &int_value));
+  EXPECT_EQ(-3, int_value);
+  EXPECT_TRUE(scoped[0]->GetString("args.str", &value));
+  EXPECT_EQ("static value", value);
+  EXPECT_TRUE(scoped[1]->GetString("ph", &value));
+  EXPECT_EQ("E", value);
+
+  std::vector<const DictionaryValue*> copied = FindEvents(*events, "copied");
+  ASSERT_EQ(1u, copied.size());
+  EXPECT_TRUE(copied[0]->GetString("args.arg", &value));
+  EXPECT_EQ("copied value", value);
+  EXPECT_TRUE(copied[0]->GetString("s", &value));
+  EXPECT_EQ("p", value);
+
+  std::vector<const DictionaryValue*> async = FindEvents(*events, "async");
+  ASSERT_EQ(1u, async.size());
+  EXPECT_TRUE(async[0]->GetString("id", &value));
+  EXPECT_EQ("0x5", value);
+}
+
+// Copied strings are cached by content, so a buffer reused for different
+// strings, or different buffers holding the same string, get the right ids.
+TEST_F(TraceEventBinaryTest, CopiedStringsAreCachedByContent) {
+  const int kNumNames = 1000;
+  BeginTrace(4096);
+  for (int round = 0; round < 2; ++round) {
+    for (int i = 0; i < kNumNames; ++i) {
+      std::string name = StringPrintf("copied %d", i);
+      TRACE_EVENT_COPY_INSTANT1("binary", name.c_str(),
+                                TRACE_EVENT_SCOPE_THREAD,
+                                "arg", std::string(name + " value"));
+    }
+  }
+  EndTrace();
+
+  scoped_ptr<ListValue> events = ConvertTrace();
+  ASSERT_TRUE(events.get());
+  for (int i = 0; i < kNumNames; ++i) {
+    std::string name = StringPrintf("copied %d", i);
+    std::vector<const DictionaryValue*> found = FindEvents(*events, name);
+    ASSERT_EQ(2u, found.size()) << name;
+    for (size_t j = 0; j < found.size(); ++j) {
+      std::string value;
+      EXPECT_TRUE(found[j]->GetString("args.arg", &value));
+      EXPECT_EQ(name + " value", value);
+    }
+  }
+}
+
+TEST_F(TraceEventBinaryTest, RingKeepsMostRecentEvents) {
+  const int kNumEvents = 100;
+  BeginTrace(30);  // Rounded up to 32.
+  TraceManyEventsDelegate delegate(kNumEvents);
+  delegate.Run();
+  EndTrace();
+
+  scoped_ptr<ListValue> events = ConvertTrace();
+  ASSERT_TRUE(events.get());
+  std::vector<const DictionaryValue*> found =
+      FindEvents(*events, "thread event");
+  ASSERT_EQ(32u, found.size());
+  for (size_t i = 0; i < found.size(); ++i) {
+    int value = 0;
+    EXPECT_TRUE(found[i]->GetInteger("args.i", &value));
+    EXPECT_EQ(kNumEvents - 32 + static_cast<int>(i), value);
+  }
+}
+
+TEST_F(TraceEventBinaryTest, EachThreadHasItsOwnRing) {
+  const int kNumThreads = 4;
+  const int kNumEvents = 500;
+  BeginTrace(1024);
+  TraceManyEventsDelegate delegate(kNumEvents);
+  ScopedVector<DelegateSimpleThread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.push_back(new DelegateSimpleThread(
+        &delegate, StringPrintf("BinaryTraceThread%d", i)));
+    threads.back()->Start();
+  }
+  for (int i = 0; i < kNumThreads; ++i)
+    threads[i]->Join();
+  EndTrace();
+
+  scoped_ptr<ListValue> events = ConvertTrace();
+  ASSERT_TRUE(events.get());
+  EXPECT_EQ(static_cast<size_t>(kNumThreads * kNumEvents),
+            FindEvents(*events, "thread event").size());
+  EXPECT_EQ(static_cast<size_t>(kNumThreads),
+            FindEvents(*events, "thread_name").size());
+}
+
+}  // namespace debug
+}  // namespace base
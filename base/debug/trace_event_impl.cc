@@ -13,8 +13,9 @@
 #include "base/debug/trace_event.h"
 #include "base/format_macros.h"
 #include "base/lazy_instance.h"
+#include "base/file_util.h"
+#include "base/files/file_path.h"
 #include "base/memory/singleton.h"
-#include "base/message_loop/message_loop.h"
 #include "base/process/process_metrics.h"
 #include "base/stl_util.h"
 #include "base/strings/string_split.h"
@@ -28,12 +29,17 @@
 #include "base/third_party/dynamic_annotations/dynamic_annotations.h"
 #include "base/threading/platform_thread.h"
 #include "base/threading/thread_id_name_manager.h"
+#include "base/threading/thread_local.h"
 #include "base/time/time.h"
 
 #if defined(OS_WIN)
 #include "base/debug/trace_event_win.h"
 #endif
 
+#if defined(OS_POSIX)
+#include "base/debug/trace_event_binary.h"
+#endif
+
 class DeleteTraceLogForTesting {
  public:
   static void Delete() {
@@ -54,16 +60,14 @@ namespace {
 // trace.
 const int kOverheadReportThresholdInMicroseconds = 50;
 
-// Controls the number of trace events we will buffer in-memory
-// before throwing them away.
+// Controls the default number of trace events we will buffer in-memory
+// before throwing them away. See TraceLog::SetTraceBufferCapacity().
 const size_t kTraceEventVectorBufferSize = 250000;
 const size_t kTraceEventRingBufferSize = kTraceEventVectorBufferSize / 4;
 const size_t kTraceEventThreadLocalBufferSize = 64;
 const size_t kTraceEventBatchSize = 1000;
 const size_t kTraceEventInitialBufferSize = 1024;
 
-const int kThreadFlushTimeoutMs = 1000;
-
 #define MAX_CATEGORY_GROUPS 100
 
 // Parallel arrays g_category_groups and g_category_group_enabled are separate
@@ -97,6 +101,7 @@ LazyInstance<ThreadLocalPointer<const char> >::Leaky
 const char kRecordUntilFull[] = "record-until-full";
 const char kRecordContinuously[] = "record-continuously";
 const char kEnableSampling[] = "enable-sampling";
+const char kRecordBinary[] = "record-binary";
 
 TimeTicks ThreadNow() {
   return TimeTicks::IsThreadNowSupported() ?
@@ -105,10 +110,12 @@ TimeTicks ThreadNow() {
 
 class TraceBufferRingBuffer : public TraceBuffer {
  public:
-  TraceBufferRingBuffer()
-      : unused_event_index_(0),
+  explicit TraceBufferRingBuffer(size_t capacity)
+      : capacity_(capacity),
+        unused_event_index_(0),
         oldest_event_index_(0) {
-    logged_events_.reserve(kTraceEventInitialBufferSize);
+    DCHECK_GT(capacity_, 1u);
+    logged_events_.reserve(std::min(capacity_, kTraceEventInitialBufferSize));
   }
 
   virtual ~TraceBufferRingBuffer() {}
@@ -167,17 +174,18 @@ class TraceBufferRingBuffer : public TraceBuffer {
   }
 
   virtual size_t Capacity() const OVERRIDE {
-    return kTraceEventRingBufferSize;
+    return capacity_;
   }
 
  private:
-  static size_t NextIndex(size_t index) {
+  size_t NextIndex(size_t index) const {
     index++;
-    if (index >= kTraceEventRingBufferSize)
+    if (index >= capacity_)
       index = 0;
     return index;
   }
 
+  const size_t capacity_;
   size_t unused_event_index_;
   size_t oldest_event_index_;
   std::vector<TraceEvent> logged_events_;
@@ -187,8 +195,10 @@ class TraceBufferRingBuffer : public TraceBuffer {
 
 class TraceBufferVector : public TraceBuffer {
  public:
-  TraceBufferVector() : current_iteration_index_(0) {
-    logged_events_.reserve(kTraceEventInitialBufferSize);
+  explicit TraceBufferVector(size_t capacity)
+      : capacity_(capacity),
+        current_iteration_index_(0) {
+    logged_events_.reserve(std::min(capacity_, kTraceEventInitialBufferSize));
   }
 
   virtual ~TraceBufferVector() {
@@ -196,11 +206,10 @@ class TraceBufferVector : public TraceBuffer {
 
   virtual void AddEvent(const TraceEvent& event) OVERRIDE {
     // Note, we have two callers which need to be handled:
-    // - AddEventToMainBufferWhileLocked() which has two cases:
-    //   - called directly from AddTraceEventWithThreadIdAndTimeStamp()
-    //     which checks if buffer is full and does an early exit if full;
-    //   - called from ThreadLocalEventBuffer::FlushWhileLocked();
-    // - AddThreadNameMetadataEvents().
+    // - AddEventToMainBufferWhileLocked() called from
+    //   ThreadLocalEventBuffer::FlushChunkWhileLocked(), whose events were
+    //   only recorded if the buffer wasn't full yet;
+    // - AddMetadataEvents().
     // We can not DECHECK(!IsFull()) because we have to add the metadata
     // events and flush thread-local buffers even if the buffer is full.
     logged_events_.push_back(event);
@@ -216,7 +225,7 @@ class TraceBufferVector : public TraceBuffer {
   }
 
   virtual bool IsFull() const OVERRIDE {
-    return Size() >= kTraceEventVectorBufferSize;
+    return Size() >= capacity_;
   }
 
   virtual size_t CountEnabledByName(
@@ -243,10 +252,11 @@ class TraceBufferVector : public TraceBuffer {
   }
 
   virtual size_t Capacity() const OVERRIDE {
-    return kTraceEventVectorBufferSize;
+    return capacity_;
   }
 
  private:
+  const size_t capacity_;
   size_t current_iteration_index_;
   std::vector<TraceEvent> logged_events_;
 
@@ -722,7 +732,7 @@ void TraceSamplingThread::DefaultSampleCallback(TraceBucketData* bucket_data) {
   if (!category_and_name)
     return;
   const char* const combined =
-      reinterpret_cast<const char* const>(category_and_name);
+      reinterpret_cast<const char*>(category_and_name);
   const char* category_group;
   const char* name;
   ExtractCategoryAndName(combined, &category_group, &name);
@@ -781,30 +791,44 @@ TraceBucketData::~TraceBucketData() {
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-class TraceLog::ThreadLocalEventBuffer
-    : public MessageLoop::DestructionObserver {
+// Each thread that adds trace events gets its own buffer, so the common path
+// doesn't touch TraceLog::lock_. The pending events live in a chunk that is
+// handed between the owning thread and Flush() with a compare-and-swap on
+// |chunk_|: the owner claims the chunk (setting |chunk_| to 0) for the
+// duration of AddEvent() and publishes it again afterwards, and Flush() may
+// only steal a published chunk. Only filling up a chunk takes |lock_|, once
+// per kTraceEventThreadLocalBufferSize events.
+class TraceLog::ThreadLocalEventBuffer {
  public:
-  ThreadLocalEventBuffer(TraceLog* trace_log);
-  virtual ~ThreadLocalEventBuffer();
+  explicit ThreadLocalEventBuffer(TraceLog* trace_log);
+  ~ThreadLocalEventBuffer();
 
+  // Must be called on the owning thread.
   void AddEvent(const TraceEvent& event, NotificationHelper* notifier);
   void ReportOverhead(const TimeTicks& event_timestamp,
                       const TimeTicks& event_thread_timestamp);
 
+  // May be called on any thread. Moves the pending events into the main buffer
+  // unless the owning thread is adding an event right now.
+  void StealEventsWhileLocked(NotificationHelper* notifier);
+
+  // ThreadLocalStorage destructor, run when the owning thread exits.
+  static void OnThreadExit(void* buffer);
+
  private:
-  // MessageLoop::DestructionObserver
-  virtual void WillDestroyCurrentMessageLoop() OVERRIDE;
+  typedef std::vector<TraceEvent> Chunk;
 
-  void FlushWhileLocked(NotificationHelper* notifier);
+  // Takes ownership of the published chunk. Returns NULL if there is none,
+  // because it has been stolen by Flush() or not been created yet.
+  Chunk* ClaimChunk();
+  void PublishChunk(Chunk* chunk);
 
-  void CheckThisIsCurrentBuffer() {
-    DCHECK(trace_log_->thread_local_event_buffer_.Get() == this);
-  }
+  void FlushChunkWhileLocked(Chunk* chunk, NotificationHelper* notifier);
 
   // Since TraceLog is a leaky singleton, trace_log_ will always be valid
   // as long as the thread exists.
   TraceLog* trace_log_;
-  std::vector<TraceEvent> logged_events_;
+  subtle::AtomicWord /* Chunk* */ chunk_;
   int event_count_;
   TimeDelta overhead_;
 
@@ -813,25 +837,15 @@ class TraceLog::ThreadLocalEventBuffer
 
 TraceLog::ThreadLocalEventBuffer::ThreadLocalEventBuffer(TraceLog* trace_log)
     : trace_log_(trace_log),
+      chunk_(0),
       event_count_(0) {
-  logged_events_.reserve(kTraceEventThreadLocalBufferSize);
-
-  // ThreadLocalEventBuffer is created only if the thread has a message loop, so
-  // the following message_loop won't be NULL.
-  MessageLoop* message_loop = MessageLoop::current();
-  message_loop->AddDestructionObserver(this);
-
   AutoLock lock(trace_log->lock_);
-  trace_log->thread_message_loops_.insert(message_loop);
+  trace_log->thread_local_event_buffers_.push_back(this);
 }
 
 TraceLog::ThreadLocalEventBuffer::~ThreadLocalEventBuffer() {
-  CheckThisIsCurrentBuffer();
-  MessageLoop::current()->RemoveDestructionObserver(this);
-
   // Zero event_count_ happens in either of the following cases:
   // - no event generated for the thread;
-  // - the thread has no message loop;
   // - trace_event_overhead is disabled.
   if (event_count_) {
     const char* arg_names[2] = { "event_count", "average_overhead" };
@@ -842,33 +856,55 @@ TraceLog::ThreadLocalEventBuffer::~ThreadLocalEventBuffer() {
     trace_event_internal::SetTraceValue(
         overhead_.InMillisecondsF() / event_count_,
         &arg_types[1], &arg_values[1]);
-    logged_events_.push_back(TraceEvent(
+    NotificationHelper notifier(trace_log_);
+    AddEvent(TraceEvent(
         static_cast<int>(PlatformThread::CurrentId()),
         TimeTicks(), TimeTicks(), TRACE_EVENT_PHASE_METADATA,
         &g_category_group_enabled[g_category_metadata],
         "trace_event_overhead", trace_event_internal::kNoEventId,
         2, arg_names, arg_types, arg_values, NULL,
-        TRACE_EVENT_FLAG_NONE));
+        TRACE_EVENT_FLAG_NONE), &notifier);
+    notifier.SendNotificationIfAny();
   }
 
+  scoped_ptr<Chunk> chunk(ClaimChunk());
   NotificationHelper notifier(trace_log_);
   {
     AutoLock lock(trace_log_->lock_);
-    FlushWhileLocked(&notifier);
-    trace_log_->thread_message_loops_.erase(MessageLoop::current());
+    if (chunk)
+      FlushChunkWhileLocked(chunk.get(), &notifier);
+    std::vector<ThreadLocalEventBuffer*>& buffers =
+        trace_log_->thread_local_event_buffers_;
+    buffers.erase(std::find(buffers.begin(), buffers.end(), this));
   }
-  trace_log_->thread_local_event_buffer_.Set(NULL);
   notifier.SendNotificationIfAny();
 }
 
+TraceLog::ThreadLocalEventBuffer::Chunk*
+TraceLog::ThreadLocalEventBuffer::ClaimChunk() {
+  subtle::AtomicWord chunk = subtle::NoBarrier_Load(&chunk_);
+  if (!chunk || subtle::Acquire_CompareAndSwap(&chunk_, chunk, 0) != chunk)
+    return NULL;
+  return reinterpret_cast<Chunk*>(chunk);
+}
+
+void TraceLog::ThreadLocalEventBuffer::PublishChunk(Chunk* chunk) {
+  subtle::Release_Store(&chunk_, reinterpret_cast<subtle::AtomicWord>(chunk));
+}
+
 void TraceLog::ThreadLocalEventBuffer::AddEvent(const TraceEvent& event,
                                                 NotificationHelper* notifier) {
-  CheckThisIsCurrentBuffer();
-  logged_events_.push_back(event);
-  if (logged_events_.size() >= kTraceEventThreadLocalBufferSize) {
+  Chunk* chunk = ClaimChunk();
+  if (!chunk) {
+    chunk = new Chunk;
+    chunk->reserve(kTraceEventThreadLocalBufferSize);
+  }
+  chunk->push_back(event);
+  if (chunk->size() >= kTraceEventThreadLocalBufferSize) {
     AutoLock lock(trace_log_->lock_);
-    FlushWhileLocked(notifier);
+    FlushChunkWhileLocked(chunk, notifier);
   }
+  PublishChunk(chunk);
 }
 
 void TraceLog::ThreadLocalEventBuffer::ReportOverhead(
@@ -882,34 +918,44 @@ void TraceLog::ThreadLocalEventBuffer::ReportOverhead(
   TimeDelta overhead = now - event_timestamp;
   if (overhead.InMicroseconds() >= kOverheadReportThresholdInMicroseconds) {
     int thread_id = static_cast<int>(PlatformThread::CurrentId());
+    NotificationHelper notifier(trace_log_);
     // TODO(wangxianzhu): Use X event when it's ready.
-    logged_events_.push_back(TraceEvent(
+    AddEvent(TraceEvent(
         thread_id, event_timestamp, event_thread_timestamp,
         TRACE_EVENT_PHASE_BEGIN,
         &g_category_group_enabled[g_category_trace_event_overhead],
         "overhead",
-        0, 0, NULL, NULL, NULL, NULL, 0));
-    logged_events_.push_back(TraceEvent(
+        0, 0, NULL, NULL, NULL, NULL, 0), &notifier);
+    AddEvent(TraceEvent(
         thread_id, now, ThreadNow(),
         TRACE_EVENT_PHASE_END,
         &g_category_group_enabled[g_category_trace_event_overhead],
         "overhead",
-        0, 0, NULL, NULL, NULL, NULL, 0));
+        0, 0, NULL, NULL, NULL, NULL, 0), &notifier);
+    notifier.SendNotificationIfAny();
   }
   overhead_ += overhead;
 }
 
-void TraceLog::ThreadLocalEventBuffer::WillDestroyCurrentMessageLoop() {
-  delete this;
+void TraceLog::ThreadLocalEventBuffer::StealEventsWhileLocked(
+    NotificationHelper* notifier) {
+  scoped_ptr<Chunk> chunk(ClaimChunk());
+  if (chunk)
+    FlushChunkWhileLocked(chunk.get(), notifier);
 }
 
-void TraceLog::ThreadLocalEventBuffer::FlushWhileLocked(
-    NotificationHelper* notifier) {
+// static
+void TraceLog::ThreadLocalEventBuffer::OnThreadExit(void* buffer) {
+  delete static_cast<ThreadLocalEventBuffer*>(buffer);
+}
+
+void TraceLog::ThreadLocalEventBuffer::FlushChunkWhileLocked(
+    Chunk* chunk, NotificationHelper* notifier) {
   trace_log_->lock_.AssertAcquired();
-  for (size_t i = 0; i < logged_events_.size(); ++i) {
-    trace_log_->AddEventToMainBufferWhileLocked(logged_events_[i]);
+  for (size_t i = 0; i < chunk->size(); ++i) {
+    trace_log_->AddEventToMainBufferWhileLocked((*chunk)[i]);
   }
-  logged_events_.resize(0);
+  chunk->resize(0);
   trace_log_->CheckIfBufferIsFullWhileLocked(notifier);
 }
 
@@ -957,6 +1003,8 @@ TraceLog::Options TraceLog::TraceOptionsFromString(const std::string& options) {
       ret |= RECORD_CONTINUOUSLY;
     } else if (*iter == kEnableSampling) {
       ret |= ENABLE_SAMPLING;
+    } else if (*iter == kRecordBinary) {
+      ret |= RECORD_BINARY;
     } else {
       NOTREACHED();  // Unknown option provided.
     }
@@ -980,7 +1028,8 @@ TraceLog::TraceLog()
       trace_options_(RECORD_UNTIL_FULL),
       sampling_thread_handle_(0),
       category_filter_(CategoryFilter::kDefaultCategoryFilterString),
-      flush_count_(0) {
+      trace_buffer_capacity_(0),
+      thread_local_event_buffer_(&ThreadLocalEventBuffer::OnThreadExit) {
   // Trace is enabled or disabled on one thread while other threads are
   // accessing the enabled flag. We don't care whether edge-case events are
   // traced or not, so we allow races on the enabled flag to keep the trace
@@ -1016,6 +1065,9 @@ TraceLog::TraceLog()
 }
 
 TraceLog::~TraceLog() {
+  // Only reached through DeleteForTesting(). Keep exiting threads from
+  // flushing into a deleted TraceLog.
+  thread_local_event_buffer_.Free();
 }
 
 const unsigned char* TraceLog::GetCategoryGroupEnabled(
@@ -1127,9 +1179,6 @@ void TraceLog::SetEnabled(const CategoryFilter& category_filter,
   {
     AutoLock lock(lock_);
 
-    // Can't enable tracing when Flush() is in progress.
-    DCHECK(!flush_message_loop_proxy_.get());
-
     Options old_options = trace_options();
 
     if (enable_count_++ > 0) {
@@ -1284,13 +1333,31 @@ void TraceLog::SetNotificationCallback(
   notification_callback_ = cb;
 }
 
+void TraceLog::SetTraceBufferCapacity(size_t capacity) {
+  AutoLock lock(lock_);
+  trace_buffer_capacity_ = capacity;
+}
+
 TraceBuffer* TraceLog::GetTraceBuffer() {
   Options options = trace_options();
-  if (options & RECORD_CONTINUOUSLY)
-    return new TraceBufferRingBuffer();
-  else if (options & ECHO_TO_CONSOLE)
+  if (options & RECORD_CONTINUOUSLY) {
+    return new TraceBufferRingBuffer(trace_buffer_capacity_ ?
+        trace_buffer_capacity_ : kTraceEventRingBufferSize);
+  } else if (options & ECHO_TO_CONSOLE) {
     return new TraceBufferDiscardsEvents();
-  return new TraceBufferVector();
+  }
+  return new TraceBufferVector(trace_buffer_capacity_ ?
+      trace_buffer_capacity_ : kTraceEventVectorBufferSize);
+}
+
+TraceLog::ThreadLocalEventBuffer* TraceLog::GetThreadLocalEventBuffer() {
+  ThreadLocalEventBuffer* thread_local_event_buffer =
+      static_cast<ThreadLocalEventBuffer*>(thread_local_event_buffer_.Get());
+  if (!thread_local_event_buffer) {
+    thread_local_event_buffer = new ThreadLocalEventBuffer(this);
+    thread_local_event_buffer_.Set(thread_local_event_buffer);
+  }
+  return thread_local_event_buffer;
 }
 
 void TraceLog::AddEventToMainBufferWhileLocked(const TraceEvent& trace_event) {
@@ -1315,22 +1382,19 @@ void TraceLog::SetEventCallback(EventCallback cb) {
                           reinterpret_cast<subtle::AtomicWord>(cb));
 };
 
-// Flush() works as the following:
-// 1. Flush() is called in threadA whose message loop is saved in
-//    flush_message_loop_proxy_;
-// 2. If thread_message_loops_ is not empty, threadA posts task to each message
-//    loop to flush the thread local buffers; otherwise finish the flush;
-// 3. FlushCurrentThread() deletes the thread local event buffer:
-//    - The last batch of events of the thread are flushed into the main buffer;
-//    - The message loop will be removed from thread_message_loops_;
-//    If this is the last message loop, finish the flush;
-// 4. If any thread hasn't finish its flush in time, finish the flush.
+void TraceLog::FlushThreadLocalBuffersWhileLocked(
+    NotificationHelper* notifier) {
+  lock_.AssertAcquired();
+  for (size_t i = 0; i < thread_local_event_buffers_.size(); ++i)
+    thread_local_event_buffers_[i]->StealEventsWhileLocked(notifier);
+}
+
 void TraceLog::Flush(const TraceLog::OutputCallback& cb) {
   if (IsEnabled()) {
-    // Can't flush when tracing is enabled because otherwise PostTask would
-    // - it generates more trace events;
-    // - it deschedules the calling thread on some platforms causing inaccurate
-    //   timing of the trace events.
+    // Can't flush when tracing is enabled because otherwise
+    // - the thread-local buffers keep filling up while being collected;
+    // - flushing generates more trace events and deschedules the calling
+    //   thread on some platforms causing inaccurate timing of the trace events.
     scoped_refptr<RefCountedString> empty_result = new RefCountedString;
     if (!cb.is_null())
       cb.Run(empty_result, false);
@@ -1338,52 +1402,19 @@ void TraceLog::Flush(const TraceLog::OutputCallback& cb) {
     return;
   }
 
-  int flush_count;
-  {
-    AutoLock lock(lock_);
-    flush_count = ++flush_count_;
-    DCHECK(!flush_message_loop_proxy_.get());
-    flush_message_loop_proxy_ = MessageLoopProxy::current();
-    DCHECK(!thread_message_loops_.size() || flush_message_loop_proxy_.get());
-    flush_output_callback_ = cb;
-
-    if (thread_message_loops_.size()) {
-      for (hash_set<MessageLoop*>::const_iterator it =
-           thread_message_loops_.begin();
-           it != thread_message_loops_.end(); ++it) {
-        (*it)->PostTask(
-            FROM_HERE,
-            Bind(&TraceLog::FlushCurrentThread, Unretained(this), flush_count));
-      }
-      flush_message_loop_proxy_->PostDelayedTask(
-          FROM_HERE,
-          Bind(&TraceLog::OnFlushTimeout, Unretained(this), flush_count),
-          TimeDelta::FromMilliseconds(kThreadFlushTimeoutMs));
-      return;
-    }
-  }
-
-  FinishFlush(flush_count);
-}
-
-void TraceLog::FinishFlush(int flush_count) {
   scoped_ptr<TraceBuffer> previous_logged_events;
-  OutputCallback flush_output_callback;
-
+  NotificationHelper notifier(this);
   {
     AutoLock lock(lock_);
-    if (flush_count != flush_count_)
-      return;
+    FlushThreadLocalBuffersWhileLocked(&notifier);
 
     previous_logged_events.swap(logged_events_);
     logged_events_.reset(GetTraceBuffer());
     subtle::NoBarrier_Store(&buffer_is_full_, 0);
-    flush_message_loop_proxy_ = NULL;
-    flush_output_callback = flush_output_callback_;
-    flush_output_callback_.Reset();
   }
+  notifier.SendNotificationIfAny();
 
-  if (flush_output_callback.is_null())
+  if (cb.is_null())
     return;
 
   bool has_more_events = previous_logged_events->HasMoreEvents();
@@ -1403,46 +1434,44 @@ void TraceLog::FinishFlush(int flush_count) {
       has_more_events = previous_logged_events->HasMoreEvents();
     }
 
-    flush_output_callback.Run(json_events_str_ptr, has_more_events);
+    cb.Run(json_events_str_ptr, has_more_events);
   } while (has_more_events);
 }
 
-// Run in each thread holding a local event buffer.
-void TraceLog::FlushCurrentThread(int flush_count) {
-  {
-    AutoLock lock(lock_);
-    if (flush_count != flush_count_ || !flush_message_loop_proxy_) {
-      // This is late. The corresponding flush has finished.
-      return;
-    }
-  }
-
-  delete thread_local_event_buffer_.Get();
+namespace {
 
-  {
-    AutoLock lock(lock_);
-    if (flush_count != flush_count_ || !flush_message_loop_proxy_ ||
-        thread_message_loops_.size())
-      return;
+void WriteTraceChunkToFile(FILE* file, const std::string& chunk) {
+  fwrite(chunk.data(), 1, chunk.size(), file);
+}
 
-    flush_message_loop_proxy_->PostTask(
-        FROM_HERE,
-        Bind(&TraceLog::FinishFlush, Unretained(this), flush_count));
-  }
+void AddTraceFragment(TraceResultBuffer* result_buffer,
+                      const scoped_refptr<RefCountedString>& events,
+                      bool has_more_events) {
+  if (!events->data().empty())
+    result_buffer->AddFragment(events->data());
 }
 
-void TraceLog::OnFlushTimeout(int flush_count) {
-  {
-    AutoLock lock(lock_);
-    if (flush_count != flush_count_ || !flush_message_loop_proxy_) {
-      // Flush has finished before timeout.
-      return;
-    }
+}  // namespace
 
-    LOG(WARNING) << thread_message_loops_.size() << " threads haven't finished"
-                 << " flush in time. Discarding remaining events of them";
+bool TraceLog::FlushToFile(const FilePath& path) {
+  if (IsEnabled()) {
+    LOG(WARNING) << "Ignored TraceLog::FlushToFile called when tracing is "
+                 << "enabled";
+    return false;
   }
-  FinishFlush(flush_count);
+
+  FILE* file = file_util::OpenFile(path, "w");
+  if (!file)
+    return false;
+
+  TraceResultBuffer result_buffer;
+  result_buffer.SetOutputCallback(Bind(&WriteTraceChunkToFile, file));
+  result_buffer.Start();
+  Flush(Bind(&AddTraceFragment, Unretained(&result_buffer)));
+  result_buffer.Finish();
+
+  bool success = !ferror(file);
+  return file_util::CloseFile(file) && success;
 }
 
 void TraceLog::AddTraceEvent(
@@ -1494,21 +1523,21 @@ void TraceLog::AddTraceEventWithThreadIdAndTimestamp(
   TimeTicks now = timestamp - time_offset_;
   TimeTicks thread_now = ThreadNow();
 
+#if defined(OS_POSIX)
+  if (trace_options() & RECORD_BINARY) {
+    // Bypass the trace buffer entirely; the events go to the binary rings.
+    BinaryTraceRecorder::GetInstance()->AddTraceEvent(
+        thread_id, now, thread_now, phase,
+        GetCategoryGroupName(category_group_enabled), name, id,
+        num_args, arg_names, arg_types, arg_values, flags);
+    return;
+  }
+#endif
+
   NotificationHelper notifier(this);
 
-  ThreadLocalEventBuffer* thread_local_event_buffer = NULL;
-  // A ThreadLocalEventBuffer needs the message loop
-  // - to know when the thread exits;
-  // - to handle the final flush.
-  // For a thread without a message loop, the trace events will be added into
-  // the main buffer directly.
-  if (MessageLoop::current()) {
-    thread_local_event_buffer = thread_local_event_buffer_.Get();
-    if (!thread_local_event_buffer) {
-      thread_local_event_buffer = new ThreadLocalEventBuffer(this);
-      thread_local_event_buffer_.Set(thread_local_event_buffer);
-    }
-  }
+  ThreadLocalEventBuffer* thread_local_event_buffer =
+      GetThreadLocalEventBuffer();
 
   // Check and update the current thread name only if the event is for the
   // current thread to avoid locks in most cases.
@@ -1587,13 +1616,7 @@ void TraceLog::AddTraceEventWithThreadIdAndTimestamp(
         thread_event_start_times_[thread_id].push(timestamp);
     }
 
-    if (thread_local_event_buffer) {
-      thread_local_event_buffer->AddEvent(trace_event, &notifier);
-    } else {
-      AutoLock lock(lock_);
-      AddEventToMainBufferWhileLocked(trace_event);
-      CheckIfBufferIsFullWhileLocked(&notifier);
-    }
+    thread_local_event_buffer->AddEvent(trace_event, &notifier);
   }
 
   if (reinterpret_cast<const unsigned char*>(subtle::NoBarrier_Load(
@@ -1612,8 +1635,7 @@ void TraceLog::AddTraceEventWithThreadIdAndTimestamp(
                    flags);
   }
 
-  if (thread_local_event_buffer)
-    thread_local_event_buffer->ReportOverhead(now, thread_now);
+  thread_local_event_buffer->ReportOverhead(now, thread_now);
 }
 
 void TraceLog::AddTraceEventEtw(char phase,
@@ -1644,6 +1666,7 @@ void TraceLog::SetWatchEvent(const std::string& category_name,
   const unsigned char* category = GetCategoryGroupEnabled(
       category_name.c_str());
   size_t notify_count = 0;
+  NotificationHelper buffer_notifier(this);
   {
     AutoLock lock(lock_);
     subtle::NoBarrier_Store(&watch_category_,
@@ -1651,9 +1674,12 @@ void TraceLog::SetWatchEvent(const std::string& category_name,
     watch_event_name_ = event_name;
 
     // First, search existing events for watch event because we want to catch
-    // it even if it has already occurred.
+    // it even if it has already occurred. Those still in thread-local buffers
+    // have to be moved into the main buffer to be seen.
+    FlushThreadLocalBuffersWhileLocked(&buffer_notifier);
     notify_count = logged_events_->CountEnabledByName(category, event_name);
   }  // release lock
+  buffer_notifier.SendNotificationIfAny();
 
   // Send notification for each event found.
   for (size_t i = 0; i < notify_count; ++i) {
@@ -1755,6 +1781,18 @@ void TraceLog::InstallWaitableEventForSamplingTesting(
   sampling_thread_->InstallWaitableEventForSamplingTesting(waitable_event);
 }
 
+size_t TraceLog::GetEventsSize() {
+  NotificationHelper notifier(this);
+  size_t size;
+  {
+    AutoLock lock(lock_);
+    FlushThreadLocalBuffersWhileLocked(&notifier);
+    size = logged_events_->Size();
+  }
+  notifier.SendNotificationIfAny();
+  return size;
+}
+
 void TraceLog::DeleteForTesting() {
   DeleteTraceLogForTesting::Delete();
 }
@@ -20,9 +20,9 @@
 #include "base/strings/string_util.h"
 #include "base/synchronization/condition_variable.h"
 #include "base/synchronization/lock.h"
-#include "base/threading/thread.h"
-#include "base/threading/thread_local.h"
-#include "base/timer/timer.h"
+#include "base/threading/platform_thread.h"
+#include "base/threading/thread_local_storage.h"
+#include "base/time/time.h"
 
 // Older style trace macros with explicit id and extra data
 // Only these macros result in publishing data to ETW as currently implemented.
@@ -44,21 +44,10 @@
 template <typename Type>
 struct DefaultSingletonTraits;
 
-#if defined(COMPILER_GCC)
-namespace BASE_HASH_NAMESPACE {
-template <>
-struct hash<base::MessageLoop*> {
-  std::size_t operator()(base::MessageLoop* value) const {
-    return reinterpret_cast<std::size_t>(value);
-  }
-};
-}  // BASE_HASH_NAMESPACE
-#endif
-
 namespace base {
 
+class FilePath;
 class WaitableEvent;
-class MessageLoop;
 
 namespace debug {
 
@@ -313,6 +302,11 @@ class BASE_EXPORT TraceLog {
 
     // Echo to console. Events are discarded.
     ECHO_TO_CONSOLE = 1 << 3,
+
+    // Write events to the memory-mapped files of BinaryTraceRecorder, which
+    // must have been started, instead of the trace buffer. Flush() returns
+    // nothing; use ConvertBinaryTraceToJSON(). POSIX only.
+    RECORD_BINARY = 1 << 4,
   };
 
   static TraceLog* GetInstance();
@@ -396,18 +390,32 @@ class BASE_EXPORT TraceLog {
   void SetEventCallback(EventCallback cb);
 
   // Flush all collected events to the given output callback. The callback will
-  // be called one or more times either synchronously or asynchronously from
-  // the current thread with IPC-bite-size chunks. The string format is
-  // undefined. Use TraceResultBuffer to convert one or more trace strings to
-  // JSON. The callback can be null if the caller doesn't want any data.
-  // Due to the implementation of thread-local buffers, flush can't be
-  // done when tracing is enabled. If called when tracing is enabled, the
-  // callback will be called directly with (empty_string, false) to indicate
-  // the end of this unsuccessful flush.
+  // be called synchronously one or more times from the current thread with
+  // IPC-bite-size chunks. The string format is undefined. Use
+  // TraceResultBuffer to convert one or more trace strings to JSON. The
+  // callback can be null if the caller doesn't want any data.
+  // Events still sitting in the thread-local buffers of other threads are
+  // collected without waiting on those threads; an event that a thread is in
+  // the middle of adding when Flush() runs lands in the next flush instead.
+  // Flush can't be done when tracing is enabled. If called when tracing is
+  // enabled, the callback will be called directly with (empty_string, false)
+  // to indicate the end of this unsuccessful flush.
   typedef base::Callback<void(const scoped_refptr<base::RefCountedString>&,
                               bool has_more_events)> OutputCallback;
   void Flush(const OutputCallback& cb);
 
+  // Flushes all collected events into |path| as a Chrome JSON trace (a JSON
+  // array of trace events, loadable by chrome://tracing). Returns false if
+  // tracing is still enabled or the file can't be written.
+  bool FlushToFile(const FilePath& path);
+
+  // Sets the maximum number of events held by the main trace buffer. Zero
+  // restores the default for the current recording mode. RECORD_UNTIL_FULL
+  // stops recording once this many events were logged; RECORD_CONTINUOUSLY
+  // keeps the most recent ones. Takes effect the next time the buffer is
+  // created, i.e. when tracing is enabled with new options or after a flush.
+  void SetTraceBufferCapacity(size_t capacity);
+
   // Called by TRACE_EVENT* macros, don't call this directly.
   // The name parameter is a category group for example:
   // TRACE_EVENT0("renderer,webkit", "WebViewImpl::HandleInputEvent")
@@ -469,8 +477,9 @@ class BASE_EXPORT TraceLog {
   // Allows deleting our singleton instance.
   static void DeleteForTesting();
 
-  // Allow tests to inspect TraceEvents.
-  size_t GetEventsSize() const { return logged_events_->Size(); }
+  // Allow tests to inspect TraceEvents. GetEventsSize() first moves the
+  // events pending in the thread-local buffers into the main buffer.
+  size_t GetEventsSize();
   const TraceEvent& GetEventAt(size_t index) const {
     return logged_events_->GetEventAt(index);
   }
@@ -574,14 +583,13 @@ class BASE_EXPORT TraceLog {
 #endif
 
   TraceBuffer* GetTraceBuffer();
+  ThreadLocalEventBuffer* GetThreadLocalEventBuffer();
 
   void AddEventToMainBufferWhileLocked(const TraceEvent& trace_event);
   void CheckIfBufferIsFullWhileLocked(NotificationHelper* notifier);
-  // |flush_count| is used in the following callbacks to check if the callback
-  // is called for the current flush.
-  void FlushCurrentThread(int flush_count);
-  void FinishFlush(int flush_count);
-  void OnFlushTimeout(int flush_count);
+  // Moves the pending events of every thread-local buffer that isn't being
+  // written to right now into the main buffer.
+  void FlushThreadLocalBuffersWhileLocked(NotificationHelper* notifier);
 
   // This lock protects TraceLog member accesses from arbitrary threads.
   Lock lock_;
@@ -624,17 +632,15 @@ class BASE_EXPORT TraceLog {
 
   CategoryFilter category_filter_;
 
-  ThreadLocalPointer<ThreadLocalEventBuffer> thread_local_event_buffer_;
+  // Maximum number of events in |logged_events_|, 0 for the default.
+  size_t trace_buffer_capacity_;
 
-  // Contains the message loops of threads that have had at least one event
-  // added into the local event buffer. Not using MessageLoopProxy because we
-  // need to know the life time of the message loops.
-  base::hash_set<MessageLoop*> thread_message_loops_;
+  // Owned by the thread they belong to and deleted when that thread exits.
+  ThreadLocalStorage::Slot thread_local_event_buffer_;
 
-  // Set when asynchronous Flush is in progress.
-  OutputCallback flush_output_callback_;
-  scoped_refptr<MessageLoopProxy> flush_message_loop_proxy_;
-  int flush_count_;
+  // All live thread-local buffers, so that Flush() can collect their events.
+  // Protected by |lock_|.
+  std::vector<ThreadLocalEventBuffer*> thread_local_event_buffers_;
 
   DISALLOW_COPY_AND_ASSIGN(TraceLog);
 };
@@ -6,19 +6,23 @@
 
 #include <cstdlib>
 
+#include "base/at_exit.h"
 #include "base/bind.h"
 #include "base/command_line.h"
 #include "base/debug/trace_event.h"
+#include "base/file_util.h"
+#include "base/files/scoped_temp_dir.h"
 #include "base/json/json_reader.h"
 #include "base/json/json_writer.h"
 #include "base/memory/ref_counted_memory.h"
 #include "base/memory/scoped_ptr.h"
+#include "base/memory/scoped_vector.h"
 #include "base/memory/singleton.h"
 #include "base/process/process_handle.h"
 #include "base/strings/stringprintf.h"
 #include "base/synchronization/waitable_event.h"
 #include "base/threading/platform_thread.h"
-#include "base/threading/thread.h"
+#include "base/threading/simple_thread.h"
 #include "base/values.h"
 #include "testing/gmock/include/gmock/gmock.h"
 #include "testing/gtest/include/gtest/gtest.h"
@@ -1317,18 +1321,53 @@ TEST_F(TraceEventTestFixture, StaticStringVsString) {
   }
 }
 
+// Runs a task on a thread of its own, then waits for |exit_event|, if any,
+// before the thread exits.
+class ClosureThreadDelegate : public DelegateSimpleThread::Delegate {
+ public:
+  ClosureThreadDelegate(const Closure& task, WaitableEvent* exit_event)
+      : task_(task),
+        exit_event_(exit_event) {
+  }
+
+  virtual void Run() OVERRIDE {
+    task_.Run();
+    if (exit_event_)
+      exit_event_->Wait();
+  }
+
+ private:
+  Closure task_;
+  WaitableEvent* exit_event_;
+};
+
+class TraceManyInstantEventsDelegate : public DelegateSimpleThread::Delegate {
+ public:
+  TraceManyInstantEventsDelegate(int thread_id, int num_events)
+      : thread_id_(thread_id),
+        num_events_(num_events) {
+  }
+
+  virtual void Run() OVERRIDE {
+    TraceManyInstantEvents(thread_id_, num_events_, NULL);
+  }
+
+ private:
+  int thread_id_;
+  int num_events_;
+};
+
 // Test that data sent from other threads is gathered
 TEST_F(TraceEventTestFixture, DataCapturedOnThread) {
   BeginTrace();
 
-  Thread thread("1");
   WaitableEvent task_complete_event(false, false);
+  ClosureThreadDelegate delegate(
+      base::Bind(&TraceWithAllMacroVariants, &task_complete_event), NULL);
+  DelegateSimpleThread thread(&delegate, "1");
   thread.Start();
-
-  thread.message_loop()->PostTask(
-      FROM_HERE, base::Bind(&TraceWithAllMacroVariants, &task_complete_event));
   task_complete_event.Wait();
-  thread.Stop();
+  thread.Join();
 
   EndTraceAndFlush();
   ValidateAllTraceMacrosCreatedData(trace_parsed_);
@@ -1340,15 +1379,20 @@ TEST_F(TraceEventTestFixture, DataCapturedManyThreads) {
 
   const int num_threads = 4;
   const int num_events = 4000;
-  Thread* threads[num_threads];
-  WaitableEvent* task_complete_events[num_threads];
+  ScopedVector<ClosureThreadDelegate> delegates;
+  ScopedVector<DelegateSimpleThread> threads;
+  ScopedVector<WaitableEvent> task_complete_events;
+  ScopedVector<WaitableEvent> exit_events;
   for (int i = 0; i < num_threads; i++) {
-    threads[i] = new Thread(StringPrintf("Thread %d", i).c_str());
-    task_complete_events[i] = new WaitableEvent(false, false);
+    task_complete_events.push_back(new WaitableEvent(false, false));
+    exit_events.push_back(new WaitableEvent(false, false));
+    delegates.push_back(new ClosureThreadDelegate(
+        base::Bind(&TraceManyInstantEvents,
+                   i, num_events, task_complete_events[i]),
+        exit_events[i]));
+    threads.push_back(new DelegateSimpleThread(
+        delegates[i], StringPrintf("Thread %d", i)));
     threads[i]->Start();
-    threads[i]->message_loop()->PostTask(
-        FROM_HERE, base::Bind(&TraceManyInstantEvents,
-                              i, num_events, task_complete_events[i]));
   }
 
   for (int i = 0; i < num_threads; i++) {
@@ -1357,64 +1401,83 @@ TEST_F(TraceEventTestFixture, DataCapturedManyThreads) {
 
   // Let half of the threads end before flush.
   for (int i = 0; i < num_threads / 2; i++) {
-    threads[i]->Stop();
-    delete threads[i];
-    delete task_complete_events[i];
+    exit_events[i]->Signal();
+    threads[i]->Join();
   }
 
   WaitableEvent flush_complete_event(false, false);
-  Thread flush_thread("flush");
+  ClosureThreadDelegate flush_delegate(
+      base::Bind(&TraceEventTestFixture::EndTraceAndFlushAsync,
+                 base::Unretained(this),
+                 &flush_complete_event),
+      NULL);
+  DelegateSimpleThread flush_thread(&flush_delegate, "flush");
   flush_thread.Start();
-  flush_thread.message_loop()->PostTask(FROM_HERE,
-    base::Bind(&TraceEventTestFixture::EndTraceAndFlushAsync,
-               base::Unretained(this),
-               &flush_complete_event));
   flush_complete_event.Wait();
+  flush_thread.Join();
   ValidateInstantEventPresentOnEveryThread(trace_parsed_,
                                            num_threads, num_events);
 
   // Let the other half of the threads end after flush.
   for (int i = num_threads / 2; i < num_threads; i++) {
-    threads[i]->Stop();
-    delete threads[i];
-    delete task_complete_events[i];
+    exit_events[i]->Signal();
+    threads[i]->Join();
   }
 }
 
+// Test that data sent from threads without a message loop is gathered,
+// including the partially filled thread-local buffers of exited threads.
+TEST_F(TraceEventTestFixture, DataCapturedOnSimpleThreads) {
+  BeginTrace();
+
+  const int num_threads = 4;
+  const int num_events = 4001;
+  ScopedVector<TraceManyInstantEventsDelegate> delegates;
+  ScopedVector<DelegateSimpleThread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    delegates.push_back(new TraceManyInstantEventsDelegate(i, num_events));
+    threads.push_back(new DelegateSimpleThread(
+        delegates[i], StringPrintf("Thread %d", i)));
+    threads[i]->Start();
+  }
+
+  // The threads exit before the flush, so their remaining events have to be
+  // handed over by the thread-local buffer destructors.
+  for (int i = 0; i < num_threads; i++)
+    threads[i]->Join();
+
+  EndTraceAndFlush();
+  ValidateInstantEventPresentOnEveryThread(trace_parsed_,
+                                           num_threads, num_events);
+}
+
 // Test that thread and process names show up in the trace
 TEST_F(TraceEventTestFixture, ThreadNames) {
   // Create threads before we enable tracing to make sure
   // that tracelog still captures them.
   const int num_threads = 4;
   const int num_events = 10;
-  Thread* threads[num_threads];
+  ScopedVector<TraceManyInstantEventsDelegate> delegates;
+  ScopedVector<DelegateSimpleThread> threads;
   PlatformThreadId thread_ids[num_threads];
-  for (int i = 0; i < num_threads; i++)
-    threads[i] = new Thread(StringPrintf("Thread %d", i).c_str());
+  for (int i = 0; i < num_threads; i++) {
+    delegates.push_back(new TraceManyInstantEventsDelegate(i, num_events));
+    threads.push_back(new DelegateSimpleThread(
+        delegates[i], StringPrintf("Thread %d", i)));
+  }
 
   // Enable tracing.
   BeginTrace();
 
   // Now run some trace code on these threads.
-  WaitableEvent* task_complete_events[num_threads];
   for (int i = 0; i < num_threads; i++) {
-    task_complete_events[i] = new WaitableEvent(false, false);
     threads[i]->Start();
-    thread_ids[i] = threads[i]->thread_id();
-    threads[i]->message_loop()->PostTask(
-        FROM_HERE, base::Bind(&TraceManyInstantEvents,
-                              i, num_events, task_complete_events[i]));
-  }
-  for (int i = 0; i < num_threads; i++) {
-    task_complete_events[i]->Wait();
+    thread_ids[i] = threads[i]->tid();
   }
 
   // Shut things down.
-  for (int i = 0; i < num_threads; i++) {
-    threads[i]->Stop();
-    delete threads[i];
-    delete task_complete_events[i];
-  }
+  for (int i = 0; i < num_threads; i++)
+    threads[i]->Join();
 
   EndTraceAndFlush();
 
@@ -1605,6 +1668,63 @@ TEST_F(TraceEventTestFixture, TraceResultBuffer) {
   EXPECT_STREQ(json_output_.json_output.c_str(), "[bla1,bla2,bla3,bla4]");
 }
 
+// Returns the largest "event" argument of the events traced by
+// TraceManyInstantEvents(), or -1 if there are none.
+int FindLastInstantEventIndex(const ListValue& trace_parsed) {
+  int last_event = -1;
+  for (size_t i = 0; i < trace_parsed.GetSize(); i++) {
+    const DictionaryValue* dict = NULL;
+    int event = -1;
+    if (trace_parsed.GetDictionary(i, &dict) &&
+        dict->GetInteger("args.event", &event)) {
+      last_event = std::max(last_event, event);
+    }
+  }
+  return last_event;
+}
+
+// Test that SetTraceBufferCapacity() bounds both recording modes.
+TEST_F(TraceEventTestFixture, TraceBufferCapacity) {
+  const size_t kCapacity = 100;
+  TraceLog::GetInstance()->SetTraceBufferCapacity(kCapacity);
+
+  TraceLog::GetInstance()->SetEnabled(CategoryFilter("*"),
+                                      TraceLog::RECORD_CONTINUOUSLY);
+  TraceManyInstantEvents(0, 1000, NULL);
+  EndTraceAndFlush();
+  EXPECT_LE(trace_parsed_.GetSize(), kCapacity);
+  // The ring buffer keeps the most recent events.
+  EXPECT_EQ(999, FindLastInstantEventIndex(trace_parsed_));
+
+  Clear();
+  BeginTrace();
+  TraceManyInstantEvents(0, 1000, NULL);
+  EndTraceAndFlush();
+  EXPECT_TRUE(notifications_received_ & TraceLog::TRACE_BUFFER_FULL);
+  EXPECT_GT(999, FindLastInstantEventIndex(trace_parsed_));
+}
+
+// Test that FlushToFile() writes a complete JSON trace.
+TEST_F(TraceEventTestFixture, FlushToFile) {
+  ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  FilePath trace_file = temp_dir.path().AppendASCII("trace.json");
+
+  BeginTrace();
+  EXPECT_FALSE(TraceLog::GetInstance()->FlushToFile(trace_file));
+  TraceManyInstantEvents(0, 2000, NULL);
+  TraceLog::GetInstance()->SetDisabled();
+  ASSERT_TRUE(TraceLog::GetInstance()->FlushToFile(trace_file));
+
+  std::string contents;
+  ASSERT_TRUE(base::ReadFileToString(trace_file, &contents));
+  scoped_ptr<Value> root(base::JSONReader::Read(contents));
+  ListValue* root_list = NULL;
+  ASSERT_TRUE(root.get());
+  ASSERT_TRUE(root->GetAsList(&root_list));
+  EXPECT_LE(2000u, root_list->GetSize());
+}
+
 // Test that trace_event parameters are not evaluated if the tracing
 // system is disabled.
 TEST_F(TraceEventTestFixture, TracingIsLazy) {
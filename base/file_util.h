@@ -53,8 +53,9 @@ BASE_EXPORT FilePath MakeAbsoluteFilePath(const FilePath& input);
 // Returns the total number of bytes used by all the files under |root_path|.
 // If the path does not exist the function returns 0.
 //
-// This function is implemented using the FileEnumerator class so it is not
-// particularly speedy in any platform.
+// Links are followed, into directories too. On POSIX, each directory reached
+// through a link is counted once, so that loops of links end; the
+// directories are read in parallel, and only the files are stat()ed.
 BASE_EXPORT int64 ComputeDirectorySize(const FilePath& root_path);
 
 // Deletes the given path, whether it's a file or a directory.
@@ -112,6 +113,16 @@ BASE_EXPORT bool CopyDirectory(const FilePath& from_path,
                                const FilePath& to_path,
                                bool recursive);
 
+#if defined(OS_POSIX)
+// As CopyDirectory(), copying the files on |num_threads| threads once the
+// directories are created. Faster for trees of many or large files, which
+// the storage copies in parallel.
+BASE_EXPORT bool CopyDirectoryInParallel(const FilePath& from_path,
+                                         const FilePath& to_path,
+                                         bool recursive,
+                                         int num_threads);
+#endif
+
 // Returns true if the given path exists on the local filesystem,
 // false otherwise.
 BASE_EXPORT bool PathExists(const FilePath& path);
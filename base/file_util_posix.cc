@@ -13,6 +13,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/errno.h>
+#include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <sys/param.h>
 #include <sys/stat.h>
@@ -28,8 +29,15 @@
 //#include <glib.h>
 #endif
 
+#if defined(OS_LINUX)
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#endif
+
+#include <algorithm>
 #include <fstream>
 
+#include "base/atomicops.h"
 #include "base/basictypes.h"
 #include "base/files/file_enumerator.h"
 #include "base/files/file_path.h"
@@ -44,6 +52,7 @@
 #include "base/strings/sys_string_conversions.h"
 #include "base/strings/utf_string_conversions.h"
 #include "base/sys_info.h"
+#include "base/threading/simple_thread.h"
 #include "base/time/time.h"
 
 #if defined(OS_ANDROID)
@@ -137,6 +146,53 @@ std::string TempFileName() {
 #endif
 }
 
+#if defined(OS_LINUX)
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+
+// Makes |outfile| share the extents of |infile|, on filesystems supporting
+// reflinks such as btrfs and XFS. Nothing is copied until either is written.
+bool CloneFile(int infile, int outfile) {
+  return ioctl(outfile, FICLONE, infile) == 0;
+}
+
+// Copies up to |size| bytes from the position of |infile| to the position of
+// |outfile| without leaving the kernel, advancing both positions and
+// |copied|. Returns false if it did not get to copy all of them, which
+// happens on filesystems or kernels that do not support it.
+bool CopyFileRange(int infile, int outfile, int64 size, int64* copied) {
+#if defined(__NR_copy_file_range)
+  while (*copied < size) {
+    size_t chunk = std::min<int64>(size - *copied, 1 << 30);
+    ssize_t result = HANDLE_EINTR(syscall(__NR_copy_file_range, infile, NULL,
+                                          outfile, NULL, chunk, 0));
+    // 0 is returned at the end of files whose size is not known up front,
+    // such as those in /proc.
+    if (result <= 0)
+      return false;
+    *copied += result;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+// As CopyFileRange(), with sendfile(), which works across all filesystems
+// since Linux 2.6.33.
+bool SendFile(int infile, int outfile, int64 size, int64* copied) {
+  while (*copied < size) {
+    size_t chunk = std::min<int64>(size - *copied, 1 << 30);
+    ssize_t result = HANDLE_EINTR(sendfile(outfile, infile, NULL, chunk));
+    if (result <= 0)
+      return false;
+    *copied += result;
+  }
+  return true;
+}
+#endif  // defined(OS_LINUX)
+
 }  // namespace
 
 FilePath MakeAbsoluteFilePath(const FilePath& input) {
@@ -196,9 +252,52 @@ bool ReplaceFile(const FilePath& from_path,
   return false;
 }
 
-bool CopyDirectory(const FilePath& from_path,
-                   const FilePath& to_path,
-                   bool recursive) {
+namespace {
+
+// A file for CopyDirectoryInParallel() to copy.
+struct FileCopy {
+  FilePath from_path;
+  FilePath to_path;
+  int64 size;
+};
+
+bool LargerFirst(const FileCopy& a, const FileCopy& b) {
+  return a.size > b.size;
+}
+
+// Copies files of a list in order, each time it is run, on any thread.
+class FileCopier : public DelegateSimpleThread::Delegate {
+ public:
+  explicit FileCopier(const std::vector<FileCopy>* copies)
+      : copies_(copies), next_(0), failed_(0) {
+  }
+
+  virtual void Run() OVERRIDE {
+    size_t index = subtle::NoBarrier_AtomicIncrement(&next_, 1) - 1;
+    const FileCopy& copy = (*copies_)[index];
+    if (!CopyFile(copy.from_path, copy.to_path)) {
+      DLOG(ERROR) << "CopyDirectoryInParallel() couldn't create file: "
+                  << copy.to_path.value();
+      subtle::NoBarrier_Store(&failed_, 1);
+    }
+  }
+
+  bool succeeded() const { return !subtle::NoBarrier_Load(&failed_); }
+
+ private:
+  const std::vector<FileCopy>* copies_;
+  subtle::Atomic32 next_;
+  subtle::Atomic32 failed_;
+
+  DISALLOW_COPY_AND_ASSIGN(FileCopier);
+};
+
+// Copies |from_path| to |to_path| as CopyDirectory() does, except that files
+// are only appended to |file_copies|, if not NULL, rather than copied.
+bool CopyDirectoryInternal(const FilePath& from_path,
+                           const FilePath& to_path,
+                           bool recursive,
+                           std::vector<FileCopy>* file_copies) {
   // Some old callers of CopyDirectory want it to support wildcards.
   // After some discussion, we decided to fix those callers.
   // Break loudly here if anyone tries to do this.
@@ -277,6 +376,9 @@ bool CopyDirectory(const FilePath& from_path,
                     << target_path.value() << " errno = " << errno;
         success = false;
       }
+    } else if (S_ISREG(from_stat.st_mode) && file_copies) {
+      FileCopy copy = { current, target_path, from_stat.st_size };
+      file_copies->push_back(copy);
     } else if (S_ISREG(from_stat.st_mode)) {
       if (!CopyFile(current, target_path)) {
         DLOG(ERROR) << "CopyDirectory() couldn't create file: "
@@ -296,6 +398,38 @@ bool CopyDirectory(const FilePath& from_path,
   return success;
 }
 
+}  // namespace
+
+bool CopyDirectory(const FilePath& from_path,
+                   const FilePath& to_path,
+                   bool recursive) {
+  return CopyDirectoryInternal(from_path, to_path, recursive, NULL);
+}
+
+bool CopyDirectoryInParallel(const FilePath& from_path,
+                             const FilePath& to_path,
+                             bool recursive,
+                             int num_threads) {
+  DCHECK_GT(num_threads, 0);
+  std::vector<FileCopy> file_copies;
+  // As CopyDirectory() does, copy the files met before any failure.
+  const bool success =
+      CopyDirectoryInternal(from_path, to_path, recursive, &file_copies);
+  if (file_copies.empty())
+    return success;
+
+  // Largest first, so that no large file is left to copy after the rest.
+  std::sort(file_copies.begin(), file_copies.end(), &LargerFirst);
+  FileCopier copier(&file_copies);
+  DelegateSimpleThreadPool pool(
+      "copy_directory",
+      std::min<size_t>(num_threads, file_copies.size()));
+  pool.AddWork(&copier, file_copies.size());
+  pool.Start();
+  pool.JoinAll();
+  return success && copier.succeeded();
+}
+
 bool PathExists(const FilePath& path) {
   return access(path.value().c_str(), F_OK) == 0;
 }
@@ -883,9 +1017,28 @@ bool CopyFileUnsafe(const FilePath& from_path, const FilePath& to_path) {
     return false;
   }
 
+  bool result = true;
+#if defined(OS_LINUX)
+  // Copy without moving the data through user space where possible, and let
+  // the loop below finish whatever is left.
+  struct stat from_stat;
+  if (fstat(infile, &from_stat) == 0 && S_ISREG(from_stat.st_mode) &&
+      from_stat.st_size > 0) {
+    if (CloneFile(infile, outfile)) {
+      if (HANDLE_EINTR(close(infile)) < 0)
+        result = false;
+      if (HANDLE_EINTR(close(outfile)) < 0)
+        result = false;
+      return result;
+    }
+    int64 copied = 0;
+    if (!CopyFileRange(infile, outfile, from_stat.st_size, &copied))
+      SendFile(infile, outfile, from_stat.st_size, &copied);
+  }
+#endif
+
   const size_t kBufferSize = 32768;
   std::vector<char> buffer(kBufferSize);
-  bool result = true;
 
   while (result) {
     ssize_t bytes_read = HANDLE_EINTR(read(infile, &buffer[0], buffer.size()));
@@ -22,6 +22,7 @@
 #include "base/files/file_path.h"
 #include "base/files/scoped_temp_dir.h"
 #include "base/path_service.h"
+#include "base/strings/stringprintf.h"
 #include "base/strings/utf_string_conversions.h"
 #include "base/test/test_file_util.h"
 #include "base/threading/platform_thread.h"
@@ -272,6 +273,24 @@ TEST_F(FileUtilTest, FileAndDirectorySize) {
   EXPECT_EQ(size_f1 + size_f2 + 3, computed_size);
 }
 
+#if defined(OS_POSIX)
+TEST_F(FileUtilTest, DirectorySizeFollowsLinks) {
+  FilePath root = temp_dir_.path().Append(FPL("root"));
+  FilePath outside = temp_dir_.path().Append(FPL("outside"));
+  file_util::CreateDirectory(root);
+  file_util::CreateDirectory(outside);
+  CreateTextFile(root.Append(FPL("file")), L"1234567890");
+  CreateTextFile(outside.Append(FPL("file")), L"12345678901234567890");
+
+  // The linked directory is counted, once, and loops of links end.
+  ASSERT_TRUE(file_util::CreateSymbolicLink(outside, root.Append(FPL("a"))));
+  ASSERT_TRUE(file_util::CreateSymbolicLink(outside, root.Append(FPL("b"))));
+  ASSERT_TRUE(file_util::CreateSymbolicLink(root,
+                                            outside.Append(FPL("up"))));
+  EXPECT_EQ(30, base::ComputeDirectorySize(root));
+}
+#endif  // defined(OS_POSIX)
+
 TEST_F(FileUtilTest, NormalizeFilePathBasic) {
   // Create a directory under the test dir.  Because we create it,
   // we know it is not a link.
@@ -1429,6 +1448,98 @@ TEST_F(FileUtilTest, CopyFile) {
   EXPECT_TRUE(base::PathExists(dest_file2));
 }
 
+TEST_F(FileUtilTest, CopyLargeFile) {
+  // Large enough to be copied in the kernel, where supported.
+  std::string contents(5 * 1024 * 1024 + 7, 0);
+  for (size_t i = 0; i < contents.size(); ++i)
+    contents[i] = static_cast<char>(i * 13);
+  FilePath file_name_from =
+      temp_dir_.path().Append(FILE_PATH_LITERAL("Large_From.bin"));
+  ASSERT_EQ(static_cast<int>(contents.size()),
+            file_util::WriteFile(file_name_from, contents.data(),
+                                 contents.size()));
+
+  FilePath dest_file =
+      temp_dir_.path().Append(FILE_PATH_LITERAL("Large_To.bin"));
+  // Overwrites a longer file.
+  CreateTextFile(dest_file, std::wstring(6 * 1024 * 1024, L'x'));
+  ASSERT_TRUE(base::CopyFile(file_name_from, dest_file));
+
+  std::string copied;
+  ASSERT_TRUE(base::ReadFileToString(dest_file, &copied));
+  EXPECT_TRUE(contents == copied);
+
+  // An empty file.
+  FilePath empty_from =
+      temp_dir_.path().Append(FILE_PATH_LITERAL("Empty_From.bin"));
+  ASSERT_EQ(0, file_util::WriteFile(empty_from, "", 0));
+  ASSERT_TRUE(base::CopyFile(empty_from, dest_file));
+  int64 size = -1;
+  ASSERT_TRUE(file_util::GetFileSize(dest_file, &size));
+  EXPECT_EQ(0, size);
+}
+
+#if defined(OS_POSIX)
+TEST_F(FileUtilTest, CopyDirectoryInParallel) {
+  FilePath dir_name_from =
+      temp_dir_.path().Append(FILE_PATH_LITERAL("Copy_From_Subdir"));
+  std::vector<FilePath> files_from;
+  for (int i = 0; i < 3; ++i) {
+    FilePath subdir = dir_name_from.AppendASCII(base::StringPrintf("dir%d", i));
+    ASSERT_TRUE(file_util::CreateDirectory(subdir));
+    for (int j = 0; j < 10; ++j) {
+      files_from.push_back(subdir.AppendASCII(base::StringPrintf("f%d", j)));
+      std::string contents(i * 10000 + j, static_cast<char>('a' + j));
+      ASSERT_EQ(static_cast<int>(contents.size()),
+                file_util::WriteFile(files_from.back(), contents.data(),
+                                     contents.size()));
+    }
+  }
+
+  FilePath dir_name_to =
+      temp_dir_.path().Append(FILE_PATH_LITERAL("Copy_To_Subdir"));
+  EXPECT_TRUE(base::CopyDirectoryInParallel(dir_name_from, dir_name_to, true,
+                                            4));
+
+  for (size_t i = 0; i < files_from.size(); ++i) {
+    FilePath file_to(dir_name_to);
+    ASSERT_TRUE(dir_name_from.AppendRelativePath(files_from[i], &file_to));
+    std::string from_contents;
+    std::string to_contents;
+    ASSERT_TRUE(base::ReadFileToString(files_from[i], &from_contents));
+    ASSERT_TRUE(base::ReadFileToString(file_to, &to_contents));
+    EXPECT_EQ(from_contents, to_contents) << file_to.value();
+  }
+
+  // Copying into the source fails, as for CopyDirectory().
+  EXPECT_FALSE(base::CopyDirectoryInParallel(
+      dir_name_from, dir_name_from.AppendASCII("dir0"), true, 4));
+}
+
+TEST_F(FileUtilTest, CopyDirectoryInParallelPartialFailure) {
+  FilePath dir_name_from =
+      temp_dir_.path().Append(FILE_PATH_LITERAL("Copy_From_Subdir"));
+  FilePath file_name_from =
+      dir_name_from.Append(FILE_PATH_LITERAL("Copy_From_File.txt"));
+  ASSERT_TRUE(file_util::CreateDirectory(
+      dir_name_from.AppendASCII("sub").AppendASCII("deep")));
+  CreateTextFile(file_name_from, L"Gooooooooooooooooooooogle");
+
+  // The destination's "sub" is a file, so "sub/deep" can't be created. The
+  // top level, enumerated before it, is still copied.
+  FilePath dir_name_to =
+      temp_dir_.path().Append(FILE_PATH_LITERAL("Copy_To_Subdir"));
+  FilePath dir_name_exists = dir_name_to.Append(dir_name_from.BaseName());
+  ASSERT_TRUE(file_util::CreateDirectory(dir_name_exists));
+  CreateTextFile(dir_name_exists.AppendASCII("sub"), L"file");
+
+  EXPECT_FALSE(base::CopyDirectoryInParallel(dir_name_from, dir_name_to, true,
+                                             4));
+  EXPECT_EQ(L"Gooooooooooooooooooooogle",
+            ReadTextFile(dir_name_exists.Append(file_name_from.BaseName())));
+}
+#endif  // defined(OS_POSIX)
+
 // file_util winds up using autoreleased objects on the Mac, so this needs
 // to be a PlatformTest.
 typedef PlatformTest ReadOnlyFileUtilTest;
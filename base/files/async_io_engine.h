@@ -0,0 +1,200 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// AsyncIOEngine reads and writes PlatformFiles asynchronously, with many
+// operations in flight at once and a callback for each when it completes.
+// Operations are queued, then submitted in a batch:
+//
+//   scoped_ptr<AsyncIOEngine> engine =
+//       AsyncIOEngine::Create(AsyncIOEngine::Options());
+//   for (size_t i = 0; i < blocks.size(); ++i) {
+//     engine->Read(file, blocks[i].offset, blocks[i].data, blocks[i].size,
+//                  Bind(&OnBlockRead, i));
+//   }
+//   engine->Submit();
+//   // Runs the callbacks as the reads complete.
+//   while (engine->pending_operations())
+//     engine->ProcessCompletions(1);
+//
+// On Linux 5.1 and later the engine is backed by io_uring, which keeps tens
+// of thousands of operations in flight from a single thread. Elsewhere, or
+// when io_uring is not available, a pool of worker threads performs the
+// operations with blocking system calls.
+//
+// An engine is used on one thread, on which the callbacks run.
+
+#ifndef BASE_FILES_ASYNC_IO_ENGINE_H_
+#define BASE_FILES_ASYNC_IO_ENGINE_H_
+
+#include <sys/uio.h>
+
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/callback.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/platform_file.h"
+#include "base/threading/thread_checker.h"
+
+namespace base {
+
+class BASE_EXPORT AsyncIOEngine {
+ public:
+  // Receives the number of bytes transferred, which may be short, or a negated
+  // errno value on failure.
+  typedef Callback<void(int result)> CompletionCallback;
+
+  struct BASE_EXPORT Options {
+    Options();
+
+    // The size of the io_uring submission ring. Up to twice as many
+    // operations are in flight; more wait in the queue until some complete.
+    size_t queue_depth;
+
+    // The number of threads performing operations without io_uring.
+    int num_threads;
+
+    // Whether to use io_uring when the kernel supports it.
+    bool use_io_uring;
+  };
+
+  // Returns an engine backed by io_uring if possible, or worker threads.
+  static scoped_ptr<AsyncIOEngine> Create(const Options& options);
+
+  // Waits for the operations in flight to complete, without running their
+  // callbacks. Queued operations are dropped.
+  virtual ~AsyncIOEngine();
+
+  // Queue a read into, or a write from, the |size| bytes at |buffer|, at
+  // |offset| in |file|. The buffer must stay valid until the callback runs.
+  void Read(PlatformFile file,
+            int64 offset,
+            char* buffer,
+            int size,
+            const CompletionCallback& callback);
+  void Write(PlatformFile file,
+             int64 offset,
+             const char* buffer,
+             int size,
+             const CompletionCallback& callback);
+
+  // As above, for the |count| buffers of |iov|, which are copied.
+  void ReadV(PlatformFile file,
+             int64 offset,
+             const struct iovec* iov,
+             int count,
+             const CompletionCallback& callback);
+  void WriteV(PlatformFile file,
+              int64 offset,
+              const struct iovec* iov,
+              int count,
+              const CompletionCallback& callback);
+
+  // Registers |count| buffers for ReadFixed() and WriteFixed(), which saves
+  // io_uring from mapping them for every operation. Replaces the buffers
+  // registered before; must not be called with operations pending. Returns
+  // false on failure.
+  bool RegisterBuffers(const struct iovec* buffers, int count);
+
+  // As Read() and Write(), for |buffer|, which lies within registered buffer
+  // |buffer_index|.
+  void ReadFixed(PlatformFile file,
+                 int64 offset,
+                 int buffer_index,
+                 char* buffer,
+                 int size,
+                 const CompletionCallback& callback);
+  void WriteFixed(PlatformFile file,
+                  int64 offset,
+                  int buffer_index,
+                  const char* buffer,
+                  int size,
+                  const CompletionCallback& callback);
+
+  // Submits the queued operations, as many as fit in flight, in one batch.
+  // Returns the number submitted.
+  int Submit();
+
+  // Waits until at least |min_completions| operations, or all of the pending
+  // ones, have completed, then runs the callbacks of those that completed.
+  // Also submits the queued operations. Returns the number of callbacks run.
+  int ProcessCompletions(int min_completions);
+
+  // Returns the number of operations queued or in flight.
+  size_t pending_operations() const {
+    return queued_.size() + in_flight_;
+  }
+
+  // Returns whether operations go through io_uring.
+  virtual bool uses_io_uring() const = 0;
+
+ protected:
+  struct Operation {
+    enum Type {
+      READ,
+      WRITE,
+      READ_FIXED,
+      WRITE_FIXED,
+    };
+
+    Operation();
+    ~Operation();
+
+    Type type;
+    PlatformFile file;
+    int64 offset;
+    // A single buffer for the fixed operations.
+    std::vector<struct iovec> iovecs;
+    int buffer_index;
+    CompletionCallback callback;
+    int result;
+  };
+
+  AsyncIOEngine();
+
+  // Starts the operations at the front of |operations|, and removes the ones
+  // started from it.
+  virtual void StartOperations(std::vector<Operation*>* operations) = 0;
+
+  // Appends the operations that completed, with their results, to
+  // |completed|. If |wait|, blocks until at least one does. Returns false if
+  // the wait failed, in which case the operations that could not be started
+  // have completed with the error.
+  virtual bool ReapOperations(bool wait,
+                              std::vector<Operation*>* completed) = 0;
+
+  // Registers |buffers| with the kernel.
+  virtual bool RegisterBuffersImpl(const std::vector<struct iovec>& buffers) {
+    return true;
+  }
+
+  // Waits for the operations in flight and deletes them. To be called by the
+  // destructors of subclasses.
+  void AbandonOperations();
+
+  // Returns the number of operations started and not reaped.
+  size_t in_flight() const { return in_flight_; }
+
+ private:
+  void Queue(Operation::Type type,
+             PlatformFile file,
+             int64 offset,
+             const struct iovec* iov,
+             int count,
+             int buffer_index,
+             const CompletionCallback& callback);
+
+  std::vector<Operation*> queued_;
+  size_t in_flight_;
+  std::vector<struct iovec> registered_buffers_;
+
+  ThreadChecker thread_checker_;
+
+  DISALLOW_COPY_AND_ASSIGN(AsyncIOEngine);
+};
+
+}  // namespace base
+
+#endif  // BASE_FILES_ASYNC_IO_ENGINE_H_
@@ -0,0 +1,306 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/files/async_io_engine_linux.h"
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "base/atomicops.h"
+#include "base/logging.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/threading/platform_thread.h"
+#include "base/time/time.h"
+
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup 425
+#endif
+#ifndef __NR_io_uring_enter
+#define __NR_io_uring_enter 426
+#endif
+#ifndef __NR_io_uring_register
+#define __NR_io_uring_register 427
+#endif
+
+namespace base {
+
+namespace {
+
+int IOUringSetup(unsigned entries, struct io_uring_params* params) {
+  return syscall(__NR_io_uring_setup, entries, params);
+}
+
+int IOUringEnter(int fd,
+                 unsigned to_submit,
+                 unsigned min_complete,
+                 unsigned flags) {
+  return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags,
+                 NULL, 0);
+}
+
+int IOUringRegister(int fd, unsigned opcode, const void* arg, unsigned count) {
+  return syscall(__NR_io_uring_register, fd, opcode, arg, count);
+}
+
+// The ring indices are shared with the kernel.
+uint32 LoadAcquire(volatile uint32* index) {
+  return subtle::Acquire_Load(reinterpret_cast<volatile subtle::Atomic32*>(
+      index));
+}
+
+void StoreRelease(volatile uint32* index, uint32 value) {
+  subtle::Release_Store(reinterpret_cast<volatile subtle::Atomic32*>(index),
+                        value);
+}
+
+template <typename T>
+T* RingField(void* ring, uint32 offset) {
+  return reinterpret_cast<T*>(static_cast<char*>(ring) + offset);
+}
+
+}  // namespace
+
+// static
+scoped_ptr<AsyncIOEngine> IOUringAsyncIOEngine::Create(
+    const Options& options) {
+  scoped_ptr<IOUringAsyncIOEngine> engine(new IOUringAsyncIOEngine);
+  if (!engine->Init(options.queue_depth))
+    return scoped_ptr<AsyncIOEngine>();
+  return engine.PassAs<AsyncIOEngine>();
+}
+
+IOUringAsyncIOEngine::IOUringAsyncIOEngine()
+    : ring_fd_(-1),
+      sq_ring_(MAP_FAILED),
+      sq_ring_size_(0),
+      cq_ring_(MAP_FAILED),
+      cq_ring_size_(0),
+      sq_head_(NULL),
+      sq_tail_(NULL),
+      sq_array_(NULL),
+      sq_mask_(0),
+      sq_entries_(0),
+      sqes_(static_cast<struct io_uring_sqe*>(MAP_FAILED)),
+      sqes_size_(0),
+      cq_head_(NULL),
+      cq_tail_(NULL),
+      cq_mask_(0),
+      cq_entries_(0),
+      cqes_(NULL),
+      to_submit_(0),
+      buffers_registered_(false) {
+}
+
+IOUringAsyncIOEngine::~IOUringAsyncIOEngine() {
+  if (ring_fd_ >= 0)
+    AbandonOperations();
+  if (sqes_ != MAP_FAILED)
+    munmap(sqes_, sqes_size_);
+  if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_)
+    munmap(cq_ring_, cq_ring_size_);
+  if (sq_ring_ != MAP_FAILED)
+    munmap(sq_ring_, sq_ring_size_);
+  if (ring_fd_ >= 0)
+    ignore_result(HANDLE_EINTR(close(ring_fd_)));
+}
+
+bool IOUringAsyncIOEngine::uses_io_uring() const {
+  return true;
+}
+
+bool IOUringAsyncIOEngine::Init(size_t entries) {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring_fd_ = IOUringSetup(entries, &params);
+  if (ring_fd_ < 0) {
+    // ENOSYS before Linux 5.1, EPERM when disabled by sysctl or seccomp.
+    DPLOG(WARNING) << "io_uring_setup";
+    return false;
+  }
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32);
+  cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  const bool single_mapping = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mapping)
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+
+  sq_ring_ = mmap(NULL, sq_ring_size_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (sq_ring_ == MAP_FAILED) {
+    DPLOG(ERROR) << "mmap submission ring";
+    return false;
+  }
+  if (single_mapping) {
+    cq_ring_ = sq_ring_;
+  } else {
+    cq_ring_ = mmap(NULL, cq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+    if (cq_ring_ == MAP_FAILED) {
+      DPLOG(ERROR) << "mmap completion ring";
+      return false;
+    }
+  }
+  sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  sqes_ = static_cast<struct io_uring_sqe*>(
+      mmap(NULL, sqes_size_, PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES));
+  if (sqes_ == MAP_FAILED) {
+    DPLOG(ERROR) << "mmap submission entries";
+    return false;
+  }
+
+  sq_head_ = RingField<uint32>(sq_ring_, params.sq_off.head);
+  sq_tail_ = RingField<uint32>(sq_ring_, params.sq_off.tail);
+  sq_array_ = RingField<uint32>(sq_ring_, params.sq_off.array);
+  sq_mask_ = *RingField<uint32>(sq_ring_, params.sq_off.ring_mask);
+  sq_entries_ = params.sq_entries;
+  cq_head_ = RingField<uint32>(cq_ring_, params.cq_off.head);
+  cq_tail_ = RingField<uint32>(cq_ring_, params.cq_off.tail);
+  cq_mask_ = *RingField<uint32>(cq_ring_, params.cq_off.ring_mask);
+  cq_entries_ = params.cq_entries;
+  cqes_ = RingField<struct io_uring_cqe>(cq_ring_, params.cq_off.cqes);
+  return true;
+}
+
+void IOUringAsyncIOEngine::StartOperations(
+    std::vector<Operation*>* operations) {
+  // Only this thread moves the tail.
+  uint32 tail = *sq_tail_;
+  uint32 free_entries = sq_entries_ - (tail - LoadAcquire(sq_head_));
+  // Never more in flight than the completion ring holds, so that no
+  // completion is dropped.
+  size_t count = std::min(operations->size(),
+                          std::min<size_t>(free_entries,
+                                           cq_entries_ - in_flight()));
+  for (size_t i = 0; i < count; ++i) {
+    Operation* operation = (*operations)[i];
+    const uint32 index = tail & sq_mask_;
+    struct io_uring_sqe* sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->fd = operation->file;
+    sqe->off = operation->offset;
+    sqe->user_data = reinterpret_cast<uintptr_t>(operation);
+    switch (operation->type) {
+      case Operation::READ:
+      case Operation::WRITE:
+        sqe->opcode = operation->type == Operation::READ ? IORING_OP_READV
+                                                         : IORING_OP_WRITEV;
+        sqe->addr = reinterpret_cast<uintptr_t>(&operation->iovecs[0]);
+        sqe->len = operation->iovecs.size();
+        break;
+      case Operation::READ_FIXED:
+      case Operation::WRITE_FIXED:
+        DCHECK(buffers_registered_);
+        sqe->opcode = operation->type == Operation::READ_FIXED
+                          ? IORING_OP_READ_FIXED
+                          : IORING_OP_WRITE_FIXED;
+        sqe->addr = reinterpret_cast<uintptr_t>(operation->iovecs[0].iov_base);
+        sqe->len = operation->iovecs[0].iov_len;
+        sqe->buf_index = operation->buffer_index;
+        break;
+    }
+    sq_array_[index] = index;
+    ++tail;
+  }
+  operations->erase(operations->begin(), operations->begin() + count);
+  StoreRelease(sq_tail_, tail);
+  to_submit_ += count;
+  Enter(0);
+}
+
+bool IOUringAsyncIOEngine::ReapOperations(bool wait,
+                                          std::vector<Operation*>* completed) {
+  bool waited = true;
+  for (;;) {
+    // Only this thread moves the head.
+    uint32 head = *cq_head_;
+    const uint32 tail = LoadAcquire(cq_tail_);
+    const bool reaped = head != tail;
+    for (; head != tail; ++head) {
+      const struct io_uring_cqe* cqe = &cqes_[head & cq_mask_];
+      Operation* operation = reinterpret_cast<Operation*>(cqe->user_data);
+      operation->result = cqe->res;
+      completed->push_back(operation);
+    }
+    StoreRelease(cq_head_, head);
+    if (reaped || !wait)
+      return waited;
+    if (waited && Enter(1))
+      continue;
+
+    // Waiting in the kernel failed, with EAGAIN, EBUSY or ENOMEM say. The
+    // operations it hasn't taken never start: fail them. Those it has may
+    // still use their buffers, so poll for them instead.
+    if (waited) {
+      waited = false;
+      const size_t count = completed->size();
+      FailUnsubmitted(errno, completed);
+      if (completed->size() != count)
+        return false;
+    }
+    PlatformThread::Sleep(TimeDelta::FromMilliseconds(1));
+  }
+}
+
+bool IOUringAsyncIOEngine::RegisterBuffersImpl(
+    const std::vector<struct iovec>& buffers) {
+  if (buffers_registered_) {
+    if (IOUringRegister(ring_fd_, IORING_UNREGISTER_BUFFERS, NULL, 0)) {
+      DPLOG(ERROR) << "io_uring_register unregister buffers";
+      return false;
+    }
+    buffers_registered_ = false;
+  }
+  if (buffers.empty())
+    return true;
+  // Fails with ENOMEM when the buffers exceed RLIMIT_MEMLOCK.
+  if (IOUringRegister(ring_fd_, IORING_REGISTER_BUFFERS, &buffers[0],
+                      buffers.size())) {
+    DPLOG(ERROR) << "io_uring_register buffers";
+    return false;
+  }
+  buffers_registered_ = true;
+  return true;
+}
+
+void IOUringAsyncIOEngine::FailUnsubmitted(
+    int error,
+    std::vector<Operation*>* completed) {
+  // Without IORING_SETUP_SQPOLL, the kernel only consumes entries in
+  // io_uring_enter(), so the tail may be moved back.
+  const uint32 head = LoadAcquire(sq_head_);
+  const uint32 tail = *sq_tail_;
+  for (uint32 i = head; i != tail; ++i) {
+    const struct io_uring_sqe* sqe = &sqes_[sq_array_[i & sq_mask_]];
+    Operation* operation = reinterpret_cast<Operation*>(sqe->user_data);
+    operation->result = -error;
+    completed->push_back(operation);
+  }
+  StoreRelease(sq_tail_, head);
+  to_submit_ = 0;
+}
+
+bool IOUringAsyncIOEngine::Enter(unsigned min_completions) {
+  if (!to_submit_ && !min_completions)
+    return true;
+  unsigned flags = min_completions ? IORING_ENTER_GETEVENTS : 0;
+  int submitted = IOUringEnter(ring_fd_, to_submit_, min_completions, flags);
+  if (submitted < 0) {
+    if (errno == EINTR)
+      return true;
+    DPLOG(ERROR) << "io_uring_enter";
+    return false;
+  }
+  to_submit_ -= submitted;
+  return true;
+}
+
+}  // namespace base
@@ -0,0 +1,85 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_FILES_ASYNC_IO_ENGINE_LINUX_H_
+#define BASE_FILES_ASYNC_IO_ENGINE_LINUX_H_
+
+#include "base/files/async_io_engine.h"
+
+struct io_uring_cqe;
+struct io_uring_sqe;
+
+namespace base {
+
+// AsyncIOEngine submitting operations to the kernel through the rings of an
+// io_uring instance. Up to twice Options::queue_depth operations are kept in
+// flight, which is as many as the completion ring holds.
+class BASE_EXPORT IOUringAsyncIOEngine : public AsyncIOEngine {
+ public:
+  // Returns NULL if the kernel does not support io_uring, or it is disabled.
+  static scoped_ptr<AsyncIOEngine> Create(const Options& options);
+
+  virtual ~IOUringAsyncIOEngine();
+
+  // AsyncIOEngine:
+  virtual bool uses_io_uring() const OVERRIDE;
+
+ protected:
+  // AsyncIOEngine:
+  virtual void StartOperations(std::vector<Operation*>* operations) OVERRIDE;
+  virtual bool ReapOperations(bool wait,
+                              std::vector<Operation*>* completed) OVERRIDE;
+  virtual bool RegisterBuffersImpl(
+      const std::vector<struct iovec>& buffers) OVERRIDE;
+
+ private:
+  IOUringAsyncIOEngine();
+
+  // Sets up an io_uring with |entries| submission entries.
+  bool Init(size_t entries);
+
+  // Submits the entries added to the submission ring, and waits for
+  // |min_completions|. Returns false on failure.
+  bool Enter(unsigned min_completions);
+
+  // Takes back the entries of the submission ring the kernel has yet to
+  // consume, and appends their operations to |completed|, failed with
+  // |error|.
+  void FailUnsubmitted(int error, std::vector<Operation*>* completed);
+
+  int ring_fd_;
+
+  // The mappings of the rings, which may be one and the same.
+  void* sq_ring_;
+  size_t sq_ring_size_;
+  void* cq_ring_;
+  size_t cq_ring_size_;
+
+  // The submission ring, which holds indices into |sqes_|.
+  volatile uint32* sq_head_;
+  volatile uint32* sq_tail_;
+  uint32* sq_array_;
+  uint32 sq_mask_;
+  uint32 sq_entries_;
+  struct io_uring_sqe* sqes_;
+  size_t sqes_size_;
+
+  // The completion ring.
+  volatile uint32* cq_head_;
+  volatile uint32* cq_tail_;
+  uint32 cq_mask_;
+  uint32 cq_entries_;
+  struct io_uring_cqe* cqes_;
+
+  // Entries added to the submission ring that the kernel has yet to consume.
+  uint32 to_submit_;
+
+  bool buffers_registered_;
+
+  DISALLOW_COPY_AND_ASSIGN(IOUringAsyncIOEngine);
+};
+
+}  // namespace base
+
+#endif  // BASE_FILES_ASYNC_IO_ENGINE_LINUX_H_
@@ -0,0 +1,324 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/files/async_io_engine.h"
+
+#include <errno.h>
+#include <unistd.h>
+
+#include "base/logging.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/synchronization/condition_variable.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/simple_thread.h"
+
+#if defined(OS_LINUX)
+#include "base/files/async_io_engine_linux.h"
+#endif
+
+namespace base {
+
+namespace {
+
+// Performs operations with blocking system calls on a pool of threads.
+class ThreadPoolAsyncIOEngine : public AsyncIOEngine {
+ public:
+  explicit ThreadPoolAsyncIOEngine(int num_threads)
+      : completed_cv_(&lock_),
+        pool_("async_io", num_threads) {
+    pool_.Start();
+  }
+
+  virtual ~ThreadPoolAsyncIOEngine() {
+    AbandonOperations();
+    pool_.JoinAll();
+  }
+
+  virtual bool uses_io_uring() const OVERRIDE {
+    return false;
+  }
+
+ protected:
+  virtual void StartOperations(std::vector<Operation*>* operations) OVERRIDE {
+    for (size_t i = 0; i < operations->size(); ++i)
+      pool_.AddWork(new Task(this, (*operations)[i]));
+    operations->clear();
+  }
+
+  virtual bool ReapOperations(bool wait,
+                              std::vector<Operation*>* completed) OVERRIDE {
+    AutoLock lock(lock_);
+    while (wait && completed_.empty())
+      completed_cv_.Wait();
+    completed->insert(completed->end(), completed_.begin(), completed_.end());
+    completed_.clear();
+    return true;
+  }
+
+ private:
+  // Performs an operation on a pool thread, then deletes itself.
+  class Task : public DelegateSimpleThread::Delegate {
+   public:
+    Task(ThreadPoolAsyncIOEngine* engine, Operation* operation)
+        : engine_(engine), operation_(operation) {
+    }
+
+    virtual void Run() OVERRIDE {
+      Perform(operation_);
+      engine_->OnCompleted(operation_);
+      delete this;
+    }
+
+   private:
+    ThreadPoolAsyncIOEngine* engine_;
+    Operation* operation_;
+  };
+
+  static void Perform(Operation* operation) {
+    const struct iovec* iov = &operation->iovecs[0];
+    const int count = static_cast<int>(operation->iovecs.size());
+    const bool read = operation->type == Operation::READ ||
+                      operation->type == Operation::READ_FIXED;
+    ssize_t result;
+    if (count == 1) {
+      result = read ? HANDLE_EINTR(pread(operation->file, iov->iov_base,
+                                         iov->iov_len, operation->offset))
+                    : HANDLE_EINTR(pwrite(operation->file, iov->iov_base,
+                                          iov->iov_len, operation->offset));
+    } else {
+#if defined(OS_LINUX)
+      result = read ? HANDLE_EINTR(preadv(operation->file, iov, count,
+                                          operation->offset))
+                    : HANDLE_EINTR(pwritev(operation->file, iov, count,
+                                           operation->offset));
+#else
+      // One buffer at a time, up to a short transfer.
+      result = 0;
+      for (int i = 0; i < count; ++i) {
+        ssize_t transferred =
+            read ? HANDLE_EINTR(pread(operation->file, iov[i].iov_base,
+                                      iov[i].iov_len,
+                                      operation->offset + result))
+                 : HANDLE_EINTR(pwrite(operation->file, iov[i].iov_base,
+                                       iov[i].iov_len,
+                                       operation->offset + result));
+        if (transferred < 0) {
+          if (!result)
+            result = -1;
+          break;
+        }
+        result += transferred;
+        if (static_cast<size_t>(transferred) < iov[i].iov_len)
+          break;
+      }
+#endif
+    }
+    operation->result = result < 0 ? -errno : static_cast<int>(result);
+  }
+
+  void OnCompleted(Operation* operation) {
+    AutoLock lock(lock_);
+    completed_.push_back(operation);
+    completed_cv_.Signal();
+  }
+
+  Lock lock_;
+  // Signaled when an operation completes.
+  ConditionVariable completed_cv_;
+  std::vector<Operation*> completed_;
+
+  DelegateSimpleThreadPool pool_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadPoolAsyncIOEngine);
+};
+
+}  // namespace
+
+AsyncIOEngine::Options::Options()
+    : queue_depth(1024),
+      num_threads(16),
+      use_io_uring(true) {
+}
+
+AsyncIOEngine::Operation::Operation()
+    : type(READ),
+      file(kInvalidPlatformFileValue),
+      offset(0),
+      buffer_index(-1),
+      result(0) {
+}
+
+AsyncIOEngine::Operation::~Operation() {
+}
+
+// static
+scoped_ptr<AsyncIOEngine> AsyncIOEngine::Create(const Options& options) {
+#if defined(OS_LINUX)
+  if (options.use_io_uring) {
+    scoped_ptr<AsyncIOEngine> engine(IOUringAsyncIOEngine::Create(options));
+    if (engine)
+      return engine.Pass();
+  }
+#endif
+  return scoped_ptr<AsyncIOEngine>(
+      new ThreadPoolAsyncIOEngine(options.num_threads));
+}
+
+AsyncIOEngine::AsyncIOEngine() : in_flight_(0) {
+}
+
+AsyncIOEngine::~AsyncIOEngine() {
+  DCHECK(thread_checker_.CalledOnValidThread());
+  DCHECK_EQ(0u, in_flight_);
+  for (size_t i = 0; i < queued_.size(); ++i)
+    delete queued_[i];
+}
+
+void AsyncIOEngine::Read(PlatformFile file,
+                         int64 offset,
+                         char* buffer,
+                         int size,
+                         const CompletionCallback& callback) {
+  struct iovec iov = { buffer, static_cast<size_t>(size) };
+  Queue(Operation::READ, file, offset, &iov, 1, -1, callback);
+}
+
+void AsyncIOEngine::Write(PlatformFile file,
+                          int64 offset,
+                          const char* buffer,
+                          int size,
+                          const CompletionCallback& callback) {
+  struct iovec iov = { const_cast<char*>(buffer), static_cast<size_t>(size) };
+  Queue(Operation::WRITE, file, offset, &iov, 1, -1, callback);
+}
+
+void AsyncIOEngine::ReadV(PlatformFile file,
+                          int64 offset,
+                          const struct iovec* iov,
+                          int count,
+                          const CompletionCallback& callback) {
+  Queue(Operation::READ, file, offset, iov, count, -1, callback);
+}
+
+void AsyncIOEngine::WriteV(PlatformFile file,
+                           int64 offset,
+                           const struct iovec* iov,
+                           int count,
+                           const CompletionCallback& callback) {
+  Queue(Operation::WRITE, file, offset, iov, count, -1, callback);
+}
+
+bool AsyncIOEngine::RegisterBuffers(const struct iovec* buffers, int count) {
+  DCHECK(thread_checker_.CalledOnValidThread());
+  DCHECK_EQ(0u, pending_operations());
+  std::vector<struct iovec> registered(buffers, buffers + count);
+  if (!RegisterBuffersImpl(registered))
+    return false;
+  registered_buffers_.swap(registered);
+  return true;
+}
+
+void AsyncIOEngine::ReadFixed(PlatformFile file,
+                              int64 offset,
+                              int buffer_index,
+                              char* buffer,
+                              int size,
+                              const CompletionCallback& callback) {
+  struct iovec iov = { buffer, static_cast<size_t>(size) };
+  Queue(Operation::READ_FIXED, file, offset, &iov, 1, buffer_index, callback);
+}
+
+void AsyncIOEngine::WriteFixed(PlatformFile file,
+                               int64 offset,
+                               int buffer_index,
+                               const char* buffer,
+                               int size,
+                               const CompletionCallback& callback) {
+  struct iovec iov = { const_cast<char*>(buffer), static_cast<size_t>(size) };
+  Queue(Operation::WRITE_FIXED, file, offset, &iov, 1, buffer_index,
+        callback);
+}
+
+int AsyncIOEngine::Submit() {
+  DCHECK(thread_checker_.CalledOnValidThread());
+  size_t queued = queued_.size();
+  if (!queued)
+    return 0;
+  StartOperations(&queued_);
+  size_t started = queued - queued_.size();
+  in_flight_ += started;
+  return static_cast<int>(started);
+}
+
+int AsyncIOEngine::ProcessCompletions(int min_completions) {
+  DCHECK(thread_checker_.CalledOnValidThread());
+  std::vector<Operation*> completed;
+  Submit();
+  ReapOperations(false, &completed);
+  in_flight_ -= completed.size();
+  while (completed.size() < static_cast<size_t>(min_completions)) {
+    // Completions make room for queued operations.
+    Submit();
+    if (!in_flight_)
+      break;
+    size_t reaped = completed.size();
+    const bool waited = ReapOperations(true, &completed);
+    in_flight_ -= completed.size() - reaped;
+    // Run the callbacks of the operations failed rather than wait on.
+    if (!waited)
+      break;
+  }
+  Submit();
+
+  // The callbacks may queue more operations.
+  for (size_t i = 0; i < completed.size(); ++i) {
+    completed[i]->callback.Run(completed[i]->result);
+    delete completed[i];
+  }
+  return static_cast<int>(completed.size());
+}
+
+void AsyncIOEngine::AbandonOperations() {
+  DCHECK(thread_checker_.CalledOnValidThread());
+  std::vector<Operation*> completed;
+  while (in_flight_) {
+    ReapOperations(true, &completed);
+    in_flight_ -= completed.size();
+    for (size_t i = 0; i < completed.size(); ++i)
+      delete completed[i];
+    completed.clear();
+  }
+}
+
+void AsyncIOEngine::Queue(Operation::Type type,
+                          PlatformFile file,
+                          int64 offset,
+                          const struct iovec* iov,
+                          int count,
+                          int buffer_index,
+                          const CompletionCallback& callback) {
+  DCHECK(thread_checker_.CalledOnValidThread());
+  DCHECK_GT(count, 0);
+  DCHECK(!callback.is_null());
+#ifndef NDEBUG
+  if (buffer_index >= 0) {
+    DCHECK_LT(static_cast<size_t>(buffer_index), registered_buffers_.size());
+    const struct iovec& registered = registered_buffers_[buffer_index];
+    const char* start = static_cast<const char*>(registered.iov_base);
+    const char* buffer = static_cast<const char*>(iov->iov_base);
+    DCHECK(buffer >= start &&
+           buffer + iov->iov_len <= start + registered.iov_len);
+  }
+#endif
+  Operation* operation = new Operation;
+  operation->type = type;
+  operation->file = file;
+  operation->offset = offset;
+  operation->iovecs.assign(iov, iov + count);
+  operation->buffer_index = buffer_index;
+  operation->callback = callback;
+  queued_.push_back(operation);
+}
+
+}  // namespace base
@@ -0,0 +1,278 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/files/async_io_engine.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/file_util.h"
+#include "base/files/file_path.h"
+#include "base/files/scoped_temp_dir.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+void StoreResult(int* stored, int result) {
+  *stored = result;
+}
+
+void AppendResult(std::vector<int>* results, int result) {
+  results->push_back(result);
+}
+
+// An engine which never performs its operations, and whose waits fail: each
+// fails one operation with EAGAIN.
+class FailingAsyncIOEngine : public AsyncIOEngine {
+ public:
+  FailingAsyncIOEngine() {}
+
+  virtual ~FailingAsyncIOEngine() {
+    AbandonOperations();
+  }
+
+  virtual bool uses_io_uring() const OVERRIDE {
+    return false;
+  }
+
+ protected:
+  virtual void StartOperations(std::vector<Operation*>* operations) OVERRIDE {
+    started_.insert(started_.end(), operations->begin(), operations->end());
+    operations->clear();
+  }
+
+  virtual bool ReapOperations(bool wait,
+                              std::vector<Operation*>* completed) OVERRIDE {
+    if (!wait || started_.empty())
+      return true;
+    started_.back()->result = -EAGAIN;
+    completed->push_back(started_.back());
+    started_.pop_back();
+    return false;
+  }
+
+ private:
+  std::vector<Operation*> started_;
+
+  DISALLOW_COPY_AND_ASSIGN(FailingAsyncIOEngine);
+};
+
+class AsyncIOEngineTest : public testing::Test {
+ protected:
+  virtual void SetUp() OVERRIDE {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    path_ = temp_dir_.path().AppendASCII("file");
+    file_ = CreatePlatformFile(path_, PLATFORM_FILE_CREATE_ALWAYS |
+                                          PLATFORM_FILE_READ |
+                                          PLATFORM_FILE_WRITE,
+                               NULL, NULL);
+    ASSERT_NE(kInvalidPlatformFileValue, file_);
+  }
+
+  virtual void TearDown() OVERRIDE {
+    ClosePlatformFile(file_);
+  }
+
+  // Returns an engine using io_uring if |io_uring|, or NULL if the kernel
+  // does not support it.
+  scoped_ptr<AsyncIOEngine> CreateEngine(bool io_uring, size_t queue_depth) {
+    AsyncIOEngine::Options options;
+    options.use_io_uring = io_uring;
+    options.queue_depth = queue_depth;
+    options.num_threads = 4;
+    scoped_ptr<AsyncIOEngine> engine = AsyncIOEngine::Create(options);
+    if (engine->uses_io_uring() != io_uring) {
+      LOG(WARNING) << "io_uring is not supported";
+      return scoped_ptr<AsyncIOEngine>();
+    }
+    return engine.Pass();
+  }
+
+  void WriteTestFile(const std::string& data) {
+    ASSERT_EQ(static_cast<int>(data.size()),
+              WritePlatformFile(file_, 0, data.data(), data.size()));
+  }
+
+  ScopedTempDir temp_dir_;
+  FilePath path_;
+  PlatformFile file_;
+};
+
+}  // namespace
+
+TEST_F(AsyncIOEngineTest, ReadAndWrite) {
+  for (int io_uring = 0; io_uring < 2; ++io_uring) {
+    scoped_ptr<AsyncIOEngine> engine = CreateEngine(io_uring, 8);
+    if (!engine)
+      continue;
+
+    int write_result = 0;
+    engine->Write(file_, 3, "hello", 5, Bind(&StoreResult, &write_result));
+    EXPECT_EQ(1u, engine->pending_operations());
+    EXPECT_EQ(1, engine->Submit());
+    EXPECT_EQ(1, engine->ProcessCompletions(1));
+    EXPECT_EQ(5, write_result);
+    EXPECT_EQ(0u, engine->pending_operations());
+
+    char buffer[16];
+    int read_result = 0;
+    engine->Read(file_, 0, buffer, sizeof(buffer),
+                 Bind(&StoreResult, &read_result));
+    int bad_result = 0;
+    engine->Read(kInvalidPlatformFileValue, 0, buffer, sizeof(buffer),
+                 Bind(&StoreResult, &bad_result));
+    // Submitted by ProcessCompletions().
+    EXPECT_EQ(2, engine->ProcessCompletions(2));
+    // Short at the end of the file.
+    EXPECT_EQ(8, read_result);
+    EXPECT_EQ(0, memcmp("\0\0\0hello", buffer, 8));
+    EXPECT_EQ(-EBADF, bad_result);
+  }
+}
+
+TEST_F(AsyncIOEngineTest, VectoredReadAndWrite) {
+  for (int io_uring = 0; io_uring < 2; ++io_uring) {
+    scoped_ptr<AsyncIOEngine> engine = CreateEngine(io_uring, 8);
+    if (!engine)
+      continue;
+
+    char first[] = "vectored ";
+    char second[] = "write";
+    struct iovec write_iov[] = {
+      { first, strlen(first) },
+      { second, strlen(second) },
+    };
+    int write_result = 0;
+    engine->WriteV(file_, 0, write_iov, arraysize(write_iov),
+                   Bind(&StoreResult, &write_result));
+    engine->ProcessCompletions(1);
+    EXPECT_EQ(14, write_result);
+
+    char head[4];
+    char tail[10];
+    struct iovec read_iov[] = {
+      { head, sizeof(head) },
+      { tail, sizeof(tail) },
+    };
+    int read_result = 0;
+    engine->ReadV(file_, 0, read_iov, arraysize(read_iov),
+                  Bind(&StoreResult, &read_result));
+    engine->ProcessCompletions(1);
+    EXPECT_EQ(14, read_result);
+    EXPECT_EQ("vect", std::string(head, sizeof(head)));
+    EXPECT_EQ("ored write", std::string(tail, sizeof(tail)));
+  }
+}
+
+TEST_F(AsyncIOEngineTest, RegisteredBuffers) {
+  for (int io_uring = 0; io_uring < 2; ++io_uring) {
+    scoped_ptr<AsyncIOEngine> engine = CreateEngine(io_uring, 8);
+    if (!engine)
+      continue;
+
+    std::vector<char> buffers(2 * 4096);
+    struct iovec registered[] = {
+      { &buffers[0], 4096 },
+      { &buffers[4096], 4096 },
+    };
+    ASSERT_TRUE(engine->RegisterBuffers(registered, arraysize(registered)));
+
+    memset(&buffers[100], 'a', 1000);
+    int write_result = 0;
+    engine->WriteFixed(file_, 0, 0, &buffers[100], 1000,
+                       Bind(&StoreResult, &write_result));
+    engine->ProcessCompletions(1);
+    EXPECT_EQ(1000, write_result);
+
+    int read_result = 0;
+    engine->ReadFixed(file_, 500, 1, &buffers[4096], 4096,
+                      Bind(&StoreResult, &read_result));
+    engine->ProcessCompletions(1);
+    EXPECT_EQ(500, read_result);
+    EXPECT_EQ(std::string(500, 'a'), std::string(&buffers[4096], 500));
+
+    EXPECT_TRUE(engine->RegisterBuffers(NULL, 0));
+  }
+}
+
+TEST_F(AsyncIOEngineTest, ManyOutstandingOperations) {
+  const int kBlockSize = 64;
+  const int kBlocks = 20000;
+  std::string data(kBlocks * kBlockSize, 0);
+  for (size_t i = 0; i < data.size(); ++i)
+    data[i] = static_cast<char>(i / kBlockSize);
+  WriteTestFile(data);
+
+  for (int io_uring = 0; io_uring < 2; ++io_uring) {
+    // Far more reads than fit in flight.
+    scoped_ptr<AsyncIOEngine> engine = CreateEngine(io_uring, 16);
+    if (!engine)
+      continue;
+
+    std::vector<char> buffer(data.size());
+    std::vector<int> results;
+    for (int i = 0; i < kBlocks; ++i) {
+      engine->Read(file_, i * kBlockSize, &buffer[i * kBlockSize], kBlockSize,
+                   Bind(&AppendResult, &results));
+    }
+    EXPECT_EQ(static_cast<size_t>(kBlocks), engine->pending_operations());
+    int submitted = engine->Submit();
+    EXPECT_LT(0, submitted);
+    if (io_uring)
+      EXPECT_GE(32, submitted);
+    while (engine->pending_operations())
+      engine->ProcessCompletions(1);
+
+    ASSERT_EQ(static_cast<size_t>(kBlocks), results.size());
+    for (size_t i = 0; i < results.size(); ++i)
+      EXPECT_EQ(kBlockSize, results[i]);
+    EXPECT_TRUE(std::string(buffer.begin(), buffer.end()) == data);
+  }
+}
+
+TEST_F(AsyncIOEngineTest, DestroyWithPendingOperations) {
+  WriteTestFile(std::string(100000, 'x'));
+  for (int io_uring = 0; io_uring < 2; ++io_uring) {
+    scoped_ptr<AsyncIOEngine> engine = CreateEngine(io_uring, 4);
+    if (!engine)
+      continue;
+
+    std::vector<char> buffer(100000);
+    int result = 0;
+    for (int i = 0; i < 100; ++i) {
+      engine->Read(file_, i * 1000, &buffer[i * 1000], 1000,
+                   Bind(&StoreResult, &result));
+    }
+    engine->Submit();
+    // Waits for the reads in flight; the callbacks are not run.
+    engine.reset();
+    EXPECT_EQ(0, result);
+  }
+}
+
+// A failed wait runs the callbacks of the operations failed, rather than
+// waiting on for more.
+TEST_F(AsyncIOEngineTest, FailedWait) {
+  scoped_ptr<AsyncIOEngine> engine(new FailingAsyncIOEngine);
+  char buffer[16];
+  std::vector<int> results;
+  for (int i = 0; i < 3; ++i) {
+    engine->Read(file_, 0, buffer, sizeof(buffer),
+                 Bind(&AppendResult, &results));
+  }
+  EXPECT_EQ(1, engine->ProcessCompletions(3));
+  ASSERT_EQ(1u, results.size());
+  EXPECT_EQ(-EAGAIN, results[0]);
+  EXPECT_EQ(2u, engine->pending_operations());
+  // Abandoning the others ends too.
+  engine.reset();
+}
+
+}  // namespace base
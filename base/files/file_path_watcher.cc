@@ -0,0 +1,60 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Cross platform methods for FilePathWatcher. See the various platform
+// specific implementation files, too.
+
+#include "base/files/file_path_watcher.h"
+
+#include "base/logging.h"
+
+namespace base {
+
+FilePathWatcher::Options::Options()
+    : recursive(false),
+      max_watches(8192) {
+}
+
+FilePathWatcher::~FilePathWatcher() {
+  Cancel();
+}
+
+// static
+bool FilePathWatcher::RecursiveWatchAvailable() {
+#if defined(OS_LINUX)
+  return true;
+#else
+  // FSEvents isn't available on iOS, and kqueue watches a single directory.
+  return false;
+#endif
+}
+
+FilePathWatcher::PlatformDelegate::PlatformDelegate() {
+}
+
+FilePathWatcher::PlatformDelegate::~PlatformDelegate() {
+}
+
+bool FilePathWatcher::Watch(const FilePath& path,
+                            bool recursive,
+                            const Callback& callback) {
+  Options options;
+  options.recursive = recursive;
+  return Watch(path, options, callback);
+}
+
+bool FilePathWatcher::Watch(const FilePath& path,
+                            const Options& options,
+                            const Callback& callback) {
+  DCHECK(path.IsAbsolute());
+  if (options.recursive && !RecursiveWatchAvailable())
+    return false;
+  return impl_->Watch(path, options, callback);
+}
+
+void FilePathWatcher::Cancel() {
+  impl_->Cancel();
+}
+
+}  // namespace base
@@ -0,0 +1,114 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// This module provides a way to monitor a file or directory for changes.
+
+#ifndef BASE_FILES_FILE_PATH_WATCHER_H_
+#define BASE_FILES_FILE_PATH_WATCHER_H_
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/callback.h"
+#include "base/files/file_path.h"
+#include "base/memory/ref_counted.h"
+#include "base/time/time.h"
+
+namespace base {
+
+// This class lets you register interest in changes on a FilePath.
+// The callback will get called whenever the file or directory referenced by the
+// FilePath is changed, including created or deleted. Due to limitations in the
+// underlying OS APIs, FilePathWatcher has slightly different semantics on OS X
+// than on Windows or Linux. FilePathWatcher on Linux and Windows will detect
+// modifications to files in a watched directory. FilePathWatcher on Mac will
+// detect the creation and deletion of files in a watched directory, but will
+// not detect modifications to those files. See file_path_watcher_kqueue.cc for
+// details.
+//
+// The callbacks of all the watchers run on a thread they share, one at a
+// time, and should return quickly.
+class BASE_EXPORT FilePathWatcher {
+ public:
+  // Callback type for Watch(). |path| points to the file that was updated,
+  // and |error| is true if the platform specific code detected an error. In
+  // that case, the callback won't be invoked again, except for recursive
+  // watches over their watch budget; see Options::max_watches.
+  typedef base::Callback<void(const FilePath& path, bool error)> Callback;
+
+  struct BASE_EXPORT Options {
+    Options();
+
+    // Whether to watch the directories below |path| as well. The callback
+    // then receives the path that changed rather than |path|. Files created
+    // in a new subdirectory before it is watched are not reported; the new
+    // subdirectory is reported instead.
+    bool recursive;
+
+    // Changes to a path during this long after the first are reported once,
+    // at the end of the window. Zero reports every change.
+    TimeDelta coalesce_window;
+
+    // The most directories a recursive watch watches at once. Each takes an
+    // inotify watch, of which a user has fs.inotify.max_user_watches. The
+    // first directory left unwatched is reported as an error, and the watch
+    // carries on with the others.
+    size_t max_watches;
+  };
+
+  // Used internally to encapsulate different members on different platforms.
+  class PlatformDelegate : public base::RefCountedThreadSafe<PlatformDelegate> {
+   public:
+    PlatformDelegate();
+
+    // Start watching for the given |path| and notify |callback| about changes.
+    virtual bool Watch(const FilePath& path,
+                       const Options& options,
+                       const Callback& callback) WARN_UNUSED_RESULT = 0;
+
+    // Stop watching. Once this returns, the callback is not run again. May be
+    // called from the callback.
+    virtual void Cancel() = 0;
+
+   protected:
+    friend class base::RefCountedThreadSafe<PlatformDelegate>;
+    friend class FilePathWatcher;
+
+    virtual ~PlatformDelegate();
+
+   private:
+    DISALLOW_COPY_AND_ASSIGN(PlatformDelegate);
+  };
+
+  FilePathWatcher();
+  virtual ~FilePathWatcher();
+
+  // Returns true if the platform and OS version support recursive watches.
+  static bool RecursiveWatchAvailable();
+
+  // Invokes |callback| whenever updates to |path| are detected. This should be
+  // called at most once. Set |recursive| to true, to watch |path| and its
+  // children. Returns true on success.
+  //
+  // Recursive watch is not supported on all platforms and file systems.
+  // Watch() will return false in the case of failure.
+  bool Watch(const FilePath& path, bool recursive, const Callback& callback);
+
+  // As above, with |options|.
+  bool Watch(const FilePath& path,
+             const Options& options,
+             const Callback& callback);
+
+  // Stops watching. Once this returns, the callback is not run again. Called
+  // by the destructor.
+  void Cancel();
+
+ private:
+  scoped_refptr<PlatformDelegate> impl_;
+
+  DISALLOW_COPY_AND_ASSIGN(FilePathWatcher);
+};
+
+}  // namespace base
+
+#endif  // BASE_FILES_FILE_PATH_WATCHER_H_
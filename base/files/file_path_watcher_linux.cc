@@ -5,30 +5,33 @@
 #include "base/files/file_path_watcher.h"
 
 #include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <string.h>
 #include <sys/inotify.h>
 #include <sys/ioctl.h>
-#include <sys/select.h>
 #include <unistd.h>
 
 #include <algorithm>
+#include <iterator>
+#include <map>
 #include <set>
 #include <utility>
 #include <vector>
 
-#include "base/bind.h"
+#include "base/atomicops.h"
 #include "base/containers/hash_tables.h"
 #include "base/file_util.h"
+#include "base/files/file_enumerator.h"
 #include "base/files/file_path.h"
+#include "base/files/parallel_file_enumerator.h"
 #include "base/lazy_instance.h"
-#include "base/location.h"
 #include "base/logging.h"
 #include "base/memory/scoped_ptr.h"
-#include "base/message_loop/message_loop.h"
-#include "base/message_loop/message_loop_proxy.h"
 #include "base/posix/eintr_wrapper.h"
+#include "base/synchronization/condition_variable.h"
 #include "base/synchronization/lock.h"
-#include "base/threading/thread.h"
+#include "base/threading/platform_thread.h"
 
 namespace base {
 
@@ -36,46 +39,116 @@ namespace {
 
 class FilePathWatcherImpl;
 
-// Singleton to manage all inotify watches.
+// The events of interest on watched directories.
+const uint32 kWatchMask = IN_ATTRIB | IN_CREATE | IN_DELETE | IN_CLOSE_WRITE |
+                          IN_MODIFY | IN_MOVE | IN_ONLYDIR;
+
+// The smallest buffer events are read into. Larger batches are read when
+// more are queued.
+const size_t kMinReadSize = 64 * 1024;
+
+// Singleton to manage all inotify watches. Its thread reads the events in
+// batches, holds back the changes to report until the end of their coalescing
+// window, and runs the callbacks.
 // TODO(tony): It would be nice if this wasn't a singleton.
 // http://crbug.com/38174
-class InotifyReader {
+class InotifyReader : public PlatformThread::Delegate {
  public:
   typedef int Watch;  // Watch descriptor used by AddWatch and RemoveWatch.
   static const Watch kInvalidWatch = -1;
 
+  // Protects the watches, the pending notifications, and the state of the
+  // FilePathWatcherImpls. Must be held for the methods below, but not while
+  // the callbacks run.
+  Lock& lock() { return lock_; }
+
+  bool valid() const { return valid_; }
+
   // Watch directory |path| for changes. |watcher| will be notified on each
-  // change. Returns kInvalidWatch on failure.
+  // change. Returns kInvalidWatch on failure. A watcher adding the same
+  // directory twice must remove it twice.
   Watch AddWatch(const FilePath& path, FilePathWatcherImpl* watcher);
 
-  // Remove |watch|. Returns true on success.
-  bool RemoveWatch(Watch watch, FilePathWatcherImpl* watcher);
+  // Remove |watch|.
+  void RemoveWatch(Watch watch, FilePathWatcherImpl* watcher);
 
-  // Callback for InotifyReaderTask.
-  void OnInotifyEvent(const inotify_event* event);
+  // Reports |path| to |watcher| at |deadline|, merged with any report of
+  // |path| already pending.
+  void Notify(FilePathWatcherImpl* watcher,
+              const FilePath& path,
+              bool error,
+              TimeTicks deadline);
+
+  // Drops the notifications pending for |watcher|.
+  void CancelNotifications(FilePathWatcherImpl* watcher);
+
+  // Has the reader thread run the scans |watcher| has queued, once the
+  // events read have been handled and |lock_| released.
+  void ScheduleScans(FilePathWatcherImpl* watcher);
+
+  // Waits for the callbacks being run to return, unless called from one.
+  // |lock_| must not be held.
+  void WaitForCallbacks();
+
+  // PlatformThread::Delegate:
+  virtual void ThreadMain() OVERRIDE;
 
  private:
   friend struct ::base::DefaultLazyInstanceTraits<InotifyReader>;
 
-  typedef std::set<FilePathWatcherImpl*> WatcherSet;
+  typedef std::multiset<FilePathWatcherImpl*> WatcherSet;
+  typedef std::pair<FilePathWatcherImpl*, FilePath> NotificationKey;
+
+  struct PendingNotification {
+    TimeTicks deadline;
+    bool error;
+  };
+
+  struct DueNotification {
+    scoped_refptr<FilePathWatcherImpl> watcher;
+    FilePath path;
+    bool error;
+  };
 
   InotifyReader();
-  ~InotifyReader();
+  virtual ~InotifyReader();
+
+  // Reads the queued events into |buffer|, and hands them to the watchers.
+  // Returns false on failure.
+  bool ReadEvents(std::vector<char>* buffer);
+
+  // Hands |event| to the watchers of its watch.
+  void OnInotifyEvent(const inotify_event* event);
+
+  // Runs the scans scheduled. |lock_| must not be held.
+  void RunScans();
+
+  // Runs the callbacks of the notifications which are due. Returns the
+  // number of milliseconds until the next one is, or -1 if none is pending.
+  int RunDueCallbacks();
+
+  Lock lock_;
 
   // We keep track of which delegates want to be notified on which watches.
   base::hash_map<Watch, WatcherSet> watchers_;
 
-  // Lock to protect watchers_.
-  base::Lock lock_;
+  std::map<NotificationKey, PendingNotification> pending_;
+
+  // The watchers with scans for the reader thread to run.
+  std::vector<scoped_refptr<FilePathWatcherImpl> > scans_;
+
+  // The reader thread, known once it runs.
+  PlatformThreadId thread_id_;
 
-  // Separate thread on which we run blocking read for inotify events.
-  base::Thread thread_;
+  // Whether callbacks are running, and signaled when they have returned.
+  bool running_callbacks_;
+  ConditionVariable callbacks_cv_;
 
-  // File descriptor returned by inotify_init.
+  // File descriptor returned by inotify_init1.
   const int inotify_fd_;
 
-  // Use self-pipe trick to unblock select during shutdown.
-  int shutdown_pipe_[2];
+  // Use self-pipe trick to wake up poll when a notification is added.
+  int wakeup_pipe_[2];
 
   // Flag set to true when startup was successful.
   bool valid_;
@@ -83,40 +156,41 @@ class InotifyReader {
   DISALLOW_COPY_AND_ASSIGN(InotifyReader);
 };
 
-class FilePathWatcherImpl : public FilePathWatcher::PlatformDelegate,
-                            public MessageLoop::DestructionObserver {
+class FilePathWatcherImpl : public FilePathWatcher::PlatformDelegate {
  public:
   FilePathWatcherImpl();
 
   // Called for each event coming from the watch. |fired_watch| identifies the
   // watch that fired, |child| indicates what has changed, and is relative to
-  // the currently watched path for |fired_watch|. The flag |created| is true if
-  // the object appears.
+  // the currently watched path for |fired_watch|. |mask| holds the inotify
+  // event bits.
   void OnFilePathChanged(InotifyReader::Watch fired_watch,
                          const FilePath::StringType& child,
-                         bool created);
+                         uint32 mask);
+
+  // Called when the inotify queue overflowed and events were lost.
+  void OnOverflow();
+
+  // Runs the callback, unless cancelled. Called on the reader thread.
+  void RunCallback(const FilePath& path, bool error);
+
+  // Runs the scans queued by AddRecursiveWatches(). Called on the reader
+  // thread, without the lock held.
+  void RunPendingScans();
 
   // Start watching |path| for changes and notify |delegate| on each change.
   // Returns true if watch for |path| has been added successfully.
   virtual bool Watch(const FilePath& path,
-                     bool recursive,
+                     const FilePathWatcher::Options& options,
                      const FilePathWatcher::Callback& callback) OVERRIDE;
 
   // Cancel the watch. This unregisters the instance with InotifyReader.
   virtual void Cancel() OVERRIDE;
 
-  // Deletion of the FilePathWatcher will call Cancel() to dispose of this
-  // object in the right thread. This also observes destruction of the required
-  // cleanup thread, in case it quits before Cancel() is called.
-  virtual void WillDestroyCurrentMessageLoop() OVERRIDE;
-
  protected:
   virtual ~FilePathWatcherImpl() {}
 
  private:
-  // Cleans up and stops observing the |message_loop_| thread.
-  virtual void CancelOnMessageLoopThread() OVERRIDE;
-
   // Inotify watches are installed for all directory components of |target_|. A
   // WatchEntry instance holds the watch descriptor for a component and the
   // subdirectory for that identifies the next component. If a symbolic link
@@ -136,9 +210,32 @@ class FilePathWatcherImpl : public FilePathWatcher::PlatformDelegate,
   // that exists. Updates |watched_path_|. Returns true on success.
   bool UpdateWatches() WARN_UNUSED_RESULT;
 
+  // Queues a scan of |directory| for the reader thread, which watches it
+  // and the directories below it, as the budget allows.
+  void AddRecursiveWatches(const FilePath& directory);
+
+  // Reads the tree under |directory| without the lock held, and then, unless
+  // the recursive watches have been reset since |generation|, watches its
+  // directories.
+  void ScanAndWatch(const FilePath& directory, int generation);
+
+  // Watches |directories|, parents first, until the budget runs out.
+  void AddWatches(const std::vector<FilePath>& directories);
+
+  // Stops watching |directory| and the directories below it.
+  void RemoveRecursiveWatches(const FilePath& directory);
+
+  // Watches the tree under |target_| afresh.
+  void ResetRecursiveWatches();
+
+  // Reports a change of |path|, at the end of the coalescing window.
+  void Report(const FilePath& path, bool error);
+
   // Callback to notify upon changes.
   FilePathWatcher::Callback callback_;
 
+  FilePathWatcher::Options options_;
+
   // The file or directory we're supposed to watch.
   FilePath target_;
 
@@ -147,111 +244,58 @@ class FilePathWatcherImpl : public FilePathWatcher::PlatformDelegate,
   // |target_| and always stores an empty next component name in |subdir_|.
   WatchVector watches_;
 
-  DISALLOW_COPY_AND_ASSIGN(FilePathWatcherImpl);
-};
+  // For recursive watches, the directories watched from |target_| down, by
+  // watch and by path.
+  std::map<InotifyReader::Watch, FilePath> recursive_watches_;
+  std::map<FilePath, InotifyReader::Watch> recursive_paths_;
 
-void InotifyReaderCallback(InotifyReader* reader, int inotify_fd,
-                           int shutdown_fd) {
-  // Make sure the file descriptors are good for use with select().
-  CHECK_LE(0, inotify_fd);
-  CHECK_GT(FD_SETSIZE, inotify_fd);
-  CHECK_LE(0, shutdown_fd);
-  CHECK_GT(FD_SETSIZE, shutdown_fd);
+  // The directories queued by AddRecursiveWatches() for the reader thread to
+  // scan.
+  std::vector<FilePath> pending_scans_;
 
-  while (true) {
-    fd_set rfds;
-    FD_ZERO(&rfds);
-    FD_SET(inotify_fd, &rfds);
-    FD_SET(shutdown_fd, &rfds);
-
-    // Wait until some inotify events are available.
-    int select_result =
-      HANDLE_EINTR(select(std::max(inotify_fd, shutdown_fd) + 1,
-                          &rfds, NULL, NULL, NULL));
-    if (select_result < 0) {
-      DPLOG(WARNING) << "select failed";
-      return;
-    }
+  // Incremented whenever the recursive watches are reset, so that scans
+  // under way are dropped.
+  int scan_generation_;
 
-    if (FD_ISSET(shutdown_fd, &rfds))
-      return;
-
-    // Adjust buffer size to current event queue size.
-    int buffer_size;
-    int ioctl_result = HANDLE_EINTR(ioctl(inotify_fd, FIONREAD,
-                                          &buffer_size));
+  // Set when a directory was left unwatched for lack of budget.
+  bool over_budget_;
 
-    if (ioctl_result != 0) {
-      DPLOG(WARNING) << "ioctl failed";
-      return;
-    }
-
-    std::vector<char> buffer(buffer_size);
-
-    ssize_t bytes_read = HANDLE_EINTR(read(inotify_fd, &buffer[0],
-                                           buffer_size));
-
-    if (bytes_read < 0) {
-      DPLOG(WARNING) << "read from inotify fd failed";
-      return;
-    }
+  // Set by Cancel(), and read by the reader thread before running callbacks.
+  subtle::Atomic32 cancelled_;
 
-    ssize_t i = 0;
-    while (i < bytes_read) {
-      inotify_event* event = reinterpret_cast<inotify_event*>(&buffer[i]);
-      size_t event_size = sizeof(inotify_event) + event->len;
-      DCHECK(i + event_size <= static_cast<size_t>(bytes_read));
-      reader->OnInotifyEvent(event);
-      i += event_size;
-    }
-  }
-}
+  DISALLOW_COPY_AND_ASSIGN(FilePathWatcherImpl);
+};
 
 static base::LazyInstance<InotifyReader>::Leaky g_inotify_reader =
     LAZY_INSTANCE_INITIALIZER;
 
 InotifyReader::InotifyReader()
-    : thread_("inotify_reader"),
-      inotify_fd_(inotify_init()),
+    : thread_id_(kInvalidThreadId),
+      running_callbacks_(false),
+      callbacks_cv_(&lock_),
+      inotify_fd_(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)),
       valid_(false) {
-  shutdown_pipe_[0] = -1;
-  shutdown_pipe_[1] = -1;
-  if (inotify_fd_ >= 0 && pipe(shutdown_pipe_) == 0 && thread_.Start()) {
-    thread_.message_loop()->PostTask(
-        FROM_HERE, base::Bind(&InotifyReaderCallback, this, inotify_fd_,
-                              shutdown_pipe_[0]));
+  wakeup_pipe_[0] = -1;
+  wakeup_pipe_[1] = -1;
+  if (inotify_fd_ >= 0 && pipe2(wakeup_pipe_, O_CLOEXEC | O_NONBLOCK) == 0 &&
+      PlatformThread::CreateNonJoinable(0, this)) {
     valid_ = true;
   }
 }
 
 InotifyReader::~InotifyReader() {
-  if (valid_) {
-    // Write to the self-pipe so that the select call in InotifyReaderTask
-    // returns.
-    ssize_t ret = HANDLE_EINTR(write(shutdown_pipe_[1], "", 1));
-    DPCHECK(ret > 0);
-    DCHECK_EQ(ret, 1);
-    thread_.Stop();
-  }
-  if (inotify_fd_ >= 0)
-    close(inotify_fd_);
-  if (shutdown_pipe_[0] >= 0)
-    close(shutdown_pipe_[0]);
-  if (shutdown_pipe_[1] >= 0)
-    close(shutdown_pipe_[1]);
+  // Leaky: the reader thread runs for the life of the process.
+  NOTREACHED();
 }
 
 InotifyReader::Watch InotifyReader::AddWatch(
     const FilePath& path, FilePathWatcherImpl* watcher) {
+  lock_.AssertAcquired();
   if (!valid_)
     return kInvalidWatch;
 
-  base::AutoLock auto_lock(lock_);
-
   Watch watch = inotify_add_watch(inotify_fd_, path.value().c_str(),
-                                  IN_CREATE | IN_DELETE |
-                                  IN_CLOSE_WRITE | IN_MOVE |
-                                  IN_ONLYDIR);
+                                  kWatchMask);
 
   if (watch == kInvalidWatch)
     return kInvalidWatch;
@@ -261,20 +305,151 @@ InotifyReader::Watch InotifyReader::AddWatch(
   return watch;
 }
 
-bool InotifyReader::RemoveWatch(Watch watch,
-                                FilePathWatcherImpl* watcher) {
-  if (!valid_)
+void InotifyReader::RemoveWatch(Watch watch, FilePathWatcherImpl* watcher) {
+  lock_.AssertAcquired();
+  base::hash_map<Watch, WatcherSet>::iterator it = watchers_.find(watch);
+  if (it == watchers_.end())
+    return;
+
+  WatcherSet::iterator entry = it->second.find(watcher);
+  if (entry != it->second.end())
+    it->second.erase(entry);
+
+  if (it->second.empty()) {
+    watchers_.erase(it);
+    // Fails if the kernel already dropped the watch, with its directory.
+    inotify_rm_watch(inotify_fd_, watch);
+  }
+}
+
+void InotifyReader::Notify(FilePathWatcherImpl* watcher,
+                           const FilePath& path,
+                           bool error,
+                           TimeTicks deadline) {
+  lock_.AssertAcquired();
+  std::pair<std::map<NotificationKey, PendingNotification>::iterator, bool>
+      inserted = pending_.insert(std::make_pair(
+          NotificationKey(watcher, path), PendingNotification()));
+  PendingNotification& notification = inserted.first->second;
+  if (inserted.second) {
+    notification.deadline = deadline;
+    notification.error = error;
+  } else {
+    // Merged into the pending notification, within its window.
+    notification.deadline = std::min(notification.deadline, deadline);
+    notification.error |= error;
+  }
+
+  // The reader thread may be waiting for a later deadline.
+  if (PlatformThread::CurrentId() != thread_id_) {
+    char byte = 0;
+    ignore_result(HANDLE_EINTR(write(wakeup_pipe_[1], &byte, 1)));
+  }
+}
+
+void InotifyReader::CancelNotifications(FilePathWatcherImpl* watcher) {
+  lock_.AssertAcquired();
+  std::map<NotificationKey, PendingNotification>::iterator it =
+      pending_.lower_bound(NotificationKey(watcher, FilePath()));
+  while (it != pending_.end() && it->first.first == watcher)
+    pending_.erase(it++);
+}
+
+void InotifyReader::ScheduleScans(FilePathWatcherImpl* watcher) {
+  lock_.AssertAcquired();
+  for (size_t i = 0; i < scans_.size(); ++i) {
+    if (scans_[i].get() == watcher)
+      return;
+  }
+  scans_.push_back(watcher);
+}
+
+void InotifyReader::WaitForCallbacks() {
+  AutoLock auto_lock(lock_);
+  if (PlatformThread::CurrentId() == thread_id_)
+    return;
+  while (running_callbacks_)
+    callbacks_cv_.Wait();
+}
+
+void InotifyReader::ThreadMain() {
+  PlatformThread::SetName("inotify_reader");
+  {
+    AutoLock auto_lock(lock_);
+    thread_id_ = PlatformThread::CurrentId();
+  }
+
+  std::vector<char> buffer(kMinReadSize);
+  while (true) {
+    struct pollfd fds[2];
+    fds[0].fd = inotify_fd_;
+    fds[0].events = POLLIN;
+    fds[1].fd = wakeup_pipe_[0];
+    fds[1].events = POLLIN;
+
+    // Wait until some inotify events are available, or a notification is due.
+    int poll_result = HANDLE_EINTR(poll(fds, arraysize(fds),
+                                        RunDueCallbacks()));
+    if (poll_result < 0) {
+      DPLOG(WARNING) << "poll failed";
+      return;
+    }
+
+    if (fds[1].revents & POLLIN) {
+      char bytes[64];
+      while (HANDLE_EINTR(read(wakeup_pipe_[0], bytes, sizeof(bytes))) > 0) {
+      }
+    }
+
+    if ((fds[0].revents & POLLIN) && !ReadEvents(&buffer))
+      return;
+    RunScans();
+  }
+}
+
+void InotifyReader::RunScans() {
+  std::vector<scoped_refptr<FilePathWatcherImpl> > scans;
+  {
+    AutoLock auto_lock(lock_);
+    scans.swap(scans_);
+  }
+  // Trees are read without the lock, so that other watchers carry on.
+  for (size_t i = 0; i < scans.size(); ++i)
+    scans[i]->RunPendingScans();
+}
+
+bool InotifyReader::ReadEvents(std::vector<char>* buffer) {
+  // Adjust buffer size to current event queue size.
+  int buffer_size;
+  int ioctl_result = HANDLE_EINTR(ioctl(inotify_fd_, FIONREAD, &buffer_size));
+
+  if (ioctl_result != 0) {
+    DPLOG(WARNING) << "ioctl failed";
     return false;
+  }
 
-  base::AutoLock auto_lock(lock_);
+  if (static_cast<size_t>(buffer_size) > buffer->size())
+    buffer->resize(buffer_size);
 
-  watchers_[watch].erase(watcher);
+  ssize_t bytes_read = HANDLE_EINTR(read(inotify_fd_, &(*buffer)[0],
+                                         buffer->size()));
 
-  if (watchers_[watch].empty()) {
-    watchers_.erase(watch);
-    return (inotify_rm_watch(inotify_fd_, watch) == 0);
+  if (bytes_read < 0) {
+    if (errno == EAGAIN)
+      return true;
+    DPLOG(WARNING) << "read from inotify fd failed";
+    return false;
   }
 
+  AutoLock auto_lock(lock_);
+  ssize_t i = 0;
+  while (i < bytes_read) {
+    inotify_event* event = reinterpret_cast<inotify_event*>(&(*buffer)[i]);
+    size_t event_size = sizeof(inotify_event) + event->len;
+    DCHECK(i + event_size <= static_cast<size_t>(bytes_read));
+    OnInotifyEvent(event);
+    i += event_size;
+  }
   return true;
 }
 
@@ -282,37 +457,106 @@ void InotifyReader::OnInotifyEvent(const inotify_event* event) {
   if (event->mask & IN_IGNORED)
     return;
 
+  if (event->mask & IN_Q_OVERFLOW) {
+    // Some events were lost. Let every watcher check its target.
+    std::set<FilePathWatcherImpl*> watchers;
+    for (base::hash_map<Watch, WatcherSet>::const_iterator it =
+             watchers_.begin();
+         it != watchers_.end(); ++it) {
+      watchers.insert(it->second.begin(), it->second.end());
+    }
+    for (std::set<FilePathWatcherImpl*>::const_iterator it = watchers.begin();
+         it != watchers.end(); ++it) {
+      (*it)->OnOverflow();
+    }
+    return;
+  }
+
+  base::hash_map<Watch, WatcherSet>::const_iterator it =
+      watchers_.find(event->wd);
+  if (it == watchers_.end())
+    return;
+
+  // Copied, as the watchers may change the watches.
+  std::vector<FilePathWatcherImpl*> watchers;
+  std::unique_copy(it->second.begin(), it->second.end(),
+                   std::back_inserter(watchers));
   FilePath::StringType child(event->len ? event->name : FILE_PATH_LITERAL(""));
-  base::AutoLock auto_lock(lock_);
-
-  for (WatcherSet::iterator watcher = watchers_[event->wd].begin();
-       watcher != watchers_[event->wd].end();
-       ++watcher) {
-    (*watcher)->OnFilePathChanged(event->wd,
-                                  child,
-                                  event->mask & (IN_CREATE | IN_MOVED_TO));
+  for (size_t i = 0; i < watchers.size(); ++i)
+    watchers[i]->OnFilePathChanged(event->wd, child, event->mask);
+}
+
+int InotifyReader::RunDueCallbacks() {
+  std::vector<DueNotification> due;
+  int timeout_ms = -1;
+  {
+    AutoLock auto_lock(lock_);
+    const TimeTicks now = TimeTicks::Now();
+    std::map<NotificationKey, PendingNotification>::iterator it =
+        pending_.begin();
+    while (it != pending_.end()) {
+      if (it->second.deadline <= now) {
+        due.push_back(DueNotification());
+        due.back().watcher = it->first.first;
+        due.back().path = it->first.second;
+        due.back().error = it->second.error;
+        pending_.erase(it++);
+        continue;
+      }
+      // Rounded up, so as not to wake up before the deadline.
+      int delay_ms = static_cast<int>(
+          (it->second.deadline - now + TimeDelta::FromMicroseconds(
+              Time::kMicrosecondsPerMillisecond - 1)).InMilliseconds());
+      if (timeout_ms < 0 || delay_ms < timeout_ms)
+        timeout_ms = delay_ms;
+      ++it;
+    }
+    if (due.empty())
+      return timeout_ms;
+    running_callbacks_ = true;
   }
+
+  for (size_t i = 0; i < due.size(); ++i)
+    due[i].watcher->RunCallback(due[i].path, due[i].error);
+
+  AutoLock auto_lock(lock_);
+  running_callbacks_ = false;
+  callbacks_cv_.Broadcast();
+  // The callbacks may have taken long enough for more to be due.
+  return 0;
 }
 
-FilePathWatcherImpl::FilePathWatcherImpl() {
+FilePathWatcherImpl::FilePathWatcherImpl()
+    : over_budget_(false),
+      scan_generation_(0),
+      cancelled_(0) {
 }
 
 void FilePathWatcherImpl::OnFilePathChanged(InotifyReader::Watch fired_watch,
                                             const FilePath::StringType& child,
-                                            bool created) {
-  if (!message_loop()->BelongsToCurrentThread()) {
-    // Switch to message_loop_ to access watches_ safely.
-    message_loop()->PostTask(FROM_HERE,
-        base::Bind(&FilePathWatcherImpl::OnFilePathChanged,
-                   this,
-                   fired_watch,
-                   child,
-                   created));
-    return;
+                                            uint32 mask) {
+  g_inotify_reader.Get().lock().AssertAcquired();
+  const bool created = mask & (IN_CREATE | IN_MOVED_TO);
+
+  // Changes below a recursively watched directory.
+  bool reported = false;
+  std::map<InotifyReader::Watch, FilePath>::const_iterator recursive_watch =
+      recursive_watches_.find(fired_watch);
+  if (recursive_watch != recursive_watches_.end()) {
+    FilePath changed = recursive_watch->second;
+    if (!child.empty()) {
+      changed = changed.Append(child);
+      if (mask & IN_ISDIR) {
+        if (created)
+          AddRecursiveWatches(changed);
+        else if (mask & (IN_DELETE | IN_MOVED_FROM))
+          RemoveRecursiveWatches(changed);
+      }
+    }
+    Report(changed, false);
+    reported = true;
   }
 
-  DCHECK(MessageLoopForIO::current());
-
   // Find the entry in |watches_| that corresponds to |fired_watch|.
   WatchVector::const_iterator watch_entry(watches_.begin());
   for ( ; watch_entry != watches_.end(); ++watch_entry) {
@@ -336,9 +580,17 @@ void FilePathWatcherImpl::OnFilePathChanged(InotifyReader::Watch fired_watch,
       // as changes to symlinks on the target path will not have
       // IN_ISDIR set in the event masks. As a result we may sometimes
       // call UpdateWatches() unnecessarily.
-      if (change_on_target_path && !UpdateWatches()) {
-        callback_.Run(target_, true /* error */);
-        return;
+      if (change_on_target_path) {
+        const InotifyReader::Watch old_target_watch = watches_.back().watch_;
+        if (!UpdateWatches()) {
+          Report(target_, true);
+          return;
+        }
+        // The tree below |target_| only needs watching afresh when |target_|
+        // is another directory, or none, rather than, say, had its
+        // attributes changed.
+        if (options_.recursive && watches_.back().watch_ != old_target_watch)
+          ResetRecursiveWatches();
       }
 
       // Report the following events:
@@ -349,87 +601,112 @@ void FilePathWatcherImpl::OnFilePathChanged(InotifyReader::Watch fired_watch,
       //  - One of the parent directories appears. The event corresponding to
       //    the target appearing might have been missed in this case, so
       //    recheck.
-      if (target_changed ||
+      if ((target_changed && !reported) ||
           (change_on_target_path && !created) ||
           (change_on_target_path && PathExists(target_))) {
-        callback_.Run(target_, false);
+        Report(target_, false);
         return;
       }
     }
   }
 }
 
-bool FilePathWatcherImpl::Watch(const FilePath& path,
-                                bool recursive,
-                                const FilePathWatcher::Callback& callback) {
-  DCHECK(target_.empty());
-  DCHECK(MessageLoopForIO::current());
-  if (recursive) {
-    // Recursive watch is not supported on this platform.
-    NOTIMPLEMENTED();
-    return false;
+void FilePathWatcherImpl::OnOverflow() {
+  g_inotify_reader.Get().lock().AssertAcquired();
+  if (!UpdateWatches()) {
+    Report(target_, true);
+    return;
   }
-
-  set_message_loop(base::MessageLoopProxy::current().get());
-  callback_ = callback;
-  target_ = path;
-  MessageLoop::current()->AddDestructionObserver(this);
-
-  std::vector<FilePath::StringType> comps;
-  target_.GetComponents(&comps);
-  DCHECK(!comps.empty());
-  std::vector<FilePath::StringType>::const_iterator comp = comps.begin();
-  for (++comp; comp != comps.end(); ++comp)
-    watches_.push_back(WatchEntry(InotifyReader::kInvalidWatch, *comp));
-
-  watches_.push_back(WatchEntry(InotifyReader::kInvalidWatch,
-                                FilePath::StringType()));
-  return UpdateWatches();
+  if (options_.recursive)
+    ResetRecursiveWatches();
+  Report(target_, false);
 }
 
-void FilePathWatcherImpl::Cancel() {
-  if (callback_.is_null()) {
-    // Watch was never called, or the |message_loop_| thread is already gone.
-    set_cancelled();
-    return;
-  }
+void FilePathWatcherImpl::RunCallback(const FilePath& path, bool error) {
+  if (!subtle::Acquire_Load(&cancelled_))
+    callback_.Run(path, error);
+}
 
-  // Switch to the message_loop_ if necessary so we can access |watches_|.
-  if (!message_loop()->BelongsToCurrentThread()) {
-    message_loop()->PostTask(FROM_HERE,
-                             base::Bind(&FilePathWatcher::CancelWatch,
-                                        make_scoped_refptr(this)));
-  } else {
-    CancelOnMessageLoopThread();
+void FilePathWatcherImpl::RunPendingScans() {
+  InotifyReader& reader = g_inotify_reader.Get();
+  for (;;) {
+    FilePath directory;
+    int generation;
+    {
+      AutoLock auto_lock(reader.lock());
+      if (pending_scans_.empty())
+        return;
+      directory = pending_scans_.back();
+      pending_scans_.pop_back();
+      generation = scan_generation_;
+    }
+    ScanAndWatch(directory, generation);
   }
 }
 
-void FilePathWatcherImpl::CancelOnMessageLoopThread() {
-  if (!is_cancelled())
-    set_cancelled();
-
-  if (!callback_.is_null()) {
-    MessageLoop::current()->RemoveDestructionObserver(this);
-    callback_.Reset();
-  }
+bool FilePathWatcherImpl::Watch(const FilePath& path,
+                                const FilePathWatcher::Options& options,
+                                const FilePathWatcher::Callback& callback) {
+  DCHECK(target_.empty());
+  InotifyReader& reader = g_inotify_reader.Get();
+  if (!reader.valid())
+    return false;
 
-  for (WatchVector::iterator watch_entry(watches_.begin());
-       watch_entry != watches_.end(); ++watch_entry) {
-    if (watch_entry->watch_ != InotifyReader::kInvalidWatch)
-      g_inotify_reader.Get().RemoveWatch(watch_entry->watch_, this);
+  callback_ = callback;
+  options_ = options;
+
+  int generation;
+  {
+    AutoLock auto_lock(reader.lock());
+    target_ = path;
+
+    std::vector<FilePath::StringType> comps;
+    target_.GetComponents(&comps);
+    DCHECK(!comps.empty());
+    std::vector<FilePath::StringType>::const_iterator comp = comps.begin();
+    for (++comp; comp != comps.end(); ++comp)
+      watches_.push_back(WatchEntry(InotifyReader::kInvalidWatch, *comp));
+
+    watches_.push_back(WatchEntry(InotifyReader::kInvalidWatch,
+                                  FilePath::StringType()));
+    if (!UpdateWatches())
+      return false;
+    generation = scan_generation_;
   }
-  watches_.clear();
-  target_.clear();
+  // The tree is read on this thread, so that it is watched on return.
+  if (options_.recursive)
+    ScanAndWatch(target_, generation);
+  return true;
 }
 
-void FilePathWatcherImpl::WillDestroyCurrentMessageLoop() {
-  CancelOnMessageLoopThread();
+void FilePathWatcherImpl::Cancel() {
+  subtle::Release_Store(&cancelled_, 1);
+  InotifyReader& reader = g_inotify_reader.Get();
+  {
+    AutoLock auto_lock(reader.lock());
+    if (target_.empty()) {
+      // Watch was never called.
+      return;
+    }
+
+    for (WatchVector::iterator watch_entry(watches_.begin());
+         watch_entry != watches_.end(); ++watch_entry) {
+      if (watch_entry->watch_ != InotifyReader::kInvalidWatch)
+        reader.RemoveWatch(watch_entry->watch_, this);
+    }
+    watches_.clear();
+    RemoveRecursiveWatches(target_);
+    pending_scans_.clear();
+    ++scan_generation_;
+    reader.CancelNotifications(this);
+    target_.clear();
+  }
+  reader.WaitForCallbacks();
 }
 
 bool FilePathWatcherImpl::UpdateWatches() {
-  // Ensure this runs on the |message_loop_| exclusively in order to avoid
-  // concurrency issues.
-  DCHECK(message_loop()->BelongsToCurrentThread());
+  InotifyReader& reader = g_inotify_reader.Get();
+  reader.lock().AssertAcquired();
 
   // Walk the list of watches and update them as we go.
   FilePath path(FILE_PATH_LITERAL("/"));
@@ -438,7 +715,7 @@ bool FilePathWatcherImpl::UpdateWatches() {
        watch_entry != watches_.end(); ++watch_entry) {
     InotifyReader::Watch old_watch = watch_entry->watch_;
     if (path_valid) {
-      watch_entry->watch_ = g_inotify_reader.Get().AddWatch(path, this);
+      watch_entry->watch_ = reader.AddWatch(path, this);
       if ((watch_entry->watch_ == InotifyReader::kInvalidWatch) &&
           file_util::IsLink(path)) {
         FilePath link;
@@ -449,8 +726,7 @@ bool FilePathWatcherImpl::UpdateWatches() {
           // then we shouldn't get here in normal situations and if we do, we'd
           // watch "/" for changes to a component "/" which is harmless so no
           // special treatment of this case is required.
-          watch_entry->watch_ =
-              g_inotify_reader.Get().AddWatch(link.DirName(), this);
+          watch_entry->watch_ = reader.AddWatch(link.DirName(), this);
           if (watch_entry->watch_ != InotifyReader::kInvalidWatch) {
             watch_entry->linkname_ = link.BaseName().value();
           } else {
@@ -468,16 +744,142 @@ bool FilePathWatcherImpl::UpdateWatches() {
     } else {
       watch_entry->watch_ = InotifyReader::kInvalidWatch;
     }
-    if (old_watch != InotifyReader::kInvalidWatch &&
-        old_watch != watch_entry->watch_) {
-      g_inotify_reader.Get().RemoveWatch(old_watch, this);
-    }
+    // Each AddWatch() is matched by a RemoveWatch(), even when the watch is
+    // unchanged.
+    if (old_watch != InotifyReader::kInvalidWatch)
+      reader.RemoveWatch(old_watch, this);
     path = path.Append(watch_entry->subdir_);
   }
 
   return true;
 }
 
+// Collects the directories of a tree.
+class DirectoryCollector : public ParallelFileEnumerator::Visitor {
+ public:
+  explicit DirectoryCollector(std::vector<FilePath>* directories)
+      : directories_(directories) {
+  }
+
+  virtual void OnDirectory(
+      const FilePath& directory,
+      const std::vector<ParallelFileEnumerator::Entry>& entries) OVERRIDE {
+    for (size_t i = 0; i < entries.size(); ++i)
+      directories_->push_back(directory.Append(entries[i].name));
+  }
+
+ private:
+  std::vector<FilePath>* directories_;
+
+  DISALLOW_COPY_AND_ASSIGN(DirectoryCollector);
+};
+
+void FilePathWatcherImpl::AddRecursiveWatches(const FilePath& directory) {
+  InotifyReader& reader = g_inotify_reader.Get();
+  reader.lock().AssertAcquired();
+  pending_scans_.push_back(directory);
+  reader.ScheduleScans(this);
+}
+
+void FilePathWatcherImpl::ScanAndWatch(const FilePath& directory,
+                                       int generation) {
+  InotifyReader& reader = g_inotify_reader.Get();
+  size_t budget;
+  {
+    AutoLock auto_lock(reader.lock());
+    if (generation != scan_generation_)
+      return;
+    budget = options_.max_watches > recursive_watches_.size() ?
+        options_.max_watches - recursive_watches_.size() : 0;
+  }
+
+  std::vector<FilePath> directories;
+  if (DirectoryExists(directory)) {
+    directories.push_back(directory);
+    if (budget) {
+      ParallelFileEnumerator::Options enumerator_options;
+      // Links are not followed, so that each directory is watched once.
+      enumerator_options.file_type =
+          FileEnumerator::DIRECTORIES | FileEnumerator::SHOW_SYM_LINKS;
+      // Each directory read takes a watch: read no more than are left, which
+      // still finds the next one if the tree has more.
+      enumerator_options.max_directories = budget;
+      enumerator_options.num_threads = 1;
+      DirectoryCollector collector(&directories);
+      ParallelFileEnumerator(directory, enumerator_options).Run(&collector);
+    }
+  }
+
+  AutoLock auto_lock(reader.lock());
+  if (generation != scan_generation_)
+    return;
+  AddWatches(directories);
+}
+
+void FilePathWatcherImpl::AddWatches(const std::vector<FilePath>& directories) {
+  InotifyReader& reader = g_inotify_reader.Get();
+  reader.lock().AssertAcquired();
+  for (size_t i = 0; i < directories.size(); ++i) {
+    if (recursive_paths_.count(directories[i]))
+      continue;
+    if (recursive_watches_.size() >= options_.max_watches) {
+      if (!over_budget_) {
+        over_budget_ = true;
+        Report(directories[i], true);
+      }
+      return;
+    }
+    InotifyReader::Watch watch = reader.AddWatch(directories[i], this);
+    if (watch == InotifyReader::kInvalidWatch) {
+      // Removed since, or out of inotify watches.
+      DPLOG_IF(WARNING, errno != ENOENT && errno != ENOTDIR)
+          << "Watch failed for " << directories[i].value();
+      continue;
+    }
+    if (!recursive_watches_.insert(std::make_pair(watch,
+                                                  directories[i])).second) {
+      // Another path to a directory already watched.
+      reader.RemoveWatch(watch, this);
+      continue;
+    }
+    recursive_paths_[directories[i]] = watch;
+  }
+}
+
+void FilePathWatcherImpl::RemoveRecursiveWatches(const FilePath& directory) {
+  InotifyReader& reader = g_inotify_reader.Get();
+  reader.lock().AssertAcquired();
+  std::map<FilePath, InotifyReader::Watch>::iterator it =
+      recursive_paths_.lower_bound(directory);
+  const FilePath::StringType& prefix = directory.value();
+  while (it != recursive_paths_.end() &&
+         it->first.value().compare(0, prefix.size(), prefix) == 0) {
+    if (it->first == directory || directory.IsParent(it->first)) {
+      reader.RemoveWatch(it->second, this);
+      recursive_watches_.erase(it->second);
+      recursive_paths_.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+  if (recursive_watches_.size() < options_.max_watches)
+    over_budget_ = false;
+}
+
+void FilePathWatcherImpl::ResetRecursiveWatches() {
+  RemoveRecursiveWatches(target_);
+  pending_scans_.clear();
+  ++scan_generation_;
+  AddRecursiveWatches(target_);
+}
+
+void FilePathWatcherImpl::Report(const FilePath& path, bool error) {
+  TimeTicks deadline = TimeTicks::Now();
+  if (!error)
+    deadline += options_.coalesce_window;
+  g_inotify_reader.Get().Notify(this, path, error, deadline);
+}
+
 }  // namespace
 
 FilePathWatcher::FilePathWatcher() {
@@ -14,15 +14,13 @@ namespace {
 class FilePathWatcherImpl : public FilePathWatcher::PlatformDelegate {
  public:
   virtual bool Watch(const FilePath& path,
-                     bool recursive,
+                     const FilePathWatcher::Options& options,
                      const FilePathWatcher::Callback& callback) OVERRIDE {
     return false;
   }
 
   virtual void Cancel() OVERRIDE {}
 
-  virtual void CancelOnMessageLoopThread() OVERRIDE {}
-
  protected:
   virtual ~FilePathWatcherImpl() {}
 };
@@ -0,0 +1,255 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/files/file_path_watcher.h"
+
+#include <sys/stat.h>
+
+#include <utility>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/synchronization/lock.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/platform_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+// Records the notifications, which arrive on the watcher thread.
+class Recorder {
+ public:
+  Recorder() : event_(false, false) {}
+
+  void OnChange(const FilePath& path, bool error) {
+    {
+      AutoLock lock(lock_);
+      changes_.push_back(std::make_pair(path, error));
+    }
+    event_.Signal();
+  }
+
+  // Waits until a notification of |path| arrives, or times out.
+  bool WaitFor(const FilePath& path, bool error) {
+    const TimeTicks deadline = TimeTicks::Now() + TimeDelta::FromSeconds(10);
+    for (;;) {
+      if (Count(path, error))
+        return true;
+      TimeDelta remaining = deadline - TimeTicks::Now();
+      if (remaining <= TimeDelta())
+        return false;
+      event_.TimedWait(remaining);
+    }
+  }
+
+  size_t Count(const FilePath& path, bool error) {
+    AutoLock lock(lock_);
+    size_t count = 0;
+    for (size_t i = 0; i < changes_.size(); ++i) {
+      if (changes_[i].first == path && changes_[i].second == error)
+        ++count;
+    }
+    return count;
+  }
+
+  size_t size() {
+    AutoLock lock(lock_);
+    return changes_.size();
+  }
+
+  void Clear() {
+    AutoLock lock(lock_);
+    changes_.clear();
+  }
+
+ private:
+  Lock lock_;
+  std::vector<std::pair<FilePath, bool> > changes_;
+  WaitableEvent event_;
+};
+
+void CancelAndRecord(FilePathWatcher* watcher,
+                     Recorder* recorder,
+                     const FilePath& path,
+                     bool error) {
+  watcher->Cancel();
+  recorder->OnChange(path, error);
+}
+
+class FilePathWatcherTest : public testing::Test {
+ protected:
+  virtual void SetUp() OVERRIDE {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+  }
+
+  FilePath Path(const char* relative) {
+    return temp_dir_.path().AppendASCII(relative);
+  }
+
+  void Write(const FilePath& path, const std::string& data) {
+    ASSERT_EQ(static_cast<int>(data.size()),
+              file_util::WriteFile(path, data.data(), data.size()));
+  }
+
+  ScopedTempDir temp_dir_;
+  Recorder recorder_;
+};
+
+}  // namespace
+
+TEST_F(FilePathWatcherTest, FileCreatedModifiedDeleted) {
+  const FilePath file = Path("file");
+  FilePathWatcher watcher;
+  ASSERT_TRUE(watcher.Watch(file, false,
+                            Bind(&Recorder::OnChange,
+                                 Unretained(&recorder_))));
+
+  Write(file, "content");
+  EXPECT_TRUE(recorder_.WaitFor(file, false));
+
+  recorder_.Clear();
+  Write(file, "new content");
+  EXPECT_TRUE(recorder_.WaitFor(file, false));
+
+  recorder_.Clear();
+  ASSERT_TRUE(DeleteFile(file, false));
+  EXPECT_TRUE(recorder_.WaitFor(file, false));
+}
+
+TEST_F(FilePathWatcherTest, ParentCreatedLater) {
+  const FilePath file = Path("dir/file");
+  FilePathWatcher watcher;
+  ASSERT_TRUE(watcher.Watch(file, false,
+                            Bind(&Recorder::OnChange,
+                                 Unretained(&recorder_))));
+
+  ASSERT_TRUE(file_util::CreateDirectory(Path("dir")));
+  Write(file, "content");
+  EXPECT_TRUE(recorder_.WaitFor(file, false));
+}
+
+TEST_F(FilePathWatcherTest, CoalescesBursts) {
+  const FilePath file = Path("file");
+  Write(file, "");
+  FilePathWatcher::Options options;
+  options.coalesce_window = TimeDelta::FromMilliseconds(300);
+  FilePathWatcher watcher;
+  ASSERT_TRUE(watcher.Watch(file, options,
+                            Bind(&Recorder::OnChange,
+                                 Unretained(&recorder_))));
+
+  for (int i = 0; i < 50; ++i)
+    Write(file, "burst");
+  EXPECT_TRUE(recorder_.WaitFor(file, false));
+  // Allow for the burst straddling two windows on a slow machine.
+  EXPECT_GE(2u, recorder_.size());
+}
+
+TEST_F(FilePathWatcherTest, Recursive) {
+  ASSERT_TRUE(FilePathWatcher::RecursiveWatchAvailable());
+  ASSERT_TRUE(file_util::CreateDirectory(Path("tree/a/b")));
+  FilePathWatcher::Options options;
+  options.recursive = true;
+  FilePathWatcher watcher;
+  ASSERT_TRUE(watcher.Watch(Path("tree"), options,
+                            Bind(&Recorder::OnChange,
+                                 Unretained(&recorder_))));
+
+  // The path that changed is reported.
+  Write(Path("tree/a/b/file"), "content");
+  EXPECT_TRUE(recorder_.WaitFor(Path("tree/a/b/file"), false));
+
+  // New directories are watched.
+  ASSERT_TRUE(file_util::CreateDirectory(Path("tree/a/new")));
+  EXPECT_TRUE(recorder_.WaitFor(Path("tree/a/new"), false));
+  Write(Path("tree/a/new/file"), "content");
+  EXPECT_TRUE(recorder_.WaitFor(Path("tree/a/new/file"), false));
+
+  // As are moved ones.
+  ASSERT_TRUE(file_util::CreateDirectory(Path("outside/sub")));
+  ASSERT_TRUE(Move(Path("outside"), Path("tree/moved")));
+  EXPECT_TRUE(recorder_.WaitFor(Path("tree/moved"), false));
+  Write(Path("tree/moved/sub/file"), "content");
+  EXPECT_TRUE(recorder_.WaitFor(Path("tree/moved/sub/file"), false));
+  EXPECT_FALSE(recorder_.Count(Path("tree/moved/sub/file"), true));
+}
+
+TEST_F(FilePathWatcherTest, RecursiveTargetAttributesChanged) {
+  ASSERT_TRUE(file_util::CreateDirectory(Path("tree/a")));
+  FilePathWatcher::Options options;
+  options.recursive = true;
+  FilePathWatcher watcher;
+  ASSERT_TRUE(watcher.Watch(Path("tree"), options,
+                            Bind(&Recorder::OnChange,
+                                 Unretained(&recorder_))));
+
+  // The tree is still watched after |target| itself changes.
+  ASSERT_EQ(0, chmod(Path("tree").value().c_str(), 0750));
+  EXPECT_TRUE(recorder_.WaitFor(Path("tree"), false));
+  Write(Path("tree/a/file"), "content");
+  EXPECT_TRUE(recorder_.WaitFor(Path("tree/a/file"), false));
+  EXPECT_EQ(0u, recorder_.Count(Path("tree/a"), true));
+}
+
+TEST_F(FilePathWatcherTest, RecursiveWatchBudget) {
+  ASSERT_TRUE(file_util::CreateDirectory(Path("tree/a")));
+  ASSERT_TRUE(file_util::CreateDirectory(Path("tree/b")));
+  ASSERT_TRUE(file_util::CreateDirectory(Path("tree/c")));
+  FilePathWatcher::Options options;
+  options.recursive = true;
+  options.max_watches = 2;
+  FilePathWatcher watcher;
+  ASSERT_TRUE(watcher.Watch(Path("tree"), options,
+                            Bind(&Recorder::OnChange,
+                                 Unretained(&recorder_))));
+
+  // One of the subdirectories is left unwatched, and reported once.
+  const TimeTicks deadline = TimeTicks::Now() + TimeDelta::FromSeconds(10);
+  while (!recorder_.size() && TimeTicks::Now() < deadline)
+    PlatformThread::Sleep(TimeDelta::FromMilliseconds(10));
+  ASSERT_EQ(1u, recorder_.size());
+  EXPECT_EQ(1u, recorder_.Count(Path("tree/a"), true) +
+                recorder_.Count(Path("tree/b"), true) +
+                recorder_.Count(Path("tree/c"), true));
+
+  // The watch carries on.
+  Write(Path("tree/file"), "content");
+  EXPECT_TRUE(recorder_.WaitFor(Path("tree/file"), false));
+}
+
+TEST_F(FilePathWatcherTest, CancelFromCallback) {
+  const FilePath file = Path("file");
+  FilePathWatcher watcher;
+  ASSERT_TRUE(watcher.Watch(file, false,
+                            Bind(&CancelAndRecord, &watcher,
+                                 Unretained(&recorder_))));
+
+  Write(file, "content");
+  EXPECT_TRUE(recorder_.WaitFor(file, false));
+  Write(file, "more content");
+  PlatformThread::Sleep(TimeDelta::FromMilliseconds(100));
+  EXPECT_EQ(1u, recorder_.size());
+}
+
+TEST_F(FilePathWatcherTest, NoCallbackAfterCancel) {
+  const FilePath file = Path("file");
+  FilePathWatcher::Options options;
+  options.coalesce_window = TimeDelta::FromMilliseconds(50);
+  scoped_ptr<FilePathWatcher> watcher(new FilePathWatcher);
+  ASSERT_TRUE(watcher->Watch(file, options,
+                             Bind(&Recorder::OnChange,
+                                  Unretained(&recorder_))));
+
+  Write(file, "content");
+  watcher.reset();
+  size_t count = recorder_.size();
+  PlatformThread::Sleep(TimeDelta::FromMilliseconds(100));
+  EXPECT_EQ(count, recorder_.size());
+}
+
+}  // namespace base
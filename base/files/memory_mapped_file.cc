@@ -9,14 +9,49 @@
 
 namespace base {
 
+const MemoryMappedFile::Region MemoryMappedFile::Region::kWholeFile = { 0, -1 };
+
+bool MemoryMappedFile::Region::operator==(
+    const MemoryMappedFile::Region& other) const {
+  return other.offset == offset && other.size == size;
+}
+
+bool MemoryMappedFile::Region::operator!=(
+    const MemoryMappedFile::Region& other) const {
+  return !(*this == other);
+}
+
 MemoryMappedFile::~MemoryMappedFile() {
   CloseHandles();
 }
 
 bool MemoryMappedFile::Initialize(const FilePath& file_name) {
+  return Initialize(file_name, Region::kWholeFile, READ_ONLY,
+                    MEMORY_HINT_NONE);
+}
+
+bool MemoryMappedFile::Initialize(PlatformFile file) {
+  return Initialize(file, Region::kWholeFile, READ_ONLY, MEMORY_HINT_NONE);
+}
+
+bool MemoryMappedFile::Initialize(const FilePath& file_name, int hints) {
+  return Initialize(file_name, Region::kWholeFile, READ_ONLY, hints);
+}
+
+bool MemoryMappedFile::Initialize(PlatformFile file, int hints) {
+  return Initialize(file, Region::kWholeFile, READ_ONLY, hints);
+}
+
+bool MemoryMappedFile::Initialize(const FilePath& file_name,
+                                  const Region& region,
+                                  Access access,
+                                  int hints) {
   if (IsValid())
     return false;
 
+  region_ = region;
+  access_ = access;
+  hints_ = hints;
   if (!MapFileToMemory(file_name)) {
     CloseHandles();
     return false;
@@ -25,12 +60,17 @@ bool MemoryMappedFile::Initialize(const FilePath& file_name) {
   return true;
 }
 
-bool MemoryMappedFile::Initialize(PlatformFile file) {
+bool MemoryMappedFile::Initialize(PlatformFile file,
+                                  const Region& region,
+                                  Access access,
+                                  int hints) {
   if (IsValid())
     return false;
 
   file_ = file;
-
+  region_ = region;
+  access_ = access;
+  hints_ = hints;
   if (!MapFileToMemoryInternal()) {
     CloseHandles();
     return false;
@@ -43,9 +83,15 @@ bool MemoryMappedFile::IsValid() const {
   return data_ != NULL;
 }
 
+bool MemoryMappedFile::Flush(FlushMode mode) {
+  return Flush(0, length_, mode);
+}
+
 bool MemoryMappedFile::MapFileToMemory(const FilePath& file_name) {
-  file_ = CreatePlatformFile(file_name, PLATFORM_FILE_OPEN | PLATFORM_FILE_READ,
-                             NULL, NULL);
+  int flags = PLATFORM_FILE_OPEN | PLATFORM_FILE_READ;
+  if (access_ == READ_WRITE || access_ == READ_WRITE_EXTEND)
+    flags |= PLATFORM_FILE_WRITE;
+  file_ = CreatePlatformFile(file_name, flags, NULL, NULL);
 
   if (file_ == kInvalidPlatformFileValue) {
     DLOG(ERROR) << "Couldn't open " << file_name.AsUTF8Unsafe();
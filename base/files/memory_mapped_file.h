@@ -7,6 +7,7 @@
 
 #include "base/base_export.h"
 #include "base/basictypes.h"
+#include "base/memory/memory_hints.h"
 #include "base/platform_file.h"
 #include "build/build_config.h"
 
@@ -20,6 +21,37 @@ class FilePath;
 
 class BASE_EXPORT MemoryMappedFile {
  public:
+  enum Access {
+    // Mapped pages can only be read.
+    READ_ONLY,
+    // Writes to the mapped pages go to the file, which must be writable.
+    READ_WRITE,
+    // As READ_WRITE, but the file is first extended to cover the region.
+    READ_WRITE_EXTEND,
+    // Writes to the mapped pages are private to the mapping (copy-on-write);
+    // the file is opened read only and never changes.
+    READ_WRITE_COPY,
+  };
+
+  // The part of the file to map, in bytes. Need not be aligned to pages.
+  struct BASE_EXPORT Region {
+    // Maps the whole file.
+    static const Region kWholeFile;
+
+    bool operator==(const Region& other) const;
+    bool operator!=(const Region& other) const;
+
+    int64 offset;
+    int64 size;
+  };
+
+  enum FlushMode {
+    // Starts writing the changed pages back to the file.
+    FLUSH_ASYNC,
+    // Returns once the changed pages are written back to the file.
+    FLUSH_SYNC,
+  };
+
   // The default constructor sets all members to invalid/null values.
   MemoryMappedFile();
   ~MemoryMappedFile();
@@ -28,12 +60,29 @@ class BASE_EXPORT MemoryMappedFile {
   // read only. If this object already points to a valid memory mapped file
   // then this method will fail and return false. If it cannot open the file,
   // the file does not exist, or the memory mapping fails, it will return false.
-  // Later we may want to allow the user to specify access.
   bool Initialize(const FilePath& file_name);
   // As above, but works with an already-opened file. MemoryMappedFile will take
   // ownership of |file| and close it when done.
   bool Initialize(PlatformFile file);
 
+  // As above, applying |hints| (MemoryHints) to the mapping, for example
+  // MEMORY_HINT_RANDOM | MEMORY_HINT_HUGE_PAGES for a large index that is
+  // probed all over. Hints are ignored on Windows.
+  bool Initialize(const FilePath& file_name, int hints);
+  bool Initialize(PlatformFile file, int hints);
+
+  // As above, mapping |region| of the file with |access|. Unless |access| is
+  // READ_WRITE_EXTEND, the region must lie within the file. |file| must have
+  // been opened for writing for READ_WRITE and READ_WRITE_EXTEND.
+  bool Initialize(const FilePath& file_name,
+                  const Region& region,
+                  Access access,
+                  int hints);
+  bool Initialize(PlatformFile file,
+                  const Region& region,
+                  Access access,
+                  int hints);
+
 #if defined(OS_WIN)
   // Opens an existing file and maps it as an image section. Please refer to
   // the Initialize function above for additional information.
@@ -41,17 +90,31 @@ class BASE_EXPORT MemoryMappedFile {
 #endif  // OS_WIN
 
   const uint8* data() const { return data_; }
+  uint8* data() { return data_; }
   size_t length() const { return length_; }
 
   // Is file_ a valid file handle that points to an open, memory mapped file?
   bool IsValid() const;
 
+  // Changes the length of the mapped region to |length|, extending the file
+  // when it is too short; the file is never shrunk. The mapping may move, so
+  // data() must be fetched again. Only for READ_WRITE and READ_WRITE_EXTEND
+  // mappings. Returns false, leaving the mapping as it was, on failure.
+  bool Resize(size_t length);
+
+  // Writes the changes to the mapped region, or to the |length| bytes at
+  // |offset| in it, back to the file. Only for READ_WRITE and
+  // READ_WRITE_EXTEND mappings.
+  bool Flush(FlushMode mode);
+  bool Flush(size_t offset, size_t length, FlushMode mode);
+
  private:
   // Open the given file and pass it to MapFileToMemoryInternal().
   bool MapFileToMemory(const FilePath& file_name);
 
-  // Map the file to memory, set data_ to that memory address. Return true on
-  // success, false on any kind of failure. This is a helper for Initialize().
+  // Map |region_| of the file to memory with |access_|, set data_ to that
+  // memory address. Return true on success, false on any kind of failure.
+  // This is a helper for Initialize().
   bool MapFileToMemoryInternal();
 
   // Closes all open handles. Later we may want to make this public.
@@ -67,6 +130,20 @@ class BASE_EXPORT MemoryMappedFile {
   PlatformFile file_;
   uint8* data_;
   size_t length_;
+  // The region and access the file is mapped with. Once mapped, the offset
+  // of kWholeFile is valid.
+  Region region_;
+  Access access_;
+  // The MemoryHints the file is mapped with.
+  int hints_;
+  // Mappings start at an offset aligned to pages (allocation granularity on
+  // Windows), this far before data_.
+  size_t data_offset_;
+#if defined(OS_POSIX)
+  // The length to unmap from data_ - data_offset_, which is rounded up to
+  // huge pages for hugetlb mappings.
+  size_t mapped_length_;
+#endif
 
   DISALLOW_COPY_AND_ASSIGN(MemoryMappedFile);
 };
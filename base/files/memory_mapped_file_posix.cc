@@ -8,15 +8,121 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <limits>
+
 #include "base/logging.h"
 #include "base/posix/eintr_wrapper.h"
 
+#if defined(OS_LINUX) && !defined(MAP_HUGETLB)
+#define MAP_HUGETLB 0x40000
+#endif
+
 namespace base {
 
+namespace {
+
+int ProtectionFor(MemoryMappedFile::Access access) {
+  return access == MemoryMappedFile::READ_ONLY ? PROT_READ
+                                               : PROT_READ | PROT_WRITE;
+}
+
+int FlagsFor(MemoryMappedFile::Access access, int hints) {
+  int flags =
+      access == MemoryMappedFile::READ_WRITE_COPY ? MAP_PRIVATE : MAP_SHARED;
+#if defined(OS_LINUX)
+  if (hints & MEMORY_HINT_POPULATE)
+    flags |= MAP_POPULATE;
+#endif
+  return flags;
+}
+
+// Extends |file| to |size| bytes if it is shorter.
+bool ExtendFile(PlatformFile file, int64 size) {
+  struct stat file_stat;
+  if (fstat(file, &file_stat)) {
+    DPLOG(ERROR) << "fstat " << file;
+    return false;
+  }
+  if (file_stat.st_size >= size)
+    return true;
+  if (HANDLE_EINTR(ftruncate(file, size))) {
+    DPLOG(ERROR) << "ftruncate " << file;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
 MemoryMappedFile::MemoryMappedFile()
     : file_(kInvalidPlatformFileValue),
       data_(NULL),
-      length_(0) {
+      length_(0),
+      region_(Region::kWholeFile),
+      access_(READ_ONLY),
+      hints_(MEMORY_HINT_NONE),
+      data_offset_(0),
+      mapped_length_(0) {
+}
+
+bool MemoryMappedFile::Resize(size_t length) {
+//  ThreadRestrictions::AssertIOAllowed();
+  DCHECK(IsValid());
+  DCHECK(access_ == READ_WRITE || access_ == READ_WRITE_EXTEND);
+  DCHECK_GT(length, 0u);
+  // hugetlb mappings cannot be resized.
+  DCHECK_EQ(data_offset_ + length_, mapped_length_);
+
+  if (!ExtendFile(file_, region_.offset + length))
+    return false;
+
+  uint8* mapping = data_ - data_offset_;
+  size_t mapped_length = data_offset_ + length;
+#if defined(OS_LINUX)
+  void* new_mapping =
+      mremap(mapping, mapped_length_, mapped_length, MREMAP_MAYMOVE);
+#else
+  // Map the new region before unmapping the old one, which keeps the mapping
+  // as it was on failure. Both map the same pages of the file.
+  void* new_mapping = mmap(NULL, mapped_length, ProtectionFor(access_),
+                           FlagsFor(access_, hints_), file_,
+                           region_.offset - data_offset_);
+  if (new_mapping != MAP_FAILED)
+    munmap(mapping, mapped_length_);
+#endif
+  if (new_mapping == MAP_FAILED) {
+    DPLOG(ERROR) << "remapping " << file_;
+    return false;
+  }
+
+  data_ = static_cast<uint8*>(new_mapping) + data_offset_;
+  length_ = length;
+  mapped_length_ = mapped_length;
+  region_.size = length;
+  int hints = hints_ & ~(MEMORY_HINT_HUGETLB | MEMORY_HINT_POPULATE);
+  if (hints)
+    ApplyMemoryHints(data_, length_, hints);
+  return true;
+}
+
+bool MemoryMappedFile::Flush(size_t offset, size_t length, FlushMode mode) {
+//  ThreadRestrictions::AssertIOAllowed();
+  DCHECK(IsValid());
+  DCHECK(access_ == READ_WRITE || access_ == READ_WRITE_EXTEND);
+  DCHECK_LE(offset, length_);
+  DCHECK_LE(length, length_ - offset);
+
+  // msync() takes page aligned addresses.
+  const uintptr_t page_mask = static_cast<uintptr_t>(getpagesize()) - 1;
+  uintptr_t start = reinterpret_cast<uintptr_t>(data_ + offset);
+  uintptr_t aligned_start = start & ~page_mask;
+  if (msync(reinterpret_cast<void*>(aligned_start),
+            length + (start - aligned_start),
+            mode == FLUSH_SYNC ? MS_SYNC : MS_ASYNC)) {
+    DPLOG(ERROR) << "msync " << file_;
+    return false;
+  }
+  return true;
 }
 
 bool MemoryMappedFile::MapFileToMemoryInternal() {
@@ -27,26 +133,75 @@ bool MemoryMappedFile::MapFileToMemoryInternal() {
     DPLOG(ERROR) << "fstat " << file_;
     return false;
   }
-  length_ = file_stat.st_size;
 
-  data_ = static_cast<uint8*>(
-      mmap(NULL, length_, PROT_READ, MAP_SHARED, file_, 0));
-  if (data_ == MAP_FAILED)
+  if (region_ == Region::kWholeFile) {
+    region_.offset = 0;
+    region_.size = file_stat.st_size;
+  } else if (region_.offset < 0 || region_.size <= 0) {
+    DLOG(ERROR) << "Invalid region " << region_.offset << " " << region_.size;
+    return false;
+  }
+  if (static_cast<uint64>(region_.size) >
+      std::numeric_limits<size_t>::max() - getpagesize()) {
+    DLOG(ERROR) << "Region too large " << region_.size;
+    return false;
+  }
+  if (access_ == READ_WRITE_EXTEND) {
+    if (!ExtendFile(file_, region_.offset + region_.size))
+      return false;
+  } else if (region_.offset + region_.size > file_stat.st_size) {
+    DLOG(ERROR) << "Region beyond the end of " << file_;
+    return false;
+  }
+
+  length_ = static_cast<size_t>(region_.size);
+  data_offset_ = region_.offset % getpagesize();
+  mapped_length_ = data_offset_ + length_;
+  const int64 map_offset = region_.offset - data_offset_;
+  const int protection = ProtectionFor(access_);
+  const int flags = FlagsFor(access_, hints_);
+
+  void* mapping = MAP_FAILED;
+#if defined(OS_LINUX)
+  if (hints_ & MEMORY_HINT_HUGETLB) {
+    // Only works for files on hugetlbfs; others get normal pages below.
+    size_t huge_length =
+        (mapped_length_ + kHugePageSize - 1) & ~(kHugePageSize - 1);
+    mapping = mmap(NULL, huge_length, protection, flags | MAP_HUGETLB, file_,
+                   map_offset);
+    if (mapping != MAP_FAILED)
+      mapped_length_ = huge_length;
+  }
+#endif
+  if (mapping == MAP_FAILED)
+    mapping = mmap(NULL, mapped_length_, protection, flags, file_, map_offset);
+  if (mapping == MAP_FAILED) {
     DPLOG(ERROR) << "mmap " << file_;
+    // CloseHandles() must not unmap it.
+    data_ = NULL;
+    return false;
+  }
+  data_ = static_cast<uint8*>(mapping) + data_offset_;
 
-  return data_ != MAP_FAILED;
+  // Populating is done by the mapping, and would write to the pages.
+  int hints = hints_ & ~(MEMORY_HINT_HUGETLB | MEMORY_HINT_POPULATE);
+  if (hints)
+    ApplyMemoryHints(data_, length_, hints);
+  return true;
 }
 
 void MemoryMappedFile::CloseHandles() {
 //  ThreadRestrictions::AssertIOAllowed();
 
   if (data_ != NULL)
-    munmap(data_, length_);
+    munmap(data_ - data_offset_, mapped_length_);
   if (file_ != kInvalidPlatformFileValue)
     ignore_result(HANDLE_EINTR(close(file_)));
 
   data_ = NULL;
   length_ = 0;
+  data_offset_ = 0;
+  mapped_length_ = 0;
   file_ = kInvalidPlatformFileValue;
 }
 
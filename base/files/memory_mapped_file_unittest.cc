@@ -0,0 +1,183 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/files/memory_mapped_file.h"
+
+#include <string.h>
+
+#include <string>
+
+#include "base/file_util.h"
+#include "base/files/file_path.h"
+#include "base/files/scoped_temp_dir.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+// Returns the contents of a test file of |size| bytes.
+std::string TestData(size_t size) {
+  std::string data(size, 0);
+  for (size_t i = 0; i < size; ++i)
+    data[i] = static_cast<char>(i * 31 + 7);
+  return data;
+}
+
+class MemoryMappedFileTest : public testing::Test {
+ protected:
+  virtual void SetUp() OVERRIDE {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    path_ = temp_dir_.path().AppendASCII("mapped");
+  }
+
+  void CreateFile(const std::string& data) {
+    ASSERT_EQ(static_cast<int>(data.size()),
+              file_util::WriteFile(path_, data.data(), data.size()));
+  }
+
+  std::string FileContents() {
+    std::string contents;
+    EXPECT_TRUE(ReadFileToString(path_, &contents));
+    return contents;
+  }
+
+  ScopedTempDir temp_dir_;
+  FilePath path_;
+};
+
+}  // namespace
+
+TEST_F(MemoryMappedFileTest, MapWholeFile) {
+  const std::string data = TestData(100000);
+  CreateFile(data);
+
+  MemoryMappedFile map;
+  ASSERT_TRUE(map.Initialize(path_));
+  EXPECT_TRUE(map.IsValid());
+  ASSERT_EQ(data.size(), map.length());
+  EXPECT_EQ(data, std::string(reinterpret_cast<const char*>(map.data()),
+                              map.length()));
+  // Already initialized.
+  EXPECT_FALSE(map.Initialize(path_));
+}
+
+TEST_F(MemoryMappedFileTest, MapMissingFile) {
+  MemoryMappedFile map;
+  EXPECT_FALSE(map.Initialize(path_));
+  EXPECT_FALSE(map.IsValid());
+}
+
+TEST_F(MemoryMappedFileTest, MapWithHints) {
+  const std::string data = TestData(3 * 1024 * 1024 + 5);
+  CreateFile(data);
+
+  const int kHints[] = {
+    MEMORY_HINT_SEQUENTIAL | MEMORY_HINT_WILLNEED,
+    MEMORY_HINT_RANDOM | MEMORY_HINT_HUGE_PAGES,
+    MEMORY_HINT_POPULATE,
+    // Not on hugetlbfs, so mapped with normal pages.
+    MEMORY_HINT_HUGETLB | MEMORY_HINT_POPULATE,
+  };
+  for (size_t i = 0; i < arraysize(kHints); ++i) {
+    MemoryMappedFile map;
+    ASSERT_TRUE(map.Initialize(path_, kHints[i])) << kHints[i];
+    ASSERT_EQ(data.size(), map.length());
+    EXPECT_EQ(data, std::string(reinterpret_cast<const char*>(map.data()),
+                                map.length()));
+  }
+}
+
+TEST_F(MemoryMappedFileTest, MapRegion) {
+  const std::string data = TestData(100000);
+  CreateFile(data);
+
+  // Regions need not be aligned to pages.
+  const MemoryMappedFile::Region kRegions[] = {
+    { 0, 1 },
+    { 4096, 8192 },
+    { 12345, 54321 },
+    { 99999, 1 },
+  };
+  for (size_t i = 0; i < arraysize(kRegions); ++i) {
+    const MemoryMappedFile::Region& region = kRegions[i];
+    MemoryMappedFile map;
+    ASSERT_TRUE(map.Initialize(path_, region, MemoryMappedFile::READ_ONLY,
+                               MEMORY_HINT_NONE));
+    ASSERT_EQ(static_cast<size_t>(region.size), map.length());
+    EXPECT_EQ(data.substr(region.offset, region.size),
+              std::string(reinterpret_cast<const char*>(map.data()),
+                          map.length()));
+  }
+
+  // Past the end of the file.
+  MemoryMappedFile map;
+  const MemoryMappedFile::Region kPastEnd = { 90000, 20000 };
+  EXPECT_FALSE(map.Initialize(path_, kPastEnd, MemoryMappedFile::READ_ONLY,
+                              MEMORY_HINT_NONE));
+}
+
+TEST_F(MemoryMappedFileTest, ReadWrite) {
+  const std::string data = TestData(10000);
+  CreateFile(data);
+
+  {
+    MemoryMappedFile map;
+    const MemoryMappedFile::Region kRegion = { 5000, 100 };
+    ASSERT_TRUE(map.Initialize(path_, kRegion, MemoryMappedFile::READ_WRITE,
+                               MEMORY_HINT_NONE));
+    memset(map.data(), 'x', map.length());
+    EXPECT_TRUE(map.Flush(MemoryMappedFile::FLUSH_SYNC));
+    EXPECT_TRUE(map.Flush(10, 20, MemoryMappedFile::FLUSH_ASYNC));
+  }
+  std::string expected = data;
+  expected.replace(5000, 100, 100, 'x');
+  EXPECT_EQ(expected, FileContents());
+}
+
+TEST_F(MemoryMappedFileTest, CopyOnWrite) {
+  const std::string data = TestData(10000);
+  CreateFile(data);
+
+  MemoryMappedFile map;
+  ASSERT_TRUE(map.Initialize(path_, MemoryMappedFile::Region::kWholeFile,
+                             MemoryMappedFile::READ_WRITE_COPY,
+                             MEMORY_HINT_NONE));
+  memset(map.data(), 'x', map.length());
+  EXPECT_EQ('x', map.data()[9999]);
+  // The file is left as it was.
+  EXPECT_EQ(data, FileContents());
+}
+
+TEST_F(MemoryMappedFileTest, ExtendAndResize) {
+  CreateFile("header");
+
+  MemoryMappedFile map;
+  const MemoryMappedFile::Region kRegion = { 6, 100 };
+  ASSERT_TRUE(map.Initialize(path_, kRegion,
+                             MemoryMappedFile::READ_WRITE_EXTEND,
+                             MEMORY_HINT_NONE));
+  ASSERT_EQ(100u, map.length());
+  memset(map.data(), 'a', map.length());
+
+  // Appends to the file through the mapping.
+  ASSERT_TRUE(map.Resize(3 * 1024 * 1024));
+  EXPECT_EQ('a', map.data()[99]);
+  memset(map.data() + 100, 'b', map.length() - 100);
+  EXPECT_TRUE(map.Flush(MemoryMappedFile::FLUSH_SYNC));
+
+  std::string contents = FileContents();
+  ASSERT_EQ(6u + 3 * 1024 * 1024, contents.size());
+  EXPECT_EQ("header", contents.substr(0, 6));
+  EXPECT_EQ(std::string(100, 'a'), contents.substr(6, 100));
+  EXPECT_EQ(std::string(3 * 1024 * 1024 - 100, 'b'), contents.substr(106));
+
+  // Shrinking the mapping leaves the file as it is.
+  ASSERT_TRUE(map.Resize(50));
+  EXPECT_EQ(50u, map.length());
+  EXPECT_EQ('a', map.data()[49]);
+  EXPECT_EQ(contents.size(), FileContents().size());
+}
+
+}  // namespace base
@@ -4,22 +4,62 @@
 
 #include "base/files/memory_mapped_file.h"
 
+#include <limits>
+
 #include "base/files/file_path.h"
 #include "base/logging.h"
 #include "base/strings/string16.h"
 
 namespace base {
 
+namespace {
+
+DWORD ProtectionFor(MemoryMappedFile::Access access) {
+  switch (access) {
+    case MemoryMappedFile::READ_ONLY:
+      return PAGE_READONLY;
+    case MemoryMappedFile::READ_WRITE_COPY:
+      return PAGE_WRITECOPY;
+    default:
+      return PAGE_READWRITE;
+  }
+}
+
+DWORD ViewAccessFor(MemoryMappedFile::Access access) {
+  switch (access) {
+    case MemoryMappedFile::READ_ONLY:
+      return FILE_MAP_READ;
+    case MemoryMappedFile::READ_WRITE_COPY:
+      return FILE_MAP_COPY;
+    default:
+      return FILE_MAP_WRITE;
+  }
+}
+
+DWORD AllocationGranularity() {
+  SYSTEM_INFO info;
+  ::GetSystemInfo(&info);
+  return info.dwAllocationGranularity;
+}
+
+}  // namespace
+
 MemoryMappedFile::MemoryMappedFile()
     : file_(INVALID_HANDLE_VALUE),
       file_mapping_(INVALID_HANDLE_VALUE),
       data_(NULL),
-      length_(INVALID_FILE_SIZE) {
+      length_(INVALID_FILE_SIZE),
+      region_(Region::kWholeFile),
+      access_(READ_ONLY),
+      hints_(MEMORY_HINT_NONE),
+      data_offset_(0) {
 }
 
 bool MemoryMappedFile::InitializeAsImageSection(const FilePath& file_name) {
   if (IsValid())
     return false;
+  region_ = Region::kWholeFile;
+  access_ = READ_ONLY;
   file_ = CreatePlatformFile(file_name, PLATFORM_FILE_OPEN | PLATFORM_FILE_READ,
                              NULL, NULL);
 
@@ -44,12 +84,33 @@ bool MemoryMappedFile::MapFileToMemoryInternalEx(int flags) {
   if (file_ == INVALID_HANDLE_VALUE)
     return false;
 
-  length_ = ::GetFileSize(file_, NULL);
-  if (length_ == INVALID_FILE_SIZE)
+  LARGE_INTEGER file_size;
+  if (!::GetFileSizeEx(file_, &file_size))
     return false;
 
-  file_mapping_ = ::CreateFileMapping(file_, NULL, PAGE_READONLY | flags,
-                                      0, 0, NULL);
+  if (region_ == Region::kWholeFile) {
+    region_.offset = 0;
+    region_.size = file_size.QuadPart;
+  } else if (region_.offset < 0 || region_.size <= 0) {
+    return false;
+  }
+  if (static_cast<uint64>(region_.size) > std::numeric_limits<size_t>::max() -
+                                              AllocationGranularity()) {
+    return false;
+  }
+  if (access_ != READ_WRITE_EXTEND &&
+      region_.offset + region_.size > file_size.QuadPart) {
+    return false;
+  }
+
+  // A mapping larger than the file extends it; zero maps the file as it is.
+  LARGE_INTEGER mapping_size;
+  mapping_size.QuadPart =
+      access_ == READ_WRITE_EXTEND ? region_.offset + region_.size : 0;
+  file_mapping_ = ::CreateFileMapping(file_, NULL,
+                                      ProtectionFor(access_) | flags,
+                                      mapping_size.HighPart,
+                                      mapping_size.LowPart, NULL);
   if (!file_mapping_) {
     // According to msdn, system error codes are only reserved up to 15999.
     // http://msdn.microsoft.com/en-us/library/ms681381(v=VS.85).aspx.
@@ -58,24 +119,77 @@ bool MemoryMappedFile::MapFileToMemoryInternalEx(int flags) {
     return false;
   }
 
-  data_ = static_cast<uint8*>(
-      ::MapViewOfFile(file_mapping_, FILE_MAP_READ, 0, 0, 0));
-  if (!data_) {
+  // Views start at a multiple of the allocation granularity.
+  data_offset_ = region_.offset % AllocationGranularity();
+  length_ = static_cast<size_t>(region_.size);
+  LARGE_INTEGER view_offset;
+  view_offset.QuadPart = region_.offset - data_offset_;
+  uint8* view = static_cast<uint8*>(
+      ::MapViewOfFile(file_mapping_, ViewAccessFor(access_),
+                      view_offset.HighPart, view_offset.LowPart,
+                      data_offset_ + length_));
+  if (!view) {
     //UMA_HISTOGRAM_ENUMERATION("MemoryMappedFile.MapViewOfFile",
     //                          logging::GetLastSystemErrorCode(), 16000);
+    return false;
+  }
+  data_ = view + data_offset_;
+  return true;
+}
+
+bool MemoryMappedFile::Resize(size_t length) {
+  DCHECK(IsValid());
+  DCHECK(access_ == READ_WRITE || access_ == READ_WRITE_EXTEND);
+  DCHECK_GT(length, 0u);
+
+  // A file mapping cannot grow, so map the file again with the new region
+  // before dropping the current mapping. Both map the same pages of the file.
+  HANDLE file_mapping = file_mapping_;
+  uint8* data = data_;
+  size_t data_offset = data_offset_;
+  Region region = region_;
+  Access access = access_;
+  region_.size = length;
+  access_ = READ_WRITE_EXTEND;
+  if (!MapFileToMemoryInternalEx(0)) {
+    if (file_mapping_ && file_mapping_ != file_mapping)
+      ::CloseHandle(file_mapping_);
+    file_mapping_ = file_mapping;
+    data_ = data;
+    data_offset_ = data_offset;
+    length_ = static_cast<size_t>(region.size);
+    region_ = region;
+    access_ = access;
+    return false;
   }
-  return data_ != NULL;
+  access_ = access;
+  ::UnmapViewOfFile(data - data_offset);
+  ::CloseHandle(file_mapping);
+  return true;
+}
+
+bool MemoryMappedFile::Flush(size_t offset, size_t length, FlushMode mode) {
+  DCHECK(IsValid());
+  DCHECK(access_ == READ_WRITE || access_ == READ_WRITE_EXTEND);
+  DCHECK_LE(offset, length_);
+  DCHECK_LE(length, length_ - offset);
+
+  if (!::FlushViewOfFile(data_ + offset, length))
+    return false;
+  // FlushViewOfFile() only starts writing the pages back.
+  return mode == FLUSH_ASYNC || ::FlushFileBuffers(file_);
 }
 
 void MemoryMappedFile::CloseHandles() {
   if (data_)
-    ::UnmapViewOfFile(data_);
+    ::UnmapViewOfFile(data_ - data_offset_);
   if (file_mapping_ != INVALID_HANDLE_VALUE)
     ::CloseHandle(file_mapping_);
   if (file_ != INVALID_HANDLE_VALUE)
     ::CloseHandle(file_);
 
   data_ = NULL;
+  data_offset_ = 0;
   file_mapping_ = file_ = INVALID_HANDLE_VALUE;
   length_ = INVALID_FILE_SIZE;
 }
@@ -0,0 +1,132 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_FILES_PARALLEL_FILE_ENUMERATOR_H_
+#define BASE_FILES_PARALLEL_FILE_ENUMERATOR_H_
+
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/files/file_enumerator.h"
+#include "base/files/file_path.h"
+#include "base/time/time.h"
+
+namespace base {
+
+// Enumerates a directory tree with many directories read at once on a pool of
+// threads, for trees of millions of files. Unlike FileEnumerator, it reads
+// directories in large batches (getdents64() on Linux) and only stat()s an
+// entry when the file system does not report its type or more than the type
+// is asked for, with a minimal statx() mask where available.
+//
+// Each directory is reported to a Visitor, on whichever thread read it:
+//
+//   class SizeVisitor : public ParallelFileEnumerator::Visitor {
+//    public:
+//     virtual void OnDirectory(
+//         const FilePath& directory,
+//         const std::vector<ParallelFileEnumerator::Entry>& entries) OVERRIDE {
+//       AutoLock lock(lock_);
+//       ...
+//     }
+//   };
+//
+//   ParallelFileEnumerator::Options options;
+//   options.file_type = FileEnumerator::FILES;
+//   options.fields = ParallelFileEnumerator::FIELD_SIZE;
+//   SizeVisitor visitor;
+//   ParallelFileEnumerator(root, options).Run(&visitor);
+//
+// Small trees are read on the calling thread; the pool is only started once
+// a few dozen directories have been read. Symbolic links to directories are
+// only descended into with Options::follow_links. This is blocking.
+// Do not use on critical threads.
+class BASE_EXPORT ParallelFileEnumerator {
+ public:
+  // Information to gather about each entry, besides its name and type.
+  enum Fields {
+    FIELD_SIZE = 1 << 0,
+    FIELD_LAST_MODIFIED = 1 << 1,
+  };
+
+  struct BASE_EXPORT Options {
+    Options();
+
+    // FileEnumerator::FileType bits selecting the entries reported. With
+    // SHOW_SYM_LINKS links are reported as such, otherwise as their targets.
+    int file_type;
+
+    // Whether to enumerate subdirectories.
+    bool recursive;
+
+    // Whether to descend into links to directories too, without
+    // SHOW_SYM_LINKS. Each directory reached through a link is read once,
+    // so that loops of links end.
+    bool follow_links;
+
+    // The most directories read, the root included, or 0 for no limit.
+    // Subdirectories left unread are still reported as entries.
+    size_t max_directories;
+
+    // Fields bits.
+    int fields;
+
+    // The number of threads reading directories, or 0 for one per processor.
+    int num_threads;
+
+    // The size of the buffer each thread reads directory entries into.
+    size_t buffer_size;
+
+    // Whether to use statx(), which fetches only the fields asked for, where
+    // the kernel supports it.
+    bool use_statx;
+  };
+
+  struct BASE_EXPORT Entry {
+    Entry();
+    ~Entry();
+
+    // The name of the entry, without path information.
+    FilePath name;
+    bool is_directory;
+    bool is_symbolic_link;
+    // Filled in with FIELD_SIZE.
+    int64 size;
+    // Filled in with FIELD_LAST_MODIFIED.
+    Time last_modified;
+  };
+
+  class BASE_EXPORT Visitor {
+   public:
+    // Receives the entries of |directory| selected by Options::file_type, in
+    // no particular order. Called once for every directory read, including
+    // the root, on the threads reading them and possibly concurrently.
+    virtual void OnDirectory(const FilePath& directory,
+                             const std::vector<Entry>& entries) = 0;
+
+   protected:
+    virtual ~Visitor() {}
+  };
+
+  ParallelFileEnumerator(const FilePath& root_path, const Options& options);
+  ~ParallelFileEnumerator();
+
+  // Enumerates the tree, and returns once every directory has been reported
+  // to |visitor|. Directories which cannot be read are skipped. Returns false
+  // if |root_path| cannot be read.
+  bool Run(Visitor* visitor);
+
+ private:
+  class Walker;
+
+  const FilePath root_path_;
+  const Options options_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelFileEnumerator);
+};
+
+}  // namespace base
+
+#endif  // BASE_FILES_PARALLEL_FILE_ENUMERATOR_H_
@@ -0,0 +1,432 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/files/parallel_file_enumerator.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <limits>
+#include <set>
+#include <utility>
+
+#include "base/atomicops.h"
+#include "base/logging.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/synchronization/condition_variable.h"
+#include "base/synchronization/lock.h"
+#include "base/sys_info.h"
+#include "base/threading/simple_thread.h"
+
+#if defined(OS_LINUX)
+#include <sys/syscall.h>
+
+#include "base/files/dir_reader_linux.h"
+#endif
+
+namespace base {
+
+namespace {
+
+const size_t kDefaultBufferSize = 64 * 1024;
+
+// The directories read on the calling thread before a pool of threads is
+// started, so that small trees are read without creating any.
+const int kSerialDirectories = 64;
+
+// Set once statx() fails with ENOSYS.
+subtle::Atomic32 g_statx_unsupported = 0;
+
+// Reads the entries of one directory at a time. On Linux the entries are
+// read with getdents64(), into a buffer reused for every directory.
+class DirectoryReader {
+ public:
+  explicit DirectoryReader(size_t buffer_size)
+#if defined(OS_LINUX)
+      : fd_(-1),
+        buffer_(std::max<size_t>(buffer_size, 4096)),
+        offset_(0),
+        size_(0) {
+#else
+      : dir_(NULL) {
+#endif
+  }
+
+  ~DirectoryReader() {
+    Close();
+  }
+
+  bool Open(const FilePath& path) {
+    Close();
+#if defined(OS_LINUX)
+    fd_ = HANDLE_EINTR(open(path.value().c_str(),
+                            O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    offset_ = size_ = 0;
+    return fd_ >= 0;
+#else
+    dir_ = opendir(path.value().c_str());
+    return dir_ != NULL;
+#endif
+  }
+
+  // Returns the name and the d_type of the next entry, or false once all
+  // have been read.
+  bool Next(const char** name, unsigned char* type) {
+#if defined(OS_LINUX)
+    while (offset_ == size_) {
+      long result = HANDLE_EINTR(syscall(__NR_getdents64, fd_, &buffer_[0],
+                                         buffer_.size()));
+      if (result <= 0) {
+        DPLOG_IF(ERROR, result < 0) << "getdents64";
+        return false;
+      }
+      size_ = result;
+      offset_ = 0;
+    }
+    const linux_dirent* dirent =
+        reinterpret_cast<const linux_dirent*>(&buffer_[offset_]);
+    offset_ += dirent->d_reclen;
+    *name = dirent->d_name;
+    *type = dirent->d_type;
+    return true;
+#else
+    struct dirent* dirent = readdir(dir_);
+    if (!dirent)
+      return false;
+    *name = dirent->d_name;
+    *type = dirent->d_type;
+    return true;
+#endif
+  }
+
+  // The descriptor of the open directory, for stat()ing entries.
+  int fd() const {
+#if defined(OS_LINUX)
+    return fd_;
+#else
+    return dirfd(dir_);
+#endif
+  }
+
+  void Close() {
+#if defined(OS_LINUX)
+    if (fd_ >= 0) {
+      ignore_result(HANDLE_EINTR(close(fd_)));
+      fd_ = -1;
+    }
+#else
+    if (dir_) {
+      closedir(dir_);
+      dir_ = NULL;
+    }
+#endif
+  }
+
+ private:
+#if defined(OS_LINUX)
+  int fd_;
+  std::vector<char> buffer_;
+  size_t offset_;
+  size_t size_;
+#else
+  DIR* dir_;
+#endif
+
+  DISALLOW_COPY_AND_ASSIGN(DirectoryReader);
+};
+
+struct EntryStat {
+  mode_t mode;
+  int64 size;
+  Time last_modified;
+};
+
+// stat()s |name| in the directory |dir_fd|, fetching the type and |fields|.
+bool StatEntry(int dir_fd,
+               const char* name,
+               bool follow_links,
+               int fields,
+               bool use_statx,
+               EntryStat* entry_stat) {
+#if defined(OS_LINUX) && defined(STATX_TYPE)
+  if (use_statx && !subtle::NoBarrier_Load(&g_statx_unsupported)) {
+    unsigned int mask = STATX_TYPE;
+    if (fields & ParallelFileEnumerator::FIELD_SIZE)
+      mask |= STATX_SIZE;
+    if (fields & ParallelFileEnumerator::FIELD_LAST_MODIFIED)
+      mask |= STATX_MTIME;
+    struct statx buffer;
+    int flags = AT_NO_AUTOMOUNT | (follow_links ? 0 : AT_SYMLINK_NOFOLLOW);
+    if (!statx(dir_fd, name, flags, mask, &buffer)) {
+      entry_stat->mode = buffer.stx_mode;
+      entry_stat->size = buffer.stx_size;
+      entry_stat->last_modified =
+          Time::FromTimeT(buffer.stx_mtime.tv_sec) +
+          TimeDelta::FromMicroseconds(buffer.stx_mtime.tv_nsec /
+                                      Time::kNanosecondsPerMicrosecond);
+      return true;
+    }
+    if (errno != ENOSYS)
+      return false;
+    subtle::NoBarrier_Store(&g_statx_unsupported, 1);
+  }
+#endif
+  struct stat buffer;
+  if (fstatat(dir_fd, name, &buffer, follow_links ? 0 : AT_SYMLINK_NOFOLLOW))
+    return false;
+  entry_stat->mode = buffer.st_mode;
+  entry_stat->size = buffer.st_size;
+  entry_stat->last_modified = Time::FromTimeT(buffer.st_mtime);
+  return true;
+}
+
+}  // namespace
+
+// Reads directories from a shared stack until all have been read, on as many
+// threads as it is run on.
+class ParallelFileEnumerator::Walker : public DelegateSimpleThread::Delegate {
+ public:
+  Walker(const Options& options, Visitor* visitor)
+      : options_(options),
+        visitor_(visitor),
+        pending_cv_(&lock_),
+        busy_(0),
+        directories_left_(options.max_directories ?
+                          options.max_directories :
+                          std::numeric_limits<size_t>::max()) {
+  }
+
+  // Counts a directory about to be read. Returns false if the most to read
+  // have been.
+  bool CountDirectory() {
+    AutoLock lock(lock_);
+    if (!directories_left_)
+      return false;
+    --directories_left_;
+    return true;
+  }
+
+  // Reads |directory| with |reader| and reports it, adding the directories
+  // to descend into to |subdirectories|. Returns false if it cannot be read.
+  bool ReadDirectory(const FilePath& directory,
+                     DirectoryReader* reader,
+                     std::vector<FilePath>* subdirectories) {
+    if (!reader->Open(directory))
+      return false;
+
+    const bool show_links = options_.file_type & FileEnumerator::SHOW_SYM_LINKS;
+    std::vector<Entry> entries;
+    const char* name;
+    unsigned char type;
+    while (reader->Next(&name, &type)) {
+      if (name[0] == '.' && (!name[1] || (name[1] == '.' && !name[2])))
+        continue;
+
+      EntryStat entry_stat = { 0, 0, Time() };
+      bool have_stat = false;
+      bool is_directory = type == DT_DIR;
+      bool is_link = type == DT_LNK;
+      if (type == DT_UNKNOWN) {
+        // Not every file system reports the type.
+        have_stat = Stat(reader->fd(), name, false, &entry_stat);
+        is_directory = S_ISDIR(entry_stat.mode);
+        is_link = S_ISLNK(entry_stat.mode);
+      }
+      if (is_directory && options_.recursive)
+        subdirectories->push_back(directory.Append(name));
+      if (is_link && !show_links) {
+        // Reported as its target, or as a file if it dangles.
+        have_stat = Stat(reader->fd(), name, true, &entry_stat);
+        is_directory = have_stat && S_ISDIR(entry_stat.mode);
+        is_link = false;
+        if (is_directory && options_.recursive && options_.follow_links &&
+            FirstVisit(reader->fd(), name)) {
+          subdirectories->push_back(directory.Append(name));
+        }
+      }
+
+      if (!(options_.file_type & (is_directory ? FileEnumerator::DIRECTORIES
+                                               : FileEnumerator::FILES))) {
+        continue;
+      }
+      if (options_.fields && !have_stat)
+        Stat(reader->fd(), name, false, &entry_stat);
+
+      entries.push_back(Entry());
+      Entry& entry = entries.back();
+      entry.name = FilePath(name);
+      entry.is_directory = is_directory;
+      entry.is_symbolic_link = is_link;
+      if (options_.fields & FIELD_SIZE)
+        entry.size = entry_stat.size;
+      if (options_.fields & FIELD_LAST_MODIFIED)
+        entry.last_modified = entry_stat.last_modified;
+    }
+    reader->Close();
+
+    visitor_->OnDirectory(directory, entries);
+    return true;
+  }
+
+  // Records that the directory |path|, relative to |dir_fd|, is read.
+  // Returns false if it already was, or can't be identified.
+  bool FirstVisit(int dir_fd, const char* path) {
+    struct stat buffer;
+    if (fstatat(dir_fd, path, &buffer, 0))
+      return false;
+    AutoLock lock(lock_);
+    return visited_.insert(std::make_pair(buffer.st_dev,
+                                          buffer.st_ino)).second;
+  }
+
+  // Adds |directories| to those to read, and clears it.
+  void AddPending(std::vector<FilePath>* directories) {
+    AutoLock lock(lock_);
+    pending_.insert(pending_.end(), directories->begin(), directories->end());
+    directories->clear();
+    pending_cv_.Broadcast();
+  }
+
+  // DelegateSimpleThread::Delegate:
+  virtual void Run() OVERRIDE {
+    DirectoryReader reader(options_.buffer_size);
+    std::vector<FilePath> subdirectories;
+    AutoLock lock(lock_);
+    for (;;) {
+      // Another thread may yet find subdirectories.
+      while (pending_.empty() && busy_)
+        pending_cv_.Wait();
+      if (pending_.empty() || !directories_left_)
+        break;
+
+      FilePath directory = pending_.back();
+      pending_.pop_back();
+      --directories_left_;
+      ++busy_;
+      {
+        AutoUnlock unlock(lock_);
+        ReadDirectory(directory, &reader, &subdirectories);
+      }
+      --busy_;
+
+      if (!subdirectories.empty() || !busy_)
+        pending_cv_.Broadcast();
+      pending_.insert(pending_.end(), subdirectories.begin(),
+                      subdirectories.end());
+      subdirectories.clear();
+    }
+  }
+
+ private:
+  bool Stat(int dir_fd,
+            const char* name,
+            bool follow_links,
+            EntryStat* entry_stat) {
+    if (StatEntry(dir_fd, name, follow_links, options_.fields,
+                  options_.use_statx, entry_stat)) {
+      return true;
+    }
+    // Entries deleted since the directory was read, and dangling links, are
+    // not worth a message.
+    DPLOG_IF(ERROR, errno != ENOENT) << "Couldn't stat " << name;
+    return false;
+  }
+
+  const Options& options_;
+  Visitor* visitor_;
+
+  Lock lock_;
+  // Signaled when directories are added to |pending_|, or all are read.
+  ConditionVariable pending_cv_;
+  // The directories left to read, read depth first to bound their number.
+  std::vector<FilePath> pending_;
+  // The number of threads reading a directory.
+  int busy_;
+  // The directories which may still be read.
+  size_t directories_left_;
+  // With Options::follow_links, the root and the directories reached through
+  // links, by device and inode.
+  std::set<std::pair<dev_t, ino_t> > visited_;
+
+  DISALLOW_COPY_AND_ASSIGN(Walker);
+};
+
+ParallelFileEnumerator::Options::Options()
+    : file_type(FileEnumerator::FILES | FileEnumerator::DIRECTORIES),
+      recursive(true),
+      follow_links(false),
+      max_directories(0),
+      fields(0),
+      num_threads(0),
+      buffer_size(kDefaultBufferSize),
+      use_statx(true) {
+}
+
+ParallelFileEnumerator::Entry::Entry()
+    : is_directory(false),
+      is_symbolic_link(false),
+      size(0) {
+}
+
+ParallelFileEnumerator::Entry::~Entry() {
+}
+
+ParallelFileEnumerator::ParallelFileEnumerator(const FilePath& root_path,
+                                               const Options& options)
+    : root_path_(root_path.StripTrailingSeparators()),
+      options_(options) {
+}
+
+ParallelFileEnumerator::~ParallelFileEnumerator() {
+}
+
+bool ParallelFileEnumerator::Run(Visitor* visitor) {
+  Walker walker(options_, visitor);
+  std::vector<FilePath> pending;
+  {
+    DirectoryReader reader(options_.buffer_size);
+    // So that a link back to the root isn't followed.
+    if (options_.follow_links)
+      walker.FirstVisit(AT_FDCWD, root_path_.value().c_str());
+    walker.CountDirectory();
+    if (!walker.ReadDirectory(root_path_, &reader, &pending))
+      return false;
+
+    // Most trees are small: read them here, depth first, and only start
+    // threads for what is left of a large one.
+    std::vector<FilePath> subdirectories;
+    for (int i = 0; i < kSerialDirectories && !pending.empty(); ++i) {
+      if (!walker.CountDirectory())
+        return true;
+      FilePath directory = pending.back();
+      pending.pop_back();
+      walker.ReadDirectory(directory, &reader, &subdirectories);
+      pending.insert(pending.end(), subdirectories.begin(),
+                     subdirectories.end());
+      subdirectories.clear();
+    }
+  }
+  if (pending.empty())
+    return true;
+  walker.AddPending(&pending);
+
+  int num_threads = options_.num_threads;
+  if (num_threads <= 0)
+    num_threads = SysInfo::NumberOfProcessors();
+  if (num_threads == 1) {
+    walker.Run();
+    return true;
+  }
+  DelegateSimpleThreadPool pool("file_enumerator", num_threads);
+  pool.AddWork(&walker, num_threads);
+  pool.Start();
+  pool.JoinAll();
+  return true;
+}
+
+}  // namespace base
@@ -0,0 +1,204 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/files/parallel_file_enumerator.h"
+
+#include <unistd.h>
+
+#include <map>
+#include <set>
+#include <string>
+
+#include "base/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/strings/stringprintf.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/platform_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+// Records the entries reported, by path relative to the root.
+class RecordingVisitor : public ParallelFileEnumerator::Visitor {
+ public:
+  explicit RecordingVisitor(const FilePath& root) : root_(root) {}
+
+  virtual void OnDirectory(
+      const FilePath& directory,
+      const std::vector<ParallelFileEnumerator::Entry>& entries) OVERRIDE {
+    FilePath relative;
+    if (directory != root_)
+      EXPECT_TRUE(root_.AppendRelativePath(directory, &relative));
+    AutoLock lock(lock_);
+    threads_.insert(PlatformThread::CurrentId());
+    EXPECT_TRUE(directories_.insert(relative.value()).second);
+    for (size_t i = 0; i < entries.size(); ++i) {
+      FilePath path = relative.empty() ? entries[i].name
+                                       : relative.Append(entries[i].name);
+      EXPECT_TRUE(entries_.insert(std::make_pair(path.value(),
+                                                 entries[i])).second);
+    }
+  }
+
+  const std::set<std::string>& directories() const { return directories_; }
+  const std::map<std::string, ParallelFileEnumerator::Entry>& entries() const {
+    return entries_;
+  }
+  // The threads which read directories.
+  const std::set<PlatformThreadId>& threads() const { return threads_; }
+
+ private:
+  const FilePath root_;
+  Lock lock_;
+  std::set<std::string> directories_;
+  std::map<std::string, ParallelFileEnumerator::Entry> entries_;
+  std::set<PlatformThreadId> threads_;
+};
+
+class ParallelFileEnumeratorTest : public testing::Test {
+ protected:
+  virtual void SetUp() OVERRIDE {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+  }
+
+  void CreateFile(const FilePath& relative, int size) {
+    std::string data(size, 'x');
+    ASSERT_EQ(size, file_util::WriteFile(temp_dir_.path().Append(relative),
+                                         data.data(), size));
+  }
+
+  void CreateDirectory(const FilePath& relative) {
+    ASSERT_TRUE(file_util::CreateDirectory(temp_dir_.path().Append(relative)));
+  }
+
+  ScopedTempDir temp_dir_;
+};
+
+}  // namespace
+
+TEST_F(ParallelFileEnumeratorTest, Tree) {
+  // A wide and deep tree, so that the threads share the directories.
+  int64 total_size = 0;
+  int files = 0;
+  for (int i = 0; i < 20; ++i) {
+    FilePath directory(StringPrintf("d%d", i));
+    CreateDirectory(directory);
+    for (int depth = 0; depth < 5; ++depth) {
+      directory = directory.Append(StringPrintf("level%d", depth));
+      CreateDirectory(directory);
+      CreateFile(directory.AppendASCII("file"), i + depth);
+      total_size += i + depth;
+      ++files;
+    }
+  }
+  CreateFile(FilePath("top"), 1000);
+  total_size += 1000;
+  ++files;
+
+  for (int num_threads = 1; num_threads <= 8; num_threads *= 8) {
+    ParallelFileEnumerator::Options options;
+    options.num_threads = num_threads;
+    options.fields = ParallelFileEnumerator::FIELD_SIZE |
+                     ParallelFileEnumerator::FIELD_LAST_MODIFIED;
+    RecordingVisitor visitor(temp_dir_.path());
+    EXPECT_TRUE(ParallelFileEnumerator(temp_dir_.path(), options)
+                    .Run(&visitor));
+
+    // The root and 20 * 6 directories.
+    EXPECT_EQ(121u, visitor.directories().size());
+    EXPECT_EQ(static_cast<size_t>(files + 120), visitor.entries().size());
+    int64 size = 0;
+    for (std::map<std::string, ParallelFileEnumerator::Entry>::const_iterator
+             it = visitor.entries().begin();
+         it != visitor.entries().end(); ++it) {
+      EXPECT_FALSE(it->second.is_symbolic_link);
+      if (!it->second.is_directory) {
+        size += it->second.size;
+        EXPECT_FALSE(it->second.last_modified.is_null());
+      }
+    }
+    EXPECT_EQ(total_size, size);
+    EXPECT_EQ(1000, visitor.entries().find("top")->second.size);
+    EXPECT_TRUE(visitor.entries().find("d3/level0")->second.is_directory);
+  }
+
+  EXPECT_EQ(total_size, ComputeDirectorySize(temp_dir_.path()));
+}
+
+// A small tree is read on the calling thread, without starting any others.
+TEST_F(ParallelFileEnumeratorTest, SmallTreeReadOnCallingThread) {
+  for (int i = 0; i < 10; ++i) {
+    FilePath directory(StringPrintf("d%d", i));
+    CreateDirectory(directory);
+    CreateFile(directory.AppendASCII("file"), i);
+  }
+
+  ParallelFileEnumerator::Options options;
+  options.num_threads = 8;
+  RecordingVisitor visitor(temp_dir_.path());
+  EXPECT_TRUE(ParallelFileEnumerator(temp_dir_.path(), options)
+                  .Run(&visitor));
+  EXPECT_EQ(11u, visitor.directories().size());
+  ASSERT_EQ(1u, visitor.threads().size());
+  EXPECT_EQ(PlatformThread::CurrentId(), *visitor.threads().begin());
+}
+
+TEST_F(ParallelFileEnumeratorTest, MaxDirectories) {
+  // A chain of directories, each with a file.
+  FilePath directory;
+  for (int i = 0; i < 10; ++i) {
+    directory = directory.Append(StringPrintf("d%d", i));
+    CreateDirectory(directory);
+    CreateFile(directory.AppendASCII("file"), i);
+  }
+
+  ParallelFileEnumerator::Options options;
+  options.max_directories = 3;
+  RecordingVisitor visitor(temp_dir_.path());
+  EXPECT_TRUE(ParallelFileEnumerator(temp_dir_.path(), options)
+                  .Run(&visitor));
+  // The root, d0 and d0/d1 are read; d0/d1/d2 is only listed.
+  EXPECT_EQ(3u, visitor.directories().size());
+  EXPECT_EQ(1u, visitor.entries().count("d0/d1/d2"));
+  EXPECT_EQ(0u, visitor.entries().count("d0/d1/d2/file"));
+}
+
+TEST_F(ParallelFileEnumeratorTest, FileTypes) {
+  CreateDirectory(FilePath("dir"));
+  CreateFile(FilePath("dir/file"), 10);
+  CreateFile(FilePath("file"), 20);
+  ASSERT_EQ(0, symlink("dir", temp_dir_.path().Append("link").value().c_str()));
+  ASSERT_EQ(0, symlink("missing",
+                       temp_dir_.path().Append("dangling").value().c_str()));
+
+  ParallelFileEnumerator::Options options;
+  options.recursive = false;
+  options.file_type = FileEnumerator::DIRECTORIES;
+  RecordingVisitor directories(temp_dir_.path());
+  EXPECT_TRUE(ParallelFileEnumerator(temp_dir_.path(), options)
+                  .Run(&directories));
+  // Links are reported as their targets, but never descended into.
+  EXPECT_EQ(1u, directories.directories().size());
+  EXPECT_EQ(2u, directories.entries().size());
+  EXPECT_EQ(1u, directories.entries().count("dir"));
+  EXPECT_EQ(1u, directories.entries().count("link"));
+
+  options.recursive = true;
+  options.file_type = FileEnumerator::FILES | FileEnumerator::SHOW_SYM_LINKS;
+  RecordingVisitor files(temp_dir_.path());
+  EXPECT_TRUE(ParallelFileEnumerator(temp_dir_.path(), options).Run(&files));
+  EXPECT_EQ(2u, files.directories().size());
+  EXPECT_EQ(4u, files.entries().size());
+  EXPECT_TRUE(files.entries().find("link")->second.is_symbolic_link);
+  EXPECT_TRUE(files.entries().find("dangling")->second.is_symbolic_link);
+  EXPECT_FALSE(files.entries().find("dir/file")->second.is_symbolic_link);
+
+  RecordingVisitor missing(temp_dir_.path());
+  EXPECT_FALSE(ParallelFileEnumerator(temp_dir_.path().Append("missing"),
+                                      options).Run(&missing));
+}
+
+}  // namespace base
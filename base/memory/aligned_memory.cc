@@ -10,8 +10,82 @@
 #include <malloc.h>
 #endif
 
+#if defined(OS_LINUX)
+#include <sys/mman.h>
+
+#include <map>
+
+#include "base/atomicops.h"
+#include "base/lazy_instance.h"
+#include "base/synchronization/lock.h"
+#endif
+
 namespace base {
 
+#if defined(OS_LINUX)
+namespace {
+
+#ifndef MAP_HUGETLB
+#define MAP_HUGETLB 0x40000
+#endif
+
+// The blocks mapped from the hugetlb pool, with their mapped sizes, which
+// AlignedFree() has to unmap rather than free().
+struct HugeTLBBlocks {
+  Lock lock;
+  std::map<void*, size_t> sizes;
+};
+
+LazyInstance<HugeTLBBlocks>::Leaky g_huge_tlb_blocks =
+    LAZY_INSTANCE_INITIALIZER;
+
+// The size of |g_huge_tlb_blocks|, so that AlignedFree() of other blocks does
+// not take the lock.
+subtle::Atomic32 g_huge_tlb_block_count = 0;
+
+// Returns |size| bytes from the hugetlb pool, or NULL if the pool is
+// exhausted or not set up.
+void* MapHugeTLBBlock(size_t size, bool populate) {
+  size_t mapped_size = (size + kHugePageSize - 1) & ~(kHugePageSize - 1);
+  int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+  if (populate)
+    flags |= MAP_POPULATE;
+  void* ptr = mmap(NULL, mapped_size, PROT_READ | PROT_WRITE, flags, -1, 0);
+  if (ptr == MAP_FAILED)
+    return NULL;
+
+  HugeTLBBlocks* blocks = g_huge_tlb_blocks.Pointer();
+  AutoLock lock(blocks->lock);
+  blocks->sizes[ptr] = mapped_size;
+  subtle::Release_Store(&g_huge_tlb_block_count, blocks->sizes.size());
+  return ptr;
+}
+
+// Unmaps |ptr| if it was returned by MapHugeTLBBlock().
+bool UnmapHugeTLBBlock(void* ptr) {
+  // Blocks from the pool are huge page aligned.
+  if (reinterpret_cast<uintptr_t>(ptr) & (kHugePageSize - 1) ||
+      !subtle::Acquire_Load(&g_huge_tlb_block_count)) {
+    return false;
+  }
+  HugeTLBBlocks* blocks = g_huge_tlb_blocks.Pointer();
+  size_t mapped_size;
+  {
+    AutoLock lock(blocks->lock);
+    std::map<void*, size_t>::iterator it = blocks->sizes.find(ptr);
+    if (it == blocks->sizes.end())
+      return false;
+    mapped_size = it->second;
+    blocks->sizes.erase(it);
+    subtle::Release_Store(&g_huge_tlb_block_count, blocks->sizes.size());
+  }
+  munmap(ptr, mapped_size);
+  return true;
+}
+
+}  // namespace
+#endif  // OS_LINUX
+
 void* AlignedAlloc(size_t size, size_t alignment) {
   DCHECK_GT(size, 0U);
   DCHECK_EQ(alignment & (alignment - 1), 0U);
@@ -44,4 +118,36 @@ void* AlignedAlloc(size_t size, size_t alignment) {
   return ptr;
 }
 
+void* AlignedAlloc(size_t size, size_t alignment, int hints) {
+#if defined(OS_LINUX)
+  if (hints & MEMORY_HINT_HUGETLB) {
+    DCHECK_LE(alignment, kHugePageSize);
+    void* ptr = MapHugeTLBBlock(size, (hints & MEMORY_HINT_POPULATE) != 0);
+    if (ptr) {
+      // Already huge pages, and populated by the mapping.
+      ApplyMemoryHints(ptr, size, hints & ~(MEMORY_HINT_HUGE_PAGES |
+                                            MEMORY_HINT_POPULATE));
+      return ptr;
+    }
+  }
+#endif
+  void* ptr = AlignedAlloc(size, alignment);
+#if defined(OS_POSIX)
+  ApplyMemoryHints(ptr, size, hints);
+#endif
+  return ptr;
+}
+
+void AlignedFree(void* ptr) {
+#if defined(COMPILER_MSVC)
+  _aligned_free(ptr);
+#else
+#if defined(OS_LINUX)
+  if (UnmapHugeTLBBlock(ptr))
+    return;
+#endif
+  free(ptr);
+#endif
+}
+
 }  // namespace base
@@ -30,6 +30,12 @@
 //
 //   scoped_ptr_malloc<float, ScopedPtrAlignedFree> my_array(
 //       static_cast<float*>(AlignedAlloc(size, alignment)));
+//
+// Large allocations can be tuned with MemoryHints, for example to be backed by
+// huge pages that are faulted in up front:
+//
+//   void* table = AlignedAlloc(size, kHugePageSize,
+//                              MEMORY_HINT_HUGE_PAGES | MEMORY_HINT_POPULATE);
 
 #ifndef BASE_MEMORY_ALIGNED_MEMORY_H_
 #define BASE_MEMORY_ALIGNED_MEMORY_H_
@@ -37,6 +43,7 @@
 #include "base/base_export.h"
 #include "base/basictypes.h"
 #include "base/compiler_specific.h"
+#include "base/memory/memory_hints.h"
 
 #if defined(COMPILER_MSVC)
 #include <malloc.h>
@@ -93,13 +100,12 @@ BASE_DECL_ALIGNED_MEMORY(4096);
 
 BASE_EXPORT void* AlignedAlloc(size_t size, size_t alignment);
 
-inline void AlignedFree(void* ptr) {
-#if defined(COMPILER_MSVC)
-  _aligned_free(ptr);
-#else
-  free(ptr);
-#endif
-}
+// As above, applying |hints| (MemoryHints) to the allocation. With
+// MEMORY_HINT_HUGETLB, |alignment| must be at most kHugePageSize. Hints are
+// ignored on Windows.
+BASE_EXPORT void* AlignedAlloc(size_t size, size_t alignment, int hints);
+
+BASE_EXPORT void AlignedFree(void* ptr);
 
 // Helper class for use with scoped_ptr_malloc.
 class BASE_EXPORT ScopedPtrAlignedFree {
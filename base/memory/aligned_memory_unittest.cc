@@ -85,6 +85,35 @@ TEST(AlignedMemoryTest, DynamicAllocation) {
   base::AlignedFree(p);
 }
 
+TEST(AlignedMemoryTest, DynamicAllocationWithHints) {
+  const size_t kSize = 2 * base::kHugePageSize;
+  const int kHints[] = {
+    base::MEMORY_HINT_NONE,
+    base::MEMORY_HINT_HUGE_PAGES | base::MEMORY_HINT_POPULATE,
+    base::MEMORY_HINT_HUGETLB,
+    base::MEMORY_HINT_HUGETLB | base::MEMORY_HINT_POPULATE |
+        base::MEMORY_HINT_RANDOM,
+    base::MEMORY_HINT_SEQUENTIAL | base::MEMORY_HINT_WILLNEED,
+  };
+  for (size_t i = 0; i < arraysize(kHints); ++i) {
+    // The hugetlb pool is usually empty, in which case normal pages are used.
+    char* p = static_cast<char*>(
+        base::AlignedAlloc(kSize, base::kHugePageSize, kHints[i]));
+    EXPECT_TRUE(p);
+    EXPECT_ALIGNED(p, base::kHugePageSize);
+    p[0] = 1;
+    p[kSize - 1] = 2;
+    base::AlignedFree(p);
+  }
+
+  // Small allocations sharing their pages with other blocks.
+  char* p = static_cast<char*>(
+      base::AlignedAlloc(100, 16, base::MEMORY_HINT_POPULATE));
+  EXPECT_ALIGNED(p, 16);
+  p[99] = 1;
+  base::AlignedFree(p);
+}
+
 TEST(AlignedMemoryTest, ScopedDynamicAllocation) {
   scoped_ptr_malloc<float, base::ScopedPtrAlignedFree> p(
       static_cast<float*>(base::AlignedAlloc(8, 8)));
@@ -0,0 +1,139 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/memory/arena.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+
+#include "base/memory/aligned_memory.h"
+
+namespace base {
+
+// Aligned so that allocations start aligned to kDefaultAlignment after it.
+struct ALIGNAS(16) Arena::Block {
+  Block* next;
+  size_t size;
+  bool huge_pages;
+};
+
+Arena::Options::Options()
+    : initial_block_size(4096),
+      max_block_size(1024 * 1024),
+      use_huge_pages(false) {
+}
+
+Arena::Arena()
+    : options_(Options()),
+      blocks_(NULL),
+      // A range that nothing fits in, not even 0 bytes.
+      position_(1),
+      limit_(0),
+      next_block_size_(options_.initial_block_size),
+      bytes_reserved_(0),
+      bytes_allocated_in_previous_blocks_(0),
+      destructors_(NULL) {
+}
+
+Arena::Arena(const Options& options)
+    : options_(options),
+      blocks_(NULL),
+      // A range that nothing fits in, not even 0 bytes.
+      position_(1),
+      limit_(0),
+      next_block_size_(options_.initial_block_size),
+      bytes_reserved_(0),
+      bytes_allocated_in_previous_blocks_(0),
+      destructors_(NULL) {
+  DCHECK_GT(options_.initial_block_size, sizeof(Block));
+  DCHECK_GE(options_.max_block_size, options_.initial_block_size);
+}
+
+Arena::~Arena() {
+  RunDestructors();
+  while (blocks_) {
+    Block* next = blocks_->next;
+    FreeBlock(blocks_);
+    blocks_ = next;
+  }
+}
+
+void Arena::Reset() {
+  RunDestructors();
+  if (!blocks_)
+    return;
+  while (blocks_->next) {
+    Block* next = blocks_->next;
+    FreeBlock(blocks_);
+    blocks_ = next;
+  }
+  position_ = reinterpret_cast<uintptr_t>(blocks_ + 1);
+  limit_ = reinterpret_cast<uintptr_t>(blocks_) + blocks_->size;
+  next_block_size_ = std::min(options_.max_block_size, 2 * blocks_->size);
+  bytes_allocated_in_previous_blocks_ = 0;
+}
+
+size_t Arena::bytes_allocated() const {
+  if (!blocks_)
+    return 0;
+  return bytes_allocated_in_previous_blocks_ +
+         (position_ - reinterpret_cast<uintptr_t>(blocks_ + 1));
+}
+
+void* Arena::AllocateInNewBlock(size_t size, size_t alignment) {
+  // Room for the largest padding |alignment| may need.
+  size_t needed = sizeof(Block) + alignment + size;
+  CHECK_GT(needed, size);
+
+  if (blocks_) {
+    bytes_allocated_in_previous_blocks_ +=
+        position_ - reinterpret_cast<uintptr_t>(blocks_ + 1);
+  }
+  Block* block = NewBlock(std::max(next_block_size_, needed));
+  block->next = blocks_;
+  blocks_ = block;
+  next_block_size_ = std::min(options_.max_block_size, 2 * next_block_size_);
+
+  position_ = reinterpret_cast<uintptr_t>(block + 1);
+  limit_ = reinterpret_cast<uintptr_t>(block) + block->size;
+  void* result = Allocate(size, alignment);
+  DCHECK_LE(reinterpret_cast<uintptr_t>(result) + size, limit_);
+  return result;
+}
+
+Arena::Block* Arena::NewBlock(size_t size) {
+  Block* block;
+  if (options_.use_huge_pages && size >= kHugePageSize) {
+    size = (size + kHugePageSize - 1) & ~(kHugePageSize - 1);
+    block = static_cast<Block*>(
+        AlignedAlloc(size, kHugePageSize, MEMORY_HINT_HUGE_PAGES));
+    block->huge_pages = true;
+  } else {
+    block = static_cast<Block*>(malloc(size));
+    CHECK(block);
+    block->huge_pages = false;
+  }
+  block->size = size;
+  bytes_reserved_ += size;
+  return block;
+}
+
+void Arena::FreeBlock(Block* block) {
+  bytes_reserved_ -= block->size;
+  if (block->huge_pages)
+    AlignedFree(block);
+  else
+    free(block);
+}
+
+void Arena::RunDestructors() {
+  while (destructors_) {
+    Destructor* destructor = destructors_;
+    destructors_ = destructor->next;
+    destructor->destroy(destructor->object);
+  }
+}
+
+}  // namespace base
@@ -0,0 +1,248 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Arena is a bump-pointer allocator for data with a common lifetime, such as
+// everything allocated while handling one request. Allocating is a pointer
+// increment; nothing is freed individually, everything is freed at once by
+// Reset() or when the arena is destroyed.
+//
+//   Arena arena;
+//   char* buffer = static_cast<char*>(arena.Allocate(size));
+//
+//   // Objects created by New() are destroyed by Reset() and ~Arena().
+//   Request* request = arena.New<Request>(url);
+//
+//   // Containers whose elements live in the arena.
+//   typedef std::vector<int, ArenaAllocator<int> > ArenaIntVector;
+//   ArenaIntVector* ids = arena.New<ArenaIntVector>(
+//       ArenaAllocator<int>(&arena));
+//
+//   arena.Reset();  // Frees all of the above.
+//
+// Memory comes from blocks that grow geometrically from
+// Options::initial_block_size to Options::max_block_size. Reset() keeps the
+// first block, so that an arena reused for request after request allocates
+// nothing from the system when requests fit in it.
+//
+// Not thread-safe.
+
+#ifndef BASE_MEMORY_ARENA_H_
+#define BASE_MEMORY_ARENA_H_
+
+#include <stddef.h>
+
+#include <limits>
+#include <new>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/compiler_specific.h"
+#include "base/logging.h"
+
+namespace base {
+
+class BASE_EXPORT Arena {
+ public:
+  // Alignment of blocks allocated without one, as for malloc().
+  static const size_t kDefaultAlignment = 16;
+
+  struct BASE_EXPORT Options {
+    Options();
+
+    // Size of the first block, which Reset() keeps.
+    size_t initial_block_size;
+
+    // Each block is twice the size of the previous one, up to this. Larger
+    // allocations get a block of their own.
+    size_t max_block_size;
+
+    // Whether blocks of 2 MB or more are backed by transparent huge pages,
+    // which saves TLB misses for large arenas. Only on Linux.
+    bool use_huge_pages;
+  };
+
+  Arena();
+  explicit Arena(const Options& options);
+
+  // Destroys the objects created by New() and frees all blocks.
+  ~Arena();
+
+  // Returns an uninitialized block of |size| bytes aligned to |alignment|, a
+  // power of two. Crashes when out of memory.
+  void* Allocate(size_t size, size_t alignment) {
+    DCHECK_EQ(alignment & (alignment - 1), 0u);
+    uintptr_t start = (position_ + alignment - 1) & ~(alignment - 1);
+    if (start >= position_ && start <= limit_ && size <= limit_ - start) {
+      position_ = start + size;
+      return reinterpret_cast<void*>(start);
+    }
+    return AllocateInNewBlock(size, alignment);
+  }
+  void* Allocate(size_t size) {
+    return Allocate(size, kDefaultAlignment);
+  }
+
+  // Returns an uninitialized array of |count| Ts.
+  template <typename T>
+  T* AllocateArray(size_t count) {
+    CHECK_LE(count, std::numeric_limits<size_t>::max() / sizeof(T));
+    return static_cast<T*>(Allocate(count * sizeof(T), ALIGNOF(T)));
+  }
+
+  // Creates a T in the arena, which is destroyed by Reset() or ~Arena(), in
+  // the reverse order of creation. Must not be deleted.
+  template <typename T>
+  T* New() {
+    Destructor* destructor = AllocateDestructor();
+    return Own(destructor, new (Allocate(sizeof(T), ALIGNOF(T))) T);
+  }
+  template <typename T, typename A1>
+  T* New(const A1& a1) {
+    Destructor* destructor = AllocateDestructor();
+    return Own(destructor, new (Allocate(sizeof(T), ALIGNOF(T))) T(a1));
+  }
+  template <typename T, typename A1, typename A2>
+  T* New(const A1& a1, const A2& a2) {
+    Destructor* destructor = AllocateDestructor();
+    return Own(destructor, new (Allocate(sizeof(T), ALIGNOF(T))) T(a1, a2));
+  }
+  template <typename T, typename A1, typename A2, typename A3>
+  T* New(const A1& a1, const A2& a2, const A3& a3) {
+    Destructor* destructor = AllocateDestructor();
+    return Own(destructor,
+               new (Allocate(sizeof(T), ALIGNOF(T))) T(a1, a2, a3));
+  }
+
+  // Destroys the objects created by New() and frees all blocks but the first.
+  void Reset();
+
+  // Returns the number of bytes handed out since the last Reset(), including
+  // alignment padding.
+  size_t bytes_allocated() const;
+
+  // Returns the total size of the blocks held.
+  size_t bytes_reserved() const { return bytes_reserved_; }
+
+ private:
+  struct Block;
+
+  // Destroys an object created by New().
+  struct Destructor {
+    void (*destroy)(void* object);
+    void* object;
+    Destructor* next;
+  };
+
+  template <typename T>
+  static void Destroy(void* object) {
+    static_cast<T*>(object)->~T();
+  }
+
+  Destructor* AllocateDestructor() {
+    return static_cast<Destructor*>(
+        Allocate(sizeof(Destructor), ALIGNOF(Destructor)));
+  }
+
+  // Registers |object|, created in the arena, for destruction.
+  template <typename T>
+  T* Own(Destructor* destructor, T* object) {
+    destructor->destroy = &Destroy<T>;
+    destructor->object = object;
+    destructor->next = destructors_;
+    destructors_ = destructor;
+    return object;
+  }
+
+  void* AllocateInNewBlock(size_t size, size_t alignment);
+  Block* NewBlock(size_t size);
+  void FreeBlock(Block* block);
+  void RunDestructors();
+
+  const Options options_;
+
+  // The block being allocated from, and earlier ones.
+  Block* blocks_;
+
+  // The free range of |blocks_|.
+  uintptr_t position_;
+  uintptr_t limit_;
+
+  size_t next_block_size_;
+  size_t bytes_reserved_;
+  // Bytes allocated from the blocks before |blocks_|.
+  size_t bytes_allocated_in_previous_blocks_;
+
+  // Of the objects created by New(), most recent first.
+  Destructor* destructors_;
+
+  DISALLOW_COPY_AND_ASSIGN(Arena);
+};
+
+// STL allocator that allocates from an Arena. Deallocation is a no-op: memory
+// is reclaimed by Arena::Reset(). Containers using it must not outlive their
+// arena; creating them with Arena::New() takes care of that.
+template <typename T>
+class ArenaAllocator {
+ public:
+  typedef T value_type;
+  typedef T* pointer;
+  typedef const T* const_pointer;
+  typedef T& reference;
+  typedef const T& const_reference;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+
+  template <typename U>
+  struct rebind {
+    typedef ArenaAllocator<U> other;
+  };
+
+  explicit ArenaAllocator(Arena* arena) : arena_(arena) {
+  }
+
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena()) {
+  }
+
+  pointer allocate(size_type count, const void* hint = 0) {
+    return arena_->AllocateArray<T>(count);
+  }
+
+  void deallocate(pointer p, size_type count) {
+  }
+
+  void construct(pointer p, const T& value) {
+    new (p) T(value);
+  }
+
+  void destroy(pointer p) {
+    p->~T();
+  }
+
+  pointer address(reference value) const { return &value; }
+  const_pointer address(const_reference value) const { return &value; }
+
+  size_type max_size() const {
+    return std::numeric_limits<size_type>::max() / sizeof(T);
+  }
+
+  Arena* arena() const { return arena_; }
+
+ private:
+  Arena* arena_;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+  return a.arena() == b.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+  return a.arena() != b.arena();
+}
+
+}  // namespace base
+
+#endif  // BASE_MEMORY_ARENA_H_
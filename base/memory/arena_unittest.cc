@@ -0,0 +1,179 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/memory/arena.h"
+
+#include <string.h>
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/containers/stack_container.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+typedef std::vector<int, ArenaAllocator<int> > ArenaIntVector;
+typedef std::basic_string<char, std::char_traits<char>, ArenaAllocator<char> >
+    ArenaString;
+typedef std::map<int, ArenaString, std::less<int>,
+                 ArenaAllocator<std::pair<const int, ArenaString> > >
+    ArenaStringMap;
+
+bool IsAligned(void* ptr, size_t alignment) {
+  return !(reinterpret_cast<uintptr_t>(ptr) & (alignment - 1));
+}
+
+// Appends its id to |log| when destroyed.
+class Logger {
+ public:
+  Logger(std::string* log, char id) : log_(log), id_(id) {}
+  ~Logger() { *log_ += id_; }
+
+ private:
+  std::string* log_;
+  char id_;
+};
+
+}  // namespace
+
+TEST(ArenaTest, Allocate) {
+  Arena arena;
+  EXPECT_EQ(0u, arena.bytes_allocated());
+  EXPECT_EQ(0u, arena.bytes_reserved());
+
+  char* first = static_cast<char*>(arena.Allocate(10));
+  char* second = static_cast<char*>(arena.Allocate(10));
+  EXPECT_TRUE(IsAligned(first, Arena::kDefaultAlignment));
+  EXPECT_TRUE(IsAligned(second, Arena::kDefaultAlignment));
+  // Bump allocation.
+  EXPECT_EQ(first + 16, second);
+  memset(first, 1, 10);
+  memset(second, 2, 10);
+  EXPECT_EQ(26u, arena.bytes_allocated());
+
+  for (size_t alignment = 1; alignment <= 4096; alignment *= 2) {
+    void* ptr = arena.Allocate(3, alignment);
+    EXPECT_TRUE(IsAligned(ptr, alignment)) << alignment;
+  }
+  EXPECT_TRUE(arena.Allocate(0));
+  int* ints = arena.AllocateArray<int>(100);
+  for (int i = 0; i < 100; ++i)
+    ints[i] = i;
+  EXPECT_EQ(1, first[9]);
+}
+
+TEST(ArenaTest, BlocksGrow) {
+  Arena::Options options;
+  options.initial_block_size = 1024;
+  options.max_block_size = 8192;
+  Arena arena(options);
+
+  arena.Allocate(100);
+  EXPECT_EQ(1024u, arena.bytes_reserved());
+  // The next blocks double in size up to the maximum.
+  arena.Allocate(1000);
+  EXPECT_EQ(1024u + 2048, arena.bytes_reserved());
+  arena.Allocate(2000);
+  EXPECT_EQ(1024u + 2048 + 4096, arena.bytes_reserved());
+  arena.Allocate(4000);
+  arena.Allocate(8000);
+  EXPECT_EQ(1024u + 2048 + 4096 + 8192 + 8192, arena.bytes_reserved());
+
+  // Larger allocations get a block of their own.
+  char* large = static_cast<char*>(arena.Allocate(100000));
+  memset(large, 0, 100000);
+  EXPECT_LT(1024u + 2048 + 4096 + 8192 + 8192 + 100000,
+            arena.bytes_reserved());
+  EXPECT_EQ(100u + 1000 + 2000 + 4000 + 8000 + 100000,
+            arena.bytes_allocated());
+}
+
+TEST(ArenaTest, ResetKeepsFirstBlock) {
+  Arena::Options options;
+  options.initial_block_size = 1024;
+  Arena arena(options);
+  void* first = arena.Allocate(16);
+  for (int i = 0; i < 100; ++i)
+    arena.Allocate(100);
+  EXPECT_LT(1024u, arena.bytes_reserved());
+
+  arena.Reset();
+  EXPECT_EQ(1024u, arena.bytes_reserved());
+  EXPECT_EQ(0u, arena.bytes_allocated());
+  // Allocation starts over in the first block.
+  EXPECT_EQ(first, arena.Allocate(16));
+}
+
+TEST(ArenaTest, NewDestroysInReverseOrder) {
+  std::string log;
+  {
+    Arena arena;
+    arena.New<Logger>(&log, 'a');
+    arena.New<Logger>(&log, 'b');
+    arena.Reset();
+    EXPECT_EQ("ba", log);
+
+    arena.New<Logger>(&log, 'c');
+    arena.New<Logger>(&log, 'd');
+    EXPECT_EQ("ba", log);
+  }
+  EXPECT_EQ("badc", log);
+}
+
+TEST(ArenaTest, Containers) {
+  Arena arena;
+  ArenaAllocator<int> allocator(&arena);
+
+  ArenaIntVector* ints = arena.New<ArenaIntVector>(allocator);
+  for (int i = 0; i < 1000; ++i)
+    ints->push_back(i);
+  EXPECT_EQ(999, ints->back());
+
+  ArenaStringMap* strings = arena.New<ArenaStringMap>(
+      std::less<int>(), ArenaAllocator<std::pair<const int, ArenaString> >(
+                            &arena));
+  const ArenaString value("a long string that is not stored inline",
+                          allocator);
+  for (int i = 0; i < 100; ++i)
+    strings->insert(std::make_pair(i, value));
+  EXPECT_EQ(100u, strings->size());
+  EXPECT_EQ(value, strings->find(42)->second);
+
+  // Containers using the stack with a heap fallback can live in the arena
+  // too; their heap storage is freed when the arena destroys them.
+  StackVector<int, 4>* stack_vector = arena.New<StackVector<int, 4> >();
+  for (int i = 0; i < 100; ++i)
+    stack_vector->container().push_back(i);
+  EXPECT_EQ(99, stack_vector->container().back());
+
+  size_t allocated = arena.bytes_allocated();
+  EXPECT_GT(allocated, 1000 * sizeof(int));
+  arena.Reset();
+  EXPECT_EQ(0u, arena.bytes_allocated());
+}
+
+#if defined(OS_LINUX)
+TEST(ArenaTest, HugePages) {
+  Arena::Options options;
+  options.initial_block_size = 2 * 1024 * 1024;
+  options.max_block_size = 4 * 1024 * 1024;
+  options.use_huge_pages = true;
+  Arena arena(options);
+  char* first = static_cast<char*>(arena.Allocate(1024));
+  EXPECT_EQ(2u * 1024 * 1024, arena.bytes_reserved());
+  // Only the block header precedes it in its huge page.
+  EXPECT_LT(reinterpret_cast<uintptr_t>(first) & (2 * 1024 * 1024 - 1), 64u);
+  char* large = static_cast<char*>(arena.Allocate(3 * 1024 * 1024));
+  memset(large, 1, 3 * 1024 * 1024);
+  arena.Reset();
+  EXPECT_EQ(2u * 1024 * 1024, arena.bytes_reserved());
+}
+#endif  // OS_LINUX
+
+}  // namespace base
@@ -15,6 +15,9 @@ DiscardableMemory::DiscardableMemory()
 #if defined(OS_ANDROID)
       , fd_(-1)
 #endif  // OS_ANDROID
+#if defined(OS_LINUX)
+      , is_purged_(false)
+#endif  // OS_LINUX
       {
   DCHECK(Supported());
 }
@@ -26,7 +29,7 @@ void* DiscardableMemory::Memory() const {
 
 // Stub implementations for platforms that don't support discardable memory.
 
-#if !defined(OS_ANDROID) && !defined(OS_MACOSX)
+#if !defined(OS_ANDROID) && !defined(OS_MACOSX) && !defined(OS_LINUX)
 
 DiscardableMemory::~DiscardableMemory() {
   NOTIMPLEMENTED();
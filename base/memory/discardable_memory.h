@@ -8,6 +8,7 @@
 #include "base/base_export.h"
 #include "base/basictypes.h"
 #include "base/compiler_specific.h"
+#include "base/memory/scoped_ptr.h"
 
 namespace base {
 
@@ -40,6 +41,7 @@ enum LockDiscardableMemoryStatus {
 //
 // References:
 //   - Linux: http://lwn.net/Articles/452035/
+//            http://lwn.net/Articles/590991/ (MADV_FREE)
 //   - Mac: http://trac.webkit.org/browser/trunk/Source/WebCore/platform/mac/PurgeableBufferMac.cpp
 //          the comment starting with "vm_object_purgable_control" at
 //            http://www.opensource.apple.com/source/xnu/xnu-792.13.8/osfmk/vm/vm_object.c
@@ -103,12 +105,31 @@ class BASE_EXPORT DiscardableMemory {
   void ReleaseFileDescriptor();
 #endif  // OS_ANDROID
 
+#if defined(OS_LINUX)
+  friend class DiscardableMemoryManager;
+
+  // Returns the size of the mapping, |size_| rounded up to whole pages.
+  size_t MappedSize() const;
+
+  // Releases the pages of the unlocked memory. Called by the
+  // DiscardableMemoryManager, which keeps Lock() from running meanwhile.
+  void Purge();
+#endif  // OS_LINUX
+
   void* memory_;
   size_t size_;
   bool is_locked_;
 #if defined(OS_ANDROID)
   int fd_;
 #endif  // OS_ANDROID
+#if defined(OS_LINUX)
+  // While unlocked, the first word of each page is moved here and replaced by
+  // a marker, which reads as zero once the kernel reclaims the page.
+  scoped_ptr<uintptr_t[]> saved_words_;
+
+  // Whether Purge() ran since the last Unlock().
+  bool is_purged_;
+#endif  // OS_LINUX
 
   DISALLOW_COPY_AND_ASSIGN(DiscardableMemory);
 };
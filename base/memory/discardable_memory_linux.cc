@@ -0,0 +1,137 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/memory/discardable_memory.h"
+
+#include <errno.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "base/atomicops.h"
+#include "base/logging.h"
+#include "base/memory/discardable_memory_manager_linux.h"
+
+#ifndef MADV_FREE
+#define MADV_FREE 8
+#endif
+
+namespace base {
+
+namespace {
+
+// Replaces the first word of each unlocked page. Pages reclaimed by the kernel
+// read as zero.
+const subtle::AtomicWord kPageMarker =
+    static_cast<subtle::AtomicWord>(0x5ca1ab1edeadbeefULL);
+
+// Set once madvise() rejects MADV_FREE, i.e. before Linux 4.5. Unlocked memory
+// is then only ever purged by the DiscardableMemoryManager.
+subtle::Atomic32 g_madv_free_unsupported = 0;
+
+subtle::AtomicWord* PageWord(void* memory, size_t page) {
+  return reinterpret_cast<subtle::AtomicWord*>(
+      static_cast<char*>(memory) + page * getpagesize());
+}
+
+}  // namespace
+
+// static
+bool DiscardableMemory::Supported() {
+  return true;
+}
+
+DiscardableMemory::~DiscardableMemory() {
+  if (!memory_)
+    return;
+  if (!is_locked_)
+    DiscardableMemoryManager::GetInstance()->Remove(this);
+  if (munmap(memory_, MappedSize()))
+    DPLOG(ERROR) << "munmap";
+}
+
+bool DiscardableMemory::InitializeAndLock(size_t size) {
+  DCHECK(!memory_);
+  size_ = size;
+
+  void* memory = mmap(NULL, MappedSize(), PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED) {
+    DPLOG(ERROR) << "mmap";
+    return false;
+  }
+
+  memory_ = memory;
+  saved_words_.reset(new uintptr_t[MappedSize() / getpagesize()]);
+  is_locked_ = true;
+  return true;
+}
+
+LockDiscardableMemoryStatus DiscardableMemory::Lock() {
+  DCHECK(!is_locked_);
+
+  DiscardableMemoryManager::GetInstance()->Remove(this);
+  is_locked_ = true;
+  if (is_purged_)
+    return DISCARDABLE_MEMORY_PURGED;
+
+  // Writing to a page takes it back from MADV_FREE. The compare-and-swap
+  // checks that the page is still there and writes to it in one step, so that
+  // the kernel can't reclaim it in between.
+  bool purged = false;
+  size_t num_pages = MappedSize() / getpagesize();
+  for (size_t i = 0; i < num_pages; ++i) {
+    if (subtle::NoBarrier_CompareAndSwap(
+            PageWord(memory_, i), kPageMarker,
+            static_cast<subtle::AtomicWord>(saved_words_[i])) != kPageMarker) {
+      purged = true;
+    }
+  }
+  return purged ? DISCARDABLE_MEMORY_PURGED : DISCARDABLE_MEMORY_SUCCESS;
+}
+
+void DiscardableMemory::Unlock() {
+  DCHECK(is_locked_);
+
+  size_t num_pages = MappedSize() / getpagesize();
+  for (size_t i = 0; i < num_pages; ++i) {
+    subtle::AtomicWord* word = PageWord(memory_, i);
+    saved_words_[i] = static_cast<uintptr_t>(*word);
+    *word = kPageMarker;
+  }
+
+  if (!subtle::NoBarrier_Load(&g_madv_free_unsupported) &&
+      madvise(memory_, MappedSize(), MADV_FREE)) {
+    DPCHECK(errno == EINVAL);
+    subtle::NoBarrier_Store(&g_madv_free_unsupported, 1);
+  }
+
+  is_locked_ = false;
+  is_purged_ = false;
+  DiscardableMemoryManager::GetInstance()->Add(this, MappedSize());
+}
+
+// static
+bool DiscardableMemory::PurgeForTestingSupported() {
+  return true;
+}
+
+// static
+void DiscardableMemory::PurgeForTesting() {
+  // Only purges the memory of this process.
+  DiscardableMemoryManager::GetInstance()->PurgeAll();
+}
+
+size_t DiscardableMemory::MappedSize() const {
+  size_t page_size = getpagesize();
+  return (size_ + page_size - 1) / page_size * page_size;
+}
+
+void DiscardableMemory::Purge() {
+  DCHECK(!is_locked_);
+  if (madvise(memory_, MappedSize(), MADV_DONTNEED))
+    DPLOG(ERROR) << "madvise";
+  is_purged_ = true;
+}
+
+}  // namespace base
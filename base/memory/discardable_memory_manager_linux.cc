@@ -0,0 +1,80 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/memory/discardable_memory_manager_linux.h"
+
+#include "base/logging.h"
+#include "base/memory/discardable_memory.h"
+#include "base/memory/singleton.h"
+
+namespace base {
+
+// static
+DiscardableMemoryManager* DiscardableMemoryManager::GetInstance() {
+  // Leaky, as DiscardableMemory may be destroyed during shutdown.
+  return Singleton<DiscardableMemoryManager,
+                   LeakySingletonTraits<DiscardableMemoryManager> >::get();
+}
+
+DiscardableMemoryManager::DiscardableMemoryManager()
+    : unlocked_memory_(UnlockedMemory::NO_AUTO_EVICT),
+      unlocked_bytes_(0),
+      unlocked_limit_(0) {
+}
+
+DiscardableMemoryManager::~DiscardableMemoryManager() {
+}
+
+void DiscardableMemoryManager::SetUnlockedMemoryLimit(size_t bytes) {
+  AutoLock lock(lock_);
+  unlocked_limit_ = bytes;
+  if (unlocked_limit_)
+    PurgeUntil(unlocked_limit_);
+}
+
+void DiscardableMemoryManager::ReduceUnlockedMemoryTo(size_t bytes) {
+  AutoLock lock(lock_);
+  PurgeUntil(bytes);
+}
+
+void DiscardableMemoryManager::PurgeAll() {
+  ReduceUnlockedMemoryTo(0);
+}
+
+size_t DiscardableMemoryManager::GetUnlockedMemorySize() {
+  AutoLock lock(lock_);
+  return unlocked_bytes_;
+}
+
+void DiscardableMemoryManager::Add(DiscardableMemory* memory, size_t bytes) {
+  AutoLock lock(lock_);
+  DCHECK(unlocked_memory_.Peek(memory) == unlocked_memory_.end());
+  unlocked_memory_.Put(memory, bytes);
+  unlocked_bytes_ += bytes;
+  if (unlocked_limit_)
+    PurgeUntil(unlocked_limit_);
+}
+
+void DiscardableMemoryManager::Remove(DiscardableMemory* memory) {
+  AutoLock lock(lock_);
+  UnlockedMemory::iterator it = unlocked_memory_.Peek(memory);
+  // Not found if already purged.
+  if (it == unlocked_memory_.end())
+    return;
+  unlocked_bytes_ -= it->second;
+  unlocked_memory_.Erase(it);
+}
+
+void DiscardableMemoryManager::PurgeUntil(size_t bytes) {
+  lock_.AssertAcquired();
+  while (unlocked_bytes_ > bytes) {
+    UnlockedMemory::reverse_iterator oldest = unlocked_memory_.rbegin();
+    // The owner can't lock the memory until Remove() acquires |lock_|.
+    oldest->first->Purge();
+    unlocked_bytes_ -= oldest->second;
+    unlocked_memory_.Erase(oldest);
+  }
+}
+
+}  // namespace base
@@ -0,0 +1,77 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_MEMORY_DISCARDABLE_MEMORY_MANAGER_LINUX_H_
+#define BASE_MEMORY_DISCARDABLE_MEMORY_MANAGER_LINUX_H_
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/containers/mru_cache.h"
+#include "base/synchronization/lock.h"
+
+template <typename Type>
+struct DefaultSingletonTraits;
+
+namespace base {
+
+class DiscardableMemory;
+
+// Keeps track of the unlocked DiscardableMemory of the process, least recently
+// unlocked first, and purges it on request or when it exceeds a limit.
+//
+// The kernel reclaims unlocked memory by itself when it runs low if it
+// supports MADV_FREE (Linux 4.5). Purging from here frees memory immediately
+// and works everywhere; callers that learn about memory pressure, e.g. caches
+// getting close to their cgroup limit, should use it to shrink first.
+//
+// Thread-safe.
+class BASE_EXPORT DiscardableMemoryManager {
+ public:
+  static DiscardableMemoryManager* GetInstance();
+
+  // Sets the number of unlocked bytes above which memory is purged when
+  // unlocked, least recently unlocked first. 0, the default, means no limit.
+  void SetUnlockedMemoryLimit(size_t bytes);
+
+  // Purges the least recently unlocked memory until at most |bytes| are
+  // unlocked and not purged.
+  void ReduceUnlockedMemoryTo(size_t bytes);
+
+  // Purges all unlocked memory.
+  void PurgeAll();
+
+  // Returns the number of bytes unlocked and not purged by the manager.
+  size_t GetUnlockedMemorySize();
+
+ private:
+  friend class DiscardableMemory;
+  friend struct DefaultSingletonTraits<DiscardableMemoryManager>;
+
+  DiscardableMemoryManager();
+  ~DiscardableMemoryManager();
+
+  // Called by |memory| once it's unlocked, making it eligible for purging.
+  void Add(DiscardableMemory* memory, size_t bytes);
+
+  // Called by |memory| before it's locked or destroyed. On return the manager
+  // no longer purges it.
+  void Remove(DiscardableMemory* memory);
+
+  // Must be called with |lock_| held.
+  void PurgeUntil(size_t bytes);
+
+  Lock lock_;
+
+  // The unlocked memory and its size, most recently unlocked first.
+  typedef MRUCache<DiscardableMemory*, size_t> UnlockedMemory;
+  UnlockedMemory unlocked_memory_;
+  size_t unlocked_bytes_;
+  size_t unlocked_limit_;
+
+  DISALLOW_COPY_AND_ASSIGN(DiscardableMemoryManager);
+};
+
+}  // namespace base
+
+#endif  // BASE_MEMORY_DISCARDABLE_MEMORY_MANAGER_LINUX_H_
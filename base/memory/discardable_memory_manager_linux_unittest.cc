@@ -0,0 +1,106 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/memory/discardable_memory_manager_linux.h"
+
+#include <string.h>
+#include <unistd.h>
+
+#include "base/memory/discardable_memory.h"
+#include "base/memory/scoped_vector.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace {
+
+class DiscardableMemoryManagerTest : public testing::Test {
+ protected:
+  DiscardableMemoryManagerTest()
+      : manager_(DiscardableMemoryManager::GetInstance()),
+        page_size_(getpagesize()) {
+  }
+
+  virtual void TearDown() OVERRIDE {
+    manager_->SetUnlockedMemoryLimit(0);
+  }
+
+  // Returns unlocked memory of |pages| pages, filled with |value|.
+  DiscardableMemory* CreateUnlocked(size_t pages, char value) {
+    DiscardableMemory* memory = new DiscardableMemory;
+    EXPECT_TRUE(memory->InitializeAndLock(pages * page_size_));
+    memset(memory->Memory(), value, pages * page_size_);
+    memory->Unlock();
+    return memory;
+  }
+
+  DiscardableMemoryManager* manager_;
+  size_t page_size_;
+};
+
+TEST_F(DiscardableMemoryManagerTest, KeepsContentsWhileNotPurged) {
+  scoped_ptr<DiscardableMemory> memory(CreateUnlocked(3, 'x'));
+  EXPECT_EQ(3 * page_size_, manager_->GetUnlockedMemorySize());
+
+  ASSERT_EQ(DISCARDABLE_MEMORY_SUCCESS, memory->Lock());
+  EXPECT_EQ(0u, manager_->GetUnlockedMemorySize());
+  const char* bytes = static_cast<const char*>(memory->Memory());
+  for (size_t i = 0; i < 3 * page_size_; ++i)
+    ASSERT_EQ('x', bytes[i]) << i;
+  memory->Unlock();
+}
+
+TEST_F(DiscardableMemoryManagerTest, PurgesLeastRecentlyUnlockedFirst) {
+  ScopedVector<DiscardableMemory> memories;
+  for (int i = 0; i < 4; ++i)
+    memories.push_back(CreateUnlocked(1, 'a' + i));
+  // Makes the first one the most recently unlocked.
+  ASSERT_EQ(DISCARDABLE_MEMORY_SUCCESS, memories[0]->Lock());
+  memories[0]->Unlock();
+
+  manager_->ReduceUnlockedMemoryTo(2 * page_size_);
+  EXPECT_EQ(2 * page_size_, manager_->GetUnlockedMemorySize());
+
+  EXPECT_EQ(DISCARDABLE_MEMORY_SUCCESS, memories[0]->Lock());
+  EXPECT_EQ(DISCARDABLE_MEMORY_PURGED, memories[1]->Lock());
+  EXPECT_EQ(DISCARDABLE_MEMORY_PURGED, memories[2]->Lock());
+  EXPECT_EQ(DISCARDABLE_MEMORY_SUCCESS, memories[3]->Lock());
+  EXPECT_EQ('a', *static_cast<char*>(memories[0]->Memory()));
+  EXPECT_EQ('d', *static_cast<char*>(memories[3]->Memory()));
+  for (size_t i = 0; i < memories.size(); ++i)
+    memories[i]->Unlock();
+}
+
+TEST_F(DiscardableMemoryManagerTest, UnlockedMemoryLimit) {
+  manager_->SetUnlockedMemoryLimit(2 * page_size_);
+  scoped_ptr<DiscardableMemory> first(CreateUnlocked(1, 'a'));
+  scoped_ptr<DiscardableMemory> second(CreateUnlocked(1, 'b'));
+  EXPECT_EQ(2 * page_size_, manager_->GetUnlockedMemorySize());
+
+  scoped_ptr<DiscardableMemory> third(CreateUnlocked(1, 'c'));
+  EXPECT_EQ(2 * page_size_, manager_->GetUnlockedMemorySize());
+  EXPECT_EQ(DISCARDABLE_MEMORY_PURGED, first->Lock());
+  EXPECT_EQ(DISCARDABLE_MEMORY_SUCCESS, third->Lock());
+}
+
+TEST_F(DiscardableMemoryManagerTest, DestroyWhileUnlocked) {
+  scoped_ptr<DiscardableMemory> memory(CreateUnlocked(2, 'x'));
+  memory.reset();
+  EXPECT_EQ(0u, manager_->GetUnlockedMemorySize());
+  manager_->PurgeAll();
+}
+
+TEST_F(DiscardableMemoryManagerTest, PurgedMemoryIsUsable) {
+  scoped_ptr<DiscardableMemory> memory(CreateUnlocked(2, 'x'));
+  manager_->PurgeAll();
+  ASSERT_EQ(DISCARDABLE_MEMORY_PURGED, memory->Lock());
+  char* bytes = static_cast<char*>(memory->Memory());
+  EXPECT_EQ(0, bytes[0]);
+  memset(bytes, 'y', 2 * page_size_);
+  memory->Unlock();
+  ASSERT_EQ(DISCARDABLE_MEMORY_SUCCESS, memory->Lock());
+  EXPECT_EQ('y', bytes[page_size_]);
+}
+
+}  // namespace
+}  // namespace base
@@ -7,7 +7,7 @@
 
 namespace base {
 
-#if defined(OS_ANDROID) || defined(OS_MACOSX)
+#if defined(OS_ANDROID) || defined(OS_MACOSX) || defined(OS_LINUX)
 // Test Lock() and Unlock() functionalities.
 TEST(DiscardableMemoryTest, LockAndUnLock) {
   ASSERT_TRUE(DiscardableMemory::Supported());
@@ -39,7 +39,7 @@ TEST(DiscardableMemoryTest, DeleteWhileLocked) {
   ASSERT_TRUE(memory.InitializeAndLock(size));
 }
 
-#if defined(OS_MACOSX)
+#if defined(OS_MACOSX) || defined(OS_LINUX)
 // Test forced purging.
 TEST(DiscardableMemoryTest, Purge) {
   ASSERT_TRUE(DiscardableMemory::Supported());
@@ -54,7 +54,7 @@ TEST(DiscardableMemoryTest, Purge) {
   DiscardableMemory::PurgeForTesting();
   EXPECT_EQ(DISCARDABLE_MEMORY_PURGED, memory.Lock());
 }
-#endif  // OS_MACOSX
+#endif  // OS_MACOSX || OS_LINUX
 
 #endif  // OS_*
 
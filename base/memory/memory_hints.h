@@ -0,0 +1,62 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Hints about how a large region of memory is going to be used, which tune how
+// the system backs it with pages. They are taken by AlignedAlloc() and
+// MemoryMappedFile, and can be applied to any mapped region with
+// ApplyMemoryHints(). Hints are combined with |; the ones the platform does
+// not support are ignored.
+
+#ifndef BASE_MEMORY_MEMORY_HINTS_H_
+#define BASE_MEMORY_MEMORY_HINTS_H_
+
+#include <stddef.h>
+
+#include "base/base_export.h"
+#include "build/build_config.h"
+
+namespace base {
+
+enum MemoryHints {
+  MEMORY_HINT_NONE = 0,
+
+  // Backs the region with transparent huge pages (MADV_HUGEPAGE), saving TLB
+  // misses in large regions accessed all over. Only the kHugePageSize aligned
+  // parts of the region can be backed by huge pages. Linux only.
+  MEMORY_HINT_HUGE_PAGES = 1 << 0,
+
+  // Maps the region from the pool of huge pages reserved by the administrator
+  // through /proc/sys/vm/nr_hugepages (MAP_HUGETLB), falling back to normal
+  // pages when the pool is exhausted. Only hugetlbfs files can be mapped this
+  // way. Takes effect when mapping only. Linux only.
+  MEMORY_HINT_HUGETLB = 1 << 1,
+
+  // Faults all pages in up front (MAP_POPULATE) rather than on first touch.
+  MEMORY_HINT_POPULATE = 1 << 2,
+
+  // The region will be accessed in order, so read ahead aggressively and drop
+  // pages soon after they are accessed (MADV_SEQUENTIAL).
+  MEMORY_HINT_SEQUENTIAL = 1 << 3,
+
+  // The region will be accessed in random order, so do not read ahead
+  // (MADV_RANDOM).
+  MEMORY_HINT_RANDOM = 1 << 4,
+
+  // The region will be accessed soon, so start reading it in (MADV_WILLNEED).
+  MEMORY_HINT_WILLNEED = 1 << 5,
+};
+
+// The size of transparent and hugetlb huge pages.
+const size_t kHugePageSize = 2 * 1024 * 1024;
+
+#if defined(OS_POSIX)
+// Applies |hints| to the pages overlapping [address, address + length), which
+// must be mapped, and writable when |hints| has MEMORY_HINT_POPULATE.
+// MEMORY_HINT_HUGETLB is ignored. Returns false if any hint failed.
+BASE_EXPORT bool ApplyMemoryHints(void* address, size_t length, int hints);
+#endif
+
+}  // namespace base
+
+#endif  // BASE_MEMORY_MEMORY_HINTS_H_
@@ -0,0 +1,87 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/memory/memory_hints.h"
+
+#include <errno.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "base/basictypes.h"
+#include "base/logging.h"
+
+#if defined(OS_LINUX)
+#ifndef MADV_HUGEPAGE
+#define MADV_HUGEPAGE 14
+#endif
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23
+#endif
+#endif  // OS_LINUX
+
+namespace base {
+
+namespace {
+
+bool Advise(uintptr_t start, size_t length, int advice) {
+  if (madvise(reinterpret_cast<void*>(start), length, advice) == 0)
+    return true;
+  DPLOG(ERROR) << "madvise " << advice;
+  return false;
+}
+
+// Faults in the pages of [start, start + length), which spans the pages of
+// |address|, for writing.
+bool Populate(uintptr_t start,
+              size_t length,
+              void* address,
+              size_t page_size) {
+#if defined(OS_LINUX)
+  if (!madvise(reinterpret_cast<void*>(start), length, MADV_POPULATE_WRITE))
+    return true;
+  // Older kernels do not know MADV_POPULATE_WRITE; touch the pages instead.
+  // Only bytes of |address| are touched, as others may be written to
+  // concurrently.
+  if (errno != EINVAL)
+    return false;
+#endif
+  uintptr_t byte = reinterpret_cast<uintptr_t>(address);
+  while (byte < start + length) {
+    volatile char* touched = reinterpret_cast<volatile char*>(byte);
+    *touched = *touched;
+    byte = (byte + page_size) & ~(page_size - 1);
+  }
+  return true;
+}
+
+}  // namespace
+
+bool ApplyMemoryHints(void* address, size_t length, int hints) {
+  if (!length)
+    return true;
+  const size_t page_size = getpagesize();
+  uintptr_t start = reinterpret_cast<uintptr_t>(address) & ~(page_size - 1);
+  length += reinterpret_cast<uintptr_t>(address) - start;
+
+  bool result = true;
+#if defined(OS_LINUX)
+  if (hints & MEMORY_HINT_HUGE_PAGES) {
+    // Fails harmlessly when transparent huge pages are disabled.
+    if (madvise(reinterpret_cast<void*>(start), length, MADV_HUGEPAGE))
+      result = false;
+  }
+#endif
+  DCHECK(!(hints & MEMORY_HINT_SEQUENTIAL) || !(hints & MEMORY_HINT_RANDOM));
+  if (hints & MEMORY_HINT_SEQUENTIAL)
+    result &= Advise(start, length, MADV_SEQUENTIAL);
+  else if (hints & MEMORY_HINT_RANDOM)
+    result &= Advise(start, length, MADV_RANDOM);
+  if (hints & MEMORY_HINT_WILLNEED)
+    result &= Advise(start, length, MADV_WILLNEED);
+  if (hints & MEMORY_HINT_POPULATE)
+    result &= Populate(start, length, address, page_size);
+  return result;
+}
+
+}  // namespace base
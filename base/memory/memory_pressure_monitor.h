@@ -0,0 +1,170 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_MEMORY_MEMORY_PRESSURE_MONITOR_H_
+#define BASE_MEMORY_MEMORY_PRESSURE_MONITOR_H_
+
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/files/file_path.h"
+#include "base/observer_list.h"
+#include "base/synchronization/condition_variable.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/platform_thread.h"
+#include "base/time/time.h"
+
+namespace base {
+
+// MemoryPressureMonitor tells observers when the system, or the cgroup we
+// run in, is short of memory, so that caches can shed memory before the
+// kernel reclaims it from under us or kills us at the container limit.
+//
+// It waits on a thread of its own for the kernel's pressure stall
+// information (PSI) triggers, which fire when tasks stall on memory for more
+// than a threshold within a window:
+//  - /proc/pressure/memory, for the whole system, needs Linux 5.2.
+//  - memory.pressure in our cgroup v2 directory, for the container.
+// and for changes to memory.events in the cgroup directory, which count the
+// times the cgroup went over memory.high and hit memory.max. Stalls of some
+// tasks and going over memory.high are moderate pressure; stalls of all
+// tasks, and hitting memory.max or the OOM killer, are critical.
+//
+// Example:
+//
+//   class Cache : public MemoryPressureMonitor::Observer {
+//     virtual void OnMemoryPressure(
+//         MemoryPressureMonitor::MemoryPressureLevel level) OVERRIDE {
+//       AutoLock lock(lock_);
+//       Shrink(level == MemoryPressureMonitor::MEMORY_PRESSURE_CRITICAL ?
+//              0 : size() / 2);
+//     }
+//   };
+//
+//   MemoryPressureMonitor monitor;
+//   monitor.AddObserver(&cache);
+//   monitor.Start();
+class BASE_EXPORT MemoryPressureMonitor : public PlatformThread::Delegate {
+ public:
+  enum MemoryPressureLevel {
+#define DEFINE_MEMORY_PRESSURE_LEVEL(name, value) name = value,
+#include "base/memory/memory_pressure_level_list.h"
+#undef DEFINE_MEMORY_PRESSURE_LEVEL
+  };
+
+  class BASE_EXPORT Observer {
+   public:
+    // Called on the monitor's thread, one notification at a time. It may add
+    // and remove observers, itself included. RemoveObserver() on another
+    // thread waits for a notification in progress, so an observer removed is
+    // never called again.
+    virtual void OnMemoryPressure(MemoryPressureLevel level) = 0;
+
+   protected:
+    virtual ~Observer() {}
+  };
+
+  struct BASE_EXPORT Options {
+    Options();
+
+    // The PSI triggers: pressure is moderate when some tasks stall on memory
+    // for |moderate_stall| in a |window|, and critical when all do for
+    // |critical_stall|. Unprivileged processes may only use windows which
+    // are a multiple of two seconds. Each level is notified at most once a
+    // window.
+    TimeDelta window;
+    TimeDelta moderate_stall;
+    TimeDelta critical_stall;
+
+    // The system PSI file, "/proc/pressure/memory", or empty not to watch
+    // the whole system.
+    FilePath system_pressure_file;
+
+    // The cgroup v2 directory whose memory.pressure and memory.events are
+    // watched. By default, that of this process; empty not to watch one.
+    FilePath cgroup_dir;
+  };
+
+  MemoryPressureMonitor();
+  explicit MemoryPressureMonitor(const Options& options);
+
+  // Stops the thread.
+  virtual ~MemoryPressureMonitor();
+
+  // Starts watching. Returns false if none of the files can be watched, for
+  // instance on kernels without PSI and outside a cgroup v2.
+  bool Start();
+
+  // May be called on any thread.
+  void AddObserver(Observer* observer);
+  void RemoveObserver(Observer* observer);
+
+  // Notifies the observers as if |level| had been detected, for tests and
+  // for debugging.
+  void SimulatePressureNotification(MemoryPressureLevel level);
+
+  // PlatformThread::Delegate:
+  virtual void ThreadMain() OVERRIDE;
+
+ private:
+  // The files polled.
+  struct Source {
+    Source();
+
+    int fd;
+    // True for memory.events, which is reread when it changes. A PSI trigger
+    // has |level|, the level of pressure it fires for.
+    bool is_events;
+    MemoryPressureLevel level;
+    // The counts of the memory.events keys, as last read.
+    uint64 high_events;
+    uint64 critical_events;
+  };
+
+  // Opens the PSI file |path| and sets a trigger on it for |level|. Returns
+  // false if it can't.
+  bool AddTrigger(const FilePath& path,
+                  MemoryPressureLevel level,
+                  const char* stall_type,
+                  TimeDelta stall);
+
+  // Opens memory.events in |cgroup_dir|. Returns false if it can't.
+  bool AddEventsFile(const FilePath& cgroup_dir);
+
+  // Rereads memory.events, setting |level| to the level its changes signify,
+  // or -1 if none. Returns false if the file can't be read.
+  bool ReadEvents(Source* source, int* level);
+
+  // Notifies the observers of |level|, unless they were notified of it
+  // within the window.
+  void Notify(MemoryPressureLevel level, TimeTicks now);
+
+  // Notifies the observers of |level|. Called with |lock_| held, which is
+  // released while each observer is called.
+  void NotifyObserversLocked(MemoryPressureLevel level);
+
+  void Wake();
+
+  const Options options_;
+  std::vector<Source> sources_;
+  int wakeup_fd_;
+  PlatformThreadHandle thread_;
+  bool started_;
+
+  // Guards the members below. Not held while observers are called.
+  Lock lock_;
+  ObserverList<Observer> observers_;
+  // The thread notifying the observers, or kInvalidThreadId.
+  PlatformThreadId notifying_thread_;
+  // Signaled when a notification ends.
+  ConditionVariable notification_done_;
+  TimeTicks last_notification_times_[MEMORY_PRESSURE_CRITICAL + 1];
+
+  DISALLOW_COPY_AND_ASSIGN(MemoryPressureMonitor);
+};
+
+}  // namespace base
+
+#endif  // BASE_MEMORY_MEMORY_PRESSURE_MONITOR_H_
@@ -0,0 +1,292 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/memory/memory_pressure_monitor.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "base/file_util.h"
+#include "base/format_macros.h"
+#include "base/logging.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/process/internal_linux.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
+#include "base/strings/stringprintf.h"
+
+namespace base {
+
+namespace {
+
+// Returns the cgroup v2 directory of this process, or an empty path if the
+// hierarchy isn't mounted.
+FilePath GetCgroup2Directory() {
+  FilePath dir;
+  if (!internal::GetCgroupDirectory(std::string(), NULL, &dir))
+    return FilePath();
+  return dir;
+}
+
+}  // namespace
+
+MemoryPressureMonitor::Options::Options()
+    : window(TimeDelta::FromSeconds(2)),
+      moderate_stall(TimeDelta::FromMilliseconds(200)),
+      critical_stall(TimeDelta::FromMilliseconds(100)),
+      system_pressure_file("/proc/pressure/memory"),
+      cgroup_dir(GetCgroup2Directory()) {
+}
+
+MemoryPressureMonitor::Source::Source()
+    : fd(-1),
+      is_events(false),
+      level(MEMORY_PRESSURE_MODERATE),
+      high_events(0),
+      critical_events(0) {
+}
+
+MemoryPressureMonitor::MemoryPressureMonitor()
+    : wakeup_fd_(-1),
+      started_(false),
+      notifying_thread_(kInvalidThreadId),
+      notification_done_(&lock_) {
+}
+
+MemoryPressureMonitor::MemoryPressureMonitor(const Options& options)
+    : options_(options),
+      wakeup_fd_(-1),
+      started_(false),
+      notifying_thread_(kInvalidThreadId),
+      notification_done_(&lock_) {
+}
+
+MemoryPressureMonitor::~MemoryPressureMonitor() {
+  if (started_) {
+    Wake();
+    PlatformThread::Join(thread_);
+  }
+  for (size_t i = 0; i < sources_.size(); ++i)
+    close(sources_[i].fd);
+  if (wakeup_fd_ >= 0)
+    close(wakeup_fd_);
+}
+
+bool MemoryPressureMonitor::Start() {
+  DCHECK(!started_);
+  if (!options_.system_pressure_file.empty()) {
+    AddTrigger(options_.system_pressure_file, MEMORY_PRESSURE_MODERATE,
+               "some", options_.moderate_stall);
+    AddTrigger(options_.system_pressure_file, MEMORY_PRESSURE_CRITICAL,
+               "full", options_.critical_stall);
+  }
+  if (!options_.cgroup_dir.empty()) {
+    const FilePath pressure_file =
+        options_.cgroup_dir.Append("memory.pressure");
+    AddTrigger(pressure_file, MEMORY_PRESSURE_MODERATE, "some",
+               options_.moderate_stall);
+    AddTrigger(pressure_file, MEMORY_PRESSURE_CRITICAL, "full",
+               options_.critical_stall);
+    AddEventsFile(options_.cgroup_dir);
+  }
+  if (sources_.empty())
+    return false;
+
+  wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wakeup_fd_ < 0) {
+    DPLOG(ERROR) << "eventfd";
+    return false;
+  }
+  if (!PlatformThread::Create(0, this, &thread_)) {
+    DLOG(ERROR) << "Failed to start the MemoryPressureMonitor thread";
+    return false;
+  }
+  started_ = true;
+  return true;
+}
+
+void MemoryPressureMonitor::AddObserver(Observer* observer) {
+  AutoLock lock(lock_);
+  observers_.AddObserver(observer);
+}
+
+void MemoryPressureMonitor::RemoveObserver(Observer* observer) {
+  AutoLock lock(lock_);
+  // An observer being notified may remove observers at once; elsewhere, wait
+  // until |observer| can no longer be in a call.
+  const PlatformThreadId thread = PlatformThread::CurrentId();
+  while (notifying_thread_ != kInvalidThreadId && notifying_thread_ != thread)
+    notification_done_.Wait();
+  observers_.RemoveObserver(observer);
+}
+
+void MemoryPressureMonitor::SimulatePressureNotification(
+    MemoryPressureLevel level) {
+  AutoLock lock(lock_);
+  NotifyObserversLocked(level);
+}
+
+void MemoryPressureMonitor::ThreadMain() {
+  PlatformThread::SetName("MemoryPressureMonitor");
+
+  // The wakeup eventfd is last; it is only written to stop the thread.
+  std::vector<struct pollfd> fds(sources_.size() + 1);
+  for (size_t i = 0; i < sources_.size(); ++i) {
+    fds[i].fd = sources_[i].fd;
+    fds[i].events = POLLPRI;
+  }
+  fds.back().fd = wakeup_fd_;
+  fds.back().events = POLLIN;
+
+  for (;;) {
+    if (HANDLE_EINTR(poll(&fds[0], fds.size(), -1)) < 0) {
+      DPLOG(ERROR) << "poll";
+      return;
+    }
+    if (fds.back().revents)
+      return;
+
+    const TimeTicks now = TimeTicks::Now();
+    for (size_t i = 0; i < sources_.size(); ++i) {
+      if (!fds[i].revents)
+        continue;
+      Source& source = sources_[i];
+      if (source.is_events) {
+        // kernfs reports a change as POLLPRI | POLLERR, so only a failed
+        // read tells that the cgroup was removed.
+        int level;
+        if (!ReadEvents(&source, &level))
+          fds[i].fd = -1;
+        else if (level >= 0)
+          Notify(static_cast<MemoryPressureLevel>(level), now);
+      } else if (fds[i].revents & POLLERR) {
+        // The cgroup was removed. Stop polling the trigger.
+        fds[i].fd = -1;
+      } else if (fds[i].revents & POLLPRI) {
+        Notify(source.level, now);
+      }
+    }
+  }
+}
+
+bool MemoryPressureMonitor::AddTrigger(const FilePath& path,
+                                       MemoryPressureLevel level,
+                                       const char* stall_type,
+                                       TimeDelta stall) {
+  Source source;
+  source.fd = HANDLE_EINTR(open(path.value().c_str(),
+                                O_RDWR | O_NONBLOCK | O_CLOEXEC));
+  if (source.fd < 0)
+    return false;
+  // The trigger is written with its terminating NUL.
+  const std::string trigger = StringPrintf(
+      "%s %" PRId64 " %" PRId64, stall_type, stall.InMicroseconds(),
+      options_.window.InMicroseconds());
+  if (HANDLE_EINTR(write(source.fd, trigger.c_str(), trigger.size() + 1)) <
+      0) {
+    DPLOG(WARNING) << "Can't set the trigger \"" << trigger << "\" on "
+                   << path.value();
+    close(source.fd);
+    return false;
+  }
+  source.level = level;
+  sources_.push_back(source);
+  return true;
+}
+
+bool MemoryPressureMonitor::AddEventsFile(const FilePath& cgroup_dir) {
+  Source source;
+  source.fd = HANDLE_EINTR(open(
+      cgroup_dir.Append("memory.events").value().c_str(),
+      O_RDONLY | O_CLOEXEC));
+  if (source.fd < 0)
+    return false;
+  source.is_events = true;
+  // The first read sets the counts which later ones compare with, and arms
+  // the change notification.
+  int level;
+  ReadEvents(&source, &level);
+  sources_.push_back(source);
+  return true;
+}
+
+bool MemoryPressureMonitor::ReadEvents(Source* source, int* level) {
+  char buffer[512];
+  const ssize_t size = HANDLE_EINTR(pread(source->fd, buffer,
+                                          sizeof(buffer) - 1, 0));
+  if (size <= 0)
+    return false;
+  buffer[size] = '\0';
+
+  // Lines of "<key> <count>". "high" counts the times reclaim was forced by
+  // going over memory.high; "max", those memory.max was hit; and "oom" and
+  // "oom_kill", the times the OOM killer was invoked and killed.
+  uint64 high = 0;
+  uint64 critical = 0;
+  std::vector<std::string> lines;
+  SplitString(buffer, '\n', &lines);
+  for (size_t i = 0; i < lines.size(); ++i) {
+    const size_t space = lines[i].find(' ');
+    uint64 count;
+    if (space == std::string::npos ||
+        !StringToUint64(lines[i].substr(space + 1), &count)) {
+      continue;
+    }
+    const std::string key = lines[i].substr(0, space);
+    if (key == "high")
+      high = count;
+    else if (key == "max" || key == "oom" || key == "oom_kill")
+      critical += count;
+  }
+
+  *level = -1;
+  if (critical > source->critical_events)
+    *level = MEMORY_PRESSURE_CRITICAL;
+  else if (high > source->high_events)
+    *level = MEMORY_PRESSURE_MODERATE;
+  source->high_events = high;
+  source->critical_events = critical;
+  return true;
+}
+
+void MemoryPressureMonitor::Notify(MemoryPressureLevel level, TimeTicks now) {
+  AutoLock lock(lock_);
+  TimeTicks& last = last_notification_times_[level];
+  if (!last.is_null() && now - last < options_.window)
+    return;
+  last = now;
+  NotifyObserversLocked(level);
+}
+
+void MemoryPressureMonitor::NotifyObserversLocked(MemoryPressureLevel level) {
+  lock_.AssertAcquired();
+  const PlatformThreadId thread = PlatformThread::CurrentId();
+  DCHECK_NE(thread, notifying_thread_) << "Notification from an observer";
+  while (notifying_thread_ != kInvalidThreadId)
+    notification_done_.Wait();
+  notifying_thread_ = thread;
+  {
+    // The list copes with observers added and removed while it is iterated.
+    ObserverList<Observer>::Iterator it(observers_);
+    Observer* observer;
+    while ((observer = it.GetNext()) != NULL) {
+      AutoUnlock unlock(lock_);
+      observer->OnMemoryPressure(level);
+    }
+  }
+  notifying_thread_ = kInvalidThreadId;
+  notification_done_.Broadcast();
+}
+
+void MemoryPressureMonitor::Wake() {
+  uint64_t value = 1;
+  if (HANDLE_EINTR(write(wakeup_fd_, &value, sizeof(value))) < 0)
+    DPLOG(ERROR) << "write";
+}
+
+}  // namespace base
@@ -0,0 +1,117 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/memory/memory_pressure_monitor.h"
+
+#include <vector>
+
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+class RecordingObserver : public MemoryPressureMonitor::Observer {
+ public:
+  virtual void OnMemoryPressure(
+      MemoryPressureMonitor::MemoryPressureLevel level) OVERRIDE {
+    levels_.push_back(level);
+  }
+
+  const std::vector<MemoryPressureMonitor::MemoryPressureLevel>& levels()
+      const {
+    return levels_;
+  }
+
+ private:
+  std::vector<MemoryPressureMonitor::MemoryPressureLevel> levels_;
+};
+
+// Removes itself, and adds |added| if not NULL, when notified.
+class SelfRemovingObserver : public RecordingObserver {
+ public:
+  SelfRemovingObserver(MemoryPressureMonitor* monitor,
+                       MemoryPressureMonitor::Observer* added)
+      : monitor_(monitor),
+        added_(added) {
+  }
+
+  virtual void OnMemoryPressure(
+      MemoryPressureMonitor::MemoryPressureLevel level) OVERRIDE {
+    RecordingObserver::OnMemoryPressure(level);
+    monitor_->RemoveObserver(this);
+    if (added_)
+      monitor_->AddObserver(added_);
+  }
+
+ private:
+  MemoryPressureMonitor* monitor_;
+  MemoryPressureMonitor::Observer* added_;
+};
+
+}  // namespace
+
+TEST(MemoryPressureMonitorTest, NothingToWatch) {
+  MemoryPressureMonitor::Options options;
+  options.system_pressure_file = FilePath("/nonexistent/pressure/memory");
+  options.cgroup_dir = FilePath();
+  MemoryPressureMonitor monitor(options);
+  EXPECT_FALSE(monitor.Start());
+}
+
+TEST(MemoryPressureMonitorTest, StartAndStop) {
+  // Whether this starts depends on the kernel and on our cgroup; either
+  // way, the monitor stops cleanly.
+  RecordingObserver observer;
+  MemoryPressureMonitor monitor;
+  monitor.AddObserver(&observer);
+  monitor.Start();
+  monitor.RemoveObserver(&observer);
+}
+
+TEST(MemoryPressureMonitorTest, Observers) {
+  RecordingObserver first;
+  RecordingObserver second;
+  MemoryPressureMonitor monitor;
+  monitor.AddObserver(&first);
+  monitor.AddObserver(&second);
+  monitor.SimulatePressureNotification(
+      MemoryPressureMonitor::MEMORY_PRESSURE_MODERATE);
+  monitor.RemoveObserver(&second);
+  monitor.SimulatePressureNotification(
+      MemoryPressureMonitor::MEMORY_PRESSURE_CRITICAL);
+  monitor.RemoveObserver(&first);
+
+  ASSERT_EQ(2u, first.levels().size());
+  EXPECT_EQ(MemoryPressureMonitor::MEMORY_PRESSURE_MODERATE,
+            first.levels()[0]);
+  EXPECT_EQ(MemoryPressureMonitor::MEMORY_PRESSURE_CRITICAL,
+            first.levels()[1]);
+  ASSERT_EQ(1u, second.levels().size());
+  EXPECT_EQ(MemoryPressureMonitor::MEMORY_PRESSURE_MODERATE,
+            second.levels()[0]);
+}
+
+// Observers may add and remove observers while they are notified.
+TEST(MemoryPressureMonitorTest, ObserversChangedWhileNotified) {
+  MemoryPressureMonitor monitor;
+  RecordingObserver added;
+  SelfRemovingObserver removing(&monitor, &added);
+  monitor.AddObserver(&removing);
+  monitor.SimulatePressureNotification(
+      MemoryPressureMonitor::MEMORY_PRESSURE_MODERATE);
+  monitor.SimulatePressureNotification(
+      MemoryPressureMonitor::MEMORY_PRESSURE_CRITICAL);
+  monitor.RemoveObserver(&added);
+
+  ASSERT_EQ(1u, removing.levels().size());
+  EXPECT_EQ(MemoryPressureMonitor::MEMORY_PRESSURE_MODERATE,
+            removing.levels()[0]);
+  // Added during the first notification, which notifies it too.
+  ASSERT_EQ(2u, added.levels().size());
+  EXPECT_EQ(MemoryPressureMonitor::MEMORY_PRESSURE_CRITICAL,
+            added.levels()[1]);
+}
+
+}  // namespace base
@@ -0,0 +1,222 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/memory/slab_allocator.h"
+
+#include <algorithm>
+
+#include "base/atomicops.h"
+#include "base/lazy_instance.h"
+#include "base/logging.h"
+#include "base/memory/aligned_memory.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/thread_local_storage.h"
+
+namespace base {
+
+namespace {
+
+// Slabs are aligned to their size, so that the slab of an object is found by
+// masking its address.
+const size_t kSlabSize = 64 * 1024;
+
+// The slab header takes the first bytes of each slab. Objects start after it,
+// at an offset that keeps them aligned to up to kHeaderSize.
+const size_t kHeaderSize = 64;
+
+const size_t kSizeClassStep = SlabAllocator::kDefaultAlignment;
+const size_t kNumSizeClasses = SlabAllocator::kMaxSize / kSizeClassStep;
+
+// Size class of blocks allocated individually.
+const uint32 kLargeSizeClass = kNumSizeClasses;
+
+struct FreeObject {
+  FreeObject* next;
+};
+
+struct ThreadCache;
+
+struct SlabHeader {
+  // Never changes: a thread that exits hands its cache over to another.
+  ThreadCache* owner;
+  uint32 size_class;
+  // Offset of the block in large slabs.
+  uint32 offset;
+};
+
+COMPILE_ASSERT(sizeof(SlabHeader) <= kHeaderSize, slab_header_too_large);
+
+struct ThreadCache {
+  // Objects freed by the owning thread.
+  FreeObject* free_lists[kNumSizeClasses];
+
+  // Lists of FreeObject pushed by other threads, taken back all at once.
+  subtle::AtomicWord return_queues[kNumSizeClasses];
+
+  // Next cache of exited threads waiting to be adopted.
+  ThreadCache* next_unowned;
+};
+
+void ReleaseThreadCache(void* cache);
+
+struct SlabAllocatorState {
+  SlabAllocatorState() : current_cache(&ReleaseThreadCache), unowned(NULL) {}
+
+  ThreadLocalStorage::Slot current_cache;
+
+  // Guards |unowned|.
+  Lock lock;
+  ThreadCache* unowned;
+};
+
+// Leaky, as objects may be freed during shutdown.
+LazyInstance<SlabAllocatorState>::Leaky g_state = LAZY_INSTANCE_INITIALIZER;
+
+// The cache of the current thread, also held by |current_cache| so that it is
+// released when the thread exits. Reading this is much cheaper than
+// pthread_getspecific().
+#if defined(COMPILER_MSVC)
+__declspec(thread) ThreadCache* t_cache;
+#else
+__thread ThreadCache* t_cache;
+#endif
+
+void ReleaseThreadCache(void* cache) {
+  t_cache = NULL;
+  SlabAllocatorState* state = g_state.Pointer();
+  AutoLock lock(state->lock);
+  static_cast<ThreadCache*>(cache)->next_unowned = state->unowned;
+  state->unowned = static_cast<ThreadCache*>(cache);
+}
+
+NOINLINE ThreadCache* CreateThreadCache() {
+  SlabAllocatorState* state = g_state.Pointer();
+  ThreadCache* cache;
+  {
+    AutoLock lock(state->lock);
+    cache = state->unowned;
+    if (cache)
+      state->unowned = cache->next_unowned;
+  }
+  if (!cache)
+    cache = new ThreadCache();
+  state->current_cache.Set(cache);
+  t_cache = cache;
+  return cache;
+}
+
+SlabHeader* SlabOf(void* ptr) {
+  return reinterpret_cast<SlabHeader*>(
+      reinterpret_cast<uintptr_t>(ptr) & ~(kSlabSize - 1));
+}
+
+// Carves a new slab owned by |cache| into objects of |size_class|.
+NOINLINE FreeObject* AllocateSlab(ThreadCache* cache, uint32 size_class) {
+  SlabHeader* slab = static_cast<SlabHeader*>(AlignedAlloc(kSlabSize,
+                                                           kSlabSize));
+  slab->owner = cache;
+  slab->size_class = size_class;
+  slab->offset = kHeaderSize;
+
+  size_t object_size = (size_class + 1) * kSizeClassStep;
+  size_t num_objects = (kSlabSize - kHeaderSize) / object_size;
+  char* start = reinterpret_cast<char*>(slab) + kHeaderSize;
+  FreeObject* list = NULL;
+  // Built backwards, so that objects are handed out in address order.
+  for (size_t i = num_objects; i > 0; --i) {
+    FreeObject* object =
+        reinterpret_cast<FreeObject*>(start + (i - 1) * object_size);
+    object->next = list;
+    list = object;
+  }
+  return list;
+}
+
+// Refills the free list of |size_class| from its return queue, or else from a
+// new slab.
+NOINLINE void Refill(ThreadCache* cache, uint32 size_class) {
+  subtle::AtomicWord* queue = &cache->return_queues[size_class];
+  subtle::AtomicWord returned = subtle::NoBarrier_Load(queue);
+  while (returned) {
+    subtle::AtomicWord previous =
+        subtle::Acquire_CompareAndSwap(queue, returned, 0);
+    if (previous == returned) {
+      cache->free_lists[size_class] = reinterpret_cast<FreeObject*>(returned);
+      return;
+    }
+    returned = previous;
+  }
+  cache->free_lists[size_class] = AllocateSlab(cache, size_class);
+}
+
+NOINLINE void* AllocateLarge(size_t size, size_t alignment) {
+  size_t offset = std::max(kHeaderSize, alignment);
+  SlabHeader* slab = static_cast<SlabHeader*>(
+      AlignedAlloc(offset + size, kSlabSize));
+  slab->owner = NULL;
+  slab->size_class = kLargeSizeClass;
+  slab->offset = offset;
+  return reinterpret_cast<char*>(slab) + offset;
+}
+
+}  // namespace
+
+// static
+void* SlabAllocator::Allocate(size_t size, size_t alignment) {
+  DCHECK_EQ(alignment & (alignment - 1), 0u);
+  DCHECK_LE(alignment, static_cast<size_t>(kMaxAlignment));
+  alignment = std::max(alignment, kSizeClassStep);
+  if (size > kMaxSize || alignment > kHeaderSize)
+    return AllocateLarge(size, alignment);
+
+  // Objects are aligned to their size up to kHeaderSize, since slabs are
+  // aligned to kSlabSize and objects start at kHeaderSize.
+  size_t object_size = (std::max<size_t>(size, 1) + alignment - 1) &
+                       ~(alignment - 1);
+  uint32 size_class = object_size / kSizeClassStep - 1;
+  ThreadCache* cache = t_cache;
+  if (!cache)
+    cache = CreateThreadCache();
+  FreeObject* object = cache->free_lists[size_class];
+  if (!object) {
+    Refill(cache, size_class);
+    object = cache->free_lists[size_class];
+  }
+  cache->free_lists[size_class] = object->next;
+  return object;
+}
+
+// static
+void SlabAllocator::Free(void* ptr) {
+  if (!ptr)
+    return;
+  SlabHeader* slab = SlabOf(ptr);
+  uint32 size_class = slab->size_class;
+  if (size_class == kLargeSizeClass) {
+    DCHECK_EQ(reinterpret_cast<char*>(slab) + slab->offset, ptr);
+    AlignedFree(slab);
+    return;
+  }
+
+  FreeObject* object = static_cast<FreeObject*>(ptr);
+  ThreadCache* owner = slab->owner;
+  if (owner == t_cache) {
+    object->next = owner->free_lists[size_class];
+    owner->free_lists[size_class] = object;
+    return;
+  }
+
+  subtle::AtomicWord* queue = &owner->return_queues[size_class];
+  subtle::AtomicWord head = subtle::NoBarrier_Load(queue);
+  for (;;) {
+    object->next = reinterpret_cast<FreeObject*>(head);
+    subtle::AtomicWord previous = subtle::Release_CompareAndSwap(
+        queue, head, reinterpret_cast<subtle::AtomicWord>(object));
+    if (previous == head)
+      return;
+    head = previous;
+  }
+}
+
+}  // namespace base
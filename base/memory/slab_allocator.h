@@ -0,0 +1,91 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// SlabAllocator is a thread-caching allocator for small objects that are
+// allocated and freed at a high rate, such as tasks and callbacks. Classes opt
+// in by deriving from SlabAllocated:
+//
+//   class MyObject : public SlabAllocated<MyObject> {
+//     ...
+//   };
+//
+//   MyObject* object = new MyObject;  // Comes from the SlabAllocator.
+//
+// Objects are carved out of 64 KB slabs, one size class per multiple of 16
+// bytes. Every thread owns the slabs it carved and keeps a free list per size
+// class, so allocating and freeing an object of one's own needs neither a lock
+// nor an atomic operation. Objects freed by another thread are pushed onto a
+// lock-free return queue of the owning thread, which takes them back when its
+// own free list runs dry; producer/consumer patterns therefore don't
+// accumulate memory on the consumer side.
+//
+// When a thread exits, its slabs and free lists are handed over as a whole to
+// the next thread that starts allocating. Memory is reused but never returned
+// to the system, except for objects larger than kMaxSize, which are allocated
+// individually.
+
+#ifndef BASE_MEMORY_SLAB_ALLOCATOR_H_
+#define BASE_MEMORY_SLAB_ALLOCATOR_H_
+
+#include <stddef.h>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/compiler_specific.h"
+
+namespace base {
+
+class BASE_EXPORT SlabAllocator {
+ public:
+  // Largest object served from slabs.
+  static const size_t kMaxSize = 1024;
+
+  // Minimum alignment of all blocks, as for malloc(). Larger alignments, powers
+  // of two, are supported up to kMaxAlignment.
+  static const size_t kDefaultAlignment = 16;
+  static const size_t kMaxAlignment = 4096;
+
+  // Returns an uninitialized block of |size| bytes aligned to |alignment| and
+  // kDefaultAlignment. Crashes when out of memory.
+  static void* Allocate(size_t size, size_t alignment);
+  static void* Allocate(size_t size) {
+    return Allocate(size, kDefaultAlignment);
+  }
+
+  // Frees a block returned by Allocate(), from any thread. NULL is ignored.
+  static void Free(void* ptr);
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(SlabAllocator);
+};
+
+// Mixin that allocates the instances of |T| with the SlabAllocator. Instances
+// of subclasses of |T| are allocated the same way.
+template <typename T>
+class SlabAllocated {
+ public:
+  static void* operator new(size_t size) {
+    return SlabAllocator::Allocate(size, ALIGNOF(T));
+  }
+
+  static void operator delete(void* ptr) {
+    SlabAllocator::Free(ptr);
+  }
+
+  // Placement new is hidden by the operator above otherwise.
+  static void* operator new(size_t size, void* ptr) {
+    return ptr;
+  }
+
+  static void operator delete(void* ptr, void* place) {
+  }
+
+ protected:
+  SlabAllocated() {}
+  ~SlabAllocated() {}
+};
+
+}  // namespace base
+
+#endif  // BASE_MEMORY_SLAB_ALLOCATOR_H_
@@ -0,0 +1,187 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/memory/slab_allocator.h"
+
+#include <stdlib.h>
+
+#include <vector>
+
+#include "base/memory/scoped_vector.h"
+#include "base/strings/stringprintf.h"
+#include "base/synchronization/lock.h"
+#include "base/test/perf_time_logger.h"
+#include "base/threading/platform_thread.h"
+#include "base/threading/simple_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+const int kAllocationsPerThread = 500000;
+const size_t kBatchSize = 256;
+
+typedef void* (*AllocateFunction)(size_t size);
+typedef void (*FreeFunction)(void* ptr);
+
+void* SlabAllocate(size_t size) {
+  return SlabAllocator::Allocate(size);
+}
+
+// Sizes of tasks and callbacks, 16 to 256 bytes.
+size_t BlockSize(int i) {
+  return 16 + static_cast<size_t>(i) * 7919 % 241;
+}
+
+// Hands batches of blocks over from a producer to a consumer thread.
+class Channel {
+ public:
+  Channel() : done_(false) {}
+
+  void Push(std::vector<void*>* batch) {
+    AutoLock lock(lock_);
+    batches_.push_back(std::vector<void*>());
+    batches_.back().swap(*batch);
+  }
+
+  void Close() {
+    AutoLock lock(lock_);
+    done_ = true;
+  }
+
+  // Returns false once the channel is closed and empty.
+  bool Pop(std::vector<void*>* batch) {
+    for (;;) {
+      {
+        AutoLock lock(lock_);
+        if (!batches_.empty()) {
+          batch->swap(batches_.back());
+          batches_.pop_back();
+          return true;
+        }
+        if (done_)
+          return false;
+      }
+      PlatformThread::YieldCurrentThread();
+    }
+  }
+
+ private:
+  Lock lock_;
+  std::vector<std::vector<void*> > batches_;
+  bool done_;
+};
+
+class Producer : public DelegateSimpleThread::Delegate {
+ public:
+  Producer(AllocateFunction allocate, Channel* channel)
+      : allocate_(allocate), channel_(channel) {}
+
+  virtual void Run() OVERRIDE {
+    std::vector<void*> batch;
+    for (int i = 0; i < kAllocationsPerThread; ++i) {
+      batch.push_back(allocate_(BlockSize(i)));
+      if (batch.size() == kBatchSize)
+        channel_->Push(&batch);
+    }
+    channel_->Push(&batch);
+    channel_->Close();
+  }
+
+ private:
+  AllocateFunction allocate_;
+  Channel* channel_;
+};
+
+class Consumer : public DelegateSimpleThread::Delegate {
+ public:
+  Consumer(FreeFunction free_function, Channel* channel)
+      : free_(free_function), channel_(channel) {}
+
+  virtual void Run() OVERRIDE {
+    std::vector<void*> batch;
+    while (channel_->Pop(&batch)) {
+      for (size_t i = 0; i < batch.size(); ++i)
+        free_(batch[i]);
+    }
+  }
+
+ private:
+  FreeFunction free_;
+  Channel* channel_;
+};
+
+// Allocates and frees on the same thread, keeping up to kBatchSize blocks.
+class LocalWorker : public DelegateSimpleThread::Delegate {
+ public:
+  LocalWorker(AllocateFunction allocate, FreeFunction free_function)
+      : allocate_(allocate), free_(free_function) {}
+
+  virtual void Run() OVERRIDE {
+    std::vector<void*> blocks(kBatchSize);
+    for (int i = 0; i < kAllocationsPerThread; ++i) {
+      void*& block = blocks[i % kBatchSize];
+      free_(block);
+      block = allocate_(BlockSize(i));
+    }
+    for (size_t i = 0; i < blocks.size(); ++i)
+      free_(blocks[i]);
+  }
+
+ private:
+  AllocateFunction allocate_;
+  FreeFunction free_;
+};
+
+void RunThreads(const std::string& test_name,
+                ScopedVector<DelegateSimpleThread::Delegate>* delegates) {
+  ScopedVector<DelegateSimpleThread> threads;
+  PerfTimeLogger timer(test_name.c_str());
+  for (size_t i = 0; i < delegates->size(); ++i) {
+    threads.push_back(new DelegateSimpleThread((*delegates)[i], "worker"));
+    threads.back()->Start();
+  }
+  for (size_t i = 0; i < threads.size(); ++i)
+    threads[i]->Join();
+  timer.Done();
+}
+
+// With one thread, allocates and frees locally; otherwise half of the threads
+// allocate and the other half free.
+void RunBenchmark(const char* allocator_name,
+                  AllocateFunction allocate,
+                  FreeFunction free_function) {
+  const int kThreadCounts[] = { 1, 2, 4, 8, 16, 32, 64 };
+  for (size_t i = 0; i < arraysize(kThreadCounts); ++i) {
+    int num_threads = kThreadCounts[i];
+    ScopedVector<Channel> channels;
+    ScopedVector<DelegateSimpleThread::Delegate> delegates;
+    if (num_threads == 1) {
+      delegates.push_back(new LocalWorker(allocate, free_function));
+    } else {
+      for (int j = 0; j < num_threads / 2; ++j) {
+        channels.push_back(new Channel);
+        delegates.push_back(new Producer(allocate, channels.back()));
+        delegates.push_back(new Consumer(free_function, channels.back()));
+      }
+    }
+    RunThreads(StringPrintf("%s_%s_%d_threads", allocator_name,
+                            num_threads == 1 ? "local" : "producer_consumer",
+                            num_threads),
+               &delegates);
+  }
+}
+
+}  // namespace
+
+TEST(SlabAllocatorPerfTest, SlabAllocator) {
+  RunBenchmark("slab_allocator", &SlabAllocate, &SlabAllocator::Free);
+}
+
+TEST(SlabAllocatorPerfTest, Malloc) {
+  RunBenchmark("malloc", &malloc, &free);
+}
+
+}  // namespace base
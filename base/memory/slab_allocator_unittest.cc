@@ -0,0 +1,189 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/memory/slab_allocator.h"
+
+#include <string.h>
+
+#include <set>
+#include <vector>
+
+#include "base/memory/scoped_ptr.h"
+#include "base/threading/simple_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+bool IsAligned(void* ptr, size_t alignment) {
+  return !(reinterpret_cast<uintptr_t>(ptr) & (alignment - 1));
+}
+
+// Blocks of kMaxSize bytes or less come from 64 KB aligned slabs.
+uintptr_t SlabOf(void* ptr) {
+  return reinterpret_cast<uintptr_t>(ptr) & ~static_cast<uintptr_t>(0xffff);
+}
+
+class Allocated : public SlabAllocated<Allocated> {
+ public:
+  explicit Allocated(int value) : value_(value) {}
+  virtual ~Allocated() {}
+
+  int value() const { return value_; }
+
+ private:
+  int value_;
+};
+
+class LargeAllocated : public Allocated {
+ public:
+  LargeAllocated() : Allocated(2) {
+    memset(data_, 0, sizeof(data_));
+  }
+
+ private:
+  char data_[4000];
+};
+
+class ALIGNAS(64) AlignedAllocated : public SlabAllocated<AlignedAllocated> {
+ public:
+  char data_[24];
+};
+
+// Allocates or frees blocks of |size| bytes in |blocks|.
+class BlockDelegate : public DelegateSimpleThread::Delegate {
+ public:
+  BlockDelegate(std::vector<void*>* blocks, size_t size, bool allocate)
+      : blocks_(blocks), size_(size), allocate_(allocate) {
+  }
+
+  virtual void Run() OVERRIDE {
+    for (size_t i = 0; i < blocks_->size(); ++i) {
+      if (allocate_) {
+        (*blocks_)[i] = SlabAllocator::Allocate(size_);
+        memset((*blocks_)[i], 0xcd, size_);
+      } else {
+        SlabAllocator::Free((*blocks_)[i]);
+      }
+    }
+  }
+
+ private:
+  std::vector<void*>* blocks_;
+  size_t size_;
+  bool allocate_;
+};
+
+void RunOnThread(DelegateSimpleThread::Delegate* delegate) {
+  DelegateSimpleThread thread(delegate, "slab_allocator_test");
+  thread.Start();
+  thread.Join();
+}
+
+}  // namespace
+
+TEST(SlabAllocatorTest, AllocatesDistinctAlignedBlocks) {
+  const size_t kSizes[] = { 1, 8, 16, 17, 100, 512, 1000, 1024, 1025, 70000 };
+  std::vector<void*> blocks;
+  std::set<void*> unique_blocks;
+  for (size_t i = 0; i < arraysize(kSizes); ++i) {
+    for (int j = 0; j < 1000; ++j) {
+      void* block = SlabAllocator::Allocate(kSizes[i]);
+      ASSERT_TRUE(block);
+      EXPECT_TRUE(IsAligned(block, SlabAllocator::kDefaultAlignment));
+      memset(block, 0xcd, kSizes[i]);
+      blocks.push_back(block);
+      unique_blocks.insert(block);
+    }
+  }
+  EXPECT_EQ(blocks.size(), unique_blocks.size());
+  for (size_t i = 0; i < blocks.size(); ++i)
+    SlabAllocator::Free(blocks[i]);
+}
+
+TEST(SlabAllocatorTest, Alignment) {
+  for (size_t alignment = 1; alignment <= SlabAllocator::kMaxAlignment;
+       alignment *= 2) {
+    void* small = SlabAllocator::Allocate(24, alignment);
+    void* large = SlabAllocator::Allocate(3000, alignment);
+    EXPECT_TRUE(IsAligned(small, alignment)) << alignment;
+    EXPECT_TRUE(IsAligned(large, alignment)) << alignment;
+    SlabAllocator::Free(small);
+    SlabAllocator::Free(large);
+  }
+}
+
+TEST(SlabAllocatorTest, ReusesFreedBlocks) {
+  void* block = SlabAllocator::Allocate(48);
+  SlabAllocator::Free(block);
+  EXPECT_EQ(block, SlabAllocator::Allocate(48));
+  // Sizes of the same class share blocks.
+  SlabAllocator::Free(block);
+  EXPECT_EQ(block, SlabAllocator::Allocate(40));
+  SlabAllocator::Free(block);
+  SlabAllocator::Free(NULL);
+}
+
+TEST(SlabAllocatorTest, ReturnsBlocksFreedOnOtherThreads) {
+  const size_t kSize = 208;
+  std::vector<void*> blocks(20000);
+  BlockDelegate allocate(&blocks, kSize, true);
+  allocate.Run();
+  BlockDelegate free(&blocks, kSize, false);
+  RunOnThread(&free);
+
+  // Once the free list runs dry, the blocks freed by the other thread are
+  // handed out again instead of new ones.
+  std::set<void*> freed(blocks.begin(), blocks.end());
+  std::vector<void*> reallocated(blocks.size());
+  size_t reused = 0;
+  for (size_t i = 0; i < reallocated.size(); ++i) {
+    reallocated[i] = SlabAllocator::Allocate(kSize);
+    reused += freed.count(reallocated[i]);
+  }
+  EXPECT_GT(reused, blocks.size() * 9 / 10);
+  for (size_t i = 0; i < reallocated.size(); ++i)
+    SlabAllocator::Free(reallocated[i]);
+}
+
+TEST(SlabAllocatorTest, AdoptsCacheOfExitedThread) {
+  const size_t kSize = 800;
+  std::vector<void*> blocks(1000);
+  BlockDelegate allocate(&blocks, kSize, true);
+  RunOnThread(&allocate);
+  // Freed into the return queues of the exited thread.
+  BlockDelegate free(&blocks, kSize, false);
+  free.Run();
+
+  std::vector<void*> reallocated(blocks.size());
+  BlockDelegate reallocate(&reallocated, kSize, true);
+  RunOnThread(&reallocate);
+  // The new thread took over the slabs of the exited one.
+  std::set<uintptr_t> slabs;
+  for (size_t i = 0; i < blocks.size(); ++i)
+    slabs.insert(SlabOf(blocks[i]));
+  for (size_t i = 0; i < reallocated.size(); ++i)
+    EXPECT_EQ(1u, slabs.count(SlabOf(reallocated[i])));
+  BlockDelegate free_reallocated(&reallocated, kSize, false);
+  free_reallocated.Run();
+}
+
+TEST(SlabAllocatorTest, SlabAllocated) {
+  scoped_ptr<Allocated> small(new Allocated(1));
+  EXPECT_EQ(1, small->value());
+  // Subclasses beyond kMaxSize are allocated individually.
+  scoped_ptr<Allocated> large(new LargeAllocated);
+  EXPECT_EQ(2, large->value());
+
+  scoped_ptr<AlignedAllocated> aligned(new AlignedAllocated);
+  EXPECT_TRUE(IsAligned(aligned.get(), 64));
+
+  char buffer[sizeof(Allocated)];
+  Allocated* placed = new (buffer) Allocated(3);
+  EXPECT_EQ(static_cast<void*>(buffer), placed);
+  placed->~Allocated();
+}
+
+}  // namespace base
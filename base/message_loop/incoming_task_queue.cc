@@ -0,0 +1,86 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/message_loop/incoming_task_queue.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/posix/eintr_wrapper.h"
+
+namespace base {
+namespace internal {
+
+IncomingTaskQueue::Node::Node(const PendingTask& task)
+    : task(task) {
+}
+
+IncomingTaskQueue::IncomingTaskQueue()
+    : wakeup_fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+      wakeup_pending_(0),
+      accepting_tasks_(1) {
+  PCHECK(wakeup_fd_ >= 0) << "eventfd";
+}
+
+bool IncomingTaskQueue::AddToIncomingQueue(
+    const tracked_objects::Location& from_here,
+    const Closure& task,
+    TimeDelta delay,
+    bool nestable) {
+  DCHECK_GE(delay.InMicroseconds(), 0)
+      << "delay should not be negative: " << from_here.ToString();
+  if (!subtle::Acquire_Load(&accepting_tasks_))
+    return false;
+
+  // Tasks without a delay are the common case; don't read the clock for
+  // them.
+  const TimeTicks delayed_run_time =
+      delay > TimeDelta() ? TimeTicks::Now() + delay : TimeTicks();
+  queue_.Push(new Node(PendingTask(from_here, task, delayed_run_time,
+                                   nestable)));
+
+  // The push is ordered before the exchange, so either the loop clears the
+  // wakeup after it, and then reloads the task, or this writes the eventfd.
+  if (internal::Barrier_AtomicExchange(&wakeup_pending_, 1) == 0) {
+    const uint64_t value = 1;
+    if (HANDLE_EINTR(write(wakeup_fd_, &value, sizeof(value))) < 0)
+      DPLOG(ERROR) << "write";
+  }
+  return true;
+}
+
+void IncomingTaskQueue::ClearWakeup() {
+  uint64_t value;
+  if (HANDLE_EINTR(read(wakeup_fd_, &value, sizeof(value))) < 0 &&
+      errno != EAGAIN) {
+    DPLOG(ERROR) << "read";
+  }
+  internal::Barrier_AtomicExchange(&wakeup_pending_, 0);
+}
+
+void IncomingTaskQueue::ReloadWorkQueue(TaskQueue* work_queue) {
+  while (Node* node = queue_.Pop()) {
+    work_queue->push(node->task);
+    delete node;
+  }
+}
+
+void IncomingTaskQueue::WillDestroyCurrentMessageLoop() {
+  internal::Barrier_AtomicExchange(&accepting_tasks_, 0);
+}
+
+IncomingTaskQueue::~IncomingTaskQueue() {
+  // No thread can be posting: they would hold a reference.
+  while (Node* node = queue_.Pop())
+    delete node;
+  DCHECK(queue_.empty());
+  close(wakeup_fd_);
+}
+
+}  // namespace internal
+}  // namespace base
@@ -0,0 +1,90 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_MESSAGE_LOOP_INCOMING_TASK_QUEUE_H_
+#define BASE_MESSAGE_LOOP_INCOMING_TASK_QUEUE_H_
+
+#include "base/atomicops.h"
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/containers/mpsc_queue.h"
+#include "base/memory/ref_counted.h"
+#include "base/pending_task.h"
+#include "base/time/time.h"
+
+namespace base {
+namespace internal {
+
+// Implements a queue of tasks posted to a MessageLoop from any thread. The
+// tasks are pushed to an MPSCQueue, so posting threads don't contend on a
+// lock, and the loop is woken through an eventfd which it polls along with
+// the file descriptors it watches.
+//
+// The eventfd is written only for the first task posted after the loop
+// last cleared its wakeup, so a burst of tasks costs the posting threads
+// one write and the loop one wakeup, and the loop takes the whole burst at
+// once in ReloadWorkQueue().
+//
+// The queue is ref counted by the MessageLoop and its MessageLoopProxy, so
+// that it outlives the loop for threads still holding the proxy.
+class BASE_EXPORT IncomingTaskQueue
+    : public RefCountedThreadSafe<IncomingTaskQueue> {
+ public:
+  IncomingTaskQueue();
+
+  // Appends a task to the incoming queue and wakes the loop if need be. May
+  // be called on any thread. Returns false, without queuing the task, once
+  // the loop is being destroyed.
+  bool AddToIncomingQueue(const tracked_objects::Location& from_here,
+                          const Closure& task,
+                          TimeDelta delay,
+                          bool nestable);
+
+  // The descriptor which becomes readable when tasks are added. The loop
+  // waits for it, and calls ClearWakeup() when it is readable.
+  int wakeup_fd() const { return wakeup_fd_; }
+
+  // Consumes the wakeup. Tasks added from then on wake the loop again, so
+  // it must be followed by a ReloadWorkQueue() before the loop sleeps.
+  void ClearWakeup();
+
+  // Appends the tasks added so far to |work_queue|. Called on the loop's
+  // thread only.
+  void ReloadWorkQueue(TaskQueue* work_queue);
+
+  // Disconnects from the MessageLoop: tasks posted from then on are refused.
+  // Tasks which are being posted as this is called are deleted with the
+  // queue instead of being run.
+  void WillDestroyCurrentMessageLoop();
+
+ private:
+  friend class RefCountedThreadSafe<IncomingTaskQueue>;
+
+  struct Node : public MPSCQueueNode<Node> {
+    explicit Node(const PendingTask& task);
+
+    PendingTask task;
+  };
+
+  virtual ~IncomingTaskQueue();
+
+  MPSCQueue<Node> queue_;
+
+  // An eventfd.
+  int wakeup_fd_;
+
+  // Set by the thread which writes |wakeup_fd_|, and cleared by the loop
+  // when it reads it.
+  volatile subtle::AtomicWord wakeup_pending_;
+
+  // Cleared when the loop is being destroyed.
+  volatile subtle::AtomicWord accepting_tasks_;
+
+  DISALLOW_COPY_AND_ASSIGN(IncomingTaskQueue);
+};
+
+}  // namespace internal
+}  // namespace base
+
+#endif  // BASE_MESSAGE_LOOP_INCOMING_TASK_QUEUE_H_
@@ -0,0 +1,362 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/message_loop/message_loop.h"
+
+#include "base/bind.h"
+#include "base/debug/trace_event.h"
+#include "base/lazy_instance.h"
+#include "base/message_loop/incoming_task_queue.h"
+#include "base/message_loop/message_loop_proxy_impl.h"
+#include "base/threading/thread_local.h"
+#include "base/tracked_objects.h"
+
+namespace base {
+
+namespace {
+
+// A lazily created thread local storage for quick access to a thread's message
+// loop, if one exists.  This should be safe and free of static constructors.
+LazyInstance<ThreadLocalPointer<MessageLoop> >::Leaky lazy_tls_ptr =
+    LAZY_INSTANCE_INITIALIZER;
+
+void QuitCurrentWhenIdle() {
+  MessageLoop::current()->QuitWhenIdle();
+}
+
+}  // namespace
+
+//------------------------------------------------------------------------------
+
+MessageLoop::DestructionObserver::~DestructionObserver() {
+}
+
+MessageLoop::WakeupWatcher::WakeupWatcher(
+    internal::IncomingTaskQueue* incoming_queue)
+    : incoming_queue_(incoming_queue) {
+}
+
+void MessageLoop::WakeupWatcher::OnFileCanReadWithoutBlocking(int fd) {
+  // The tasks are reloaded by the next DoWork().
+  incoming_queue_->ClearWakeup();
+}
+
+void MessageLoop::WakeupWatcher::OnFileCanWriteWithoutBlocking(int fd) {
+  NOTREACHED();
+}
+
+//------------------------------------------------------------------------------
+
+MessageLoop::MessageLoop(Type type)
+    : type_(type),
+      next_sequence_num_(0),
+      run_depth_(0),
+      quit_when_idle_(false),
+      quit_now_(false),
+      pump_(new MessagePumpEpoll),
+      incoming_task_queue_(new internal::IncomingTaskQueue),
+      wakeup_watcher_(incoming_task_queue_.get()) {
+  DCHECK(!current()) << "should only have one message loop per thread";
+  lazy_tls_ptr.Pointer()->Set(this);
+
+  message_loop_proxy_ =
+      new internal::MessageLoopProxyImpl(incoming_task_queue_);
+  CHECK(pump_->WatchFileDescriptor(incoming_task_queue_->wakeup_fd(), true,
+                                   MessagePumpEpoll::WATCH_READ,
+                                   &wakeup_controller_, &wakeup_watcher_));
+}
+
+MessageLoop::~MessageLoop() {
+  DCHECK_EQ(this, current());
+  DCHECK(!run_depth_);
+
+  // Clean up any unprocessed tasks, but take care: deleting a task could
+  // result in the addition of more tasks (e.g., via DeleteSoon).  We set a
+  // limit on the number of times we will allow a deleted task to generate more
+  // tasks.  Normally, we should only pass through this loop once or twice.  If
+  // we end up hitting the loop limit, then it is probably due to one task that
+  // is being stubborn.  Inspect the queues to see who is left.
+  bool did_work;
+  for (int i = 0; i < 100; ++i) {
+    DeletePendingTasks();
+    incoming_task_queue_->ReloadWorkQueue(&work_queue_);
+    // If we end up with empty queues, then break out of the loop.
+    did_work = DeletePendingTasks();
+    if (!did_work)
+      break;
+  }
+  DCHECK(!did_work);
+
+  // Let interested parties have one last shot at accessing this.
+  FOR_EACH_OBSERVER(DestructionObserver, destruction_observers_,
+                    WillDestroyCurrentMessageLoop());
+
+  // Tell the incoming queue that we are dying.
+  wakeup_controller_.StopWatchingFileDescriptor();
+  incoming_task_queue_->WillDestroyCurrentMessageLoop();
+  incoming_task_queue_ = NULL;
+  message_loop_proxy_ = NULL;
+
+  // OK, now make it so that no one can find us.
+  lazy_tls_ptr.Pointer()->Set(NULL);
+}
+
+// static
+MessageLoop* MessageLoop::current() {
+  // TODO(darin): sadly, we cannot enable this yet since people call us even
+  // when they have no intention of using us.
+  // DCHECK(loop) << "Ouch, did you forget to initialize me?";
+  return lazy_tls_ptr.Pointer()->Get();
+}
+
+void MessageLoop::AddDestructionObserver(
+    DestructionObserver* destruction_observer) {
+  DCHECK_EQ(this, current());
+  destruction_observers_.AddObserver(destruction_observer);
+}
+
+void MessageLoop::RemoveDestructionObserver(
+    DestructionObserver* destruction_observer) {
+  DCHECK_EQ(this, current());
+  destruction_observers_.RemoveObserver(destruction_observer);
+}
+
+void MessageLoop::PostTask(
+    const tracked_objects::Location& from_here,
+    const Closure& task) {
+  DCHECK(!task.is_null()) << from_here.ToString();
+  incoming_task_queue_->AddToIncomingQueue(from_here, task, TimeDelta(), true);
+}
+
+void MessageLoop::PostDelayedTask(
+    const tracked_objects::Location& from_here,
+    const Closure& task,
+    TimeDelta delay) {
+  DCHECK(!task.is_null()) << from_here.ToString();
+  incoming_task_queue_->AddToIncomingQueue(from_here, task, delay, true);
+}
+
+void MessageLoop::PostNonNestableTask(
+    const tracked_objects::Location& from_here,
+    const Closure& task) {
+  DCHECK(!task.is_null()) << from_here.ToString();
+  incoming_task_queue_->AddToIncomingQueue(from_here, task, TimeDelta(),
+                                           false);
+}
+
+void MessageLoop::PostNonNestableDelayedTask(
+    const tracked_objects::Location& from_here,
+    const Closure& task,
+    TimeDelta delay) {
+  DCHECK(!task.is_null()) << from_here.ToString();
+  incoming_task_queue_->AddToIncomingQueue(from_here, task, delay, false);
+}
+
+void MessageLoop::Run() {
+  RunInternal(false);
+}
+
+void MessageLoop::RunUntilIdle() {
+  RunInternal(true);
+}
+
+void MessageLoop::QuitWhenIdle() {
+  DCHECK_EQ(this, current());
+  if (run_depth_) {
+    quit_when_idle_ = true;
+  } else {
+    NOTREACHED() << "Must be inside Run to call Quit";
+  }
+}
+
+void MessageLoop::QuitNow() {
+  DCHECK_EQ(this, current());
+  if (run_depth_) {
+    quit_now_ = true;
+    pump_->Quit();
+  } else {
+    NOTREACHED() << "Must be inside Run to call Quit";
+  }
+}
+
+// static
+Closure MessageLoop::QuitClosure() {
+  return Bind(&QuitCurrentWhenIdle);
+}
+
+//------------------------------------------------------------------------------
+
+void MessageLoop::RunInternal(bool quit_when_idle) {
+  DCHECK_EQ(this, current());
+
+  // The state of the enclosing Run(), if any, is restored on the way out.
+  const bool previous_quit_when_idle = quit_when_idle_;
+  const bool previous_quit_now = quit_now_;
+  quit_when_idle_ = quit_when_idle;
+  quit_now_ = false;
+  ++run_depth_;
+
+  pump_->Run(this);
+
+  --run_depth_;
+  quit_when_idle_ = previous_quit_when_idle;
+  quit_now_ = previous_quit_now;
+}
+
+bool MessageLoop::DeferOrRunPendingTask(const PendingTask& pending_task) {
+  if (pending_task.nestable || run_depth_ == 1) {
+    RunTask(pending_task);
+    return true;
+  }
+
+  // We couldn't run the task now because we're in a nested message loop
+  // and the task isn't nestable.
+  deferred_non_nestable_work_queue_.push(pending_task);
+  return false;
+}
+
+void MessageLoop::RunTask(const PendingTask& pending_task) {
+  tracked_objects::TrackedTime start_time =
+      tracked_objects::ThreadData::NowForStartOfRun(pending_task.birth_tally);
+
+  TRACE_EVENT2("task", "MessageLoop::RunTask",
+               "src_file", pending_task.posted_from.file_name(),
+               "src_func", pending_task.posted_from.function_name());
+
+  pending_task.task.Run();
+
+  tracked_objects::ThreadData::TallyRunOnNamedThreadIfTracking(pending_task,
+      start_time, tracked_objects::ThreadData::NowForEndOfRun());
+}
+
+void MessageLoop::AddToDelayedWorkQueue(const PendingTask& pending_task) {
+  // Move to the delayed work queue. The sequence number breaks ties between
+  // tasks due at the same time, keeping them in the order they were posted.
+  PendingTask new_pending_task(pending_task);
+  new_pending_task.sequence_num = next_sequence_num_++;
+  delayed_work_queue_.push(new_pending_task);
+}
+
+bool MessageLoop::DeletePendingTasks() {
+  bool did_work = !work_queue_.empty();
+  while (!work_queue_.empty()) {
+    PendingTask pending_task = work_queue_.front();
+    work_queue_.pop();
+    if (!pending_task.delayed_run_time.is_null()) {
+      // We want to delete delayed tasks in the same order in which they would
+      // normally be deleted in case of any funny dependencies between delayed
+      // tasks.
+      AddToDelayedWorkQueue(pending_task);
+    }
+  }
+  did_work |= !deferred_non_nestable_work_queue_.empty();
+  while (!deferred_non_nestable_work_queue_.empty())
+    deferred_non_nestable_work_queue_.pop();
+  did_work |= !delayed_work_queue_.empty();
+  while (!delayed_work_queue_.empty())
+    delayed_work_queue_.pop();
+  return did_work;
+}
+
+void MessageLoop::DeleteSoonInternal(const tracked_objects::Location& from_here,
+                                     void(*deleter)(const void*),
+                                     const void* object) {
+  PostNonNestableTask(from_here, Bind(deleter, object));
+}
+
+void MessageLoop::ReleaseSoonInternal(
+    const tracked_objects::Location& from_here,
+    void(*releaser)(const void*),
+    const void* object) {
+  PostNonNestableTask(from_here, Bind(releaser, object));
+}
+
+bool MessageLoop::DoWork() {
+  // Take the tasks posted since the queue was last drained, in one batch.
+  if (work_queue_.empty())
+    incoming_task_queue_->ReloadWorkQueue(&work_queue_);
+
+  bool did_work = false;
+  for (int i = 0; i < kMaxTasksPerBatch && !work_queue_.empty(); ++i) {
+    PendingTask pending_task = work_queue_.front();
+    work_queue_.pop();
+    if (!pending_task.delayed_run_time.is_null()) {
+      // DoDelayedWork(), which comes before the loop sleeps, arms the timer
+      // for it.
+      AddToDelayedWorkQueue(pending_task);
+      continue;
+    }
+    if (DeferOrRunPendingTask(pending_task))
+      did_work = true;
+    if (quit_now_)
+      break;
+  }
+  // Tasks left over from the batch are run without sleeping.
+  return did_work || !work_queue_.empty();
+}
+
+bool MessageLoop::DoDelayedWork(TimeTicks* next_delayed_work_time) {
+  if (delayed_work_queue_.empty()) {
+    recent_time_ = *next_delayed_work_time = TimeTicks();
+    return false;
+  }
+
+  // When we "fall behind," there will be a lot of tasks in the delayed work
+  // queue that are ready to run.  To increase efficiency when we fall behind,
+  // we will only call Time::Now() intermittently, and then process all tasks
+  // that are ready to run before calling it again.  As a result, the more we
+  // fall behind (and have a lot of ready-to-run delayed tasks), the more
+  // efficient we'll be at handling the tasks.
+  bool did_work = false;
+  for (int i = 0; i < kMaxTasksPerBatch && !delayed_work_queue_.empty();
+       ++i) {
+    TimeTicks next_run_time = delayed_work_queue_.top().delayed_run_time;
+    if (next_run_time > recent_time_) {
+      recent_time_ = TimeTicks::Now();  // Get a better view of Now();
+      if (next_run_time > recent_time_)
+        break;
+    }
+
+    PendingTask pending_task = delayed_work_queue_.top();
+    delayed_work_queue_.pop();
+    if (DeferOrRunPendingTask(pending_task))
+      did_work = true;
+    if (quit_now_)
+      break;
+  }
+
+  *next_delayed_work_time = delayed_work_queue_.empty() ?
+      TimeTicks() : delayed_work_queue_.top().delayed_run_time;
+  return did_work;
+}
+
+bool MessageLoop::DoIdleWork() {
+  // Now that we are outside of the nested loops, run the non-nestable tasks
+  // which they deferred.
+  if (run_depth_ == 1 && !deferred_non_nestable_work_queue_.empty()) {
+    PendingTask pending_task = deferred_non_nestable_work_queue_.front();
+    deferred_non_nestable_work_queue_.pop();
+    RunTask(pending_task);
+    return true;
+  }
+
+  if (quit_when_idle_)
+    pump_->Quit();
+
+  return false;
+}
+
+//------------------------------------------------------------------------------
+// MessageLoopForIO
+
+bool MessageLoopForIO::WatchFileDescriptor(int fd,
+                                           bool persistent,
+                                           Mode mode,
+                                           FileDescriptorWatcher* controller,
+                                           Watcher* delegate) {
+  return pump()->WatchFileDescriptor(fd, persistent, mode, controller,
+                                     delegate);
+}
+
+}  // namespace base
@@ -0,0 +1,331 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_MESSAGE_LOOP_MESSAGE_LOOP_H_
+#define BASE_MESSAGE_LOOP_MESSAGE_LOOP_H_
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/callback_forward.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/message_loop/message_loop_proxy.h"
+#include "base/message_loop/message_pump_epoll.h"
+#include "base/observer_list.h"
+#include "base/pending_task.h"
+#include "base/sequenced_task_runner_helpers.h"
+#include "base/time/time.h"
+
+namespace base {
+
+namespace internal {
+class IncomingTaskQueue;
+}  // namespace internal
+
+// A MessageLoop is used to process events for a particular thread.  There is
+// at most one MessageLoop instance per thread.
+//
+// Events include at a minimum Task instances submitted to PostTask and its
+// variants, and the file descriptors watched through MessageLoopForIO.
+// The loop sleeps in epoll_wait() until one of those is ready: tasks posted
+// from other threads wake it through an eventfd, and delayed tasks are kept
+// in a heap whose earliest entry a timerfd is armed for. See MessagePumpEpoll.
+//
+// Tasks are taken from the incoming queue in batches, and the loop checks
+// its file descriptors between batches, so neither starves the other.
+//
+// NOTE: Unless otherwise specified, a MessageLoop's methods may only be called
+// on the thread where the MessageLoop's Run method executes.
+//
+// NOTE: MessageLoop has task reentrancy protection.  This means that if a
+// task is being processed, a second task cannot start until the first task is
+// finished, unless the first task runs a nested loop with Run() or
+// RunUntilIdle(). Tasks posted with PostNonNestableTask are not run by a
+// nested loop; they wait until the outermost loop resumes.
+class BASE_EXPORT MessageLoop : public MessagePumpEpoll::Delegate {
+ public:
+  // A MessageLoop has a particular type, which indicates the set of
+  // asynchronous events it may process in addition to tasks and timers.
+  //
+  // TYPE_DEFAULT
+  //   This type of ML only supports tasks and timers.
+  //
+  // TYPE_IO
+  //   This type of ML also supports asynchronous IO, through
+  //   MessageLoopForIO.
+  //
+  // Both are run by the same epoll pump.
+  enum Type {
+    TYPE_DEFAULT,
+    TYPE_IO
+  };
+
+  // Normally, it is not necessary to instantiate a MessageLoop.  Instead, it
+  // is typical to make use of the current thread's MessageLoop instance.
+  explicit MessageLoop(Type type = TYPE_DEFAULT);
+  virtual ~MessageLoop();
+
+  // Returns the MessageLoop object for the current thread, or null if none.
+  static MessageLoop* current();
+
+  // A DestructionObserver is notified when the current MessageLoop is being
+  // destroyed.  These observers are notified prior to MessageLoop::current()
+  // being changed to return NULL.  This gives interested parties the chance to
+  // do final cleanup that depends on the MessageLoop.
+  //
+  // NOTE: Any tasks posted to the MessageLoop during this notification will
+  // not be run.  Instead, they will be deleted.
+  //
+  class BASE_EXPORT DestructionObserver {
+   public:
+    virtual void WillDestroyCurrentMessageLoop() = 0;
+
+   protected:
+    virtual ~DestructionObserver();
+  };
+
+  // Add a DestructionObserver, which will start receiving notifications
+  // immediately.
+  void AddDestructionObserver(DestructionObserver* destruction_observer);
+
+  // Remove a DestructionObserver.  It is safe to call this method while a
+  // DestructionObserver is receiving a notification callback.
+  void RemoveDestructionObserver(DestructionObserver* destruction_observer);
+
+  // The "PostTask" family of methods call the task's Run method asynchronously
+  // from within a message loop at some point in the future.
+  //
+  // With the PostTask variant, tasks are invoked in FIFO order, inter-mixed
+  // with normal UI or IO event processing.  With the PostDelayedTask variant,
+  // tasks are called after at least approximately 'delay_ms' have elapsed.
+  //
+  // The NonNestable variants work similarly except that they promise never to
+  // dispatch the task from a nested invocation of MessageLoop::Run.  Instead,
+  // such tasks get deferred until the top-most MessageLoop::Run is executing.
+  //
+  // The MessageLoop takes ownership of the Task, and deletes it after it has
+  // been Run().
+  //
+  // NOTE: These methods may be called on any thread.  The Task will be invoked
+  // on the thread that executes MessageLoop::Run().
+  void PostTask(const tracked_objects::Location& from_here,
+                const Closure& task);
+
+  void PostDelayedTask(const tracked_objects::Location& from_here,
+                       const Closure& task,
+                       TimeDelta delay);
+
+  void PostNonNestableTask(const tracked_objects::Location& from_here,
+                           const Closure& task);
+
+  void PostNonNestableDelayedTask(const tracked_objects::Location& from_here,
+                                  const Closure& task,
+                                  TimeDelta delay);
+
+  // A variant on PostTask that deletes the given object.  This is useful
+  // if the object needs to live until the next run of the MessageLoop (for
+  // example, deleting a RenderProcessHost from within an IPC callback is not
+  // good).
+  //
+  // NOTE: This method may be called on any thread.  The object will be deleted
+  // on the thread that executes MessageLoop::Run().  If this is not the same
+  // as the thread that calls PostDelayedTask(FROM_HERE, ), then T MUST inherit
+  // from RefCountedThreadSafe<T>!
+  template <class T>
+  void DeleteSoon(const tracked_objects::Location& from_here, const T* object) {
+    base::subtle::DeleteHelperInternal<T, void>::DeleteViaSequencedTaskRunner(
+        this, from_here, object);
+  }
+
+  // A variant on PostTask that releases the given reference counted object
+  // (by calling its Release method).  This is useful if the object needs to
+  // live until the next run of the MessageLoop, or if the object needs to be
+  // released on a particular thread.
+  //
+  // NOTE: This method may be called on any thread.  The object will be
+  // released (and thus possibly deleted) on the thread that executes
+  // MessageLoop::Run().  If this is not the same as the thread that calls
+  // PostDelayedTask(FROM_HERE, ), then T MUST inherit from
+  // RefCountedThreadSafe<T>!
+  template <class T>
+  void ReleaseSoon(const tracked_objects::Location& from_here,
+                   const T* object) {
+    base::subtle::ReleaseHelperInternal<T, void>::ReleaseViaSequencedTaskRunner(
+        this, from_here, object);
+  }
+
+  // Run the message loop until Quit() or QuitNow() is called. Run() may be
+  // called from a task to run a nested loop, which returns once it is quit.
+  void Run();
+
+  // Process all pending tasks and file descriptor events, but don't wait/sleep.
+  // Return as soon as all items that can be run are taken care of.
+  void RunUntilIdle();
+
+  // Makes the innermost Run() return once the tasks which are ready have
+  // run. Delayed tasks which aren't due don't keep it running.
+  void QuitWhenIdle();
+
+  // Deprecated: use QuitWhenIdle().
+  void Quit() { QuitWhenIdle(); }
+
+  // Makes the innermost Run() return after the current task, leaving the
+  // tasks which are ready for the next Run().
+  void QuitNow();
+
+  // Returns a closure which calls QuitWhenIdle() on the current thread's
+  // loop.
+  static Closure QuitClosure();
+
+  // Returns the type passed to the constructor.
+  Type type() const { return type_; }
+
+  // Gets the message loop proxy associated with this message loop.
+  scoped_refptr<MessageLoopProxy> message_loop_proxy() {
+    return message_loop_proxy_;
+  }
+
+  // Returns true if the message loop is in a Run() call, or nested ones.
+  bool is_running() const { return run_depth_ > 0; }
+
+ protected:
+  MessagePumpEpoll* pump() { return pump_.get(); }
+
+ private:
+  template <class T, class R> friend class base::subtle::DeleteHelperInternal;
+  template <class T, class R> friend class base::subtle::ReleaseHelperInternal;
+
+  // Wakes the loop when a task is posted from another thread.
+  class WakeupWatcher : public MessagePumpEpoll::Watcher {
+   public:
+    explicit WakeupWatcher(internal::IncomingTaskQueue* incoming_queue);
+
+    // MessagePumpEpoll::Watcher:
+    virtual void OnFileCanReadWithoutBlocking(int fd) OVERRIDE;
+    virtual void OnFileCanWriteWithoutBlocking(int fd) OVERRIDE;
+
+   private:
+    internal::IncomingTaskQueue* const incoming_queue_;
+  };
+
+  // The most tasks run by DoWork() or DoDelayedWork() before the loop checks
+  // its file descriptors.
+  static const int kMaxTasksPerBatch = 64;
+
+  // Runs the pump until the innermost Run() is quit, and quits it when idle
+  // if |quit_when_idle|.
+  void RunInternal(bool quit_when_idle);
+
+  // Runs |pending_task|, or defers it if it isn't nestable and the loop is
+  // nested. Returns true if it was run.
+  bool DeferOrRunPendingTask(const PendingTask& pending_task);
+
+  // Runs a task.
+  void RunTask(const PendingTask& pending_task);
+
+  // Adds a task to the heap of delayed tasks.
+  void AddToDelayedWorkQueue(const PendingTask& pending_task);
+
+  // Deletes the tasks which haven't run, returning true if there were any.
+  bool DeletePendingTasks();
+
+  void DeleteSoonInternal(const tracked_objects::Location& from_here,
+                          void(*deleter)(const void*),
+                          const void* object);
+  void ReleaseSoonInternal(const tracked_objects::Location& from_here,
+                           void(*releaser)(const void*),
+                           const void* object);
+
+  // MessagePumpEpoll::Delegate methods:
+  virtual bool DoWork() OVERRIDE;
+  virtual bool DoDelayedWork(TimeTicks* next_delayed_work_time) OVERRIDE;
+  virtual bool DoIdleWork() OVERRIDE;
+
+  const Type type_;
+
+  // A list of tasks that need to be processed by this instance.  Note that
+  // this queue is only accessed (push/pop) by our current thread.
+  TaskQueue work_queue_;
+
+  // Contains delayed tasks, sorted by their 'delayed_run_time' property.
+  DelayedTaskQueue delayed_work_queue_;
+
+  // A recent snapshot of Time::Now(), used to check delayed_work_queue_.
+  TimeTicks recent_time_;
+
+  // A queue of non-nestable tasks that we had to defer because when it came
+  // time to execute them we were in a nested message loop.  They will execute
+  // once we're out of nested message loops.
+  TaskQueue deferred_non_nestable_work_queue_;
+
+  // The sequence number given to the next delayed task, which orders tasks
+  // due at the same time.
+  int next_sequence_num_;
+
+  ObserverList<DestructionObserver> destruction_observers_;
+
+  // The depth of nested Run() calls, and whether the innermost quits when
+  // idle.
+  int run_depth_;
+  bool quit_when_idle_;
+  bool quit_now_;
+
+  scoped_ptr<MessagePumpEpoll> pump_;
+
+  scoped_refptr<internal::IncomingTaskQueue> incoming_task_queue_;
+  scoped_refptr<MessageLoopProxy> message_loop_proxy_;
+
+  WakeupWatcher wakeup_watcher_;
+  MessagePumpEpoll::FileDescriptorWatcher wakeup_controller_;
+
+  DISALLOW_COPY_AND_ASSIGN(MessageLoop);
+};
+
+//-----------------------------------------------------------------------------
+// MessageLoopForIO extends MessageLoop with methods that are particular to a
+// MessageLoop instantiated with TYPE_IO.
+//
+// This class is typically used like so:
+//   MessageLoopForIO::current()->...call some method...
+//
+class BASE_EXPORT MessageLoopForIO : public MessageLoop {
+ public:
+  typedef MessagePumpEpoll::Watcher Watcher;
+  typedef MessagePumpEpoll::FileDescriptorWatcher FileDescriptorWatcher;
+
+  enum Mode {
+    WATCH_READ = MessagePumpEpoll::WATCH_READ,
+    WATCH_WRITE = MessagePumpEpoll::WATCH_WRITE,
+    WATCH_READ_WRITE = MessagePumpEpoll::WATCH_READ_WRITE
+  };
+
+  MessageLoopForIO() : MessageLoop(TYPE_IO) {
+  }
+
+  // Returns the MessageLoopForIO of the current thread.
+  static MessageLoopForIO* current() {
+    MessageLoop* loop = MessageLoop::current();
+    DCHECK_EQ(MessageLoop::TYPE_IO, loop->type());
+    return static_cast<MessageLoopForIO*>(loop);
+  }
+
+  // Please see MessagePumpEpoll for definition.
+  bool WatchFileDescriptor(int fd,
+                           bool persistent,
+                           Mode mode,
+                           FileDescriptorWatcher* controller,
+                           Watcher* delegate);
+};
+
+// Do not add any member variables to MessageLoopForIO!  This is important b/c
+// MessageLoopForIO is often allocated via MessageLoop(TYPE_IO).  Any extra
+// data that you need should be stored on the MessageLoop's pump_ instance.
+COMPILE_ASSERT(sizeof(MessageLoop) == sizeof(MessageLoopForIO),
+               MessageLoopForIO_should_not_have_extra_member_variables);
+
+}  // namespace base
+
+#endif  // BASE_MESSAGE_LOOP_MESSAGE_LOOP_H_
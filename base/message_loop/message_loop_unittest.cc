@@ -0,0 +1,350 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/message_loop/message_loop.h"
+
+#include <unistd.h>
+
+#include <vector>
+
+#include "base/bind.h"
+#include "base/memory/ref_counted.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/simple_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+void RecordOrder(std::vector<int>* order, int id) {
+  order->push_back(id);
+}
+
+void Increment(int* counter) {
+  ++*counter;
+}
+
+void WriteByte(int fd) {
+  EXPECT_EQ(1, HANDLE_EINTR(write(fd, "x", 1)));
+}
+
+void QuitNowAfterRecording(std::vector<int>* order, int id) {
+  order->push_back(id);
+  MessageLoop::current()->QuitNow();
+}
+
+// Runs a nested loop, which must not run non-nestable tasks.
+void RunNestedLoop(std::vector<int>* order) {
+  order->push_back(1);
+  MessageLoop::current()->RunUntilIdle();
+  order->push_back(2);
+}
+
+class DeletedOnLoop {
+ public:
+  explicit DeletedOnLoop(bool* deleted) : deleted_(deleted) {}
+  ~DeletedOnLoop() { *deleted_ = true; }
+
+ private:
+  bool* deleted_;
+};
+
+void TakeDeletedOnLoop(DeletedOnLoop* object) {
+  ADD_FAILURE() << "Not run";
+}
+
+class Poster : public DelegateSimpleThread::Delegate {
+ public:
+  Poster(scoped_refptr<MessageLoopProxy> proxy, int* counter, int tasks)
+      : proxy_(proxy),
+        counter_(counter),
+        tasks_(tasks) {
+  }
+
+  virtual void Run() OVERRIDE {
+    for (int i = 0; i < tasks_; ++i)
+      proxy_->PostTask(FROM_HERE, Bind(&Increment, counter_));
+  }
+
+ private:
+  scoped_refptr<MessageLoopProxy> proxy_;
+  int* counter_;
+  const int tasks_;
+};
+
+class TestDestructionObserver : public MessageLoop::DestructionObserver {
+ public:
+  TestDestructionObserver() : destroyed_(false) {}
+
+  virtual void WillDestroyCurrentMessageLoop() OVERRIDE {
+    EXPECT_TRUE(MessageLoop::current());
+    destroyed_ = true;
+  }
+
+  bool destroyed() const { return destroyed_; }
+
+ private:
+  bool destroyed_;
+};
+
+// Reads a byte from the pipe each time it is readable, and quits after
+// |reads| of them.
+class PipeReader : public MessageLoopForIO::Watcher {
+ public:
+  PipeReader(MessageLoopForIO::FileDescriptorWatcher* controller, int reads)
+      : controller_(controller),
+        reads_left_(reads),
+        reads_(0),
+        delete_controller_(false) {
+  }
+
+  virtual void OnFileCanReadWithoutBlocking(int fd) OVERRIDE {
+    char byte;
+    EXPECT_EQ(1, HANDLE_EINTR(read(fd, &byte, 1)));
+    ++reads_;
+    if (--reads_left_ == 0) {
+      if (delete_controller_)
+        delete controller_;
+      else
+        controller_->StopWatchingFileDescriptor();
+      MessageLoop::current()->QuitWhenIdle();
+    }
+  }
+
+  virtual void OnFileCanWriteWithoutBlocking(int fd) OVERRIDE {
+    ADD_FAILURE() << "Not watched for writing";
+  }
+
+  int reads() const { return reads_; }
+  void set_delete_controller() { delete_controller_ = true; }
+
+ private:
+  MessageLoopForIO::FileDescriptorWatcher* controller_;
+  int reads_left_;
+  int reads_;
+  bool delete_controller_;
+};
+
+class MessageLoopPipeTest : public testing::Test {
+ protected:
+  virtual void SetUp() OVERRIDE {
+    ASSERT_EQ(0, pipe(fds_));
+  }
+
+  virtual void TearDown() OVERRIDE {
+    close(fds_[0]);
+    close(fds_[1]);
+  }
+
+  void WriteBytes(int count) {
+    for (int i = 0; i < count; ++i)
+      WriteByte(fds_[1]);
+  }
+
+  int fds_[2];
+};
+
+}  // namespace
+
+TEST(MessageLoopTest, PostTask) {
+  MessageLoop loop;
+  std::vector<int> order;
+  for (int i = 0; i < 200; ++i)
+    loop.PostTask(FROM_HERE, Bind(&RecordOrder, &order, i));
+  loop.RunUntilIdle();
+  ASSERT_EQ(200u, order.size());
+  for (int i = 0; i < 200; ++i)
+    EXPECT_EQ(i, order[i]);
+}
+
+TEST(MessageLoopTest, PostDelayedTask) {
+  MessageLoop loop;
+  std::vector<int> order;
+  const TimeTicks start = TimeTicks::Now();
+  loop.PostDelayedTask(FROM_HERE, Bind(&RecordOrder, &order, 3),
+                       TimeDelta::FromMilliseconds(30));
+  loop.PostDelayedTask(FROM_HERE, Bind(&RecordOrder, &order, 1),
+                       TimeDelta::FromMilliseconds(10));
+  loop.PostDelayedTask(FROM_HERE, Bind(&RecordOrder, &order, 2),
+                       TimeDelta::FromMilliseconds(10));
+  loop.PostTask(FROM_HERE, Bind(&RecordOrder, &order, 0));
+  loop.PostDelayedTask(FROM_HERE, MessageLoop::QuitClosure(),
+                       TimeDelta::FromMilliseconds(40));
+  loop.Run();
+
+  EXPECT_GE(TimeTicks::Now() - start, TimeDelta::FromMilliseconds(40));
+  ASSERT_EQ(4u, order.size());
+  for (int i = 0; i < 4; ++i)
+    EXPECT_EQ(i, order[i]);
+}
+
+TEST(MessageLoopTest, RunUntilIdleSkipsDelayedTasks) {
+  MessageLoop loop;
+  int counter = 0;
+  loop.PostDelayedTask(FROM_HERE, Bind(&Increment, &counter),
+                       TimeDelta::FromSeconds(100));
+  loop.PostTask(FROM_HERE, Bind(&Increment, &counter));
+  loop.RunUntilIdle();
+  EXPECT_EQ(1, counter);
+}
+
+TEST(MessageLoopTest, QuitNow) {
+  MessageLoop loop;
+  std::vector<int> order;
+  loop.PostTask(FROM_HERE, Bind(&QuitNowAfterRecording, &order, 0));
+  loop.PostTask(FROM_HERE, Bind(&RecordOrder, &order, 1));
+  loop.Run();
+  ASSERT_EQ(1u, order.size());
+
+  // The task left behind runs in the next Run().
+  loop.RunUntilIdle();
+  ASSERT_EQ(2u, order.size());
+  EXPECT_EQ(1, order[1]);
+}
+
+TEST(MessageLoopTest, NonNestableTaskDeferred) {
+  MessageLoop loop;
+  std::vector<int> order;
+  loop.PostTask(FROM_HERE, Bind(&RunNestedLoop, &order));
+  loop.PostNonNestableTask(FROM_HERE, Bind(&RecordOrder, &order, 3));
+  loop.PostTask(FROM_HERE, Bind(&RecordOrder, &order, 0));
+  loop.RunUntilIdle();
+
+  // The nestable task runs in the nested loop; the non-nestable one waits
+  // for it to return.
+  ASSERT_EQ(4u, order.size());
+  EXPECT_EQ(1, order[0]);
+  EXPECT_EQ(0, order[1]);
+  EXPECT_EQ(2, order[2]);
+  EXPECT_EQ(3, order[3]);
+}
+
+TEST(MessageLoopTest, PostFromOtherThreads) {
+  MessageLoop loop;
+  int counter = 0;
+  const int kThreads = 4;
+  const int kTasksPerThread = 10000;
+  Poster poster(loop.message_loop_proxy(), &counter, kTasksPerThread);
+  DelegateSimpleThreadPool pool("poster", kThreads);
+  pool.AddWork(&poster, kThreads);
+  pool.Start();
+
+  // The loop sleeps between the posts, and must be woken for each burst.
+  while (counter < kThreads * kTasksPerThread) {
+    loop.PostDelayedTask(FROM_HERE, MessageLoop::QuitClosure(),
+                         TimeDelta::FromMilliseconds(1));
+    loop.Run();
+  }
+  pool.JoinAll();
+  loop.RunUntilIdle();
+  EXPECT_EQ(kThreads * kTasksPerThread, counter);
+}
+
+TEST(MessageLoopTest, DeleteSoon) {
+  MessageLoop loop;
+  bool deleted = false;
+  loop.DeleteSoon(FROM_HERE, new DeletedOnLoop(&deleted));
+  EXPECT_FALSE(deleted);
+  loop.RunUntilIdle();
+  EXPECT_TRUE(deleted);
+}
+
+TEST(MessageLoopTest, DestructionDeletesPendingTasks) {
+  bool deleted = false;
+  TestDestructionObserver observer;
+  {
+    MessageLoop loop;
+    loop.AddDestructionObserver(&observer);
+    // The task owns the object, which is deleted with the task.
+    loop.PostTask(FROM_HERE, Bind(&TakeDeletedOnLoop,
+                                  Owned(new DeletedOnLoop(&deleted))));
+  }
+  EXPECT_TRUE(deleted);
+  EXPECT_TRUE(observer.destroyed());
+  EXPECT_FALSE(MessageLoop::current());
+}
+
+TEST(MessageLoopTest, ProxyOutlivesLoop) {
+  scoped_refptr<MessageLoopProxy> proxy;
+  int counter = 0;
+  {
+    MessageLoop loop;
+    proxy = MessageLoopProxy::current();
+    ASSERT_TRUE(proxy.get());
+    EXPECT_TRUE(proxy->BelongsToCurrentThread());
+    EXPECT_TRUE(proxy->PostTask(FROM_HERE, Bind(&Increment, &counter)));
+    loop.RunUntilIdle();
+    EXPECT_EQ(1, counter);
+  }
+  EXPECT_FALSE(proxy->PostTask(FROM_HERE, Bind(&Increment, &counter)));
+  EXPECT_EQ(1, counter);
+}
+
+TEST_F(MessageLoopPipeTest, WatchPersistent) {
+  MessageLoopForIO loop;
+  MessageLoopForIO::FileDescriptorWatcher controller;
+  PipeReader reader(&controller, 3);
+  ASSERT_TRUE(loop.WatchFileDescriptor(fds_[0], true,
+                                       MessageLoopForIO::WATCH_READ,
+                                       &controller, &reader));
+  WriteBytes(3);
+  loop.Run();
+  EXPECT_EQ(3, reader.reads());
+
+  // The watch was stopped.
+  WriteBytes(1);
+  loop.RunUntilIdle();
+  EXPECT_EQ(3, reader.reads());
+}
+
+TEST_F(MessageLoopPipeTest, WatchOnce) {
+  MessageLoopForIO loop;
+  MessageLoopForIO::FileDescriptorWatcher controller;
+  PipeReader reader(&controller, 2);
+  ASSERT_TRUE(loop.WatchFileDescriptor(fds_[0], false,
+                                       MessageLoopForIO::WATCH_READ,
+                                       &controller, &reader));
+  WriteBytes(2);
+  loop.RunUntilIdle();
+  EXPECT_EQ(1, reader.reads());
+
+  // It may watch again once called.
+  ASSERT_TRUE(loop.WatchFileDescriptor(fds_[0], false,
+                                       MessageLoopForIO::WATCH_READ,
+                                       &controller, &reader));
+  loop.Run();
+  EXPECT_EQ(2, reader.reads());
+}
+
+TEST_F(MessageLoopPipeTest, DeleteControllerFromWatcher) {
+  MessageLoopForIO loop;
+  MessageLoopForIO::FileDescriptorWatcher* controller =
+      new MessageLoopForIO::FileDescriptorWatcher;
+  PipeReader reader(controller, 1);
+  reader.set_delete_controller();
+  ASSERT_TRUE(loop.WatchFileDescriptor(fds_[0], true,
+                                       MessageLoopForIO::WATCH_READ,
+                                       controller, &reader));
+  WriteBytes(2);
+  loop.Run();
+  EXPECT_EQ(1, reader.reads());
+}
+
+TEST_F(MessageLoopPipeTest, SleepUntilReadable) {
+  MessageLoopForIO loop;
+  MessageLoopForIO::FileDescriptorWatcher controller;
+  PipeReader reader(&controller, 1);
+  ASSERT_TRUE(loop.WatchFileDescriptor(fds_[0], true,
+                                       MessageLoopForIO::WATCH_READ,
+                                       &controller, &reader));
+  // Nothing is ready: the loop sleeps in epoll_wait() until the write.
+  loop.PostDelayedTask(FROM_HERE, Bind(&WriteByte, fds_[1]),
+                       TimeDelta::FromMilliseconds(10));
+  loop.Run();
+  EXPECT_EQ(1, reader.reads());
+}
+
+}  // namespace base
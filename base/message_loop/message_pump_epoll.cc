@@ -0,0 +1,290 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/message_loop/message_pump_epoll.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "base/auto_reset.h"
+#include "base/logging.h"
+#include "base/posix/eintr_wrapper.h"
+
+namespace base {
+
+namespace {
+
+// The most events taken from epoll_wait() at once.
+const int kMaxEvents = 64;
+
+// The epoll data of |timer_fd_|. Watches have a generation of at least one.
+const uint64 kTimerData = 0;
+
+uint64 MakeEventData(uint32 slot, uint32 generation) {
+  return (static_cast<uint64>(generation) << 32) | slot;
+}
+
+uint32 EpollEvents(int mode) {
+  uint32 events = 0;
+  if (mode & MessagePumpEpoll::WATCH_READ)
+    events |= EPOLLIN;
+  if (mode & MessagePumpEpoll::WATCH_WRITE)
+    events |= EPOLLOUT;
+  return events;
+}
+
+}  // namespace
+
+MessagePumpEpoll::FileDescriptorWatcher::FileDescriptorWatcher()
+    : pump_(NULL),
+      fd_(-1),
+      mode_(0),
+      persistent_(false),
+      watcher_(NULL),
+      slot_(0),
+      was_destroyed_(NULL) {
+}
+
+MessagePumpEpoll::FileDescriptorWatcher::~FileDescriptorWatcher() {
+  StopWatchingFileDescriptor();
+  if (was_destroyed_) {
+    DCHECK(!*was_destroyed_);
+    *was_destroyed_ = true;
+  }
+}
+
+bool MessagePumpEpoll::FileDescriptorWatcher::StopWatchingFileDescriptor() {
+  if (!pump_)
+    return true;
+  return pump_->StopWatching(this);
+}
+
+MessagePumpEpoll::MessagePumpEpoll()
+    : epoll_fd_(epoll_create1(EPOLL_CLOEXEC)),
+      timer_fd_(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)),
+      keep_running_(true) {
+  PCHECK(epoll_fd_ >= 0) << "epoll_create1";
+  PCHECK(timer_fd_ >= 0) << "timerfd_create";
+  struct epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.u64 = kTimerData;
+  PCHECK(epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, timer_fd_, &event) == 0)
+      << "epoll_ctl";
+}
+
+MessagePumpEpoll::~MessagePumpEpoll() {
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    if (slots_[i].controller)
+      StopWatching(slots_[i].controller);
+  }
+  close(timer_fd_);
+  close(epoll_fd_);
+}
+
+bool MessagePumpEpoll::WatchFileDescriptor(int fd,
+                                           bool persistent,
+                                           int mode,
+                                           FileDescriptorWatcher* controller,
+                                           Watcher* delegate) {
+  DCHECK_GE(fd, 0);
+  DCHECK(controller);
+  DCHECK(delegate);
+  DCHECK(mode == WATCH_READ || mode == WATCH_WRITE ||
+         mode == WATCH_READ_WRITE);
+
+  struct epoll_event event = {};
+  if (controller->pump_ == this && controller->fd_ == fd) {
+    // Combine the modes of the watch under way.
+    DCHECK_EQ(persistent, controller->persistent_);
+    mode |= controller->mode_;
+    event.events = EpollEvents(mode);
+    event.data.u64 = MakeEventData(controller->slot_,
+                                   slots_[controller->slot_].generation);
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &event) != 0) {
+      DPLOG(ERROR) << "epoll_ctl";
+      return false;
+    }
+    controller->mode_ = mode;
+    controller->watcher_ = delegate;
+    return true;
+  }
+
+  if (!controller->StopWatchingFileDescriptor())
+    return false;
+
+  uint32 slot;
+  if (free_slots_.empty()) {
+    slot = static_cast<uint32>(slots_.size());
+    Slot new_slot = { NULL, 0 };
+    slots_.push_back(new_slot);
+  } else {
+    slot = free_slots_.back();
+    free_slots_.pop_back();
+  }
+  const uint32 generation = ++slots_[slot].generation;
+
+  event.events = EpollEvents(mode);
+  event.data.u64 = MakeEventData(slot, generation);
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) != 0) {
+    // EEXIST if another controller watches |fd|, and EPERM for regular files.
+    DPLOG(ERROR) << "epoll_ctl";
+    free_slots_.push_back(slot);
+    return false;
+  }
+
+  slots_[slot].controller = controller;
+  controller->pump_ = this;
+  controller->fd_ = fd;
+  controller->mode_ = mode;
+  controller->persistent_ = persistent;
+  controller->watcher_ = delegate;
+  controller->slot_ = slot;
+  return true;
+}
+
+void MessagePumpEpoll::Run(Delegate* delegate) {
+  AutoReset<bool> auto_reset_keep_running(&keep_running_, true);
+
+  for (;;) {
+    bool did_work = delegate->DoWork();
+    if (!keep_running_)
+      break;
+
+    // Dispatch the descriptors which are ready between batches of tasks, so
+    // that a busy loop doesn't starve them.
+    did_work |= ProcessEvents(0);
+    if (!keep_running_)
+      break;
+
+    did_work |= delegate->DoDelayedWork(&delayed_work_time_);
+    if (!keep_running_)
+      break;
+
+    if (did_work)
+      continue;
+
+    did_work = delegate->DoIdleWork();
+    if (!keep_running_)
+      break;
+
+    if (did_work)
+      continue;
+
+    // Sleep until a descriptor is ready, a task is posted, or the timer for
+    // the next delayed task fires.
+    UpdateTimer();
+    ProcessEvents(-1);
+  }
+}
+
+void MessagePumpEpoll::Quit() {
+  DCHECK(keep_running_) << "Quit was called outside of Run!";
+  // Tell both the epoll loop and Run that they should break out of their
+  // loops.
+  keep_running_ = false;
+}
+
+bool MessagePumpEpoll::ProcessEvents(int timeout_ms) {
+  struct epoll_event events[kMaxEvents];
+  const int count = HANDLE_EINTR(epoll_wait(epoll_fd_, events, kMaxEvents,
+                                            timeout_ms));
+  if (count < 0) {
+    DPLOG(ERROR) << "epoll_wait";
+    return false;
+  }
+
+  for (int i = 0; i < count; ++i) {
+    const uint64 data = events[i].data.u64;
+    if (data == kTimerData) {
+      // Consume the expiration. The delayed tasks are run by DoDelayedWork(),
+      // which comes next.
+      uint64_t expirations;
+      if (HANDLE_EINTR(read(timer_fd_, &expirations,
+                            sizeof(expirations))) < 0 &&
+          errno != EAGAIN) {
+        DPLOG(ERROR) << "read";
+      }
+      timer_time_ = TimeTicks();
+      continue;
+    }
+
+    // Drop the events of watches stopped by an earlier watcher.
+    const uint32 slot = static_cast<uint32>(data);
+    const uint32 generation = static_cast<uint32>(data >> 32);
+    if (slot >= slots_.size() || slots_[slot].generation != generation ||
+        !slots_[slot].controller) {
+      continue;
+    }
+    OnFileDescriptorEvent(slots_[slot].controller, events[i].events);
+    if (!keep_running_)
+      break;
+  }
+  return count > 0;
+}
+
+void MessagePumpEpoll::OnFileDescriptorEvent(
+    FileDescriptorWatcher* controller,
+    uint32 events) {
+  const int fd = controller->fd_;
+  Watcher* watcher = controller->watcher_;
+  // Errors and hang-ups are reported to the watcher as readiness, so that its
+  // read or write fails and tells it what happened.
+  const bool error = (events & (EPOLLERR | EPOLLHUP)) != 0;
+  const bool can_read = (controller->mode_ & WATCH_READ) &&
+                        (error || (events & EPOLLIN));
+  const bool can_write = (controller->mode_ & WATCH_WRITE) &&
+                         (error || (events & EPOLLOUT));
+  if (!controller->persistent_)
+    StopWatching(controller);
+
+  bool controller_was_destroyed = false;
+  controller->was_destroyed_ = &controller_was_destroyed;
+  if (can_write)
+    watcher->OnFileCanWriteWithoutBlocking(fd);
+  // The write callback may have destroyed the controller, or stopped it.
+  if (can_read && !controller_was_destroyed &&
+      (!controller->persistent_ || controller->pump_)) {
+    watcher->OnFileCanReadWithoutBlocking(fd);
+  }
+  if (!controller_was_destroyed)
+    controller->was_destroyed_ = NULL;
+}
+
+void MessagePumpEpoll::UpdateTimer() {
+  if (delayed_work_time_ == timer_time_)
+    return;
+  struct itimerspec spec = {};
+  if (!delayed_work_time_.is_null()) {
+    // TimeTicks are CLOCK_MONOTONIC microseconds.
+    const int64 microseconds = delayed_work_time_.ToInternalValue();
+    spec.it_value.tv_sec = microseconds / Time::kMicrosecondsPerSecond;
+    spec.it_value.tv_nsec = (microseconds % Time::kMicrosecondsPerSecond) *
+                            Time::kNanosecondsPerMicrosecond;
+  }
+  // A zero |spec| disarms the timer. One in the past fires at once.
+  if (timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, NULL) != 0) {
+    DPLOG(ERROR) << "timerfd_settime";
+    return;
+  }
+  timer_time_ = delayed_work_time_;
+}
+
+bool MessagePumpEpoll::StopWatching(FileDescriptorWatcher* controller) {
+  DCHECK_EQ(this, controller->pump_);
+  slots_[controller->slot_].controller = NULL;
+  free_slots_.push_back(controller->slot_);
+  controller->pump_ = NULL;
+  // The descriptor may have been closed already, which removes it.
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, controller->fd_, NULL) != 0 &&
+      errno != EBADF) {
+    DPLOG(ERROR) << "epoll_ctl";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace base
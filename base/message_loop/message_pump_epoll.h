@@ -0,0 +1,161 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_MESSAGE_LOOP_MESSAGE_PUMP_EPOLL_H_
+#define BASE_MESSAGE_LOOP_MESSAGE_PUMP_EPOLL_H_
+
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/time/time.h"
+
+namespace base {
+
+// The message pump of MessageLoop on Linux. It sleeps in epoll_wait() on the
+// file descriptors watched, and on a timerfd armed for the next delayed
+// task, so a loop handles both I/O and timers without a thread of its own
+// for either. Tasks posted from other threads wake it through a descriptor
+// watched like any other; see IncomingTaskQueue.
+//
+// The descriptors are level triggered: a watcher which doesn't read all
+// there is to read is called again on the next iteration.
+class BASE_EXPORT MessagePumpEpoll {
+ public:
+  // The work the pump runs between waits.
+  class BASE_EXPORT Delegate {
+   public:
+    virtual ~Delegate() {}
+
+    // Called from within Run() to run the tasks which are ready. Returns true
+    // if there may be more work, in which case the pump doesn't sleep.
+    virtual bool DoWork() = 0;
+
+    // Called from within Run() to run the delayed tasks which are due, and
+    // sets |next_delayed_work_time| to when the next is due, or to null if
+    // there is none. Returns true if there may be more work.
+    virtual bool DoDelayedWork(TimeTicks* next_delayed_work_time) = 0;
+
+    // Called from within Run() before the pump sleeps. Returns true to be
+    // called back without sleeping.
+    virtual bool DoIdleWork() = 0;
+  };
+
+  // Used with WatchFileDescriptor to asynchronously monitor the I/O readiness
+  // of a file descriptor.
+  class BASE_EXPORT Watcher {
+   public:
+    // Called from MessageLoop::Run when an FD can be read from/written to
+    // without blocking
+    virtual void OnFileCanReadWithoutBlocking(int fd) = 0;
+    virtual void OnFileCanWriteWithoutBlocking(int fd) = 0;
+
+   protected:
+    virtual ~Watcher() {}
+  };
+
+  // Object returned by WatchFileDescriptor to manage further watching.
+  class BASE_EXPORT FileDescriptorWatcher {
+   public:
+    FileDescriptorWatcher();
+    ~FileDescriptorWatcher();  // Implicitly calls StopWatchingFileDescriptor.
+
+    // Stops watching the file descriptor. May be called from the watcher,
+    // and on a watcher which isn't watching. Returns false on error.
+    bool StopWatchingFileDescriptor();
+
+   private:
+    friend class MessagePumpEpoll;
+
+    MessagePumpEpoll* pump_;
+    int fd_;
+    int mode_;
+    bool persistent_;
+    Watcher* watcher_;
+    // The index of the pump's slot which the epoll events refer to.
+    uint32 slot_;
+    // Points to a flag of the dispatch under way, set if this is destroyed
+    // by the watcher.
+    bool* was_destroyed_;
+
+    DISALLOW_COPY_AND_ASSIGN(FileDescriptorWatcher);
+  };
+
+  enum Mode {
+    WATCH_READ = 1 << 0,
+    WATCH_WRITE = 1 << 1,
+    WATCH_READ_WRITE = WATCH_READ | WATCH_WRITE
+  };
+
+  MessagePumpEpoll();
+
+  // Stops the watches still registered; their watchers are not called again.
+  ~MessagePumpEpoll();
+
+  // Have the current thread's message loop watch for a situation in which
+  // reading/writing to the FD can be performed without blocking.
+  // Callers must provide a preallocated FileDescriptorWatcher object which
+  // can later be used to manage the lifetime of this event.
+  // If a FileDescriptorWatcher is passed in which is already attached to
+  // |fd|, the modes are combined. A descriptor may be watched by one
+  // FileDescriptorWatcher at a time, and regular files, which are always
+  // ready, can't be watched.
+  // If |persistent| is false, the watch is stopped once the watcher has been
+  // called.
+  // Returns true on success.
+  // Must be called on the same thread the message_pump is running on.
+  bool WatchFileDescriptor(int fd,
+                           bool persistent,
+                           int mode,
+                           FileDescriptorWatcher* controller,
+                           Watcher* delegate);
+
+  // Runs |delegate|'s work and dispatches the watched descriptors until
+  // Quit() is called. May be nested.
+  void Run(Delegate* delegate);
+
+  // Makes the innermost Run() return once the work under way is done.
+  void Quit();
+
+ private:
+  // A watch registered with epoll. Its events carry the slot's index and
+  // generation, so that events for a watch stopped while they were pending
+  // are told from those of a later watch in the same slot, and dropped.
+  struct Slot {
+    FileDescriptorWatcher* controller;
+    uint32 generation;
+  };
+
+  // Waits up to |timeout_ms| for descriptors to be ready, or not at all if
+  // zero, and dispatches them. Returns true if any were.
+  bool ProcessEvents(int timeout_ms);
+
+  // Calls the watcher of |controller| for |events|.
+  void OnFileDescriptorEvent(FileDescriptorWatcher* controller,
+                             uint32 events);
+
+  // Arms the timerfd for |delayed_work_time_|, unless it already is.
+  void UpdateTimer();
+
+  bool StopWatching(FileDescriptorWatcher* controller);
+
+  int epoll_fd_;
+  int timer_fd_;
+
+  std::vector<Slot> slots_;
+  std::vector<uint32> free_slots_;
+
+  // When the next delayed task is due, and when |timer_fd_| fires.
+  TimeTicks delayed_work_time_;
+  TimeTicks timer_time_;
+
+  // Cleared by Quit() to leave the innermost Run().
+  bool keep_running_;
+
+  DISALLOW_COPY_AND_ASSIGN(MessagePumpEpoll);
+};
+
+}  // namespace base
+
+#endif  // BASE_MESSAGE_LOOP_MESSAGE_PUMP_EPOLL_H_
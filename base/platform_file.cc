@@ -4,6 +4,10 @@
 
 #include "base/platform_file.h"
 
+#include <algorithm>
+
+#include "base/memory/aligned_memory.h"
+
 namespace base {
 
 PlatformFileInfo::PlatformFileInfo()
@@ -14,6 +18,14 @@ PlatformFileInfo::PlatformFileInfo()
 
 PlatformFileInfo::~PlatformFileInfo() {}
 
+char* AllocatePlatformFileDirectIOBuffer(size_t size) {
+  const size_t mask = kPlatformFileDirectIOAlignment - 1;
+  size = std::max<size_t>((size + mask) & ~mask,
+                          kPlatformFileDirectIOAlignment);
+  return static_cast<char*>(AlignedAlloc(size,
+                                         kPlatformFileDirectIOAlignment));
+}
+
 #if !defined(OS_NACL)
 PlatformFile CreatePlatformFile(const FilePath& name,
                                 int flags,
@@ -8,6 +8,8 @@
 #include "build/build_config.h"
 #if defined(OS_WIN)
 #include <windows.h>
+#elif defined(OS_POSIX)
+#include <sys/uio.h>
 #endif
 
 #include <string>
@@ -52,8 +54,17 @@ enum PlatformFileFlags {
   PLATFORM_FILE_BACKUP_SEMANTICS = 1 << 18,  // Used on Windows only
 
   PLATFORM_FILE_EXECUTE = 1 << 19,           // Used on Windows only
+
+  // Bypasses the page cache (O_DIRECT, F_NOCACHE on Mac). Offsets, sizes and
+  // buffer addresses must be multiples of kPlatformFileDirectIOAlignment;
+  // see AllocatePlatformFileDirectIOBuffer().
+  PLATFORM_FILE_DIRECT_IO = 1 << 20,
 };
 
+// The alignment of offsets, sizes and buffers for PLATFORM_FILE_DIRECT_IO,
+// which covers the logical block size of common devices.
+const size_t kPlatformFileDirectIOAlignment = 4096;
+
 // PLATFORM_FILE_ERROR_ACCESS_DENIED is returned when a call fails because of
 // a filesystem restriction. PLATFORM_FILE_ERROR_SECURITY is returned when a
 // browser policy doesn't allow the operation to be executed.
@@ -211,6 +222,56 @@ BASE_EXPORT bool TouchPlatformFile(PlatformFile file,
 // Returns some information for the given file.
 BASE_EXPORT bool GetPlatformFileInfo(PlatformFile file, PlatformFileInfo* info);
 
+// Returns a buffer for PLATFORM_FILE_DIRECT_IO of at least |size| bytes,
+// rounded up to a multiple of kPlatformFileDirectIOAlignment. Free it with
+// AlignedFree(), or hold it in a scoped_ptr_malloc with ScopedPtrAlignedFree.
+BASE_EXPORT char* AllocatePlatformFileDirectIOBuffer(size_t size);
+
+#if defined(OS_POSIX)
+// Reads into the |count| buffers of |iov| starting at the given offset, until
+// they are full or EOF is reached. Returns the number of bytes read, or -1 on
+// error. Like ReadPlatformFile() this makes a best effort to read all data, in
+// as few preadv() calls as possible, and the sizes are not limited to int.
+BASE_EXPORT int64 ReadPlatformFileV(PlatformFile file, int64 offset,
+                                    const struct iovec* iov, int count);
+
+// Writes the |count| buffers of |iov| into the file at the given offset.
+// Returns the number of bytes written, or -1 on error. Makes a best effort to
+// write all data, and ignores the offset if the file was opened with
+// PLATFORM_FILE_APPEND.
+BASE_EXPORT int64 WritePlatformFileV(PlatformFile file, int64 offset,
+                                     const struct iovec* iov, int count);
+
+// How a range of a file is about to be accessed, for AdvisePlatformFile().
+enum PlatformFileAccessHint {
+  PLATFORM_FILE_ACCESS_NORMAL,
+  PLATFORM_FILE_ACCESS_SEQUENTIAL,  // Read ahead aggressively.
+  PLATFORM_FILE_ACCESS_RANDOM,      // Do not read ahead.
+  PLATFORM_FILE_ACCESS_WILL_NEED,   // Start reading into the page cache.
+  PLATFORM_FILE_ACCESS_DONT_NEED,   // Drop the cached pages.
+};
+
+// Advises the kernel how |length| bytes from |offset| will be accessed, or to
+// the end of the file if |length| is 0 (posix_fadvise()). Hints the platform
+// has no equivalent for are ignored. Returns false on error.
+BASE_EXPORT bool AdvisePlatformFile(PlatformFile file, int64 offset,
+                                    int64 length,
+                                    PlatformFileAccessHint hint);
+
+// Starts reading |length| bytes from |offset| into the page cache, so that
+// reading them later does not wait on the disk (readahead() on Linux). Returns
+// false on error.
+BASE_EXPORT bool ReadAheadPlatformFile(PlatformFile file, int64 offset,
+                                       int64 length);
+
+// Allocates disk space for |length| bytes from |offset|, so that writing them
+// will not fail for lack of space nor fragment the file (fallocate()). The
+// file is extended to cover the range, unless |keep_size|. Returns false if
+// the file system cannot preallocate, or on error.
+BASE_EXPORT bool PreallocatePlatformFile(PlatformFile file, int64 offset,
+                                         int64 length, bool keep_size);
+#endif  // defined(OS_POSIX)
+
 // Use this class to pass ownership of a PlatformFile to a receiver that may or
 // may not want to accept it.  This class does not own the storage for the
 // PlatformFile.
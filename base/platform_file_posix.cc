@@ -6,9 +6,12 @@
 
 #include <fcntl.h>
 #include <errno.h>
+#include <limits.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
+
 #include "base/files/file_path.h"
 #include "base/logging.h"
 #include "base/posix/eintr_wrapper.h"
@@ -51,6 +54,23 @@ static int DoPwrite(PlatformFile file, const char* data, int size,
   return HANDLE_EINTR(pwrite(file, data, size, offset));
 }
 
+#if defined(OS_LINUX)
+static ssize_t DoPreadv(PlatformFile file, const struct iovec* iov, int count,
+                        int64 offset) {
+  return HANDLE_EINTR(preadv(file, iov, count, offset));
+}
+
+static ssize_t DoPwritev(PlatformFile file, const struct iovec* iov,
+                         int count, int64 offset) {
+  return HANDLE_EINTR(pwritev(file, iov, count, offset));
+}
+
+static ssize_t DoWritev(PlatformFile file, const struct iovec* iov,
+                        int count) {
+  return HANDLE_EINTR(writev(file, iov, count));
+}
+#endif  // defined(OS_LINUX)
+
 static bool IsOpenAppend(PlatformFile file) {
   return (fcntl(file, F_GETFL) & O_APPEND) != 0;
 }
@@ -115,6 +135,96 @@ static int CallFutimes(PlatformFile file, const struct timeval times[2]) {
 }
 #endif  // defined(OS_NACL)
 
+#if !defined(OS_LINUX)
+// preadv() and pwritev() are missing or recent elsewhere, so transfer one
+// buffer at a time, up to the first short transfer.
+static ssize_t DoTransferEach(PlatformFile file, const struct iovec* iov,
+                              int count, int64 offset, bool write) {
+  ssize_t transferred = 0;
+  for (int i = 0; i < count; ++i) {
+    char* data = static_cast<char*>(iov[i].iov_base);
+    int size = static_cast<int>(std::min<size_t>(iov[i].iov_len, INT_MAX));
+    int rv = write ? DoPwrite(file, data, size, offset + transferred)
+                   : DoPread(file, data, size, offset + transferred);
+    if (rv < 0)
+      return transferred ? transferred : rv;
+    transferred += rv;
+    if (static_cast<size_t>(rv) < iov[i].iov_len)
+      break;
+  }
+  return transferred;
+}
+
+static ssize_t DoPreadv(PlatformFile file, const struct iovec* iov, int count,
+                        int64 offset) {
+  return DoTransferEach(file, iov, count, offset, false);
+}
+
+static ssize_t DoPwritev(PlatformFile file, const struct iovec* iov,
+                         int count, int64 offset) {
+  return DoTransferEach(file, iov, count, offset, true);
+}
+
+static ssize_t DoWritev(PlatformFile file, const struct iovec* iov,
+                        int count) {
+  return HANDLE_EINTR(writev(file, iov, count));
+}
+#endif  // !defined(OS_LINUX)
+
+enum VectorTransfer {
+  VECTOR_READ,
+  VECTOR_WRITE,
+  VECTOR_APPEND,
+};
+
+// Makes a best effort to transfer all the buffers of |iov|, resuming after
+// short transfers.
+int64 TransferPlatformFileV(PlatformFile file, int64 offset,
+                            const struct iovec* iov, int count,
+                            VectorTransfer transfer) {
+  if (file < 0 || count < 0)
+    return -1;
+
+  // The number of bytes of iov[index] already transferred.
+  size_t skip = 0;
+  int index = 0;
+  int64 total = 0;
+  ssize_t rv = 0;
+  while (index < count) {
+    struct iovec partial;
+    const struct iovec* batch = iov + index;
+    int batch_count = std::min(count - index, IOV_MAX);
+    if (skip) {
+      partial.iov_base = static_cast<char*>(iov[index].iov_base) + skip;
+      partial.iov_len = iov[index].iov_len - skip;
+      batch = &partial;
+      batch_count = 1;
+    }
+    switch (transfer) {
+      case VECTOR_READ:
+        rv = DoPreadv(file, batch, batch_count, offset + total);
+        break;
+      case VECTOR_WRITE:
+        rv = DoPwritev(file, batch, batch_count, offset + total);
+        break;
+      case VECTOR_APPEND:
+        rv = DoWritev(file, batch, batch_count);
+        break;
+    }
+    if (rv <= 0)
+      break;
+
+    total += rv;
+    skip += rv;
+    while (index < count && skip >= iov[index].iov_len) {
+      skip -= iov[index].iov_len;
+      ++index;
+    }
+  }
+
+  return total ? total : rv;
+}
+
 }  // namespace
 
 // NaCl doesn't implement system calls to open files directly.
@@ -165,6 +275,11 @@ PlatformFile CreatePlatformFileUnsafe(const FilePath& name,
   if (flags & PLATFORM_FILE_TERMINAL_DEVICE)
     open_flags |= O_NOCTTY | O_NDELAY;
 
+#if defined(O_DIRECT)
+  if (flags & PLATFORM_FILE_DIRECT_IO)
+    open_flags |= O_DIRECT;
+#endif
+
   if (flags & PLATFORM_FILE_APPEND && flags & PLATFORM_FILE_READ)
     open_flags |= O_APPEND | O_RDWR;
   else if (flags & PLATFORM_FILE_APPEND)
@@ -202,6 +317,13 @@ PlatformFile CreatePlatformFileUnsafe(const FilePath& name,
     unlink(name.value().c_str());
   }
 
+#if defined(OS_MACOSX)
+  if ((descriptor >= 0) && (flags & PLATFORM_FILE_DIRECT_IO) &&
+      fcntl(descriptor, F_NOCACHE, 1) < 0) {
+    DPLOG(WARNING) << "fcntl F_NOCACHE";
+  }
+#endif
+
   if (error) {
     if (descriptor >= 0)
       *error = PLATFORM_FILE_OK;
@@ -330,6 +452,120 @@ int WritePlatformFileCurPosNoBestEffort(PlatformFile file,
   return HANDLE_EINTR(write(file, data, size));
 }
 
+int64 ReadPlatformFileV(PlatformFile file, int64 offset,
+                        const struct iovec* iov, int count) {
+  return TransferPlatformFileV(file, offset, iov, count, VECTOR_READ);
+}
+
+int64 WritePlatformFileV(PlatformFile file, int64 offset,
+                         const struct iovec* iov, int count) {
+  if (file < 0)
+    return -1;
+
+  return TransferPlatformFileV(
+      file, offset, iov, count,
+      IsOpenAppend(file) ? VECTOR_APPEND : VECTOR_WRITE);
+}
+
+bool AdvisePlatformFile(PlatformFile file, int64 offset, int64 length,
+                        PlatformFileAccessHint hint) {
+  if (file < 0 || offset < 0 || length < 0)
+    return false;
+
+#if defined(OS_LINUX)
+  int advice = POSIX_FADV_NORMAL;
+  switch (hint) {
+    case PLATFORM_FILE_ACCESS_NORMAL:
+      advice = POSIX_FADV_NORMAL;
+      break;
+    case PLATFORM_FILE_ACCESS_SEQUENTIAL:
+      advice = POSIX_FADV_SEQUENTIAL;
+      break;
+    case PLATFORM_FILE_ACCESS_RANDOM:
+      advice = POSIX_FADV_RANDOM;
+      break;
+    case PLATFORM_FILE_ACCESS_WILL_NEED:
+      advice = POSIX_FADV_WILLNEED;
+      break;
+    case PLATFORM_FILE_ACCESS_DONT_NEED:
+      advice = POSIX_FADV_DONTNEED;
+      break;
+  }
+  // Returns the error rather than setting errno.
+  return !posix_fadvise(file, offset, length, advice);
+#elif defined(OS_MACOSX)
+  switch (hint) {
+    case PLATFORM_FILE_ACCESS_NORMAL:
+    case PLATFORM_FILE_ACCESS_SEQUENTIAL:
+      return fcntl(file, F_RDAHEAD, 1) != -1;
+    case PLATFORM_FILE_ACCESS_RANDOM:
+      return fcntl(file, F_RDAHEAD, 0) != -1;
+    case PLATFORM_FILE_ACCESS_WILL_NEED:
+      return ReadAheadPlatformFile(file, offset, length);
+    case PLATFORM_FILE_ACCESS_DONT_NEED:
+      break;
+  }
+  return true;
+#else
+  return true;
+#endif
+}
+
+bool ReadAheadPlatformFile(PlatformFile file, int64 offset, int64 length) {
+  if (file < 0 || offset < 0 || length < 0)
+    return false;
+
+#if defined(OS_LINUX)
+  return HANDLE_EINTR(readahead(file, offset, length)) == 0;
+#elif defined(OS_MACOSX)
+  struct radvisory advisory;
+  advisory.ra_offset = offset;
+  advisory.ra_count = static_cast<int>(std::min<int64>(length, INT_MAX));
+  return fcntl(file, F_RDADVISE, &advisory) != -1;
+#else
+  return true;
+#endif
+}
+
+bool PreallocatePlatformFile(PlatformFile file, int64 offset, int64 length,
+                             bool keep_size) {
+  if (file < 0 || offset < 0 || length <= 0)
+    return false;
+
+#if defined(OS_LINUX)
+  if (!HANDLE_EINTR(fallocate(file, keep_size ? FALLOC_FL_KEEP_SIZE : 0,
+                              offset, length))) {
+    return true;
+  }
+  // Without fallocate() support, posix_fallocate() writes zeros, which
+  // extends the file.
+  if (errno != EOPNOTSUPP || keep_size)
+    return false;
+  return !posix_fallocate(file, offset, length);
+#elif defined(OS_MACOSX)
+  stat_wrapper_t file_info;
+  if (CallFstat(file, &file_info))
+    return false;
+  const int64 end = offset + length;
+  if (end > file_info.st_size) {
+    // Allocates beyond the physical end of the file, contiguously if
+    // possible.
+    fstore_t store = { F_ALLOCATECONTIG | F_ALLOCATEALL, F_PEOFPOSMODE, 0,
+                       end - file_info.st_size, 0 };
+    if (fcntl(file, F_PREALLOCATE, &store) == -1) {
+      store.fst_flags = F_ALLOCATEALL;
+      if (fcntl(file, F_PREALLOCATE, &store) == -1)
+        return false;
+    }
+    if (!keep_size)
+      return !CallFtruncate(file, end);
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
 bool TruncatePlatformFile(PlatformFile file, int64 length) {
   return ((file >= 0) && !CallFtruncate(file, length));
 }
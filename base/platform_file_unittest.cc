@@ -2,8 +2,16 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
 #include "base/file_util.h"
 #include "base/files/scoped_temp_dir.h"
+#include "base/memory/aligned_memory.h"
+#include "base/memory/scoped_ptr.h"
 #include "base/platform_file.h"
 #include "base/time/time.h"
 #include "testing/gtest/include/gtest/gtest.h"
@@ -398,3 +406,157 @@ TEST(PlatformFile, DISABLED_TouchGetInfoPlatformFile) {
   // Close the file handle to allow the temp directory to be deleted.
   base::ClosePlatformFile(file);
 }
+
+TEST(PlatformFile, DirectIOPlatformFile) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  FilePath file_path = temp_dir.path().AppendASCII("direct_file");
+  base::PlatformFileError error;
+  base::PlatformFile file = base::CreatePlatformFile(
+      file_path,
+      base::PLATFORM_FILE_CREATE | base::PLATFORM_FILE_READ |
+          base::PLATFORM_FILE_WRITE | base::PLATFORM_FILE_DIRECT_IO,
+      NULL,
+      &error);
+  if (file == base::kInvalidPlatformFileValue) {
+    // Some file systems, like tmpfs on older kernels, refuse direct I/O.
+    LOG(WARNING) << "Direct I/O is not supported: " << error;
+    return;
+  }
+
+  const int kSize = 3 * base::kPlatformFileDirectIOAlignment;
+  scoped_ptr_malloc<char, base::ScopedPtrAlignedFree> buffer(
+      base::AllocatePlatformFileDirectIOBuffer(kSize - 10));
+  ASSERT_TRUE(buffer.get());
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(buffer.get()) %
+                    base::kPlatformFileDirectIOAlignment);
+  for (int i = 0; i < kSize; i++)
+    buffer.get()[i] = static_cast<char>(i);
+  EXPECT_EQ(kSize, WriteFully(file, 0, buffer.get(), kSize));
+
+  scoped_ptr_malloc<char, base::ScopedPtrAlignedFree> read_buffer(
+      base::AllocatePlatformFileDirectIOBuffer(kSize));
+  EXPECT_EQ(kSize, ReadFully(file, 0, read_buffer.get(), kSize));
+  EXPECT_EQ(0, memcmp(buffer.get(), read_buffer.get(), kSize));
+
+  base::ClosePlatformFile(file);
+}
+
+#if defined(OS_POSIX)
+TEST(PlatformFile, VectoredReadWritePlatformFile) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  FilePath file_path = temp_dir.path().AppendASCII("vectored_file");
+  base::PlatformFile file = base::CreatePlatformFile(
+      file_path,
+      base::PLATFORM_FILE_CREATE | base::PLATFORM_FILE_READ |
+          base::PLATFORM_FILE_WRITE,
+      NULL,
+      NULL);
+  ASSERT_NE(base::kInvalidPlatformFileValue, file);
+
+  // More buffers than one preadv() takes, some of them empty.
+  const int kBuffers = 3000;
+  std::vector<std::string> data(kBuffers);
+  std::vector<struct iovec> write_iov(kBuffers);
+  int64 total = 0;
+  for (int i = 0; i < kBuffers; i++) {
+    data[i] = std::string(i % 7, static_cast<char>('a' + i % 26));
+    write_iov[i].iov_base = const_cast<char*>(data[i].data());
+    write_iov[i].iov_len = data[i].size();
+    total += data[i].size();
+  }
+  EXPECT_EQ(total, base::WritePlatformFileV(file, 10, &write_iov[0],
+                                            kBuffers));
+  int64 file_size = 0;
+  EXPECT_TRUE(file_util::GetFileSize(file_path, &file_size));
+  EXPECT_EQ(10 + total, file_size);
+
+  // Read back into differently sized buffers, past the end of the file.
+  std::vector<char> read_data(total + 100, 'x');
+  std::vector<struct iovec> read_iov;
+  for (size_t offset = 0; offset < read_data.size(); offset += 1000) {
+    struct iovec iov = { &read_data[offset],
+                         std::min<size_t>(1000, read_data.size() - offset) };
+    read_iov.push_back(iov);
+  }
+  EXPECT_EQ(total, base::ReadPlatformFileV(file, 10, &read_iov[0],
+                                           read_iov.size()));
+  std::string expected;
+  for (int i = 0; i < kBuffers; i++)
+    expected += data[i];
+  EXPECT_EQ(expected, std::string(&read_data[0], total));
+  EXPECT_EQ('x', read_data[total]);
+
+  // At the end of the file.
+  EXPECT_EQ(0, base::ReadPlatformFileV(file, 10 + total, &read_iov[0], 1));
+  EXPECT_EQ(-1, base::ReadPlatformFileV(base::kInvalidPlatformFileValue, 0,
+                                        &read_iov[0], 1));
+
+  base::ClosePlatformFile(file);
+}
+
+TEST(PlatformFile, AppendVectoredPlatformFile) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  FilePath file_path = temp_dir.path().AppendASCII("append_file");
+  base::PlatformFile file = base::CreatePlatformFile(
+      file_path,
+      base::PLATFORM_FILE_CREATE | base::PLATFORM_FILE_APPEND,
+      NULL,
+      NULL);
+  ASSERT_NE(base::kInvalidPlatformFileValue, file);
+
+  char first[] = "first ";
+  char second[] = "second";
+  struct iovec iov[] = {
+    { first, strlen(first) },
+    { second, strlen(second) },
+  };
+  EXPECT_EQ(12, base::WritePlatformFileV(file, 0, iov, arraysize(iov)));
+  // The offset is ignored.
+  EXPECT_EQ(12, base::WritePlatformFileV(file, 0, iov, arraysize(iov)));
+  base::ClosePlatformFile(file);
+
+  std::string contents;
+  EXPECT_TRUE(base::ReadFileToString(file_path, &contents));
+  EXPECT_EQ("first secondfirst second", contents);
+}
+
+TEST(PlatformFile, AdvisePreallocatePlatformFile) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  FilePath file_path = temp_dir.path().AppendASCII("preallocated_file");
+  base::PlatformFile file = base::CreatePlatformFile(
+      file_path,
+      base::PLATFORM_FILE_CREATE | base::PLATFORM_FILE_READ |
+          base::PLATFORM_FILE_WRITE,
+      NULL,
+      NULL);
+  ASSERT_NE(base::kInvalidPlatformFileValue, file);
+
+  const int kSize = 1 << 20;
+  int64 file_size = 0;
+  if (base::PreallocatePlatformFile(file, 0, kSize, true)) {
+    EXPECT_TRUE(file_util::GetFileSize(file_path, &file_size));
+    EXPECT_EQ(0, file_size);
+  }
+  if (base::PreallocatePlatformFile(file, 0, kSize, false)) {
+    EXPECT_TRUE(file_util::GetFileSize(file_path, &file_size));
+    EXPECT_EQ(kSize, file_size);
+  }
+  EXPECT_FALSE(base::PreallocatePlatformFile(file, -1, kSize, false));
+
+  EXPECT_TRUE(base::AdvisePlatformFile(file, 0, 0,
+                                       base::PLATFORM_FILE_ACCESS_SEQUENTIAL));
+  EXPECT_TRUE(base::AdvisePlatformFile(file, 0, kSize,
+                                       base::PLATFORM_FILE_ACCESS_RANDOM));
+  EXPECT_TRUE(base::AdvisePlatformFile(file, 0, kSize,
+                                       base::PLATFORM_FILE_ACCESS_DONT_NEED));
+  EXPECT_TRUE(base::ReadAheadPlatformFile(file, 0, kSize));
+  EXPECT_FALSE(base::AdvisePlatformFile(base::kInvalidPlatformFileValue, 0, 0,
+                                        base::PLATFORM_FILE_ACCESS_NORMAL));
+
+  base::ClosePlatformFile(file);
+}
+#endif  // defined(OS_POSIX)
@@ -79,6 +79,8 @@ PlatformFile CreatePlatformFileUnsafe(const FilePath& name,
     create_flags |= FILE_FLAG_DELETE_ON_CLOSE;
   if (flags & PLATFORM_FILE_BACKUP_SEMANTICS)
     create_flags |= FILE_FLAG_BACKUP_SEMANTICS;
+  if (flags & PLATFORM_FILE_DIRECT_IO)
+    create_flags |= FILE_FLAG_NO_BUFFERING;
 
   HANDLE file = CreateFile(name.value().c_str(), access, sharing, NULL,
                            disposition, create_flags, NULL);
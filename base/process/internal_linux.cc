@@ -4,8 +4,10 @@
 
 #include "base/process/internal_linux.h"
 
+#include <sys/syscall.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <map>
 #include <string>
 #include <vector>
@@ -17,6 +19,11 @@
 #include "base/strings/string_util.h"
 #include "base/time/time.h"
 
+#if !defined(__NR_pidfd_open)
+// The same on every architecture, so that older headers may lack it.
+#define __NR_pidfd_open 434
+#endif
+
 namespace base {
 namespace internal {
 
@@ -184,5 +191,84 @@ TimeDelta ClockTicksToTimeDelta(int clock_ticks) {
       Time::kMicrosecondsPerSecond * clock_ticks / kHertz);
 }
 
+int OpenPidFd(pid_t pid) {
+  return syscall(__NR_pidfd_open, pid, 0);
+}
+
+bool GetCgroupDirectory(const std::string& controller,
+                        FilePath* mount_point,
+                        FilePath* dir) {
+  std::string cgroups;
+  std::string mounts;
+  if (!ReadFileToString(FilePath("/proc/self/cgroup"), &cgroups) ||
+      !ReadFileToString(FilePath("/proc/self/mountinfo"), &mounts)) {
+    return false;
+  }
+
+  // Lines of "<hierarchy id>:<controllers>:<path>". The cgroup v2 hierarchy
+  // is "0::<path>".
+  std::string path;
+  std::vector<std::string> lines;
+  SplitString(cgroups, '\n', &lines);
+  for (size_t i = 0; i < lines.size() && path.empty(); ++i) {
+    std::vector<std::string> fields;
+    SplitString(lines[i], ':', &fields);
+    if (fields.size() != 3)
+      continue;
+    std::vector<std::string> controllers;
+    SplitString(fields[1], ',', &controllers);
+    if (controller.empty() ? fields[0] == "0" && fields[1].empty()
+                           : std::find(controllers.begin(), controllers.end(),
+                                       controller) != controllers.end()) {
+      path = fields[2];
+    }
+  }
+  if (path.empty())
+    return false;
+
+  // Lines of "<id> <parent> <dev> <root> <mount point> <options> ... - <type>
+  // <source> <super options>". A cgroup v1 hierarchy lists its controllers
+  // in the super options.
+  SplitString(mounts, '\n', &lines);
+  for (size_t i = 0; i < lines.size(); ++i) {
+    const size_t separator = lines[i].find(" - ");
+    if (separator == std::string::npos)
+      continue;
+    std::vector<std::string> fields;
+    std::vector<std::string> type_fields;
+    SplitString(lines[i].substr(0, separator), ' ', &fields);
+    SplitString(lines[i].substr(separator + 3), ' ', &type_fields);
+    if (fields.size() < 5 || type_fields.size() < 3)
+      continue;
+    if (controller.empty()) {
+      if (type_fields[0] != "cgroup2")
+        continue;
+    } else {
+      std::vector<std::string> options;
+      SplitString(type_fields[2], ',', &options);
+      if (type_fields[0] != "cgroup" ||
+          std::find(options.begin(), options.end(), controller) ==
+              options.end()) {
+        continue;
+      }
+    }
+
+    // The path is relative to the root of the hierarchy, which is mounted
+    // from |root|: in a container, typically the container's own cgroup.
+    const std::string& root = fields[3];
+    std::string relative = path;
+    if (root != "/" && StartsWithASCII(path, root, true))
+      relative = path.substr(root.size());
+    while (!relative.empty() && relative[0] == '/')
+      relative.erase(0, 1);
+    const FilePath mount(fields[4]);
+    if (mount_point)
+      *mount_point = mount;
+    *dir = relative.empty() ? mount : mount.Append(relative);
+    return true;
+  }
+  return false;
+}
+
 }  // namespace internal
 }  // namespace base
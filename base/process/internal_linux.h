@@ -83,6 +83,21 @@ Time GetBootTime();
 // Converts Linux clock ticks to a wall time delta.
 TimeDelta ClockTicksToTimeDelta(int clock_ticks);
 
+// Returns a pidfd for |pid|, which polls readable once the process has exited,
+// or -1 with errno set. errno is ESRCH if there is no such process, and
+// something else, typically ENOSYS, if the kernel predates pidfds (Linux 5.3).
+int OpenPidFd(pid_t pid);
+
+// Finds the directory of this process's cgroup in the hierarchy which has
+// |controller|, such as "cpu" or "memory", or in the cgroup v2 hierarchy if
+// |controller| is empty, from /proc/self/cgroup and /proc/self/mountinfo.
+// Sets |mount_point|, if not NULL, to where the hierarchy is mounted; limits
+// set on the directories between the two apply too. Returns false if the
+// hierarchy isn't mounted.
+bool GetCgroupDirectory(const std::string& controller,
+                        FilePath* mount_point,
+                        FilePath* dir);
+
 }  // namespace internal
 }  // namespace base
 
@@ -4,6 +4,7 @@
 
 #include "base/process/kill.h"
 
+#include <poll.h>
 #include <signal.h>
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -17,10 +18,107 @@
 #include "base/third_party/dynamic_annotations/dynamic_annotations.h"
 #include "base/threading/platform_thread.h"
 
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "base/process/internal_linux.h"
+#endif
+
 namespace base {
 
 namespace {
 
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+// Returns the poll() timeout for the time left until |deadline|, rounded up
+// so that we never wake up early and spin.
+int PollTimeoutUntil(TimeTicks deadline) {
+  int64 remaining = (deadline - TimeTicks::Now()).InMicroseconds();
+  if (remaining <= 0)
+    return 0;
+  remaining = (remaining + Time::kMicrosecondsPerMillisecond - 1) /
+              Time::kMicrosecondsPerMillisecond;
+  return static_cast<int>(
+      std::min<int64>(remaining, std::numeric_limits<int>::max()));
+}
+
+// Waits for |handle| to exit by polling a pidfd for it, which wakes us as
+// soon as it does, and then reaps it. Returns false, having done nothing, if
+// the kernel doesn't support pidfds. Otherwise returns true, and sets
+// |status| and |success| as WaitpidWithTimeout() does.
+bool WaitpidWithPidFd(ProcessHandle handle,
+                      int64 wait_milliseconds,
+                      int* status,
+                      bool* success) {
+  int pidfd = internal::OpenPidFd(handle);
+  if (pidfd >= 0) {
+    file_util::ScopedFD pidfd_closer(&pidfd);
+    const TimeTicks deadline = TimeTicks::Now() +
+        TimeDelta::FromMilliseconds(std::max<int64>(wait_milliseconds, 0));
+    struct pollfd pfd = { pidfd, POLLIN, 0 };
+    while (poll(&pfd, 1, PollTimeoutUntil(deadline)) == -1 && errno == EINTR) {
+    }
+  } else if (errno != ESRCH) {
+    return false;
+  }
+  // With ESRCH there is no such process, and waitpid() fails too.
+
+  *status = -1;
+  pid_t ret_pid = HANDLE_EINTR(waitpid(handle, status, WNOHANG));
+  if (ret_pid == 0)
+    *status = -1;
+  *success = (ret_pid != -1);
+  return true;
+}
+
+// Waits until |end_time| for all the processes |iter| finds to exit, by
+// polling pidfds for them. Returns false if the kernel doesn't support
+// pidfds. Otherwise returns true, and sets |found| to whether |iter| found
+// any processes.
+bool WaitForProcessesWithPidFds(NamedProcessIterator* iter,
+                                TimeTicks end_time,
+                                bool* found) {
+  std::vector<struct pollfd> pidfds;
+  bool supported = true;
+  *found = false;
+  while (const ProcessEntry* entry = iter->NextProcessEntry()) {
+    *found = true;
+    int pidfd = internal::OpenPidFd(entry->pid());
+    if (pidfd >= 0) {
+      struct pollfd pfd = { pidfd, POLLIN, 0 };
+      pidfds.push_back(pfd);
+    } else if (errno != ESRCH) {
+      supported = false;
+      break;
+    }
+  }
+
+  size_t running = supported ? pidfds.size() : 0;
+  while (running) {
+    int ready = poll(&pidfds[0], pidfds.size(), PollTimeoutUntil(end_time));
+    if (ready == -1 && errno == EINTR)
+      continue;
+    if (ready <= 0)
+      break;
+    // poll() ignores the negative descriptors of the processes that exited.
+    for (size_t i = 0; i < pidfds.size(); ++i) {
+      if (pidfds[i].fd >= 0 && pidfds[i].revents) {
+        close(pidfds[i].fd);
+        pidfds[i].fd = -1;
+        --running;
+      }
+    }
+  }
+
+  for (size_t i = 0; i < pidfds.size(); ++i) {
+    if (pidfds[i].fd >= 0)
+      close(pidfds[i].fd);
+  }
+  return supported;
+}
+#endif  // defined(OS_LINUX) || defined(OS_ANDROID)
+
 int WaitpidWithTimeout(ProcessHandle handle,
                        int64 wait_milliseconds,
                        bool* success) {
@@ -47,7 +145,18 @@ int WaitpidWithTimeout(ProcessHandle handle,
   //
   // This function is used primarily for unit tests, if we want to use it in
   // the application itself it would probably be best to examine other routes.
+  //
+  // On Linux 5.3 and later, we wait on a pidfd instead, which returns as soon
+  // as the process exits.
   int status = -1;
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+  bool pidfd_success = false;
+  if (WaitpidWithPidFd(handle, wait_milliseconds, &status, &pidfd_success)) {
+    if (success)
+      *success = pidfd_success;
+    return status;
+  }
+#endif
   pid_t ret_pid = HANDLE_EINTR(waitpid(handle, &status, WNOHANG));
   static const int64 kMaxSleepInMicroseconds = 1 << 18;  // ~256 milliseconds.
   int64 max_sleep_time_usecs = 1 << 10;  // ~1 milliseconds.
@@ -253,6 +362,19 @@ bool WaitForProcessesToExit(const FilePath::StringType& executable_name,
 
   base::TimeTicks end_time = base::TimeTicks::Now() + wait;
   do {
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+    // Wait for the processes found to exit, rather than rescanning /proc
+    // every 100 ms, then scan again for any started meanwhile.
+    NamedProcessIterator pidfd_iter(executable_name, filter);
+    bool found = false;
+    if (WaitForProcessesWithPidFds(&pidfd_iter, end_time, &found)) {
+      if (!found) {
+        result = true;
+        break;
+      }
+      continue;
+    }
+#endif
     NamedProcessIterator iter(executable_name, filter);
     if (!iter.NextProcessEntry()) {
       result = true;
@@ -441,14 +563,14 @@ class BackgroundReaper : public PlatformThread::Delegate {
       return;
     }
 
-    // There's no good way to wait for a specific child to exit in a timed
-    // fashion. (No kqueue on Linux), so we just loop and sleep.
-
-    // Wait for 2 * timeout_ 500 milliseconds intervals.
-    for (unsigned i = 0; i < 2 * timeout_; ++i) {
-      PlatformThread::Sleep(TimeDelta::FromMilliseconds(500));
-      if (IsChildDead(child_))
-        return;
+    // Wait for up to |timeout_| seconds, on a pidfd where there are those.
+    bool waitpid_success = false;
+    int status = WaitpidWithTimeout(child_, timeout_ * 1000, &waitpid_success);
+    if (status != -1)
+      return;
+    if (!waitpid_success) {
+      DPLOG(ERROR) << "waitpid(" << child_ << ")";
+      return;
     }
 
     if (kill(child_, SIGKILL) == 0) {
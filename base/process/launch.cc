@@ -24,6 +24,7 @@ LaunchOptions::LaunchOptions()
       new_process_group(false)
 #if defined(OS_LINUX)
       , clone_flags(0)
+      , use_vfork(true)
 #endif  // OS_LINUX
 #if defined(OS_CHROMEOS)
       , ctrl_terminal_fd(-1)
@@ -100,6 +100,12 @@ struct BASE_EXPORT LaunchOptions {
 #if defined(OS_LINUX)
   // If non-zero, start the process using clone(), using flags as provided.
   int clone_flags;
+
+  // If true (the default), and |clone_flags| is zero, start the process
+  // using clone(CLONE_VM | CLONE_VFORK), which borrows our address space
+  // until the child execs, rather than fork(), which copies our page tables
+  // and so takes longer the more memory we map.
+  bool use_vfork;
 #endif  // defined(OS_LINUX)
 
 #if defined(OS_CHROMEOS)
@@ -128,7 +134,10 @@ struct BASE_EXPORT LaunchOptions {
 //   stdin is reopened as /dev/null, and the child is allowed to inherit its
 //   parent's stdout and stderr.
 // - If the first argument on the command line does not contain a slash,
-//   PATH will be searched.  (See man execvp.)
+//   PATH will be searched.  (See man execvp.) The PATH searched is the one
+//   in options::environ, if that sets it. As with execvp(), a file found
+//   which isn't an executable format, such as a script without a "#!" line,
+//   is run with /bin/sh.
 BASE_EXPORT bool LaunchProcess(const CommandLine& cmdline,
                                const LaunchOptions& options,
                                ProcessHandle* process_handle);
@@ -0,0 +1,62 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/process/launch.h"
+
+#include <string.h>
+
+#include <vector>
+
+#include "base/memory/scoped_ptr.h"
+#include "base/strings/stringprintf.h"
+#include "base/test/perf_log.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+const int kLaunches = 200;
+
+// Launches /bin/true kLaunches times, waiting for each, and logs the rate.
+void RunLaunches(const char* method, bool use_vfork, size_t parent_mb) {
+  std::vector<std::string> argv;
+  argv.push_back("/bin/true");
+  LaunchOptions options;
+  options.wait = true;
+#if defined(OS_LINUX)
+  options.use_vfork = use_vfork;
+#endif
+
+  TimeTicks start = TimeTicks::Now();
+  for (int i = 0; i < kLaunches; ++i)
+    ASSERT_TRUE(LaunchProcess(argv, options, NULL));
+  TimeDelta elapsed = TimeTicks::Now() - start;
+
+  LogPerfResult(StringPrintf("launch_%s_%dMB", method,
+                             static_cast<int>(parent_mb)).c_str(),
+                kLaunches / elapsed.InSecondsF(), "launches/s");
+}
+
+}  // namespace
+
+// How the launch rate falls as our resident set grows, which fork() copies
+// the page tables of and clone(CLONE_VM | CLONE_VFORK) doesn't.
+TEST(LaunchPerfTest, LaunchesPerSecondByParentSize) {
+  const size_t kParentSizesMB[] = { 0, 64, 256, 1024 };
+  for (size_t i = 0; i < arraysize(kParentSizesMB); ++i) {
+    const size_t size = kParentSizesMB[i] * 1024 * 1024;
+    scoped_ptr<char[]> resident(new char[size ? size : 1]);
+    // Touch every page, so that it's resident and mapped.
+    memset(resident.get(), 1, size);
+
+    RunLaunches("fork", false, kParentSizesMB[i]);
+#if defined(OS_LINUX)
+    RunLaunches("vfork", true, kParentSizesMB[i]);
+#endif
+  }
+}
+
+}  // namespace base
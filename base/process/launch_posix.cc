@@ -9,13 +9,13 @@
 #include <fcntl.h>
 #include <signal.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/resource.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
-#include <iterator>
 #include <limits>
 #include <set>
 
@@ -36,6 +36,20 @@
 #include "base/third_party/dynamic_annotations/dynamic_annotations.h"
 #include "base/threading/platform_thread.h"
 
+#if defined(OS_LINUX)
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+#include <sys/syscall.h>
+
+#if !defined(__NR_close_range)
+// The same on every architecture, so that older headers may lack it.
+#define __NR_close_range 436
+#endif
+#endif
+
 #if defined(OS_CHROMEOS)
 #include <sys/ioctl.h>
 #endif
@@ -66,16 +80,6 @@ char** GetEnvironment() {
 #endif
 }
 
-// Set the process's "environment" (i.e. the thing that setenv/getenv
-// work with).
-void SetEnvironment(char** env) {
-#if defined(OS_MACOSX)
-  *_NSGetEnviron() = env;
-#else
-  environ = env;
-#endif
-}
-
 // Set the calling thread's signal mask to new_sigmask and return
 // the previous signal mask.
 sigset_t SetSignalMask(const sigset_t& new_sigmask) {
@@ -205,10 +209,45 @@ static const char kFDDir[] = "/dev/fd";
 static const char kFDDir[] = "/proc/self/fd";
 #endif
 
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+// Closes the descriptors above stderr that aren't a destination in
+// |saved_mapping| with a close_range() for each gap between those, rather
+// than a close() for each open descriptor. Returns false if the kernel
+// predates close_range() (Linux 5.9).
+static bool CloseSuperfluousFdsInRanges(
+    const base::InjectiveMultimap& saved_mapping) {
+  const unsigned int kLastFd = std::numeric_limits<unsigned int>::max();
+  unsigned int first = STDERR_FILENO + 1;
+  for (;;) {
+    // Find the lowest destination from |first| on. The mapping is short, and
+    // sorting it would allocate.
+    unsigned int next = kLastFd;
+    for (InjectiveMultimap::const_iterator i = saved_mapping.begin();
+         i != saved_mapping.end(); ++i) {
+      const unsigned int dest = static_cast<unsigned int>(i->dest);
+      if (i->dest >= 0 && dest >= first && dest < next)
+        next = dest;
+    }
+    if (next > first && syscall(__NR_close_range, first, next - 1, 0) != 0)
+      return false;
+    if (next == kLastFd)
+      return true;
+    first = next + 1;
+  }
+}
+#endif  // defined(OS_LINUX) || defined(OS_ANDROID)
+
 void CloseSuperfluousFds(const base::InjectiveMultimap& saved_mapping) {
   // DANGER: no calls to malloc are allowed from now on:
   // http://crbug.com/36678
 
+#if defined(OS_LINUX) || defined(OS_ANDROID)
+  // Valgrind's own descriptors, which we mustn't close (see below), are in
+  // the range that close_range() closes.
+  if (!RunningOnValgrind() && CloseSuperfluousFdsInRanges(saved_mapping))
+    return;
+#endif
+
   // Get the maximum number of FDs possible.
   size_t max_fds = GetMaxFds();
 
@@ -269,28 +308,282 @@ void CloseSuperfluousFds(const base::InjectiveMultimap& saved_mapping) {
   }
 }
 
-bool LaunchProcess(const std::vector<std::string>& argv,
-                   const LaunchOptions& options,
-                   ProcessHandle* process_handle) {
-  size_t fd_shuffle_size = 0;
-  if (options.fds_to_remap) {
-    fd_shuffle_size = options.fds_to_remap->size();
+namespace {
+
+#if defined(OS_LINUX)
+// The stack of a child started with clone(CLONE_VM). It runs only until it
+// execs, but that includes the descriptor shuffle and RAW_LOG.
+const size_t kChildStackSize = 256 * 1024;
+#endif
+
+// What the child of LaunchProcessInternal() does between fork() and exec.
+// The parent prepares all of it, so that the child never allocates. When the
+// child borrows our address space until it execs, the only memory of ours it
+// writes to, besides errno, is the scratch below, which the parent sets aside
+// for it and does not read again.
+struct ChildState {
+  const LaunchOptions* options;
+  sigset_t orig_sigmask;
+  // Scratch: a copy of |fd_shuffle2| which the child shuffles in place.
+  InjectiveMultimap* fd_shuffle1;
+  const InjectiveMultimap* fd_shuffle2;
+  char* const* argv;
+  char* const* envp;
+  // The paths to try to exec in turn, NULL-terminated.
+  char* const* exec_paths;
+  // Scratch: the arguments to run a file that exec refuses (ENOEXEC) with
+  // the shell, as execvp() does; the child fills in the file at [1]. NULL if
+  // the PATH isn't searched.
+  char** shell_argv;
+};
+
+// Returns the value of the variable |name| in |env|, or NULL if it isn't set.
+const char* GetEnvironmentValue(char* const* env, const char* name) {
+  const size_t name_length = strlen(name);
+  for (; *env; ++env) {
+    if (!strncmp(*env, name, name_length) && (*env)[name_length] == '=')
+      return *env + name_length + 1;
+  }
+  return NULL;
+}
+
+// Returns the paths that execvp() tries to exec for |program|: |program|
+// itself if it contains a slash, or else |program| in each directory of
+// |path|, which is execvp()'s default if NULL.
+std::vector<std::string> GetExecPaths(const std::string& program,
+                                      const char* path) {
+  std::vector<std::string> paths;
+  if (program.find('/') != std::string::npos) {
+    paths.push_back(program);
+    return paths;
+  }
+  if (program.empty())
+    return paths;
+  if (!path)
+    path = "/bin:/usr/bin";
+  for (;;) {
+    const char* end = strchr(path, ':');
+    const size_t length = end ? end - path : strlen(path);
+    // An empty directory means the current one.
+    if (length)
+      paths.push_back(std::string(path, length) + "/" + program);
+    else
+      paths.push_back(program);
+    if (!end)
+      break;
+    path = end + 1;
+  }
+  return paths;
+}
+
+// Runs in the child, and execs or exits rather than returning. Takes the
+// ChildState as a void* to serve as the entry point for clone().
+int RunChild(void* arg) {
+  const ChildState& state = *static_cast<const ChildState*>(arg);
+  const LaunchOptions& options = *state.options;
+
+  // DANGER: fork() rule: in the child, if you don't end up doing exec*(),
+  // you call _exit() instead of exit(). This is because _exit() does not
+  // call any previously-registered (in the parent) exit handlers, which
+  // might do things like block waiting for threads that don't even exist
+  // in the child.
+
+  // If a child process uses the readline library, the process block forever.
+  // In BSD like OSes including OS X it is safe to assign /dev/null as stdin.
+  // See http://crbug.com/56596.
+  int null_fd = HANDLE_EINTR(open("/dev/null", O_RDONLY));
+  if (null_fd < 0) {
+    RAW_LOG(ERROR, "Failed to open /dev/null");
+    _exit(127);
+  }
+
+  file_util::ScopedFD null_fd_closer(&null_fd);
+  int new_fd = HANDLE_EINTR(dup2(null_fd, STDIN_FILENO));
+  if (new_fd != STDIN_FILENO) {
+    RAW_LOG(ERROR, "Failed to dup /dev/null for stdin");
+    _exit(127);
+  }
+
+  if (options.new_process_group) {
+    // Instead of inheriting the process group ID of the parent, the child
+    // starts off a new process group with pgid equal to its process ID.
+    if (setpgid(0, 0) < 0) {
+      RAW_LOG(ERROR, "setpgid failed");
+      _exit(127);
+    }
+  }
+
+  // Stop type-profiler.
+  // The profiler should be stopped between fork and exec since it inserts
+  // locks at new/delete expressions.  See http://crbug.com/36678.
+  // A child sharing our address space is only started while it isn't
+  // running, so that this doesn't stop it for us.
+  base::type_profiler::Controller::Stop();
+
+  if (options.maximize_rlimits) {
+    // Some resource limits need to be maximal in this child.
+    std::set<int>::const_iterator resource;
+    for (resource = options.maximize_rlimits->begin();
+         resource != options.maximize_rlimits->end();
+         ++resource) {
+      struct rlimit limit;
+      if (getrlimit(*resource, &limit) < 0) {
+        RAW_LOG(WARNING, "getrlimit failed");
+      } else if (limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        if (setrlimit(*resource, &limit) < 0) {
+          RAW_LOG(WARNING, "setrlimit failed");
+        }
+      }
+    }
+  }
+
+#if defined(OS_MACOSX)
+  RestoreDefaultExceptionHandler();
+#endif  // defined(OS_MACOSX)
+
+  ResetChildSignalHandlersToDefaults();
+  SetSignalMask(state.orig_sigmask);
+
+#if 0
+  // When debugging it can be helpful to check that we really aren't making
+  // any hidden calls to malloc.
+  void *malloc_thunk =
+      reinterpret_cast<void*>(reinterpret_cast<intptr_t>(malloc) & ~4095);
+  mprotect(malloc_thunk, 4096, PROT_READ | PROT_WRITE | PROT_EXEC);
+  memset(reinterpret_cast<void*>(malloc), 0xff, 8);
+#endif  // 0
+
+  // DANGER: no calls to malloc are allowed from now on:
+  // http://crbug.com/36678
+
+#if defined(OS_CHROMEOS)
+  if (options.ctrl_terminal_fd >= 0) {
+    // Set process' controlling terminal.
+    if (HANDLE_EINTR(setsid()) != -1) {
+      if (HANDLE_EINTR(
+              ioctl(options.ctrl_terminal_fd, TIOCSCTTY, NULL)) == -1) {
+        RAW_LOG(WARNING, "ioctl(TIOCSCTTY), ctrl terminal not set");
+      }
+    } else {
+      RAW_LOG(WARNING, "setsid failed, ctrl terminal not set");
+    }
+  }
+#endif  // defined(OS_CHROMEOS)
+
+  // fd_shuffle1 is mutated by this call because it cannot malloc.
+  if (!ShuffleFileDescriptors(state.fd_shuffle1))
+    _exit(127);
+
+  CloseSuperfluousFds(*state.fd_shuffle2);
+
+  for (char* const* path = state.exec_paths; *path; ++path) {
+    execve(*path, state.argv, state.envp);
+    if (errno == ENOEXEC && state.shell_argv) {
+      // Like execvp(), run a script without a "#!" line with the shell.
+      state.shell_argv[1] = *path;
+      execve(state.shell_argv[0], state.shell_argv, state.envp);
+      break;
+    }
+    // Like execvp(), carry on down the PATH unless the file was found and
+    // could have been run.
+    if (errno != ENOENT && errno != ENOTDIR && errno != EACCES)
+      break;
   }
 
+  RAW_LOG(ERROR, "LaunchProcess: failed to execvp:");
+  RAW_LOG(ERROR, state.argv[0]);
+  _exit(127);
+}
+
+#if defined(OS_LINUX)
+// Starts a child running RunChild(|state|) on a stack of its own, in our
+// address space. We are suspended until the child execs or exits, so it only
+// needs to leave our memory, but for the scratch in |state|, alone. Returns
+// the pid of the child, or -1.
+pid_t CloneWithSharedAddressSpace(ChildState* state) {
+  void* stack = mmap(NULL, kChildStackSize, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+  if (stack == MAP_FAILED)
+    return -1;
+  // The stack grows down on every architecture we support.
+  pid_t pid = clone(&RunChild, static_cast<char*>(stack) + kChildStackSize,
+                    CLONE_VM | CLONE_VFORK | SIGCHLD, state);
+  const int clone_errno = errno;
+  munmap(stack, kChildStackSize);
+  errno = clone_errno;
+  return pid;
+}
+#endif  // defined(OS_LINUX)
+
+// Launches |argv| as LaunchProcess() does. If |envp| is non-NULL, it is the
+// environment of the child, instead of ours as altered by |options|, and the
+// PATH isn't searched for |argv[0]|.
+bool LaunchProcessInternal(const std::vector<std::string>& argv,
+                           const LaunchOptions& options,
+                           char* const envp[],
+                           ProcessHandle* process_handle) {
   InjectiveMultimap fd_shuffle1;
   InjectiveMultimap fd_shuffle2;
-  fd_shuffle1.reserve(fd_shuffle_size);
-  fd_shuffle2.reserve(fd_shuffle_size);
+  if (options.fds_to_remap) {
+    fd_shuffle1.reserve(options.fds_to_remap->size());
+    for (FileHandleMappingVector::const_iterator
+             it = options.fds_to_remap->begin();
+         it != options.fds_to_remap->end(); ++it) {
+      fd_shuffle1.push_back(InjectionArc(it->first, it->second, false));
+    }
+    fd_shuffle2 = fd_shuffle1;
+  }
 
   scoped_ptr<char*[]> argv_cstr(new char*[argv.size() + 1]);
+  for (size_t i = 0; i < argv.size(); i++)
+    argv_cstr[i] = const_cast<char*>(argv[i].c_str());
+  argv_cstr[argv.size()] = NULL;
+
   scoped_ptr<char*[]> new_environ;
-  if (!options.environ.empty())
-    new_environ = AlterEnvironment(GetEnvironment(), options.environ);
+  char* const* child_environ = envp;
+  if (!child_environ) {
+    if (!options.environ.empty())
+      new_environ = AlterEnvironment(GetEnvironment(), options.environ);
+    child_environ = new_environ ? new_environ.get() : GetEnvironment();
+  }
+
+  const std::string program = argv.empty() ? std::string() : argv[0];
+  std::vector<std::string> exec_paths;
+  if (envp)
+    exec_paths.push_back(program);
+  else
+    exec_paths = GetExecPaths(program,
+                              GetEnvironmentValue(child_environ, "PATH"));
+  scoped_ptr<char*[]> exec_paths_cstr(new char*[exec_paths.size() + 1]);
+  for (size_t i = 0; i < exec_paths.size(); i++)
+    exec_paths_cstr[i] = const_cast<char*>(exec_paths[i].c_str());
+  exec_paths_cstr[exec_paths.size()] = NULL;
+
+  // "/bin/sh", the file, then the arguments after argv[0].
+  scoped_ptr<char*[]> shell_argv;
+  if (!envp && !argv.empty()) {
+    shell_argv.reset(new char*[argv.size() + 2]);
+    shell_argv[0] = const_cast<char*>("/bin/sh");
+    shell_argv[1] = NULL;
+    for (size_t i = 1; i <= argv.size(); i++)
+      shell_argv[i + 1] = argv_cstr[i];
+  }
 
   sigset_t full_sigset;
   sigfillset(&full_sigset);
   const sigset_t orig_sigmask = SetSignalMask(full_sigset);
 
+  ChildState state;
+  state.options = &options;
+  state.orig_sigmask = orig_sigmask;
+  state.fd_shuffle1 = &fd_shuffle1;
+  state.fd_shuffle2 = &fd_shuffle2;
+  state.argv = argv_cstr.get();
+  state.envp = child_environ;
+  state.exec_paths = exec_paths_cstr.get();
+  state.shell_argv = shell_argv.get();
+
   pid_t pid;
 #if defined(OS_LINUX)
   if (options.clone_flags) {
@@ -300,6 +593,9 @@ bool LaunchProcess(const std::vector<std::string>& argv,
     RAW_CHECK(
         !(options.clone_flags & (CLONE_SIGHAND | CLONE_THREAD | CLONE_VM)));
     pid = syscall(__NR_clone, options.clone_flags, 0, 0, 0);
+  } else if (options.use_vfork &&
+             !base::type_profiler::Controller::IsProfiling()) {
+    pid = CloneWithSharedAddressSpace(&state);
   } else
 #endif
   {
@@ -316,120 +612,7 @@ bool LaunchProcess(const std::vector<std::string>& argv,
     return false;
   } else if (pid == 0) {
     // Child process
-
-    // DANGER: fork() rule: in the child, if you don't end up doing exec*(),
-    // you call _exit() instead of exit(). This is because _exit() does not
-    // call any previously-registered (in the parent) exit handlers, which
-    // might do things like block waiting for threads that don't even exist
-    // in the child.
-
-    // If a child process uses the readline library, the process block forever.
-    // In BSD like OSes including OS X it is safe to assign /dev/null as stdin.
-    // See http://crbug.com/56596.
-    int null_fd = HANDLE_EINTR(open("/dev/null", O_RDONLY));
-    if (null_fd < 0) {
-      RAW_LOG(ERROR, "Failed to open /dev/null");
-      _exit(127);
-    }
-
-    file_util::ScopedFD null_fd_closer(&null_fd);
-    int new_fd = HANDLE_EINTR(dup2(null_fd, STDIN_FILENO));
-    if (new_fd != STDIN_FILENO) {
-      RAW_LOG(ERROR, "Failed to dup /dev/null for stdin");
-      _exit(127);
-    }
-
-    if (options.new_process_group) {
-      // Instead of inheriting the process group ID of the parent, the child
-      // starts off a new process group with pgid equal to its process ID.
-      if (setpgid(0, 0) < 0) {
-        RAW_LOG(ERROR, "setpgid failed");
-        _exit(127);
-      }
-    }
-
-    // Stop type-profiler.
-    // The profiler should be stopped between fork and exec since it inserts
-    // locks at new/delete expressions.  See http://crbug.com/36678.
-    base::type_profiler::Controller::Stop();
-
-    if (options.maximize_rlimits) {
-      // Some resource limits need to be maximal in this child.
-      std::set<int>::const_iterator resource;
-      for (resource = options.maximize_rlimits->begin();
-           resource != options.maximize_rlimits->end();
-           ++resource) {
-        struct rlimit limit;
-        if (getrlimit(*resource, &limit) < 0) {
-          RAW_LOG(WARNING, "getrlimit failed");
-        } else if (limit.rlim_cur < limit.rlim_max) {
-          limit.rlim_cur = limit.rlim_max;
-          if (setrlimit(*resource, &limit) < 0) {
-            RAW_LOG(WARNING, "setrlimit failed");
-          }
-        }
-      }
-    }
-
-#if defined(OS_MACOSX)
-    RestoreDefaultExceptionHandler();
-#endif  // defined(OS_MACOSX)
-
-    ResetChildSignalHandlersToDefaults();
-    SetSignalMask(orig_sigmask);
-
-#if 0
-    // When debugging it can be helpful to check that we really aren't making
-    // any hidden calls to malloc.
-    void *malloc_thunk =
-        reinterpret_cast<void*>(reinterpret_cast<intptr_t>(malloc) & ~4095);
-    mprotect(malloc_thunk, 4096, PROT_READ | PROT_WRITE | PROT_EXEC);
-    memset(reinterpret_cast<void*>(malloc), 0xff, 8);
-#endif  // 0
-
-    // DANGER: no calls to malloc are allowed from now on:
-    // http://crbug.com/36678
-
-#if defined(OS_CHROMEOS)
-    if (options.ctrl_terminal_fd >= 0) {
-      // Set process' controlling terminal.
-      if (HANDLE_EINTR(setsid()) != -1) {
-        if (HANDLE_EINTR(
-                ioctl(options.ctrl_terminal_fd, TIOCSCTTY, NULL)) == -1) {
-          RAW_LOG(WARNING, "ioctl(TIOCSCTTY), ctrl terminal not set");
-        }
-      } else {
-        RAW_LOG(WARNING, "setsid failed, ctrl terminal not set");
-      }
-    }
-#endif  // defined(OS_CHROMEOS)
-
-    if (options.fds_to_remap) {
-      for (FileHandleMappingVector::const_iterator
-               it = options.fds_to_remap->begin();
-           it != options.fds_to_remap->end(); ++it) {
-        fd_shuffle1.push_back(InjectionArc(it->first, it->second, false));
-        fd_shuffle2.push_back(InjectionArc(it->first, it->second, false));
-      }
-    }
-
-    if (!options.environ.empty())
-      SetEnvironment(new_environ.get());
-
-    // fd_shuffle1 is mutated by this call because it cannot malloc.
-    if (!ShuffleFileDescriptors(&fd_shuffle1))
-      _exit(127);
-
-    CloseSuperfluousFds(fd_shuffle2);
-
-    for (size_t i = 0; i < argv.size(); i++)
-      argv_cstr[i] = const_cast<char*>(argv[i].c_str());
-    argv_cstr[argv.size()] = NULL;
-    execvp(argv_cstr[0], argv_cstr.get());
-
-    RAW_LOG(ERROR, "LaunchProcess: failed to execvp:");
-    RAW_LOG(ERROR, argv_cstr[0]);
-    _exit(127);
+    RunChild(&state);
   } else {
     // Parent process
     if (options.wait) {
@@ -446,6 +629,13 @@ bool LaunchProcess(const std::vector<std::string>& argv,
   return true;
 }
 
+}  // namespace
+
+bool LaunchProcess(const std::vector<std::string>& argv,
+                   const LaunchOptions& options,
+                   ProcessHandle* process_handle) {
+  return LaunchProcessInternal(argv, options, NULL, process_handle);
+}
 
 bool LaunchProcess(const CommandLine& cmdline,
                    const LaunchOptions& options,
@@ -494,107 +684,67 @@ static GetAppOutputInternalResult GetAppOutputInternal(
   DCHECK(exit_code);
   *exit_code = EXIT_FAILURE;
 
-  int pipe_fd[2];
-  pid_t pid;
-  InjectiveMultimap fd_shuffle1, fd_shuffle2;
-  scoped_ptr<char*[]> argv_cstr(new char*[argv.size() + 1]);
-
-  fd_shuffle1.reserve(3);
-  fd_shuffle2.reserve(3);
-
   // Either |do_search_path| should be false or |envp| should be null, but not
   // both.
   DCHECK(!do_search_path ^ !envp);
 
+  int pipe_fd[2];
   if (pipe(pipe_fd) < 0)
     return EXECUTE_FAILURE;
 
-  switch (pid = fork()) {
-    case -1:  // error
-      close(pipe_fd[0]);
-      close(pipe_fd[1]);
-      return EXECUTE_FAILURE;
-    case 0:  // child
-      {
-#if defined(OS_MACOSX)
-        RestoreDefaultExceptionHandler();
-#endif
-        // DANGER: no calls to malloc are allowed from now on:
-        // http://crbug.com/36678
-
-        // Obscure fork() rule: in the child, if you don't end up doing exec*(),
-        // you call _exit() instead of exit(). This is because _exit() does not
-        // call any previously-registered (in the parent) exit handlers, which
-        // might do things like block waiting for threads that don't even exist
-        // in the child.
-        int dev_null = open("/dev/null", O_WRONLY);
-        if (dev_null < 0)
-          _exit(127);
-
-        // Stop type-profiler.
-        // The profiler should be stopped between fork and exec since it inserts
-        // locks at new/delete expressions.  See http://crbug.com/36678.
-        base::type_profiler::Controller::Stop();
-
-        fd_shuffle1.push_back(InjectionArc(pipe_fd[1], STDOUT_FILENO, true));
-        fd_shuffle1.push_back(InjectionArc(dev_null, STDERR_FILENO, true));
-        fd_shuffle1.push_back(InjectionArc(dev_null, STDIN_FILENO, true));
-        // Adding another element here? Remeber to increase the argument to
-        // reserve(), above.
-
-        std::copy(fd_shuffle1.begin(), fd_shuffle1.end(),
-                  std::back_inserter(fd_shuffle2));
-
-        if (!ShuffleFileDescriptors(&fd_shuffle1))
-          _exit(127);
-
-        CloseSuperfluousFds(fd_shuffle2);
-
-        for (size_t i = 0; i < argv.size(); i++)
-          argv_cstr[i] = const_cast<char*>(argv[i].c_str());
-        argv_cstr[argv.size()] = NULL;
-        if (do_search_path)
-          execvp(argv_cstr[0], argv_cstr.get());
-        else
-          execve(argv_cstr[0], argv_cstr.get(), envp);
-        _exit(127);
-      }
-    default:  // parent
-      {
-        // Close our writing end of pipe now. Otherwise later read would not
-        // be able to detect end of child's output (in theory we could still
-        // write to the pipe).
-        close(pipe_fd[1]);
-
-        output->clear();
-        char buffer[256];
-        size_t output_buf_left = max_output;
-        ssize_t bytes_read = 1;  // A lie to properly handle |max_output == 0|
-                                 // case in the logic below.
-
-        while (output_buf_left > 0) {
-          bytes_read = HANDLE_EINTR(read(pipe_fd[0], buffer,
-                                    std::min(output_buf_left, sizeof(buffer))));
-          if (bytes_read <= 0)
-            break;
-          output->append(buffer, bytes_read);
-          output_buf_left -= static_cast<size_t>(bytes_read);
-        }
-        close(pipe_fd[0]);
-
-        // Always wait for exit code (even if we know we'll declare
-        // GOT_MAX_OUTPUT).
-        bool success = WaitForExitCode(pid, exit_code);
-
-        // If we stopped because we read as much as we wanted, we return
-        // GOT_MAX_OUTPUT (because the child may exit due to |SIGPIPE|).
-        if (!output_buf_left && bytes_read > 0)
-          return GOT_MAX_OUTPUT;
-        else if (success)
-          return EXECUTE_SUCCESS;
-        return EXECUTE_FAILURE;
-      }
+  int dev_null = HANDLE_EINTR(open("/dev/null", O_WRONLY));
+  if (dev_null < 0) {
+    close(pipe_fd[0]);
+    close(pipe_fd[1]);
+    return EXECUTE_FAILURE;
+  }
+
+  // The child's stdin is /dev/null, as LaunchProcess() makes it.
+  FileHandleMappingVector fds_to_remap;
+  fds_to_remap.push_back(std::make_pair(pipe_fd[1], STDOUT_FILENO));
+  fds_to_remap.push_back(std::make_pair(dev_null, STDERR_FILENO));
+  LaunchOptions options;
+  options.fds_to_remap = &fds_to_remap;
+  ProcessHandle pid;
+  const bool launched = LaunchProcessInternal(argv, options, envp, &pid);
+
+  // Close our writing end of pipe now. Otherwise later read would not
+  // be able to detect end of child's output (in theory we could still
+  // write to the pipe).
+  close(pipe_fd[1]);
+  close(dev_null);
+  if (!launched) {
+    close(pipe_fd[0]);
+    return EXECUTE_FAILURE;
+  }
+
+  output->clear();
+  char buffer[256];
+  size_t output_buf_left = max_output;
+  ssize_t bytes_read = 1;  // A lie to properly handle |max_output == 0|
+                           // case in the logic below.
+
+  while (output_buf_left > 0) {
+    bytes_read = HANDLE_EINTR(read(pipe_fd[0], buffer,
+                              std::min(output_buf_left, sizeof(buffer))));
+    if (bytes_read <= 0)
+      break;
+    output->append(buffer, bytes_read);
+    output_buf_left -= static_cast<size_t>(bytes_read);
   }
+  close(pipe_fd[0]);
+
+  // Always wait for exit code (even if we know we'll declare
+  // GOT_MAX_OUTPUT).
+  bool success = WaitForExitCode(pid, exit_code);
+
+  // If we stopped because we read as much as we wanted, we return
+  // GOT_MAX_OUTPUT (because the child may exit due to |SIGPIPE|).
+  if (!output_buf_left && bytes_read > 0)
+    return GOT_MAX_OUTPUT;
+  else if (success)
+    return EXECUTE_SUCCESS;
+  return EXECUTE_FAILURE;
 }
 
 bool GetAppOutput(const CommandLine& cl, std::string* output) {
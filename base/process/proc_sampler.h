@@ -0,0 +1,174 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_PROCESS_PROC_SAMPLER_H_
+#define BASE_PROCESS_PROC_SAMPLER_H_
+
+#include <sys/types.h>
+
+#include <string>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/time/time.h"
+
+namespace base {
+
+// ProcSampler samples the /proc files of many processes or threads in one
+// pass, for monitors which poll them every second or so. ProcessMetrics opens
+// and splits a file into strings for each value it returns; ProcSampler
+// keeps the files open, reads them with pread() into a buffer it reuses, and
+// parses them in place.
+//
+// An open file keeps referring to its process or thread after that exits,
+// so a sample is never of another process which has reused the pid. Each
+// file sampled takes a descriptor per process; when we run out, the files
+// are opened for each sample instead.
+//
+// Example:
+//
+//   ProcSampler sampler(ProcSampler::FIELD_CPU | ProcSampler::FIELD_MEMORY);
+//   for (size_t i = 0; i < pids.size(); ++i)
+//     sampler.AddProcess(pids[i]);
+//   std::vector<ProcSampler::Sample> samples;
+//   for (;;) {
+//     sampler.SampleAll(&samples);
+//     ...
+//     PlatformThread::Sleep(TimeDelta::FromSeconds(1));
+//   }
+//
+// Not thread safe.
+class BASE_EXPORT ProcSampler {
+ public:
+  // The values to sample, each of which reads a file per process.
+  enum Fields {
+    // From stat: the state, CPU time and number of threads.
+    FIELD_CPU = 1 << 0,
+    // From statm: the memory sizes.
+    FIELD_MEMORY = 1 << 1,
+    // From io: the I/O counters. Needs CONFIG_TASK_IO_ACCOUNTING, and the
+    // permission to ptrace the process.
+    FIELD_IO = 1 << 2,
+    // From schedstat: the time run and waited for a CPU. Needs
+    // CONFIG_SCHEDSTATS.
+    FIELD_SCHEDULING = 1 << 3,
+    // From status: the context switches.
+    FIELD_CONTEXT_SWITCHES = 1 << 4,
+  };
+
+  struct BASE_EXPORT Sample {
+    Sample();
+
+    pid_t pid;
+    // The thread sampled, or 0 for the whole process.
+    pid_t tid;
+
+    // False if the process or thread has exited, or a file couldn't be read
+    // or parsed. The other values are then zero.
+    bool valid;
+
+    // FIELD_CPU. The state is a letter, as ps shows: 'R' for running, 'S'
+    // for sleeping, and so on.
+    char state;
+    // |cpu_time| is |user_time| plus |system_time|, in clock ticks.
+    TimeDelta cpu_time;
+    TimeDelta user_time;
+    TimeDelta system_time;
+    // The CPU time used since the previous sample, as a percentage of the
+    // wall time, as ProcessMetrics::GetCPUUsage() returns: more than 100
+    // when threads use more than one CPU between them. Zero for the first.
+    double cpu_usage;
+    int num_threads;
+
+    // FIELD_MEMORY.
+    uint64 virtual_bytes;
+    uint64 resident_bytes;
+    uint64 shared_bytes;
+
+    // FIELD_IO. Bytes and calls, through read() and write() and the like.
+    uint64 read_bytes;
+    uint64 write_bytes;
+    uint64 read_ops;
+    uint64 write_ops;
+
+    // FIELD_SCHEDULING. The time on a CPU, to the nanosecond, and the time
+    // runnable but waiting for one, which is high for a starved thread.
+    TimeDelta run_time;
+    TimeDelta run_queue_wait;
+    // |run_queue_wait| since the previous sample, as a percentage of the wall
+    // time, like |cpu_usage|.
+    double run_queue_wait_usage;
+
+    // FIELD_CONTEXT_SWITCHES. Voluntary switches are those where the thread
+    // blocked; involuntary ones, where it was preempted.
+    uint64 voluntary_context_switches;
+    uint64 involuntary_context_switches;
+  };
+
+  // |fields| is a combination of Fields.
+  explicit ProcSampler(int fields);
+  ~ProcSampler();
+
+  // Adds a process, or one of its threads, to sample. Returns false if there
+  // is no such process or thread, or we may not read its files.
+  bool AddProcess(pid_t pid);
+  bool AddThread(pid_t pid, pid_t tid);
+
+  // Stops sampling a process or thread.
+  void RemoveProcess(pid_t pid);
+  void RemoveThread(pid_t pid, pid_t tid);
+
+  // Returns the number of processes and threads sampled.
+  size_t size() const { return targets_.size(); }
+
+  // Samples each process and thread, in the order added, into |samples|,
+  // whose storage is reused.
+  void SampleAll(std::vector<Sample>* samples);
+
+ private:
+  // The files sampled, per process or thread.
+  enum File {
+    FILE_STAT,
+    FILE_STATM,
+    FILE_IO,
+    FILE_SCHEDSTAT,
+    FILE_STATUS,
+    FILE_COUNT,
+  };
+
+  struct Target {
+    pid_t pid;
+    pid_t tid;
+    // "/proc/<pid>/" or "/proc/<pid>/task/<tid>/".
+    std::string dir;
+    // Open descriptors for the files sampled, or -1 to open them each time.
+    int fds[FILE_COUNT];
+    TimeTicks last_cpu_sample_time;
+    int64 last_cpu_ticks;
+    TimeTicks last_wait_sample_time;
+    TimeDelta last_run_queue_wait;
+  };
+
+  bool Add(pid_t pid, pid_t tid);
+  void Remove(pid_t pid, pid_t tid);
+
+  // Reads |file| of |target| into |buffer_|, which it grows to fit. Returns
+  // the number of bytes read, or -1 on failure.
+  ssize_t ReadFile(const Target& target, File file);
+
+  // Samples |target| into |sample|. Returns false if a file couldn't be
+  // read or parsed.
+  bool SampleTarget(Target* target, TimeTicks now, Sample* sample);
+
+  const int fields_;
+  std::vector<Target> targets_;
+  std::vector<char> buffer_;
+
+  DISALLOW_COPY_AND_ASSIGN(ProcSampler);
+};
+
+}  // namespace base
+
+#endif  // BASE_PROCESS_PROC_SAMPLER_H_
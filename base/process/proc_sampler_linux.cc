@@ -0,0 +1,383 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/process/proc_sampler.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "base/logging.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/strings/string_piece.h"
+#include "base/strings/stringprintf.h"
+
+namespace base {
+
+namespace {
+
+// Large enough for most of the files sampled; a stat line is under 400
+// bytes. A status file with long lists of groups or CPUs grows it.
+const size_t kBufferSize = 4096;
+
+// Indexed by ProcSampler::File. Each field is 1 << the file it reads.
+const char* const kFileNames[] = { "stat", "statm", "io", "schedstat",
+                                   "status" };
+
+// Splits the contents of a /proc file into the fields separated by spaces,
+// tabs and newlines, without copying them.
+class FieldScanner {
+ public:
+  explicit FieldScanner(const StringPiece& input) : input_(input), pos_(0) {}
+
+  // Returns the next field, or an empty one at the end.
+  StringPiece Next() {
+    while (pos_ < input_.size() && IsSeparator(input_[pos_]))
+      ++pos_;
+    const size_t start = pos_;
+    while (pos_ < input_.size() && !IsSeparator(input_[pos_]))
+      ++pos_;
+    return input_.substr(start, pos_ - start);
+  }
+
+  // Skips |count| fields. Returns false if there are fewer.
+  bool Skip(int count) {
+    for (int i = 0; i < count; ++i) {
+      if (Next().empty())
+        return false;
+    }
+    return true;
+  }
+
+  // Parses the next field as a decimal number. Returns false if it isn't one.
+  bool NextUint64(uint64* value) {
+    const StringPiece field = Next();
+    if (field.empty())
+      return false;
+    uint64 result = 0;
+    for (size_t i = 0; i < field.size(); ++i) {
+      if (field[i] < '0' || field[i] > '9')
+        return false;
+      result = result * 10 + (field[i] - '0');
+    }
+    *value = result;
+    return true;
+  }
+
+ private:
+  static bool IsSeparator(char c) {
+    return c == ' ' || c == '\n' || c == '\t';
+  }
+
+  const StringPiece input_;
+  size_t pos_;
+};
+
+TimeDelta ClockTicksToTimeDelta(int64 ticks) {
+  static const int64 kHertz = sysconf(_SC_CLK_TCK);
+  return TimeDelta::FromMicroseconds(
+      ticks * Time::kMicrosecondsPerSecond / kHertz);
+}
+
+// Parses the fields of /proc/<pid>/stat we sample, which are described in
+// man 5 proc, numbered from 1.
+bool ParseStat(const StringPiece& contents,
+               ProcSampler::Sample* sample,
+               int64* cpu_ticks) {
+  // The name in parentheses, the second field, may contain anything,
+  // including spaces and parentheses, so start after the last ')'.
+  const size_t name_end = contents.rfind(')');
+  if (name_end == StringPiece::npos)
+    return false;
+  FieldScanner scanner(contents.substr(name_end + 1));
+
+  const StringPiece state = scanner.Next();  // 3
+  uint64 utime;
+  uint64 stime;
+  uint64 num_threads;
+  if (state.size() != 1 ||
+      !scanner.Skip(10) ||  // 4 to 13.
+      !scanner.NextUint64(&utime) ||  // 14
+      !scanner.NextUint64(&stime) ||  // 15
+      !scanner.Skip(4) ||  // 16 to 19.
+      !scanner.NextUint64(&num_threads)) {  // 20
+    return false;
+  }
+  sample->state = state[0];
+  sample->num_threads = static_cast<int>(num_threads);
+  *cpu_ticks = utime + stime;
+  sample->cpu_time = ClockTicksToTimeDelta(*cpu_ticks);
+  sample->user_time = ClockTicksToTimeDelta(utime);
+  sample->system_time = ClockTicksToTimeDelta(stime);
+  return true;
+}
+
+bool ParseStatm(const StringPiece& contents, ProcSampler::Sample* sample) {
+  static const uint64 kPageSize = getpagesize();
+  FieldScanner scanner(contents);
+  uint64 size;
+  uint64 resident;
+  uint64 shared;
+  if (!scanner.NextUint64(&size) ||
+      !scanner.NextUint64(&resident) ||
+      !scanner.NextUint64(&shared)) {
+    return false;
+  }
+  sample->virtual_bytes = size * kPageSize;
+  sample->resident_bytes = resident * kPageSize;
+  sample->shared_bytes = shared * kPageSize;
+  return true;
+}
+
+bool ParseIo(const StringPiece& contents, ProcSampler::Sample* sample) {
+  FieldScanner scanner(contents);
+  int found = 0;
+  for (;;) {
+    const StringPiece key = scanner.Next();
+    uint64 value;
+    if (key.empty() || !scanner.NextUint64(&value))
+      break;
+    if (key == "rchar:") {
+      sample->read_bytes = value;
+    } else if (key == "wchar:") {
+      sample->write_bytes = value;
+    } else if (key == "syscr:") {
+      sample->read_ops = value;
+    } else if (key == "syscw:") {
+      sample->write_ops = value;
+    } else {
+      continue;
+    }
+    ++found;
+  }
+  return found == 4;
+}
+
+// schedstat is "<run ns> <wait ns> <timeslices>".
+bool ParseSchedstat(const StringPiece& contents, ProcSampler::Sample* sample) {
+  FieldScanner scanner(contents);
+  uint64 run_ns;
+  uint64 wait_ns;
+  if (!scanner.NextUint64(&run_ns) || !scanner.NextUint64(&wait_ns))
+    return false;
+  sample->run_time = TimeDelta::FromMicroseconds(
+      run_ns / Time::kNanosecondsPerMicrosecond);
+  sample->run_queue_wait = TimeDelta::FromMicroseconds(
+      wait_ns / Time::kNanosecondsPerMicrosecond);
+  return true;
+}
+
+// Finds the line of status starting with |key| and parses its value. Values
+// such as the name may contain spaces, so the lines before can't be split
+// into fields.
+bool FindStatusValue(const StringPiece& contents,
+                     const StringPiece& key,
+                     uint64* value) {
+  size_t pos = 0;
+  for (;;) {
+    pos = contents.find(key, pos);
+    if (pos == StringPiece::npos)
+      return false;
+    if (pos == 0 || contents[pos - 1] == '\n')
+      break;
+    pos += key.size();
+  }
+  FieldScanner scanner(contents.substr(pos + key.size()));
+  return scanner.NextUint64(value);
+}
+
+bool ParseStatus(const StringPiece& contents, ProcSampler::Sample* sample) {
+  return FindStatusValue(contents, "voluntary_ctxt_switches:",
+                         &sample->voluntary_context_switches) &&
+         FindStatusValue(contents, "nonvoluntary_ctxt_switches:",
+                         &sample->involuntary_context_switches);
+}
+
+}  // namespace
+
+ProcSampler::Sample::Sample()
+    : pid(0),
+      tid(0),
+      valid(false),
+      state(0),
+      cpu_usage(0),
+      num_threads(0),
+      virtual_bytes(0),
+      resident_bytes(0),
+      shared_bytes(0),
+      read_bytes(0),
+      write_bytes(0),
+      read_ops(0),
+      write_ops(0),
+      run_queue_wait_usage(0),
+      voluntary_context_switches(0),
+      involuntary_context_switches(0) {
+}
+
+ProcSampler::ProcSampler(int fields)
+    : fields_(fields),
+      buffer_(kBufferSize) {
+}
+
+ProcSampler::~ProcSampler() {
+  for (size_t i = 0; i < targets_.size(); ++i) {
+    for (int file = 0; file < FILE_COUNT; ++file) {
+      if (targets_[i].fds[file] >= 0)
+        close(targets_[i].fds[file]);
+    }
+  }
+}
+
+bool ProcSampler::AddProcess(pid_t pid) {
+  return Add(pid, 0);
+}
+
+bool ProcSampler::AddThread(pid_t pid, pid_t tid) {
+  return Add(pid, tid);
+}
+
+void ProcSampler::RemoveProcess(pid_t pid) {
+  Remove(pid, 0);
+}
+
+void ProcSampler::RemoveThread(pid_t pid, pid_t tid) {
+  Remove(pid, tid);
+}
+
+void ProcSampler::SampleAll(std::vector<Sample>* samples) {
+  samples->resize(targets_.size());
+  const TimeTicks now = TimeTicks::Now();
+  for (size_t i = 0; i < targets_.size(); ++i) {
+    Sample& sample = (*samples)[i];
+    sample = Sample();
+    if (SampleTarget(&targets_[i], now, &sample))
+      sample.valid = true;
+    else
+      sample = Sample();
+    sample.pid = targets_[i].pid;
+    sample.tid = targets_[i].tid;
+  }
+}
+
+bool ProcSampler::Add(pid_t pid, pid_t tid) {
+  Target target;
+  target.pid = pid;
+  target.tid = tid;
+  target.dir = tid ? StringPrintf("/proc/%d/task/%d/", pid, tid)
+                   : StringPrintf("/proc/%d/", pid);
+  target.last_cpu_ticks = -1;
+  bool opened = true;
+  for (int file = 0; file < FILE_COUNT; ++file) {
+    target.fds[file] = -1;
+    if (!opened || !(fields_ & (1 << file)))
+      continue;
+    const std::string path = target.dir + kFileNames[file];
+    target.fds[file] = HANDLE_EINTR(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+    // Out of descriptors, we open the file for each sample instead.
+    if (target.fds[file] < 0 && errno != EMFILE && errno != ENFILE)
+      opened = false;
+  }
+  if (!opened) {
+    for (int file = 0; file < FILE_COUNT; ++file) {
+      if (target.fds[file] >= 0)
+        close(target.fds[file]);
+    }
+    return false;
+  }
+  targets_.push_back(target);
+  return true;
+}
+
+void ProcSampler::Remove(pid_t pid, pid_t tid) {
+  for (size_t i = 0; i < targets_.size(); ++i) {
+    if (targets_[i].pid != pid || targets_[i].tid != tid)
+      continue;
+    for (int file = 0; file < FILE_COUNT; ++file) {
+      if (targets_[i].fds[file] >= 0)
+        close(targets_[i].fds[file]);
+    }
+    targets_.erase(targets_.begin() + i);
+    return;
+  }
+}
+
+ssize_t ProcSampler::ReadFile(const Target& target, File file) {
+  int fd = target.fds[file];
+  const bool opened = fd < 0;
+  if (opened) {
+    const std::string path = target.dir + kFileNames[file];
+    fd = HANDLE_EINTR(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+    if (fd < 0)
+      return -1;
+  }
+  // /proc files are generated whole on each read from offset 0, so a read
+  // which fills the buffer is retried with a larger one.
+  ssize_t size;
+  for (;;) {
+    size = HANDLE_EINTR(pread(fd, &buffer_[0], buffer_.size(), 0));
+    if (size < static_cast<ssize_t>(buffer_.size()))
+      break;
+    buffer_.resize(buffer_.size() * 2);
+  }
+  if (opened)
+    close(fd);
+  return size;
+}
+
+bool ProcSampler::SampleTarget(Target* target,
+                               TimeTicks now,
+                               Sample* sample) {
+  if (fields_ & FIELD_CPU) {
+    const ssize_t size = ReadFile(*target, FILE_STAT);
+    int64 cpu_ticks;
+    if (size <= 0 ||
+        !ParseStat(StringPiece(&buffer_[0], size), sample, &cpu_ticks)) {
+      return false;
+    }
+    if (target->last_cpu_ticks >= 0 && now > target->last_cpu_sample_time) {
+      sample->cpu_usage =
+          100.0 * ClockTicksToTimeDelta(cpu_ticks - target->last_cpu_ticks)
+                      .InSecondsF() /
+          (now - target->last_cpu_sample_time).InSecondsF();
+    }
+    target->last_cpu_ticks = cpu_ticks;
+    target->last_cpu_sample_time = now;
+  }
+
+  if (fields_ & FIELD_MEMORY) {
+    const ssize_t size = ReadFile(*target, FILE_STATM);
+    if (size <= 0 || !ParseStatm(StringPiece(&buffer_[0], size), sample))
+      return false;
+  }
+
+  if (fields_ & FIELD_IO) {
+    const ssize_t size = ReadFile(*target, FILE_IO);
+    if (size <= 0 || !ParseIo(StringPiece(&buffer_[0], size), sample))
+      return false;
+  }
+
+  if (fields_ & FIELD_SCHEDULING) {
+    const ssize_t size = ReadFile(*target, FILE_SCHEDSTAT);
+    if (size <= 0 || !ParseSchedstat(StringPiece(&buffer_[0], size), sample))
+      return false;
+    if (!target->last_wait_sample_time.is_null() &&
+        now > target->last_wait_sample_time) {
+      sample->run_queue_wait_usage =
+          100.0 * (sample->run_queue_wait - target->last_run_queue_wait)
+                      .InSecondsF() /
+          (now - target->last_wait_sample_time).InSecondsF();
+    }
+    target->last_run_queue_wait = sample->run_queue_wait;
+    target->last_wait_sample_time = now;
+  }
+
+  if (fields_ & FIELD_CONTEXT_SWITCHES) {
+    const ssize_t size = ReadFile(*target, FILE_STATUS);
+    if (size <= 0 || !ParseStatus(StringPiece(&buffer_[0], size), sample))
+      return false;
+  }
+  return true;
+}
+
+}  // namespace base
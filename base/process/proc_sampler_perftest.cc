@@ -0,0 +1,93 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/process/proc_sampler.h"
+
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "base/memory/scoped_vector.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/process/process_metrics.h"
+#include "base/test/perf_time_logger.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+const int kProcesses = 1000;
+const int kPasses = 20;
+
+class ProcSamplerPerfTest : public testing::Test {
+ protected:
+  virtual void SetUp() OVERRIDE {
+    // Room for a descriptor per process, with some to spare.
+    struct rlimit limit;
+    ASSERT_EQ(0, getrlimit(RLIMIT_NOFILE, &limit));
+    if (limit.rlim_cur < limit.rlim_max) {
+      limit.rlim_cur = limit.rlim_max;
+      setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    for (int i = 0; i < kProcesses; ++i) {
+      pid_t child = fork();
+      if (child == 0) {
+        pause();
+        _exit(0);
+      }
+      ASSERT_GT(child, 0);
+      children_.push_back(child);
+    }
+  }
+
+  virtual void TearDown() OVERRIDE {
+    for (size_t i = 0; i < children_.size(); ++i)
+      kill(children_[i], SIGKILL);
+    for (size_t i = 0; i < children_.size(); ++i)
+      HANDLE_EINTR(waitpid(children_[i], NULL, 0));
+  }
+
+  std::vector<pid_t> children_;
+};
+
+}  // namespace
+
+TEST_F(ProcSamplerPerfTest, ProcSampler) {
+  ProcSampler sampler(ProcSampler::FIELD_CPU | ProcSampler::FIELD_MEMORY);
+  for (size_t i = 0; i < children_.size(); ++i)
+    ASSERT_TRUE(sampler.AddProcess(children_[i]));
+  std::vector<ProcSampler::Sample> samples;
+
+  PerfTimeLogger timer("proc_sampler_1000_processes_20_passes");
+  for (int pass = 0; pass < kPasses; ++pass)
+    sampler.SampleAll(&samples);
+  timer.Done();
+
+  for (size_t i = 0; i < samples.size(); ++i)
+    EXPECT_TRUE(samples[i].valid);
+}
+
+TEST_F(ProcSamplerPerfTest, ProcessMetrics) {
+  ScopedVector<ProcessMetrics> metrics;
+  for (size_t i = 0; i < children_.size(); ++i)
+    metrics.push_back(ProcessMetrics::CreateProcessMetrics(children_[i]));
+
+  PerfTimeLogger timer("process_metrics_1000_processes_20_passes");
+  for (int pass = 0; pass < kPasses; ++pass) {
+    for (size_t i = 0; i < metrics.size(); ++i) {
+      metrics[i]->GetCPUUsage();
+      WorkingSetKBytes working_set;
+      metrics[i]->GetWorkingSetKBytes(&working_set);
+      metrics[i]->GetPagefileUsage();
+    }
+  }
+  timer.Done();
+}
+
+}  // namespace base
@@ -0,0 +1,170 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/process/proc_sampler.h"
+
+#include <signal.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "base/posix/eintr_wrapper.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/platform_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+// Spins for |duration| of wall time.
+void BurnCPU(TimeDelta duration) {
+  const TimeTicks end = TimeTicks::Now() + duration;
+  volatile int sink = 0;
+  while (TimeTicks::Now() < end) {
+    for (int i = 0; i < 10000; ++i)
+      sink += i;
+  }
+}
+
+// A thread with a name that would trip up splitting /proc/<pid>/stat on
+// spaces and parentheses, which waits to be told to exit.
+class OddlyNamedThread : public PlatformThread::Delegate {
+ public:
+  OddlyNamedThread() : started_(false, false), exit_(false, false), tid_(0) {}
+
+  virtual void ThreadMain() OVERRIDE {
+    prctl(PR_SET_NAME, "a) b (c", 0, 0, 0);
+    tid_ = PlatformThread::CurrentId();
+    started_.Signal();
+    exit_.Wait();
+  }
+
+  PlatformThreadId Start(PlatformThreadHandle* handle) {
+    EXPECT_TRUE(PlatformThread::Create(0, this, handle));
+    started_.Wait();
+    return tid_;
+  }
+
+  void Exit() { exit_.Signal(); }
+
+ private:
+  WaitableEvent started_;
+  WaitableEvent exit_;
+  PlatformThreadId tid_;
+};
+
+}  // namespace
+
+TEST(ProcSamplerTest, Self) {
+  ProcSampler sampler(ProcSampler::FIELD_CPU | ProcSampler::FIELD_MEMORY |
+                      ProcSampler::FIELD_IO);
+  ASSERT_TRUE(sampler.AddProcess(getpid()));
+  std::vector<ProcSampler::Sample> samples;
+  sampler.SampleAll(&samples);
+  ASSERT_EQ(1u, samples.size());
+  ProcSampler::Sample first = samples[0];
+  EXPECT_TRUE(first.valid);
+  EXPECT_EQ(getpid(), first.pid);
+  EXPECT_EQ(0, first.tid);
+  EXPECT_EQ('R', first.state);
+  EXPECT_EQ(0, first.cpu_usage);
+  EXPECT_GE(first.num_threads, 1);
+  EXPECT_GT(first.resident_bytes, 0u);
+  EXPECT_GE(first.virtual_bytes, first.resident_bytes);
+  EXPECT_GT(first.read_bytes, 0u);
+
+  BurnCPU(TimeDelta::FromMilliseconds(200));
+  sampler.SampleAll(&samples);
+  ASSERT_TRUE(samples[0].valid);
+  EXPECT_GT(samples[0].cpu_time, first.cpu_time);
+  EXPECT_GT(samples[0].cpu_usage, 20);
+  EXPECT_LT(samples[0].cpu_usage, 200);
+}
+
+TEST(ProcSamplerTest, Thread) {
+  OddlyNamedThread thread;
+  PlatformThreadHandle handle;
+  PlatformThreadId tid = thread.Start(&handle);
+
+  ProcSampler sampler(ProcSampler::FIELD_CPU);
+  ASSERT_TRUE(sampler.AddThread(getpid(), tid));
+  ASSERT_TRUE(sampler.AddThread(getpid(), PlatformThread::CurrentId()));
+  EXPECT_EQ(2u, sampler.size());
+  std::vector<ProcSampler::Sample> samples;
+  sampler.SampleAll(&samples);
+  ASSERT_EQ(2u, samples.size());
+  ASSERT_TRUE(samples[0].valid);
+  EXPECT_EQ(tid, samples[0].tid);
+  EXPECT_EQ('S', samples[0].state);
+  ASSERT_TRUE(samples[1].valid);
+  EXPECT_EQ('R', samples[1].state);
+
+  // An exited thread is sampled as invalid rather than as another.
+  thread.Exit();
+  PlatformThread::Join(handle);
+  sampler.SampleAll(&samples);
+  EXPECT_FALSE(samples[0].valid);
+  EXPECT_EQ(tid, samples[0].tid);
+  EXPECT_TRUE(samples[1].valid);
+
+  sampler.RemoveThread(getpid(), tid);
+  sampler.SampleAll(&samples);
+  ASSERT_EQ(1u, samples.size());
+  EXPECT_EQ(PlatformThread::CurrentId(), samples[0].tid);
+}
+
+TEST(ProcSamplerTest, Scheduling) {
+  int fields = ProcSampler::FIELD_CPU | ProcSampler::FIELD_CONTEXT_SWITCHES;
+  const bool has_schedstat = access("/proc/self/schedstat", R_OK) == 0;
+  if (has_schedstat)
+    fields |= ProcSampler::FIELD_SCHEDULING;
+  ProcSampler sampler(fields);
+  ASSERT_TRUE(sampler.AddThread(getpid(), PlatformThread::CurrentId()));
+  std::vector<ProcSampler::Sample> samples;
+  sampler.SampleAll(&samples);
+  ProcSampler::Sample first = samples[0];
+  ASSERT_TRUE(first.valid);
+  EXPECT_EQ(first.cpu_time, first.user_time + first.system_time);
+
+  // Each sleep blocks, which is a voluntary switch.
+  for (int i = 0; i < 10; ++i)
+    PlatformThread::Sleep(TimeDelta::FromMilliseconds(1));
+  BurnCPU(TimeDelta::FromMilliseconds(100));
+  sampler.SampleAll(&samples);
+  ASSERT_TRUE(samples[0].valid);
+  EXPECT_GE(samples[0].voluntary_context_switches,
+            first.voluntary_context_switches + 10);
+  EXPECT_GE(samples[0].involuntary_context_switches,
+            first.involuntary_context_switches);
+  if (has_schedstat) {
+    EXPECT_GE(samples[0].run_time - first.run_time,
+              TimeDelta::FromMilliseconds(50));
+    EXPECT_GE(samples[0].run_queue_wait, first.run_queue_wait);
+    EXPECT_GE(samples[0].run_queue_wait_usage, 0);
+  }
+}
+
+TEST(ProcSamplerTest, ExitedProcess) {
+  pid_t child = fork();
+  if (child == 0) {
+    pause();
+    _exit(0);
+  }
+  ASSERT_GT(child, 0);
+
+  ProcSampler sampler(ProcSampler::FIELD_CPU | ProcSampler::FIELD_MEMORY);
+  ASSERT_TRUE(sampler.AddProcess(child));
+  std::vector<ProcSampler::Sample> samples;
+  sampler.SampleAll(&samples);
+  EXPECT_TRUE(samples[0].valid);
+
+  ASSERT_EQ(0, kill(child, SIGKILL));
+  ASSERT_EQ(child, HANDLE_EINTR(waitpid(child, NULL, 0)));
+  sampler.SampleAll(&samples);
+  EXPECT_FALSE(samples[0].valid);
+  EXPECT_FALSE(sampler.AddProcess(child));
+}
+
+}  // namespace base
@@ -101,7 +101,9 @@ BASE_EXPORT int64 TimeValToMicroseconds(const struct timeval& tv);
 // Provides performance metrics for a specified process (CPU usage, memory and
 // IO counters). To use it, invoke CreateProcessMetrics() to get an instance
 // for a specific process, then access the information with the different get
-// methods.
+// methods. To sample many processes or threads periodically on Linux, see
+// ProcSampler, which is much cheaper, and for the threads of this process,
+// ThreadMetrics.
 class BASE_EXPORT ProcessMetrics {
  public:
   ~ProcessMetrics();
@@ -0,0 +1,103 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_PROCESS_PROCESS_REAPER_H_
+#define BASE_PROCESS_PROCESS_REAPER_H_
+
+#include <map>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/callback.h"
+#include "base/process/kill.h"
+#include "base/process/process_handle.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/platform_thread.h"
+
+namespace base {
+
+// ProcessReaper waits for any number of child processes at once, on a thread
+// of its own, and reaps each as soon as it exits. It waits on a pidfd for
+// each child, all in one epoll set, so that it needs neither a thread per
+// child nor a SIGCHLD handler. On kernels without pidfds (before Linux 5.3)
+// it polls the children with waitpid() every 100 ms instead.
+//
+// Example:
+//
+//   void OnExit(ProcessHandle process, TerminationStatus status,
+//               int exit_code) {
+//     ...
+//   }
+//
+//   ProcessReaper reaper;
+//   for (size_t i = 0; i < children.size(); ++i)
+//     reaper.Watch(children[i], Bind(&OnExit));
+class BASE_EXPORT ProcessReaper : public PlatformThread::Delegate {
+ public:
+  // Runs on the reaper thread once |process| has been reaped, with the
+  // results of GetTerminationStatus() for it. The callbacks run one at a
+  // time, and should return quickly.
+  typedef Callback<void(ProcessHandle process,
+                        TerminationStatus status,
+                        int exit_code)> ExitCallback;
+
+  ProcessReaper();
+
+  // Stops the reaper thread. The processes still being watched are left
+  // unreaped, and their callbacks are not run. Must not be called from a
+  // callback.
+  virtual ~ProcessReaper();
+
+  // Reaps |process| once it exits, and then runs |callback|. |process| must
+  // be a child of this process that nothing else waits for, and that isn't
+  // being watched already. Returns false if there is no such process. May be
+  // called from a callback.
+  bool Watch(ProcessHandle process, const ExitCallback& callback);
+
+  // Returns the number of processes being watched.
+  size_t GetWatchedCount();
+
+ private:
+  struct Child {
+    Child();
+
+    // The pidfd in |epoll_fd_|, or -1 if the child is polled instead.
+    int pidfd;
+    ExitCallback callback;
+  };
+
+  typedef std::map<ProcessHandle, Child> ChildMap;
+
+  // PlatformThread::Delegate:
+  virtual void ThreadMain() OVERRIDE;
+
+  // Reaps those of |candidates| that have exited, and runs their callbacks.
+  void ReapChildren(const std::vector<ProcessHandle>& candidates);
+
+  // Wakes the reaper thread up.
+  void Wake();
+
+  int epoll_fd_;
+  int wakeup_fd_;
+
+  // Protects the members below.
+  Lock lock_;
+
+  ChildMap children_;
+
+  // The children without a pidfd.
+  std::vector<ProcessHandle> polled_children_;
+
+  bool thread_started_;
+  bool stopping_;
+  PlatformThreadHandle thread_;
+  PlatformThreadId thread_id_;
+
+  DISALLOW_COPY_AND_ASSIGN(ProcessReaper);
+};
+
+}  // namespace base
+
+#endif  // BASE_PROCESS_PROCESS_REAPER_H_
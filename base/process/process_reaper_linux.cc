@@ -0,0 +1,215 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/process/process_reaper.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "base/logging.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/process/internal_linux.h"
+
+namespace base {
+
+namespace {
+
+// How often the children without a pidfd are polled.
+const int kPollIntervalMs = 100;
+
+// The most events taken from the epoll set at once.
+const int kMaxEvents = 64;
+
+// The epoll data of the wakeup eventfd. Children are keyed by their pid,
+// which is positive, and which can't be reused before we reap them.
+const uint64_t kWakeupKey = 0;
+
+}  // namespace
+
+ProcessReaper::Child::Child() : pidfd(-1) {
+}
+
+ProcessReaper::ProcessReaper()
+    : epoll_fd_(epoll_create1(EPOLL_CLOEXEC)),
+      wakeup_fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+      thread_started_(false),
+      stopping_(false),
+      thread_id_(kInvalidThreadId) {
+  DPCHECK(epoll_fd_ >= 0) << "epoll_create1";
+  DPCHECK(wakeup_fd_ >= 0) << "eventfd";
+  struct epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.u64 = kWakeupKey;
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wakeup_fd_, &event) != 0)
+    DPLOG(ERROR) << "epoll_ctl";
+}
+
+ProcessReaper::~ProcessReaper() {
+  bool thread_started;
+  {
+    AutoLock lock(lock_);
+    DCHECK_NE(thread_id_, PlatformThread::CurrentId())
+        << "ProcessReaper deleted from its own callback";
+    stopping_ = true;
+    thread_started = thread_started_;
+  }
+  if (thread_started) {
+    Wake();
+    PlatformThread::Join(thread_);
+  }
+
+  for (ChildMap::iterator it = children_.begin(); it != children_.end();
+       ++it) {
+    if (it->second.pidfd >= 0)
+      close(it->second.pidfd);
+  }
+  close(wakeup_fd_);
+  close(epoll_fd_);
+}
+
+bool ProcessReaper::Watch(ProcessHandle process,
+                          const ExitCallback& callback) {
+  DCHECK_GT(process, 0);
+  int pidfd = internal::OpenPidFd(process);
+  if (pidfd < 0 && errno == ESRCH)
+    return false;
+
+  AutoLock lock(lock_);
+  DCHECK(!stopping_);
+  DCHECK(children_.find(process) == children_.end())
+      << "Process " << process << " is already being watched";
+  if (pidfd >= 0) {
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = static_cast<uint64_t>(process);
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, pidfd, &event) != 0) {
+      DPLOG(ERROR) << "epoll_ctl";
+      close(pidfd);
+      return false;
+    }
+  } else {
+    polled_children_.push_back(process);
+  }
+  Child& child = children_[process];
+  child.pidfd = pidfd;
+  child.callback = callback;
+
+  if (!thread_started_) {
+    if (!PlatformThread::Create(0, this, &thread_)) {
+      DLOG(ERROR) << "Failed to start the ProcessReaper thread";
+      if (pidfd >= 0)
+        close(pidfd);
+      else
+        polled_children_.pop_back();
+      children_.erase(process);
+      return false;
+    }
+    thread_started_ = true;
+  } else if (pidfd < 0 && polled_children_.size() == 1) {
+    // The thread sleeps for as long as it takes a pidfd to become readable,
+    // so tell it to start polling.
+    Wake();
+  }
+  return true;
+}
+
+size_t ProcessReaper::GetWatchedCount() {
+  AutoLock lock(lock_);
+  return children_.size();
+}
+
+void ProcessReaper::ThreadMain() {
+  PlatformThread::SetName("ProcessReaper");
+  {
+    AutoLock lock(lock_);
+    thread_id_ = PlatformThread::CurrentId();
+  }
+
+  struct epoll_event events[kMaxEvents];
+  std::vector<ProcessHandle> candidates;
+  for (;;) {
+    int timeout = -1;
+    {
+      AutoLock lock(lock_);
+      if (stopping_)
+        return;
+      if (!polled_children_.empty())
+        timeout = kPollIntervalMs;
+    }
+
+    int count = HANDLE_EINTR(epoll_wait(epoll_fd_, events, kMaxEvents,
+                                        timeout));
+    if (count < 0) {
+      DPLOG(ERROR) << "epoll_wait";
+      return;
+    }
+
+    candidates.clear();
+    for (int i = 0; i < count; ++i) {
+      if (events[i].data.u64 == kWakeupKey) {
+        uint64_t value;
+        if (HANDLE_EINTR(read(wakeup_fd_, &value, sizeof(value))) < 0 &&
+            errno != EAGAIN) {
+          DPLOG(ERROR) << "read";
+        }
+      } else {
+        candidates.push_back(static_cast<ProcessHandle>(events[i].data.u64));
+      }
+    }
+    {
+      AutoLock lock(lock_);
+      candidates.insert(candidates.end(), polled_children_.begin(),
+                        polled_children_.end());
+    }
+    ReapChildren(candidates);
+  }
+}
+
+void ProcessReaper::ReapChildren(
+    const std::vector<ProcessHandle>& candidates) {
+  std::vector<std::pair<ProcessHandle, ExitCallback> > exited;
+  std::vector<std::pair<TerminationStatus, int> > statuses;
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    int exit_code = 0;
+    TerminationStatus status = GetTerminationStatus(candidates[i], &exit_code);
+    if (status == TERMINATION_STATUS_STILL_RUNNING)
+      continue;
+
+    AutoLock lock(lock_);
+    ChildMap::iterator it = children_.find(candidates[i]);
+    DCHECK(it != children_.end());
+    if (it->second.pidfd >= 0) {
+      // Closing the pidfd alone leaves it in the epoll set if a child forked
+      // since has a copy of it.
+      if (epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, it->second.pidfd, NULL) != 0)
+        DPLOG(ERROR) << "epoll_ctl";
+      close(it->second.pidfd);
+    } else {
+      polled_children_.erase(std::find(polled_children_.begin(),
+                                       polled_children_.end(),
+                                       candidates[i]));
+    }
+    exited.push_back(std::make_pair(candidates[i], it->second.callback));
+    statuses.push_back(std::make_pair(status, exit_code));
+    children_.erase(it);
+  }
+
+  // The callbacks may watch more processes.
+  for (size_t i = 0; i < exited.size(); ++i)
+    exited[i].second.Run(exited[i].first, statuses[i].first,
+                         statuses[i].second);
+}
+
+void ProcessReaper::Wake() {
+  uint64_t value = 1;
+  if (HANDLE_EINTR(write(wakeup_fd_, &value, sizeof(value))) < 0)
+    DPLOG(ERROR) << "write";
+}
+
+}  // namespace base
@@ -0,0 +1,169 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/process/process_reaper.h"
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <map>
+
+#include "base/bind.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/synchronization/condition_variable.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+// Forks a child that exits with |exit_code| after |delay|.
+ProcessHandle ForkChild(int exit_code, TimeDelta delay) {
+  pid_t pid = fork();
+  if (pid == 0) {
+    usleep(delay.InMicroseconds());
+    _exit(exit_code);
+  }
+  return pid;
+}
+
+// Records the exits, which are reported on the reaper thread.
+class ExitRecorder {
+ public:
+  ExitRecorder() : condition_(&lock_) {}
+
+  void OnExit(ProcessHandle process, TerminationStatus status, int exit_code) {
+    AutoLock lock(lock_);
+    EXPECT_TRUE(exits_.insert(
+        std::make_pair(process, std::make_pair(status, exit_code))).second);
+    condition_.Broadcast();
+  }
+
+  // Waits until |count| exits have been recorded, or times out.
+  bool WaitForExits(size_t count) {
+    const TimeTicks deadline = TimeTicks::Now() + TimeDelta::FromSeconds(10);
+    AutoLock lock(lock_);
+    while (exits_.size() < count) {
+      TimeDelta remaining = deadline - TimeTicks::Now();
+      if (remaining <= TimeDelta())
+        return false;
+      condition_.TimedWait(remaining);
+    }
+    return true;
+  }
+
+  std::map<ProcessHandle, std::pair<TerminationStatus, int> > exits() {
+    AutoLock lock(lock_);
+    return exits_;
+  }
+
+ private:
+  Lock lock_;
+  ConditionVariable condition_;
+  std::map<ProcessHandle, std::pair<TerminationStatus, int> > exits_;
+};
+
+// Watches a second child from the callback for the first.
+void WatchAnother(ProcessReaper* reaper,
+                  ExitRecorder* recorder,
+                  ProcessHandle* second,
+                  ProcessHandle process,
+                  TerminationStatus status,
+                  int exit_code) {
+  *second = ForkChild(0, TimeDelta());
+  EXPECT_TRUE(reaper->Watch(*second, Bind(&ExitRecorder::OnExit,
+                                          Unretained(recorder))));
+  recorder->OnExit(process, status, exit_code);
+}
+
+}  // namespace
+
+TEST(ProcessReaperTest, ReapsMany) {
+  ExitRecorder recorder;
+  ProcessReaper reaper;
+  std::vector<ProcessHandle> children;
+  for (int i = 0; i < 20; ++i) {
+    ProcessHandle child =
+        ForkChild(i, TimeDelta::FromMilliseconds((i % 5) * 20));
+    ASSERT_GT(child, 0);
+    children.push_back(child);
+    ASSERT_TRUE(reaper.Watch(child, Bind(&ExitRecorder::OnExit,
+                                         Unretained(&recorder))));
+  }
+  // One which has exited already.
+  ProcessHandle exited = ForkChild(0, TimeDelta());
+  ASSERT_GT(exited, 0);
+  children.push_back(exited);
+  usleep(50000);
+  ASSERT_TRUE(reaper.Watch(exited, Bind(&ExitRecorder::OnExit,
+                                        Unretained(&recorder))));
+
+  ASSERT_TRUE(recorder.WaitForExits(children.size()));
+  std::map<ProcessHandle, std::pair<TerminationStatus, int> > exits =
+      recorder.exits();
+  for (size_t i = 0; i < children.size(); ++i) {
+    std::pair<TerminationStatus, int> exit = exits[children[i]];
+    int code = i < 20 ? static_cast<int>(i) : 0;
+    EXPECT_EQ(code ? TERMINATION_STATUS_ABNORMAL_TERMINATION
+                   : TERMINATION_STATUS_NORMAL_TERMINATION, exit.first);
+    EXPECT_TRUE(WIFEXITED(exit.second));
+    EXPECT_EQ(code, WEXITSTATUS(exit.second));
+    // They were reaped.
+    EXPECT_EQ(-1, HANDLE_EINTR(waitpid(children[i], NULL, WNOHANG)));
+  }
+  EXPECT_EQ(0u, reaper.GetWatchedCount());
+}
+
+TEST(ProcessReaperTest, Killed) {
+  ExitRecorder recorder;
+  ProcessReaper reaper;
+  ProcessHandle child = ForkChild(0, TimeDelta::FromSeconds(60));
+  ASSERT_GT(child, 0);
+  ASSERT_TRUE(reaper.Watch(child, Bind(&ExitRecorder::OnExit,
+                                       Unretained(&recorder))));
+  EXPECT_EQ(1u, reaper.GetWatchedCount());
+  ASSERT_EQ(0, kill(child, SIGKILL));
+  ASSERT_TRUE(recorder.WaitForExits(1));
+  EXPECT_EQ(TERMINATION_STATUS_PROCESS_WAS_KILLED,
+            recorder.exits()[child].first);
+}
+
+TEST(ProcessReaperTest, WatchFromCallback) {
+  ExitRecorder recorder;
+  ProcessReaper reaper;
+  ProcessHandle second = 0;
+  ProcessHandle first = ForkChild(0, TimeDelta());
+  ASSERT_GT(first, 0);
+  ASSERT_TRUE(reaper.Watch(first, Bind(&WatchAnother, &reaper, &recorder,
+                                       &second)));
+  ASSERT_TRUE(recorder.WaitForExits(2));
+  EXPECT_EQ(1u, recorder.exits().count(first));
+  EXPECT_EQ(1u, recorder.exits().count(second));
+}
+
+TEST(ProcessReaperTest, NoSuchProcess) {
+  ProcessReaper reaper;
+  ProcessHandle child = ForkChild(0, TimeDelta());
+  ASSERT_GT(child, 0);
+  ASSERT_EQ(child, HANDLE_EINTR(waitpid(child, NULL, 0)));
+  ExitRecorder recorder;
+  EXPECT_FALSE(reaper.Watch(child, Bind(&ExitRecorder::OnExit,
+                                        Unretained(&recorder))));
+}
+
+TEST(ProcessReaperTest, WaitForExitCodeWithTimeout) {
+  // The wait returns as soon as the child exits, and times out otherwise.
+  ProcessHandle child = ForkChild(3, TimeDelta::FromMilliseconds(300));
+  ASSERT_GT(child, 0);
+  int exit_code = 0;
+  EXPECT_FALSE(WaitForExitCodeWithTimeout(child, &exit_code,
+                                          TimeDelta::FromMilliseconds(10)));
+  EXPECT_TRUE(WaitForExitCodeWithTimeout(child, &exit_code,
+                                         TimeDelta::FromSeconds(10)));
+  EXPECT_EQ(3, exit_code);
+}
+
+}  // namespace base
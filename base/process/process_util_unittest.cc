@@ -9,7 +9,9 @@
 #include "base/command_line.h"
 #include "base/debug/alias.h"
 #include "base/debug/stack_trace.h"
+#include "base/file_util.h"
 #include "base/files/file_path.h"
+#include "base/files/scoped_temp_dir.h"
 #include "base/logging.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/path_service.h"
@@ -40,6 +42,7 @@
 #include <signal.h>
 #include <sys/resource.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/wait.h>
 #endif
 #if defined(OS_WIN)
@@ -670,6 +673,74 @@ TEST_F(ProcessUtilTest, LaunchProcess) {
 #endif
 }
 
+#if defined(OS_LINUX)
+TEST_F(ProcessUtilTest, LaunchProcessVfork) {
+  // The child remaps descriptors, alters its environment and searches the
+  // altered PATH alike, whether it borrows our address space or copies it.
+  for (int use_vfork = 0; use_vfork < 2; ++use_vfork) {
+    std::vector<std::string> args;
+    args.push_back("sh");
+    args.push_back("-c");
+    args.push_back("echo $BASE_TEST");
+
+    int fds[2];
+    PCHECK(pipe(fds) == 0);
+    base::FileHandleMappingVector fds_to_remap;
+    fds_to_remap.push_back(std::make_pair(fds[1], 1));
+    base::LaunchOptions options;
+    options.wait = true;
+    options.use_vfork = use_vfork != 0;
+    options.environ["BASE_TEST"] = "vfork";
+    options.environ["PATH"] = "/nonexistent:/bin:/usr/bin";
+    options.fds_to_remap = &fds_to_remap;
+    EXPECT_TRUE(base::LaunchProcess(args, options, NULL));
+    PCHECK(HANDLE_EINTR(close(fds[1])) == 0);
+
+    char buf[512];
+    const ssize_t n = HANDLE_EINTR(read(fds[0], buf, sizeof(buf)));
+    PCHECK(n > 0);
+    PCHECK(HANDLE_EINTR(close(fds[0])) == 0);
+    EXPECT_EQ("vfork\n", std::string(buf, n));
+  }
+}
+
+TEST_F(ProcessUtilTest, LaunchProcessScriptWithoutInterpreter) {
+  // Like execvp(), a script found on the PATH without a "#!" line is run
+  // with the shell.
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  const base::FilePath script = temp_dir.path().AppendASCII("script");
+  const char kScript[] = "echo script \"$1\"\n";
+  ASSERT_EQ(static_cast<int>(sizeof(kScript) - 1),
+            file_util::WriteFile(script, kScript, sizeof(kScript) - 1));
+  ASSERT_EQ(0, chmod(script.value().c_str(), 0700));
+
+  for (int use_vfork = 0; use_vfork < 2; ++use_vfork) {
+    std::vector<std::string> args;
+    args.push_back("script");
+    args.push_back("arg");
+
+    int fds[2];
+    PCHECK(pipe(fds) == 0);
+    base::FileHandleMappingVector fds_to_remap;
+    fds_to_remap.push_back(std::make_pair(fds[1], 1));
+    base::LaunchOptions options;
+    options.wait = true;
+    options.use_vfork = use_vfork != 0;
+    options.environ["PATH"] = "/nonexistent:" + temp_dir.path().value();
+    options.fds_to_remap = &fds_to_remap;
+    EXPECT_TRUE(base::LaunchProcess(args, options, NULL));
+    PCHECK(HANDLE_EINTR(close(fds[1])) == 0);
+
+    char buf[512];
+    const ssize_t n = HANDLE_EINTR(read(fds[0], buf, sizeof(buf)));
+    PCHECK(n > 0);
+    PCHECK(HANDLE_EINTR(close(fds[0])) == 0);
+    EXPECT_EQ("script arg\n", std::string(buf, n));
+  }
+}
+#endif  // defined(OS_LINUX)
+
 TEST_F(ProcessUtilTest, GetAppOutput) {
   std::string output;
 
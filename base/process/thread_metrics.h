@@ -0,0 +1,98 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_PROCESS_THREAD_METRICS_H_
+#define BASE_PROCESS_THREAD_METRICS_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/process/proc_sampler.h"
+#include "base/threading/platform_thread.h"
+#include "base/time/time.h"
+
+namespace base {
+
+// ThreadMetrics takes snapshots of the CPU and scheduling metrics of each
+// thread of the current process, where ProcessMetrics gives only the totals.
+// A thread using most of a CPU is hot; one with a high run queue wait is
+// runnable but starved of a CPU, and one with many involuntary context
+// switches is being preempted.
+//
+// The thread files are kept open between snapshots, through a ProcSampler,
+// so that a snapshot a second is cheap even with hundreds of threads.
+//
+// Example:
+//
+//   ThreadMetrics metrics;
+//   std::vector<ThreadMetrics::Snapshot> threads;
+//   for (;;) {
+//     metrics.TakeSnapshot(&threads);
+//     for (size_t i = 0; i < threads.size(); ++i) {
+//       if (threads[i].run_queue_wait_usage > 20)
+//         LOG(WARNING) << threads[i].name << " is starved";
+//     }
+//     PlatformThread::Sleep(TimeDelta::FromSeconds(1));
+//   }
+//
+// Not thread safe.
+class BASE_EXPORT ThreadMetrics {
+ public:
+  struct BASE_EXPORT Snapshot {
+    Snapshot();
+
+    PlatformThreadId id;
+    // The name given to PlatformThread::SetName(), from ThreadIdNameManager,
+    // or the kernel's name for threads it doesn't know about.
+    std::string name;
+
+    TimeDelta user_time;
+    TimeDelta system_time;
+    // The CPU time used since the previous snapshot, as a percentage of the
+    // wall time: at most 100. Zero in the first snapshot of a thread.
+    double cpu_usage;
+
+    // The time runnable but waiting for a CPU, and the share of the wall time
+    // since the previous snapshot spent so. Zero without CONFIG_SCHEDSTATS.
+    TimeDelta run_queue_wait;
+    double run_queue_wait_usage;
+
+    uint64 voluntary_context_switches;
+    uint64 involuntary_context_switches;
+  };
+
+  ThreadMetrics();
+  ~ThreadMetrics();
+
+  // Takes a snapshot of each thread of the process, in order of id, into
+  // |threads|. Threads started since the previous snapshot are added, and
+  // those which have exited are dropped. Returns false if the threads can't
+  // be listed.
+  bool TakeSnapshot(std::vector<Snapshot>* threads);
+
+ private:
+  // Lists the threads of the process into |tids|, in order.
+  bool ListThreads(std::vector<PlatformThreadId>* tids);
+
+  // Adds the threads in |tids| which aren't being sampled, and removes
+  // those sampled which aren't in |tids|.
+  void UpdateThreads(const std::vector<PlatformThreadId>& tids);
+
+  const pid_t pid_;
+  ProcSampler sampler_;
+  // The kernel's names of the threads sampled, read once when added.
+  std::map<PlatformThreadId, std::string> kernel_names_;
+
+  std::vector<PlatformThreadId> tids_;
+  std::vector<ProcSampler::Sample> samples_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadMetrics);
+};
+
+}  // namespace base
+
+#endif  // BASE_PROCESS_THREAD_METRICS_H_
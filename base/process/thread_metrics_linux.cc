@@ -0,0 +1,139 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/process/thread_metrics.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "base/file_util.h"
+#include "base/files/dir_reader_posix.h"
+#include "base/files/file_path.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/stringprintf.h"
+#include "base/threading/thread_id_name_manager.h"
+
+namespace base {
+
+namespace {
+
+// schedstat exists only with CONFIG_SCHEDSTATS; without it, every sample of
+// it would fail.
+int SampledFields() {
+  int fields = ProcSampler::FIELD_CPU | ProcSampler::FIELD_CONTEXT_SWITCHES;
+  if (access("/proc/self/schedstat", R_OK) == 0)
+    fields |= ProcSampler::FIELD_SCHEDULING;
+  return fields;
+}
+
+bool CompareSnapshotIds(const ThreadMetrics::Snapshot& a,
+                        const ThreadMetrics::Snapshot& b) {
+  return a.id < b.id;
+}
+
+}  // namespace
+
+ThreadMetrics::Snapshot::Snapshot()
+    : id(kInvalidThreadId),
+      cpu_usage(0),
+      run_queue_wait_usage(0),
+      voluntary_context_switches(0),
+      involuntary_context_switches(0) {
+}
+
+ThreadMetrics::ThreadMetrics()
+    : pid_(getpid()),
+      sampler_(SampledFields()) {
+}
+
+ThreadMetrics::~ThreadMetrics() {
+}
+
+bool ThreadMetrics::TakeSnapshot(std::vector<Snapshot>* threads) {
+  threads->clear();
+  if (!ListThreads(&tids_))
+    return false;
+  UpdateThreads(tids_);
+
+  sampler_.SampleAll(&samples_);
+  ThreadIdNameManager* names = ThreadIdNameManager::GetInstance();
+  threads->reserve(samples_.size());
+  for (size_t i = 0; i < samples_.size(); ++i) {
+    const ProcSampler::Sample& sample = samples_[i];
+    if (!sample.valid) {
+      // The thread has exited since it was listed. Its id may be reused
+      // before the next snapshot, which then samples the new thread.
+      sampler_.RemoveThread(pid_, sample.tid);
+      kernel_names_.erase(sample.tid);
+      continue;
+    }
+    threads->push_back(Snapshot());
+    Snapshot& snapshot = threads->back();
+    snapshot.id = sample.tid;
+    const char* name = names->GetName(sample.tid);
+    snapshot.name = *name ? name : kernel_names_[sample.tid];
+    snapshot.user_time = sample.user_time;
+    snapshot.system_time = sample.system_time;
+    snapshot.cpu_usage = sample.cpu_usage;
+    snapshot.run_queue_wait = sample.run_queue_wait;
+    snapshot.run_queue_wait_usage = sample.run_queue_wait_usage;
+    snapshot.voluntary_context_switches = sample.voluntary_context_switches;
+    snapshot.involuntary_context_switches =
+        sample.involuntary_context_switches;
+  }
+  std::sort(threads->begin(), threads->end(), &CompareSnapshotIds);
+  return true;
+}
+
+bool ThreadMetrics::ListThreads(std::vector<PlatformThreadId>* tids) {
+  tids->clear();
+  const std::string task_dir = StringPrintf("/proc/%d/task", pid_);
+  DirReaderPosix reader(task_dir.c_str());
+  if (!reader.IsValid())
+    return false;
+  while (reader.Next()) {
+    int tid;
+    if (StringToInt(reader.name(), &tid))
+      tids->push_back(tid);
+  }
+  std::sort(tids->begin(), tids->end());
+  return true;
+}
+
+void ThreadMetrics::UpdateThreads(const std::vector<PlatformThreadId>& tids) {
+  // Both are in order of id, so one pass finds the threads started and
+  // exited.
+  std::vector<PlatformThreadId> exited;
+  std::vector<PlatformThreadId>::const_iterator tid = tids.begin();
+  std::map<PlatformThreadId, std::string>::iterator sampled =
+      kernel_names_.begin();
+  while (tid != tids.end() || sampled != kernel_names_.end()) {
+    if (sampled == kernel_names_.end() ||
+        (tid != tids.end() && *tid < sampled->first)) {
+      if (sampler_.AddThread(pid_, *tid)) {
+        std::string name;
+        ReadFileToString(
+            FilePath(StringPrintf("/proc/%d/task/%d/comm", pid_, *tid)),
+            &name);
+        if (!name.empty() && name[name.size() - 1] == '\n')
+          name.resize(name.size() - 1);
+        kernel_names_.insert(sampled, std::make_pair(*tid, name));
+      }
+      ++tid;
+    } else if (tid == tids.end() || sampled->first < *tid) {
+      exited.push_back(sampled->first);
+      ++sampled;
+    } else {
+      ++tid;
+      ++sampled;
+    }
+  }
+  for (size_t i = 0; i < exited.size(); ++i) {
+    sampler_.RemoveThread(pid_, exited[i]);
+    kernel_names_.erase(exited[i]);
+  }
+}
+
+}  // namespace base
@@ -0,0 +1,114 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/process/thread_metrics.h"
+
+#include <sys/prctl.h>
+
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/platform_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+// Finds the snapshot of thread |id| in |threads|, or returns NULL.
+const ThreadMetrics::Snapshot* FindThread(
+    const std::vector<ThreadMetrics::Snapshot>& threads,
+    PlatformThreadId id) {
+  for (size_t i = 0; i < threads.size(); ++i) {
+    if (threads[i].id == id)
+      return &threads[i];
+  }
+  return NULL;
+}
+
+// A thread which spins until told to exit, named either through
+// PlatformThread or only in the kernel.
+class SpinningThread : public PlatformThread::Delegate {
+ public:
+  explicit SpinningThread(bool kernel_name_only)
+      : kernel_name_only_(kernel_name_only),
+        started_(false, false),
+        exit_(false, false),
+        tid_(kInvalidThreadId) {
+  }
+
+  virtual void ThreadMain() OVERRIDE {
+    if (kernel_name_only_)
+      prctl(PR_SET_NAME, "KernelOnly", 0, 0, 0);
+    else
+      PlatformThread::SetName("Spinner");
+    tid_ = PlatformThread::CurrentId();
+    started_.Signal();
+    while (!exit_.IsSignaled()) {
+    }
+  }
+
+  PlatformThreadId Start(PlatformThreadHandle* handle) {
+    EXPECT_TRUE(PlatformThread::Create(0, this, handle));
+    started_.Wait();
+    return tid_;
+  }
+
+  void Exit() { exit_.Signal(); }
+
+ private:
+  const bool kernel_name_only_;
+  WaitableEvent started_;
+  WaitableEvent exit_;
+  PlatformThreadId tid_;
+};
+
+}  // namespace
+
+TEST(ThreadMetricsTest, Snapshot) {
+  SpinningThread spinner(false);
+  PlatformThreadHandle spinner_handle;
+  const PlatformThreadId spinner_id = spinner.Start(&spinner_handle);
+  SpinningThread unnamed(true);
+  PlatformThreadHandle unnamed_handle;
+  const PlatformThreadId unnamed_id = unnamed.Start(&unnamed_handle);
+
+  ThreadMetrics metrics;
+  std::vector<ThreadMetrics::Snapshot> threads;
+  ASSERT_TRUE(metrics.TakeSnapshot(&threads));
+  ASSERT_GE(threads.size(), 3u);
+  for (size_t i = 1; i < threads.size(); ++i)
+    EXPECT_LT(threads[i - 1].id, threads[i].id);
+  ASSERT_TRUE(FindThread(threads, PlatformThread::CurrentId()));
+  const ThreadMetrics::Snapshot* spinning = FindThread(threads, spinner_id);
+  ASSERT_TRUE(spinning);
+  EXPECT_EQ("Spinner", spinning->name);
+  EXPECT_EQ(0, spinning->cpu_usage);
+  const ThreadMetrics::Snapshot* kernel_named = FindThread(threads,
+                                                           unnamed_id);
+  ASSERT_TRUE(kernel_named);
+  EXPECT_EQ("KernelOnly", kernel_named->name);
+
+  PlatformThread::Sleep(TimeDelta::FromMilliseconds(200));
+  ASSERT_TRUE(metrics.TakeSnapshot(&threads));
+  spinning = FindThread(threads, spinner_id);
+  ASSERT_TRUE(spinning);
+  EXPECT_GT(spinning->user_time + spinning->system_time, TimeDelta());
+  EXPECT_LE(spinning->cpu_usage, 101);
+  // The test thread slept, blocking at least once.
+  const ThreadMetrics::Snapshot* self =
+      FindThread(threads, PlatformThread::CurrentId());
+  ASSERT_TRUE(self);
+  EXPECT_GT(self->voluntary_context_switches, 0u);
+
+  // Exited threads are dropped.
+  spinner.Exit();
+  PlatformThread::Join(spinner_handle);
+  unnamed.Exit();
+  PlatformThread::Join(unnamed_handle);
+  ASSERT_TRUE(metrics.TakeSnapshot(&threads));
+  EXPECT_FALSE(FindThread(threads, spinner_id));
+  EXPECT_FALSE(FindThread(threads, unnamed_id));
+  EXPECT_TRUE(FindThread(threads, PlatformThread::CurrentId()));
+}
+
+}  // namespace base
@@ -7,7 +7,6 @@
 #include "base/bind.h"
 #include "base/callback.h"
 #include "base/message_loop/message_loop.h"
-#include "base/run_loop.h"
 #include "base/synchronization/waitable_event.h"
 #include "base/threading/platform_thread.h"
 #include "testing/gtest/include/gtest/gtest.h"
@@ -20,7 +19,8 @@ namespace {
 const MessageLoop::Type testing_message_loops[] = {
   MessageLoop::TYPE_DEFAULT,
   MessageLoop::TYPE_IO,
-#if !defined(OS_IOS)  // iOS does not allow direct running of the UI loop.
+// iOS does not allow direct running of the UI loop, and Linux has none.
+#if !defined(OS_IOS) && !defined(OS_LINUX)
   MessageLoop::TYPE_UI,
 #endif
 };
@@ -96,7 +96,7 @@ void RunTest_CancelAfterSet(MessageLoop::Type message_loop_type) {
 
   watcher.StopWatching();
 
-  RunLoop().RunUntilIdle();
+  MessageLoop::current()->RunUntilIdle();
 
   // Our delegate should not have fired.
   EXPECT_EQ(1, counter);
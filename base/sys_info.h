@@ -7,6 +7,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include "base/base_export.h"
 #include "base/basictypes.h"
@@ -81,6 +82,38 @@ class BASE_EXPORT SysInfo {
   static size_t MaxSharedMemorySize();
 #endif  // defined(OS_POSIX) && !defined(OS_MACOSX)
 
+#if defined(OS_LINUX)
+  // The processors and memory of a NUMA node.
+  struct BASE_EXPORT NumaNode {
+    NumaNode();
+    ~NumaNode();
+
+    int id;
+    std::vector<int> cpus;
+    int64 memory_bytes;
+  };
+
+  // Returns the number of processors this process may run on: the CPUs in
+  // its affinity mask, which reflects the cpuset of its cgroup, limited by
+  // the cgroup's CPU quota (cpu.max in cgroup v2, cpu.cfs_quota_us in v1)
+  // rounded up. Size thread pools from this rather than from
+  // NumberOfProcessors(), which counts the CPUs of the host. At least 1.
+  static int EffectiveProcessorCount();
+
+  // Returns the bytes of memory this process may use: the physical memory,
+  // limited by the cgroup's memory.max (v2) or memory.limit_in_bytes (v1).
+  static int64 EffectiveMemoryLimit();
+
+  // Returns the NUMA nodes of the machine, from /sys/devices/system/node, in
+  // order of id. Without NUMA, a single node 0 has every online CPU and all
+  // the physical memory.
+  static std::vector<NumaNode> NumaNodes();
+
+  // The three above are read once and cached. Rereads them, for instance
+  // after the container has been resized.
+  static void RefreshResourceLimits();
+#endif  // defined(OS_LINUX)
+
 #if defined(OS_CHROMEOS)
   typedef std::map<std::string, std::string> LsbReleaseMap;
 
@@ -4,11 +4,21 @@
 
 #include "base/sys_info.h"
 
+#include <sched.h>
+#include <stdio.h>
+
+#include <algorithm>
 #include <limits>
 
 #include "base/file_util.h"
+#include "base/files/dir_reader_posix.h"
+#include "base/lazy_instance.h"
 #include "base/logging.h"
+#include "base/process/internal_linux.h"
 #include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
+#include "base/strings/string_util.h"
+#include "base/synchronization/lock.h"
 
 namespace {
 
@@ -22,6 +32,234 @@ int64 AmountOfMemory(int pages_name) {
   return static_cast<int64>(pages) * page_size;
 }
 
+#if defined(OS_LINUX)
+
+const char kNodeDir[] = "/sys/devices/system/node";
+
+// Reads the file |name| in |dir| without its surrounding whitespace.
+bool ReadTrimmedFile(const base::FilePath& dir,
+                     const char* name,
+                     std::string* contents) {
+  std::string raw;
+  if (!base::ReadFileToString(dir.Append(name), &raw))
+    return false;
+  TrimWhitespaceASCII(raw, TRIM_ALL, contents);
+  return true;
+}
+
+// Reads a limit in the cgroup |dir|, or returns -1 if it has none.
+typedef int64 (*CgroupLimitReader)(const base::FilePath& dir);
+
+// The CPU quota, in thousandths of a CPU. cpu.max is "<quota> <period>" in
+// microseconds, where the quota may be "max".
+int64 ReadCgroup2CpuLimit(const base::FilePath& dir) {
+  std::string contents;
+  if (!ReadTrimmedFile(dir, "cpu.max", &contents))
+    return -1;
+  std::vector<std::string> fields;
+  base::SplitString(contents, ' ', &fields);
+  int64 quota;
+  int64 period;
+  if (fields.size() != 2 || !base::StringToInt64(fields[0], &quota) ||
+      !base::StringToInt64(fields[1], &period) || quota <= 0 || period <= 0) {
+    return -1;
+  }
+  return quota * 1000 / period;
+}
+
+// cgroup v1 splits cpu.max into two files; a quota of -1 is no limit.
+int64 ReadCgroup1CpuLimit(const base::FilePath& dir) {
+  std::string quota_string;
+  std::string period_string;
+  int64 quota;
+  int64 period;
+  if (!ReadTrimmedFile(dir, "cpu.cfs_quota_us", &quota_string) ||
+      !ReadTrimmedFile(dir, "cpu.cfs_period_us", &period_string) ||
+      !base::StringToInt64(quota_string, &quota) ||
+      !base::StringToInt64(period_string, &period) ||
+      quota <= 0 || period <= 0) {
+    return -1;
+  }
+  return quota * 1000 / period;
+}
+
+// memory.max is a number of bytes, or "max".
+int64 ReadCgroup2MemoryLimit(const base::FilePath& dir) {
+  std::string contents;
+  int64 limit;
+  if (!ReadTrimmedFile(dir, "memory.max", &contents) ||
+      !base::StringToInt64(contents, &limit)) {
+    return -1;
+  }
+  return limit;
+}
+
+// No limit is a number near 2^63 here, which the physical memory caps.
+int64 ReadCgroup1MemoryLimit(const base::FilePath& dir) {
+  std::string contents;
+  int64 limit;
+  if (!ReadTrimmedFile(dir, "memory.limit_in_bytes", &contents) ||
+      !base::StringToInt64(contents, &limit)) {
+    return -1;
+  }
+  return limit;
+}
+
+// Returns the smallest of the limits of our cgroup for |controller|, or
+// "" for cgroup v2, and of its ancestors, which bound it; or -1 if none has
+// a limit.
+int64 GetCgroupLimit(const std::string& controller,
+                     CgroupLimitReader read_limit) {
+  base::FilePath mount_point;
+  base::FilePath dir;
+  if (!base::internal::GetCgroupDirectory(controller, &mount_point, &dir))
+    return -1;
+  int64 smallest = -1;
+  for (;;) {
+    const int64 limit = read_limit(dir);
+    if (limit >= 0 && (smallest < 0 || limit < smallest))
+      smallest = limit;
+    if (dir == mount_point || dir.DirName() == dir)
+      break;
+    dir = dir.DirName();
+  }
+  return smallest;
+}
+
+// Parses a list of CPUs such as "0-3,8,10-11" into |cpus|.
+bool ParseCpuList(const std::string& list, std::vector<int>* cpus) {
+  std::vector<std::string> ranges;
+  base::SplitString(list, ',', &ranges);
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    if (ranges[i].empty())
+      continue;
+    std::vector<std::string> bounds;
+    base::SplitString(ranges[i], '-', &bounds);
+    int first;
+    int last;
+    if (bounds.empty() || bounds.size() > 2 ||
+        !base::StringToInt(bounds[0], &first) ||
+        !base::StringToInt(bounds.back(), &last) || first > last) {
+      return false;
+    }
+    for (int cpu = first; cpu <= last; ++cpu)
+      cpus->push_back(cpu);
+  }
+  return true;
+}
+
+bool CompareNodeIds(const base::SysInfo::NumaNode& a,
+                    const base::SysInfo::NumaNode& b) {
+  return a.id < b.id;
+}
+
+// Reads the NUMA nodes, or returns an empty list without NUMA.
+std::vector<base::SysInfo::NumaNode> ReadNumaNodes() {
+  std::vector<base::SysInfo::NumaNode> nodes;
+  base::DirReaderPosix reader(kNodeDir);
+  if (!reader.IsValid())
+    return nodes;
+  while (reader.Next()) {
+    int id;
+    if (strncmp(reader.name(), "node", 4) != 0 ||
+        !base::StringToInt(reader.name() + 4, &id)) {
+      continue;
+    }
+    const base::FilePath dir = base::FilePath(kNodeDir).Append(reader.name());
+    base::SysInfo::NumaNode node;
+    node.id = id;
+    std::string cpulist;
+    if (!ReadTrimmedFile(dir, "cpulist", &cpulist) ||
+        !ParseCpuList(cpulist, &node.cpus)) {
+      continue;
+    }
+    // "Node <id> MemTotal:       32791432 kB" is among the lines.
+    std::string meminfo;
+    if (base::ReadFileToString(dir.Append("meminfo"), &meminfo)) {
+      const size_t pos = meminfo.find("MemTotal:");
+      long long kilobytes;
+      if (pos != std::string::npos &&
+          sscanf(meminfo.c_str() + pos, "MemTotal: %lld kB", &kilobytes) == 1) {
+        node.memory_bytes = kilobytes * 1024;
+      }
+    }
+    nodes.push_back(node);
+  }
+  std::sort(nodes.begin(), nodes.end(), &CompareNodeIds);
+  return nodes;
+}
+
+// The effective resources, read when first asked for and on refreshes.
+class ResourceLimits {
+ public:
+  ResourceLimits() { Refresh(); }
+
+  void Refresh() {
+    int processor_count = base::SysInfo::NumberOfProcessors();
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    if (sched_getaffinity(0, sizeof(cpus), &cpus) == 0)
+      processor_count = CPU_COUNT(&cpus);
+    int64 cpu_limit = GetCgroupLimit(std::string(), &ReadCgroup2CpuLimit);
+    if (cpu_limit < 0)
+      cpu_limit = GetCgroupLimit("cpu", &ReadCgroup1CpuLimit);
+    if (cpu_limit >= 0) {
+      processor_count = std::min<int64>(processor_count,
+                                        (cpu_limit + 999) / 1000);
+    }
+    processor_count = std::max(processor_count, 1);
+
+    int64 memory_limit = AmountOfMemory(_SC_PHYS_PAGES);
+    int64 cgroup_memory_limit =
+        GetCgroupLimit(std::string(), &ReadCgroup2MemoryLimit);
+    if (cgroup_memory_limit < 0)
+      cgroup_memory_limit = GetCgroupLimit("memory", &ReadCgroup1MemoryLimit);
+    if (cgroup_memory_limit >= 0)
+      memory_limit = std::min(memory_limit, cgroup_memory_limit);
+
+    std::vector<base::SysInfo::NumaNode> numa_nodes = ReadNumaNodes();
+    if (numa_nodes.empty()) {
+      numa_nodes.resize(1);
+      for (int cpu = 0; cpu < base::SysInfo::NumberOfProcessors(); ++cpu)
+        numa_nodes[0].cpus.push_back(cpu);
+      numa_nodes[0].memory_bytes = AmountOfMemory(_SC_PHYS_PAGES);
+    }
+
+    base::AutoLock lock(lock_);
+    processor_count_ = processor_count;
+    memory_limit_ = memory_limit;
+    numa_nodes_.swap(numa_nodes);
+  }
+
+  int processor_count() {
+    base::AutoLock lock(lock_);
+    return processor_count_;
+  }
+
+  int64 memory_limit() {
+    base::AutoLock lock(lock_);
+    return memory_limit_;
+  }
+
+  std::vector<base::SysInfo::NumaNode> numa_nodes() {
+    base::AutoLock lock(lock_);
+    return numa_nodes_;
+  }
+
+ private:
+  base::Lock lock_;
+  int processor_count_;
+  int64 memory_limit_;
+  std::vector<base::SysInfo::NumaNode> numa_nodes_;
+
+  DISALLOW_COPY_AND_ASSIGN(ResourceLimits);
+};
+
+base::LazyInstance<ResourceLimits>::Leaky g_resource_limits =
+    LAZY_INSTANCE_INITIALIZER;
+
+#endif  // defined(OS_LINUX)
+
 }  // namespace
 
 namespace base {
@@ -59,6 +297,34 @@ size_t SysInfo::MaxSharedMemorySize() {
   return static_cast<size_t>(limit);
 }
 
+#if defined(OS_LINUX)
+SysInfo::NumaNode::NumaNode() : id(0), memory_bytes(0) {
+}
+
+SysInfo::NumaNode::~NumaNode() {
+}
+
+// static
+int SysInfo::EffectiveProcessorCount() {
+  return g_resource_limits.Get().processor_count();
+}
+
+// static
+int64 SysInfo::EffectiveMemoryLimit() {
+  return g_resource_limits.Get().memory_limit();
+}
+
+// static
+std::vector<SysInfo::NumaNode> SysInfo::NumaNodes() {
+  return g_resource_limits.Get().numa_nodes();
+}
+
+// static
+void SysInfo::RefreshResourceLimits() {
+  g_resource_limits.Get().Refresh();
+}
+#endif  // defined(OS_LINUX)
+
 // static
 std::string SysInfo::CPUModelName() {
 #if defined(OS_CHROMEOS) && defined(ARCH_CPU_ARMEL)
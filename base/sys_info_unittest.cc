@@ -31,6 +31,33 @@ TEST_F(SysInfoTest, AmountOfMem) {
   EXPECT_GT(base::SysInfo::AmountOfPhysicalMemoryMB(), 0);
 }
 
+#if defined(OS_LINUX)
+TEST_F(SysInfoTest, EffectiveLimits) {
+  // Containers and affinity masks only ever lower them.
+  EXPECT_GE(base::SysInfo::EffectiveProcessorCount(), 1);
+  EXPECT_LE(base::SysInfo::EffectiveProcessorCount(),
+            base::SysInfo::NumberOfProcessors());
+  EXPECT_GT(base::SysInfo::EffectiveMemoryLimit(), 0);
+  EXPECT_LE(base::SysInfo::EffectiveMemoryLimit(),
+            base::SysInfo::AmountOfPhysicalMemory());
+
+  // Each online CPU is in one node.
+  std::vector<base::SysInfo::NumaNode> nodes = base::SysInfo::NumaNodes();
+  ASSERT_FALSE(nodes.empty());
+  size_t cpus = 0;
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    if (i > 0)
+      EXPECT_LT(nodes[i - 1].id, nodes[i].id);
+    cpus += nodes[i].cpus.size();
+  }
+  EXPECT_GE(cpus, static_cast<size_t>(base::SysInfo::NumberOfProcessors()));
+
+  const int count = base::SysInfo::EffectiveProcessorCount();
+  base::SysInfo::RefreshResourceLimits();
+  EXPECT_EQ(count, base::SysInfo::EffectiveProcessorCount());
+}
+#endif
+
 TEST_F(SysInfoTest, AmountOfFreeDiskSpace) {
   // We aren't actually testing that it's correct, just that it's sane.
   FilePath tmp_path;
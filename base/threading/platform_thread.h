@@ -9,6 +9,8 @@
 #ifndef BASE_THREADING_PLATFORM_THREAD_H_
 #define BASE_THREADING_PLATFORM_THREAD_H_
 
+#include <vector>
+
 #include "base/base_export.h"
 #include "base/basictypes.h"
 #include "base/time/time.h"
@@ -85,6 +87,23 @@ enum ThreadPriority{
   kThreadPriority_Background
 };
 
+#if defined(OS_LINUX)
+// Valid values for SetThreadSchedulingPolicy(), the scheduler's policies.
+enum SchedulingPolicy {
+  // SCHED_OTHER, the default time sharing policy.
+  kSchedulingPolicy_Normal,
+  // SCHED_BATCH, for CPU-bound threads which may wait longer to be woken in
+  // return for longer timeslices.
+  kSchedulingPolicy_Batch,
+  // SCHED_IDLE, for threads which should run only when nothing else would.
+  kSchedulingPolicy_Idle,
+  // SCHED_FIFO and SCHED_RR, the real-time policies, which preempt all the
+  // others and need CAP_SYS_NICE or an RLIMIT_RTPRIO.
+  kSchedulingPolicy_Fifo,
+  kSchedulingPolicy_RoundRobin
+};
+#endif
+
 // A namespace for low-level thread functions.
 class BASE_EXPORT PlatformThread {
  public:
@@ -151,6 +170,37 @@ class BASE_EXPORT PlatformThread {
   static void SetThreadPriority(PlatformThreadHandle handle,
                                 ThreadPriority priority);
 
+#if defined(OS_LINUX)
+  // Finer control of scheduling than SetThreadPriority(). Each returns false,
+  // leaving the thread as it was, if the kernel refuses, typically for lack
+  // of permission.
+
+  // Restricts the thread to the CPUs numbered in |cpus|, which must not be
+  // empty. CPUs outside the cpuset of the process are ignored.
+  static bool SetThreadAffinity(PlatformThreadHandle handle,
+                                const std::vector<int>& cpus);
+
+  // Sets |cpus| to the CPUs the thread may run on.
+  static bool GetThreadAffinity(PlatformThreadHandle handle,
+                                std::vector<int>* cpus);
+
+  // Runs the current thread on the CPUs of the NUMA node |node|, and makes it
+  // allocate memory from that node's while it has free memory. The memory
+  // policy applies only to the calling thread, so unlike the others this
+  // takes no handle.
+  static bool BindCurrentThreadToNumaNode(int node);
+
+  // |priority| is the real-time priority, from 1 to 99, of the Fifo and
+  // RoundRobin policies, and must be 0 for the others.
+  static bool SetThreadSchedulingPolicy(PlatformThreadHandle handle,
+                                        SchedulingPolicy policy,
+                                        int priority);
+
+  // Sets the nice value of the thread, from -20 (most favoured) to 19.
+  // Lowering it needs CAP_SYS_NICE or an RLIMIT_NICE.
+  static bool SetThreadNiceValue(PlatformThreadHandle handle, int nice_value);
+#endif
+
  private:
   DISALLOW_IMPLICIT_CONSTRUCTORS(PlatformThread);
 };
@@ -11,6 +11,7 @@
 #include "base/logging.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/safe_strerror_posix.h"
+#include "base/sys_info.h"
 #include "base/threading/thread_id_name_manager.h"
 #include "base/tracked_objects.h"
 
@@ -92,6 +93,114 @@ void PlatformThread::SetThreadPriority(PlatformThreadHandle handle,
 #endif  //  !defined(OS_NACL)
 }
 
+#if defined(OS_LINUX)
+// static
+bool PlatformThread::SetThreadAffinity(PlatformThreadHandle handle,
+                                       const std::vector<int>& cpus) {
+  DCHECK(!cpus.empty());
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (size_t i = 0; i < cpus.size(); ++i) {
+    DCHECK(cpus[i] >= 0 && cpus[i] < CPU_SETSIZE) << cpus[i];
+    CPU_SET(cpus[i], &set);
+  }
+  if (sched_setaffinity(handle.id_, sizeof(set), &set) != 0) {
+    DVPLOG(1) << "sched_setaffinity";
+    return false;
+  }
+  return true;
+}
+
+// static
+bool PlatformThread::GetThreadAffinity(PlatformThreadHandle handle,
+                                       std::vector<int>* cpus) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(handle.id_, sizeof(set), &set) != 0) {
+    DVPLOG(1) << "sched_getaffinity";
+    return false;
+  }
+  cpus->clear();
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &set))
+      cpus->push_back(cpu);
+  }
+  return true;
+}
+
+// static
+bool PlatformThread::BindCurrentThreadToNumaNode(int node) {
+  std::vector<SysInfo::NumaNode> nodes = SysInfo::NumaNodes();
+  const SysInfo::NumaNode* found = NULL;
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    if (nodes[i].id == node)
+      found = &nodes[i];
+  }
+  if (!found || found->cpus.empty() ||
+      node >= static_cast<int>(sizeof(unsigned long) * 8)) {
+    DLOG(ERROR) << "No NUMA node " << node;
+    return false;
+  }
+  if (!SetThreadAffinity(CurrentHandle(), found->cpus))
+    return false;
+
+  // The preferred policy falls back to other nodes when this one is out of
+  // memory, where MPOL_BIND would invoke the OOM killer. There is no libc
+  // wrapper without libnuma. Without NUMA support in the kernel, there is a
+  // single node and nothing to prefer.
+  const int kMemoryPolicyPreferred = 1;  // MPOL_PREFERRED in numaif.h.
+  const unsigned long mask = 1UL << node;
+  if (syscall(__NR_set_mempolicy, kMemoryPolicyPreferred, &mask,
+              sizeof(mask) * 8) != 0 && errno != ENOSYS) {
+    DVPLOG(1) << "set_mempolicy";
+    return false;
+  }
+  return true;
+}
+
+// static
+bool PlatformThread::SetThreadSchedulingPolicy(PlatformThreadHandle handle,
+                                               SchedulingPolicy policy,
+                                               int priority) {
+  int linux_policy = SCHED_OTHER;
+  switch (policy) {
+    case kSchedulingPolicy_Normal:
+      linux_policy = SCHED_OTHER;
+      break;
+    case kSchedulingPolicy_Batch:
+      linux_policy = SCHED_BATCH;
+      break;
+    case kSchedulingPolicy_Idle:
+      linux_policy = SCHED_IDLE;
+      break;
+    case kSchedulingPolicy_Fifo:
+      linux_policy = SCHED_FIFO;
+      break;
+    case kSchedulingPolicy_RoundRobin:
+      linux_policy = SCHED_RR;
+      break;
+  }
+  struct sched_param param = {};
+  param.sched_priority = priority;
+  if (sched_setscheduler(handle.id_, linux_policy, &param) != 0) {
+    DVPLOG(1) << "sched_setscheduler";
+    return false;
+  }
+  return true;
+}
+
+// static
+bool PlatformThread::SetThreadNiceValue(PlatformThreadHandle handle,
+                                        int nice_value) {
+  DCHECK(nice_value >= -20 && nice_value <= 19) << nice_value;
+  if (setpriority(PRIO_PROCESS, handle.id_, nice_value) != 0) {
+    DVPLOG(1) << "setpriority";
+    return false;
+  }
+  return true;
+}
+#endif  // defined(OS_LINUX)
+
 void InitThreading() {}
 
 void InitOnThread() {}
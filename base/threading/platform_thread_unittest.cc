@@ -5,6 +5,13 @@
 #include "base/compiler_specific.h"
 #include "base/threading/platform_thread.h"
 
+#if defined(OS_LINUX)
+#include <sched.h>
+#include <sys/resource.h>
+
+#include "base/sys_info.h"
+#endif
+
 #include "testing/gtest/include/gtest/gtest.h"
 
 namespace base {
@@ -118,4 +125,54 @@ TEST(PlatformThreadTest, FunctionTimesTen) {
   EXPECT_EQ(main_thread_id, PlatformThread::CurrentId());
 }
 
+#if defined(OS_LINUX)
+// Scheduling tests, run on a thread of their own so as not to change the
+// test runner's -----------------------------------------------------------
+
+class SchedulingTestThread : public PlatformThread::Delegate {
+ public:
+  SchedulingTestThread() {}
+
+  virtual void ThreadMain() OVERRIDE {
+    const PlatformThreadHandle self = PlatformThread::CurrentHandle();
+
+    std::vector<int> cpus;
+    ASSERT_TRUE(PlatformThread::GetThreadAffinity(self, &cpus));
+    ASSERT_FALSE(cpus.empty());
+    ASSERT_TRUE(PlatformThread::SetThreadAffinity(
+        self, std::vector<int>(1, cpus.back())));
+    std::vector<int> pinned;
+    ASSERT_TRUE(PlatformThread::GetThreadAffinity(self, &pinned));
+    ASSERT_EQ(1u, pinned.size());
+    EXPECT_EQ(cpus.back(), pinned[0]);
+    EXPECT_EQ(cpus.back(), sched_getcpu());
+
+    // Unprivileged threads may always move to the batch and idle policies,
+    // and raise their nice value.
+    EXPECT_TRUE(PlatformThread::SetThreadSchedulingPolicy(
+        self, kSchedulingPolicy_Batch, 0));
+    EXPECT_EQ(SCHED_BATCH, sched_getscheduler(0));
+    EXPECT_TRUE(PlatformThread::SetThreadNiceValue(self, 5));
+    EXPECT_EQ(5, getpriority(PRIO_PROCESS, PlatformThread::CurrentId()));
+
+    std::vector<SysInfo::NumaNode> nodes = SysInfo::NumaNodes();
+    ASSERT_FALSE(nodes.empty());
+    EXPECT_TRUE(PlatformThread::BindCurrentThreadToNumaNode(nodes[0].id));
+    ASSERT_TRUE(PlatformThread::GetThreadAffinity(self, &pinned));
+    EXPECT_EQ(nodes[0].cpus, pinned);
+    EXPECT_FALSE(PlatformThread::BindCurrentThreadToNumaNode(-1));
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(SchedulingTestThread);
+};
+
+TEST(PlatformThreadTest, Scheduling) {
+  SchedulingTestThread thread;
+  PlatformThreadHandle handle;
+  ASSERT_TRUE(PlatformThread::Create(0, &thread, &handle));
+  PlatformThread::Join(handle);
+}
+#endif  // defined(OS_LINUX)
+
 }  // namespace base
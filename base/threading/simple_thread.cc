@@ -6,10 +6,35 @@
 
 #include "base/logging.h"
 #include "base/strings/string_number_conversions.h"
+#include "base/sys_info.h"
 #include "base/threading/platform_thread.h"
 
 namespace base {
 
+namespace {
+
+// The work DelegateSimpleThreadPool hands out without locking; more waits
+// in a std::queue.
+const size_t kPoolQueueCapacity = 1024;
+
+}  // namespace
+
+SimpleThread::Options::Options()
+    :
+#if defined(OS_LINUX)
+      numa_node_(-1),
+      has_scheduling_policy_(false),
+      scheduling_policy_(kSchedulingPolicy_Normal),
+      scheduling_priority_(0),
+      has_nice_value_(false),
+      nice_value_(0),
+#endif
+      stack_size_(0) {
+}
+
+SimpleThread::Options::~Options() {
+}
+
 SimpleThread::SimpleThread(const std::string& name_prefix)
     : name_prefix_(name_prefix), name_(name_prefix),
       thread_(), event_(true, false), tid_(0), joined_(false) {
@@ -51,6 +76,20 @@ void SimpleThread::ThreadMain() {
   name_.append(IntToString(tid_));
   PlatformThread::SetName(name_.c_str());
 
+#if defined(OS_LINUX)
+  const PlatformThreadHandle self = PlatformThread::CurrentHandle();
+  if (options_.numa_node() >= 0)
+    PlatformThread::BindCurrentThreadToNumaNode(options_.numa_node());
+  if (!options_.cpu_affinity().empty())
+    PlatformThread::SetThreadAffinity(self, options_.cpu_affinity());
+  if (options_.has_scheduling_policy()) {
+    PlatformThread::SetThreadSchedulingPolicy(
+        self, options_.scheduling_policy(), options_.scheduling_priority());
+  }
+  if (options_.has_nice_value())
+    PlatformThread::SetThreadNiceValue(self, options_.nice_value());
+#endif
+
   // We've initialized our new thread, signal that we're done to Start().
   event_.Signal();
 
@@ -84,19 +123,43 @@ DelegateSimpleThreadPool::DelegateSimpleThreadPool(
     int num_threads)
     : name_prefix_(name_prefix),
       num_threads_(num_threads),
-      dry_(true, false) {
+#if defined(OS_LINUX)
+      placement_(PLACEMENT_NONE),
+#endif
+      queue_(kPoolQueueCapacity),
+      overflow_size_(0),
+      work_added_(&lock_),
+      idle_threads_(0) {
 }
 
 DelegateSimpleThreadPool::~DelegateSimpleThreadPool() {
   DCHECK(threads_.empty());
-  DCHECK(delegates_.empty());
-  DCHECK(!dry_.IsSignaled());
+  DCHECK(overflow_.empty());
 }
 
 void DelegateSimpleThreadPool::Start() {
   DCHECK(threads_.empty()) << "Start() called with outstanding threads.";
+#if defined(OS_LINUX)
+  std::vector<int> cpus;
+  if (placement_ == PLACEMENT_PER_CORE &&
+      !PlatformThread::GetThreadAffinity(PlatformThread::CurrentHandle(),
+                                         &cpus)) {
+    cpus.clear();
+  }
+  std::vector<SysInfo::NumaNode> nodes;
+  if (placement_ == PLACEMENT_PER_NODE)
+    nodes = SysInfo::NumaNodes();
+#endif
   for (int i = 0; i < num_threads_; ++i) {
-    DelegateSimpleThread* thread = new DelegateSimpleThread(this, name_prefix_);
+    SimpleThread::Options options;
+#if defined(OS_LINUX)
+    if (!cpus.empty())
+      options.set_cpu_affinity(std::vector<int>(1, cpus[i % cpus.size()]));
+    if (!nodes.empty())
+      options.set_numa_node(nodes[i % nodes.size()].id);
+#endif
+    DelegateSimpleThread* thread =
+        new DelegateSimpleThread(this, name_prefix_, options);
     thread->Start();
     threads_.push_back(thread);
   }
@@ -114,35 +177,51 @@ void DelegateSimpleThreadPool::JoinAll() {
     delete threads_[i];
   }
   threads_.clear();
-  DCHECK(delegates_.empty());
+  DCHECK(overflow_.empty());
 }
 
 void DelegateSimpleThreadPool::AddWork(Delegate* delegate, int repeat_count) {
-  AutoLock locked(lock_);
-  for (int i = 0; i < repeat_count; ++i)
-    delegates_.push(delegate);
-  // If we were empty, signal that we have work now.
-  if (!dry_.IsSignaled())
-    dry_.Signal();
+  for (int i = 0; i < repeat_count; ++i) {
+    if (subtle::Acquire_Load(&overflow_size_) == 0 &&
+        queue_.TryPush(delegate)) {
+      continue;
+    }
+    AutoLock locked(lock_);
+    overflow_.push(delegate);
+    subtle::Release_Store(&overflow_size_,
+                          static_cast<subtle::Atomic32>(overflow_.size()));
+  }
+
+  // A thread announces that it is idle before looking for work a last time,
+  // and we look for idle threads after adding work, so with a barrier
+  // between on both sides, either it finds the work or we wake it.
+  subtle::MemoryBarrier();
+  if (subtle::NoBarrier_Load(&idle_threads_) > 0) {
+    AutoLock locked(lock_);
+    work_added_.Broadcast();
+  }
 }
 
 void DelegateSimpleThreadPool::Run() {
   Delegate* work = NULL;
 
   while (true) {
-    dry_.Wait();
-    {
+    if (!queue_.TryPop(&work)) {
       AutoLock locked(lock_);
-      if (!dry_.IsSignaled())
-        continue;
-
-      DCHECK(!delegates_.empty());
-      work = delegates_.front();
-      delegates_.pop();
-
-      // Signal to any other threads that we're currently out of work.
-      if (delegates_.empty())
-        dry_.Reset();
+      subtle::Barrier_AtomicIncrement(&idle_threads_, 1);
+      while (!queue_.TryPop(&work)) {
+        // Whatever is in the queue was added before the overflow.
+        if (!overflow_.empty()) {
+          work = overflow_.front();
+          overflow_.pop();
+          subtle::Release_Store(
+              &overflow_size_,
+              static_cast<subtle::Atomic32>(overflow_.size()));
+          break;
+        }
+        work_added_.Wait();
+      }
+      subtle::Barrier_AtomicIncrement(&idle_threads_, -1);
     }
 
     // A NULL delegate pointer signals us to quit.
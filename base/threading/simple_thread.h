@@ -44,10 +44,13 @@
 #include <queue>
 #include <vector>
 
+#include "base/atomicops.h"
 #include "base/base_export.h"
 #include "base/basictypes.h"
 #include "base/compiler_specific.h"
+#include "base/containers/bounded_mpmc_queue.h"
 #include "base/threading/platform_thread.h"
+#include "base/synchronization/condition_variable.h"
 #include "base/synchronization/lock.h"
 #include "base/synchronization/waitable_event.h"
 
@@ -59,15 +62,58 @@ class BASE_EXPORT SimpleThread : public PlatformThread::Delegate {
  public:
   class BASE_EXPORT Options {
    public:
-    Options() : stack_size_(0) { }
-    ~Options() { }
+    Options();
+    ~Options();
 
     // We use the standard compiler-supplied copy constructor.
 
     // A custom stack size, or 0 for the system default.
     void set_stack_size(size_t size) { stack_size_ = size; }
     size_t stack_size() const { return stack_size_; }
+
+#if defined(OS_LINUX)
+    // The placement and scheduling of the thread, set on it before Run().
+    // See PlatformThread for what each needs; a setting the kernel refuses
+    // is logged and ignored.
+
+    // The CPUs to run on, or empty for any.
+    void set_cpu_affinity(const std::vector<int>& cpus) {
+      cpu_affinity_ = cpus;
+    }
+    const std::vector<int>& cpu_affinity() const { return cpu_affinity_; }
+
+    // The NUMA node to run on and allocate memory from, or -1 for any. A CPU
+    // affinity, if set too, is applied after, so may narrow it.
+    void set_numa_node(int node) { numa_node_ = node; }
+    int numa_node() const { return numa_node_; }
+
+    void set_scheduling_policy(SchedulingPolicy policy, int priority) {
+      has_scheduling_policy_ = true;
+      scheduling_policy_ = policy;
+      scheduling_priority_ = priority;
+    }
+    bool has_scheduling_policy() const { return has_scheduling_policy_; }
+    SchedulingPolicy scheduling_policy() const { return scheduling_policy_; }
+    int scheduling_priority() const { return scheduling_priority_; }
+
+    void set_nice_value(int nice_value) {
+      has_nice_value_ = true;
+      nice_value_ = nice_value;
+    }
+    bool has_nice_value() const { return has_nice_value_; }
+    int nice_value() const { return nice_value_; }
+#endif
+
    private:
+#if defined(OS_LINUX)
+    std::vector<int> cpu_affinity_;
+    int numa_node_;
+    bool has_scheduling_policy_;
+    SchedulingPolicy scheduling_policy_;
+    int scheduling_priority_;
+    bool has_nice_value_;
+    int nice_value_;
+#endif
     size_t stack_size_;
   };
 
@@ -150,14 +196,35 @@ class BASE_EXPORT DelegateSimpleThread : public SimpleThread {
 // JoinAll() will make sure that all outstanding work is processed, and wait
 // for everything to finish.  You can reuse a pool, so you can call Start()
 // again after you've called JoinAll().
+//
+// On Linux, set_placement() pins the workers, so that threads with warm
+// caches aren't migrated between cores or sockets.
 class BASE_EXPORT DelegateSimpleThreadPool
     : public DelegateSimpleThread::Delegate {
  public:
   typedef DelegateSimpleThread::Delegate Delegate;
 
+#if defined(OS_LINUX)
+  enum Placement {
+    // The workers run wherever the scheduler puts them.
+    PLACEMENT_NONE,
+    // Each worker is pinned to one of the CPUs the pool's creator may run
+    // on, in turn.
+    PLACEMENT_PER_CORE,
+    // Each worker is bound to one of the NUMA nodes in turn, running on its
+    // CPUs and allocating from its memory.
+    PLACEMENT_PER_NODE,
+  };
+#endif
+
   DelegateSimpleThreadPool(const std::string& name_prefix, int num_threads);
   virtual ~DelegateSimpleThreadPool();
 
+#if defined(OS_LINUX)
+  // Call before Start().
+  void set_placement(Placement placement) { placement_ = placement; }
+#endif
+
   // Start up all of the underlying threads, and start processing work if we
   // have any.
   void Start();
@@ -179,10 +246,21 @@ class BASE_EXPORT DelegateSimpleThreadPool
  private:
   const std::string name_prefix_;
   int num_threads_;
+#if defined(OS_LINUX)
+  Placement placement_;
+#endif
   std::vector<DelegateSimpleThread*> threads_;
-  std::queue<Delegate*> delegates_;
-  base::Lock lock_;            // Locks delegates_
-  WaitableEvent dry_;    // Not signaled when there is no work to do.
+
+  // Work is handed out through |queue_| without locking. When it is full,
+  // work goes to |overflow_| instead, until that has drained, so that it is
+  // still done in order.
+  BoundedMPMCQueue<Delegate*> queue_;
+  base::Lock lock_;  // Locks overflow_, and the waits for work.
+  std::queue<Delegate*> overflow_;
+  volatile subtle::Atomic32 overflow_size_;
+  // Signaled when work is added while threads are waiting for it.
+  ConditionVariable work_added_;
+  volatile subtle::Atomic32 idle_threads_;
 };
 
 }  // namespace base
@@ -0,0 +1,79 @@
+// Copyright (c) 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/threading/simple_thread.h"
+
+#include "base/atomic_sequence_num.h"
+#include "base/memory/scoped_vector.h"
+#include "base/strings/stringprintf.h"
+#include "base/test/perf_log.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+const int kWorkItems = 1000000;
+
+class CountingRunner : public DelegateSimpleThread::Delegate {
+ public:
+  virtual void Run() OVERRIDE { seq_.GetNext(); }
+
+ private:
+  AtomicSequenceNumber seq_;
+};
+
+// Adds kWorkItems tiny items from |producers| threads to a pool of
+// |workers|, one at a time, as a task poster would.
+class Poster : public DelegateSimpleThread::Delegate {
+ public:
+  Poster(DelegateSimpleThreadPool* pool, DelegateSimpleThread::Delegate* work,
+         int count)
+      : pool_(pool), work_(work), count_(count) {}
+
+  virtual void Run() OVERRIDE {
+    for (int i = 0; i < count_; ++i)
+      pool_->AddWork(work_);
+  }
+
+ private:
+  DelegateSimpleThreadPool* pool_;
+  DelegateSimpleThread::Delegate* work_;
+  const int count_;
+};
+
+void RunPool(int producers, int workers) {
+  CountingRunner runner;
+  DelegateSimpleThreadPool pool("worker", workers);
+  ScopedVector<Poster> posters;
+  ScopedVector<DelegateSimpleThread> threads;
+  for (int i = 0; i < producers; ++i) {
+    posters.push_back(new Poster(&pool, &runner, kWorkItems / producers));
+    threads.push_back(new DelegateSimpleThread(posters.back(), "poster"));
+  }
+
+  const TimeTicks start = TimeTicks::Now();
+  pool.Start();
+  for (size_t i = 0; i < threads.size(); ++i)
+    threads[i]->Start();
+  for (size_t i = 0; i < threads.size(); ++i)
+    threads[i]->Join();
+  pool.JoinAll();
+  const TimeDelta elapsed = TimeTicks::Now() - start;
+
+  LogPerfResult(StringPrintf("pool_%dp_%dw", producers, workers).c_str(),
+                kWorkItems / elapsed.InSecondsF(), "items/s");
+}
+
+}  // namespace
+
+TEST(DelegateSimpleThreadPoolPerfTest, Throughput) {
+  const int kThreads[][2] = { { 1, 1 }, { 1, 4 }, { 4, 1 }, { 4, 4 },
+                              { 8, 8 } };
+  for (size_t i = 0; i < arraysize(kThreads); ++i)
+    RunPool(kThreads[i][0], kThreads[i][1]);
+}
+
+}  // namespace base
@@ -2,6 +2,8 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <algorithm>
+
 #include "base/atomic_sequence_num.h"
 #include "base/strings/string_number_conversions.h"
 #include "base/synchronization/waitable_event.h"
@@ -74,6 +76,31 @@ class VerifyPoolRunner : public DelegateSimpleThread::Delegate {
   WaitableEvent* event_;
 };
 
+#if defined(OS_LINUX)
+// Records the CPUs each thread it runs on may use.
+class AffinityRunner : public DelegateSimpleThread::Delegate {
+ public:
+  AffinityRunner() { }
+
+  virtual void Run() OVERRIDE {
+    std::vector<int> cpus;
+    EXPECT_TRUE(PlatformThread::GetThreadAffinity(
+        PlatformThread::CurrentHandle(), &cpus));
+    AutoLock lock(lock_);
+    affinities_.push_back(cpus);
+  }
+
+  std::vector<std::vector<int> > affinities() {
+    AutoLock lock(lock_);
+    return affinities_;
+  }
+
+ private:
+  Lock lock_;
+  std::vector<std::vector<int> > affinities_;
+};
+#endif
+
 }  // namespace
 
 TEST(SimpleThreadTest, CreateAndJoin) {
@@ -167,4 +194,62 @@ TEST(SimpleThreadTest, ThreadPool) {
   EXPECT_EQ(seq2.GetNext(), 10);
 }
 
+TEST(SimpleThreadTest, ThreadPoolOverflow) {
+  // More work than the pool's lock-free queue holds, before and while
+  // running.
+  AtomicSequenceNumber seq;
+  SeqRunner runner(&seq);
+  DelegateSimpleThreadPool pool("seq_runner", 4);
+  pool.AddWork(&runner, 5000);
+  pool.Start();
+  for (int i = 0; i < 100; ++i)
+    pool.AddWork(&runner, 50);
+  pool.JoinAll();
+  EXPECT_EQ(10000, seq.GetNext());
+}
+
+#if defined(OS_LINUX)
+TEST(SimpleThreadTest, ThreadWithAffinity) {
+  std::vector<int> cpus;
+  ASSERT_TRUE(PlatformThread::GetThreadAffinity(
+      PlatformThread::CurrentHandle(), &cpus));
+  AffinityRunner runner;
+  SimpleThread::Options options;
+  options.set_cpu_affinity(std::vector<int>(1, cpus.back()));
+  options.set_nice_value(3);
+  DelegateSimpleThread thread(&runner, "pinned", options);
+  thread.Start();
+  thread.Join();
+  ASSERT_EQ(1u, runner.affinities().size());
+  EXPECT_EQ(std::vector<int>(1, cpus.back()), runner.affinities()[0]);
+}
+
+TEST(SimpleThreadTest, ThreadPoolPerCore) {
+  std::vector<int> cpus;
+  ASSERT_TRUE(PlatformThread::GetThreadAffinity(
+      PlatformThread::CurrentHandle(), &cpus));
+  // One worker per CPU, each on its own.
+  AffinityRunner runner;
+  AtomicSequenceNumber seq;
+  WaitableEvent event(true, false);
+  const int num_threads = static_cast<int>(cpus.size());
+  VerifyPoolRunner verifier(&seq, num_threads - 1, &event);
+  DelegateSimpleThreadPool pool("pinned", num_threads);
+  pool.set_placement(DelegateSimpleThreadPool::PLACEMENT_PER_CORE);
+  pool.Start();
+  // Hold every worker until all have started.
+  pool.AddWork(&verifier, num_threads);
+  pool.AddWork(&runner, num_threads);
+  pool.JoinAll();
+
+  std::vector<std::vector<int> > affinities = runner.affinities();
+  ASSERT_EQ(cpus.size(), affinities.size());
+  for (size_t i = 0; i < affinities.size(); ++i) {
+    ASSERT_EQ(1u, affinities[i].size());
+    EXPECT_TRUE(std::find(cpus.begin(), cpus.end(), affinities[i][0]) !=
+                cpus.end());
+  }
+}
+#endif  // defined(OS_LINUX)
+
 }  // namespace base
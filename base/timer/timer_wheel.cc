@@ -0,0 +1,258 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/timer/timer_wheel.h"
+
+#include "base/logging.h"
+#include "base/time/tick_clock.h"
+
+namespace base {
+
+namespace {
+
+// The furthest a timer may expire, in ticks.
+const int64 kMaxTicks = GG_INT64_C(0xffffffff);
+
+}  // namespace
+
+TimerWheel::Timer::Timer()
+    : wheel_(NULL),
+      expiry_tick_(0),
+      level_(-1) {
+}
+
+TimerWheel::Timer::~Timer() {
+  if (wheel_)
+    wheel_->Cancel(this);
+}
+
+TimerWheel::TimerWheel(TickClock* tick_clock, TimeDelta tick)
+    : tick_clock_(tick_clock),
+      tick_(tick),
+      origin_(tick_clock->NowTicks()),
+      next_tick_(0),
+      size_(0) {
+  DCHECK_GT(tick.InMicroseconds(), 0);
+  for (int i = 0; i < kLevels; ++i)
+    level_sizes_[i] = 0;
+}
+
+TimerWheel::~TimerWheel() {
+  for (int i = 0; i < kRootSlots; ++i) {
+    for (LinkNode<Timer>* node = root_[i].head(); node != root_[i].end();
+         node = node->next()) {
+      node->value()->wheel_ = NULL;
+    }
+  }
+  for (int level = 0; level < kLevels - 1; ++level) {
+    for (int i = 0; i < kLevelSlots; ++i) {
+      Slot& slot = levels_[level][i];
+      for (LinkNode<Timer>* node = slot.head(); node != slot.end();
+           node = node->next()) {
+        node->value()->wheel_ = NULL;
+      }
+    }
+  }
+  for (LinkNode<Timer>* node = expired_.head(); node != expired_.end();
+       node = node->next()) {
+    node->value()->wheel_ = NULL;
+  }
+}
+
+void TimerWheel::Start(Timer* timer, TimeDelta delay, const Closure& task) {
+  DCHECK(!task.is_null());
+  timer->delay_ = delay;
+  timer->task_ = task;
+  Reset(timer);
+}
+
+void TimerWheel::Reset(Timer* timer) {
+  DCHECK(!timer->task_.is_null()) << "Reset of a timer never started";
+  if (timer->wheel_)
+    RemoveTimer(timer);
+  timer->expiry_tick_ =
+      TickAtOrAfter(tick_clock_->NowTicks() + timer->delay_);
+  timer->wheel_ = this;
+  ++size_;
+  AddTimer(timer);
+}
+
+void TimerWheel::Cancel(Timer* timer) {
+  if (!timer->wheel_)
+    return;
+  DCHECK_EQ(this, timer->wheel_);
+  RemoveTimer(timer);
+}
+
+size_t TimerWheel::Advance() {
+  const int64 now_tick =
+      (tick_clock_->NowTicks() - origin_).InMicroseconds() /
+      tick_.InMicroseconds();
+
+  while (next_tick_ <= now_tick) {
+    // Nothing happens until the next slot of the innermost wheel which has
+    // timers comes up; skip to it.
+    int lowest = 0;
+    while (lowest < kLevels && !level_sizes_[lowest])
+      ++lowest;
+    if (lowest == kLevels) {
+      next_tick_ = now_tick + 1;
+      break;
+    }
+    if (lowest > 0) {
+      const int64 granularity =
+          GG_INT64_C(1) << (kRootBits + (lowest - 1) * kLevelBits);
+      const int64 next_slot_tick =
+          (next_tick_ + granularity - 1) / granularity * granularity;
+      if (next_slot_tick > now_tick) {
+        next_tick_ = now_tick + 1;
+        break;
+      }
+      next_tick_ = next_slot_tick;
+    }
+
+    ExpireNextTick();
+  }
+
+  // Run the tasks once the wheel is consistent again, so that they may
+  // start and cancel timers.
+  size_t tasks_run = 0;
+  while (expired_.head() != expired_.end()) {
+    Timer* timer = expired_.head()->value();
+    RemoveTimer(timer);
+    // The task may delete the timer.
+    Closure task = timer->task_;
+    task.Run();
+    ++tasks_run;
+  }
+  return tasks_run;
+}
+
+TimeTicks TimerWheel::NextWakeupTime() const {
+  if (!size_)
+    return TimeTicks();
+  // Wake up for the next cascade of the innermost outer wheel which has
+  // timers, which may come before the first timer of the first wheel. One
+  // of its next kLevelSlots slots has timers.
+  int64 tick = -1;
+  int lowest = 1;
+  while (lowest < kLevels && !level_sizes_[lowest])
+    ++lowest;
+  if (lowest < kLevels) {
+    const int64 granularity =
+        GG_INT64_C(1) << (kRootBits + (lowest - 1) * kLevelBits);
+    tick = (next_tick_ + granularity - 1) / granularity * granularity;
+    while (!CascadesTimersAt(tick))
+      tick += granularity;
+  }
+  if (level_sizes_[0]) {
+    // The first wheel holds the timers of the next kRootSlots ticks.
+    int64 root_tick = next_tick_;
+    while (root_[root_tick & (kRootSlots - 1)].head() ==
+           root_[root_tick & (kRootSlots - 1)].end()) {
+      ++root_tick;
+    }
+    if (tick < 0 || root_tick < tick)
+      tick = root_tick;
+  }
+  if (tick < 0)
+    tick = next_tick_;  // Only expired timers.
+  return origin_ + tick_ * tick;
+}
+
+int64 TimerWheel::TickAtOrAfter(TimeTicks time) const {
+  const int64 microseconds = (time - origin_).InMicroseconds();
+  const int64 tick = tick_.InMicroseconds();
+  if (microseconds <= 0)
+    return 0;
+  return (microseconds + tick - 1) / tick;
+}
+
+void TimerWheel::AddTimer(Timer* timer) {
+  // A timer due already expires on the next tick.
+  int64 ticks = timer->expiry_tick_ - next_tick_;
+  if (ticks < 0) {
+    ticks = 0;
+    timer->expiry_tick_ = next_tick_;
+  } else if (ticks > kMaxTicks) {
+    ticks = kMaxTicks;
+    timer->expiry_tick_ = next_tick_ + kMaxTicks;
+  }
+  const int64 expiry = timer->expiry_tick_;
+
+  if (ticks < kRootSlots) {
+    timer->level_ = 0;
+    root_[expiry & (kRootSlots - 1)].Append(timer);
+  } else {
+    int level = 1;
+    while (level < kLevels - 1 &&
+           ticks >= GG_INT64_C(1) << (kRootBits + level * kLevelBits)) {
+      ++level;
+    }
+    const int shift = kRootBits + (level - 1) * kLevelBits;
+    timer->level_ = level;
+    levels_[level - 1][(expiry >> shift) & (kLevelSlots - 1)].Append(timer);
+  }
+  ++level_sizes_[timer->level_];
+}
+
+void TimerWheel::RemoveTimer(Timer* timer) {
+  timer->RemoveFromList();
+  if (timer->level_ >= 0)
+    --level_sizes_[timer->level_];
+  timer->level_ = -1;
+  timer->wheel_ = NULL;
+  --size_;
+}
+
+bool TimerWheel::CascadesTimersAt(int64 tick) const {
+  // As in ExpireNextTick(), each wheel cascades when the one inside it has
+  // come round.
+  for (int level = 1; level < kLevels; ++level) {
+    const int shift = kRootBits + (level - 1) * kLevelBits;
+    const int index = (tick >> shift) & (kLevelSlots - 1);
+    const Slot& slot = levels_[level - 1][index];
+    if (slot.head() != slot.end())
+      return true;
+    if (index)
+      return false;
+  }
+  return false;
+}
+
+int TimerWheel::Cascade(int level) {
+  const int shift = kRootBits + (level - 1) * kLevelBits;
+  const int index = (next_tick_ >> shift) & (kLevelSlots - 1);
+  Slot& slot = levels_[level - 1][index];
+  while (slot.head() != slot.end()) {
+    Timer* timer = slot.head()->value();
+    timer->RemoveFromList();
+    --level_sizes_[level];
+    AddTimer(timer);
+  }
+  return index;
+}
+
+void TimerWheel::ExpireNextTick() {
+  const int index = next_tick_ & (kRootSlots - 1);
+  if (index == 0) {
+    // The first wheel has come round: refill it from the next one, which
+    // refills from the one after when it comes round too, and so on.
+    for (int level = 1; level < kLevels && Cascade(level) == 0; ++level) {
+    }
+  }
+
+  Slot& slot = root_[index];
+  while (slot.head() != slot.end()) {
+    Timer* timer = slot.head()->value();
+    DCHECK_EQ(next_tick_, timer->expiry_tick_);
+    timer->RemoveFromList();
+    --level_sizes_[0];
+    timer->level_ = -1;
+    expired_.Append(timer);
+  }
+  ++next_tick_;
+}
+
+}  // namespace base
@@ -0,0 +1,166 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_TIMER_TIMER_WHEEL_H_
+#define BASE_TIMER_TIMER_WHEEL_H_
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/callback.h"
+#include "base/containers/linked_list.h"
+#include "base/time/time.h"
+
+namespace base {
+
+class TickClock;
+
+// TimerWheel keeps large numbers of timeouts, such as one per connection,
+// where a heap of them would cost O(log n) a start or cancel. It is a
+// hierarchical hashed timer wheel, as in the Linux kernel: time is cut into
+// ticks, and a timer is hashed into a slot of one of five wheels by how many
+// ticks away it expires. The first wheel has a slot per tick for the next 256
+// ticks, and each following one a slot per 64 ticks of the previous one, up
+// to 2^32 ticks. As time passes, the slots of the outer wheels are cascaded
+// into the inner ones. Starting, cancelling and resetting a timer are O(1),
+// and expiring one is O(1) plus a cascade per outer wheel it was in.
+//
+// A timer fires on the first tick boundary at or after its delay, never
+// before: the tick is the granularity traded for speed.
+//
+// The wheel doesn't read the clock nor run on its own. Time is taken from
+// the TickClock given to it, and timers expire only when Advance() is
+// called, so tests can drive it with a SimpleTestTickClock. A MessageLoop
+// would call Advance() from a task posted for NextWakeupTime().
+//
+// Example:
+//
+//   class Connection {
+//     void OnData() {
+//       // Pushes the idle timeout back.
+//       wheel_->Reset(&idle_timer_);
+//     }
+//     TimerWheel::Timer idle_timer_;
+//   };
+//
+//   TimerWheel wheel(&tick_clock, TimeDelta::FromMilliseconds(10));
+//   wheel.Start(&connection->idle_timer_, TimeDelta::FromSeconds(30),
+//               Bind(&Connection::Close, Unretained(connection)));
+//   ...
+//   wheel.Advance();  // Runs the tasks of the timers which have expired.
+//
+// Not thread safe.
+class BASE_EXPORT TimerWheel {
+ public:
+  // A timer, which the wheel links into its slots, so that starting one
+  // doesn't allocate. The caller owns it; destroying it cancels it.
+  class BASE_EXPORT Timer : public LinkNode<Timer> {
+   public:
+    Timer();
+    ~Timer();
+
+    bool IsRunning() const { return wheel_ != NULL; }
+
+    // The delay the timer was last started with.
+    TimeDelta delay() const { return delay_; }
+
+   private:
+    friend class TimerWheel;
+
+    // The wheel the timer is in, or NULL if it isn't running.
+    TimerWheel* wheel_;
+    TimeDelta delay_;
+    Closure task_;
+    // The tick it expires on, and the wheel it is in, or -1 if it has
+    // expired and is waiting to run.
+    int64 expiry_tick_;
+    int level_;
+
+    DISALLOW_COPY_AND_ASSIGN(Timer);
+  };
+
+  // |tick_clock| is not owned, and must outlive the wheel. |tick| is the
+  // granularity of the timers.
+  TimerWheel(TickClock* tick_clock, TimeDelta tick);
+
+  // Stops the timers still running; their tasks are not run.
+  ~TimerWheel();
+
+  // Starts |timer|, to run |task| after |delay|. If it is running, it is
+  // restarted. Delays of more than 2^32 ticks are cut to that.
+  void Start(Timer* timer, TimeDelta delay, const Closure& task);
+
+  // Restarts |timer| with the delay and task it was last started with.
+  void Reset(Timer* timer);
+
+  // Stops |timer|, if it is running. Its task isn't run. May be called from
+  // the task of another timer which expired in the same Advance().
+  void Cancel(Timer* timer);
+
+  // Expires the timers whose time has come, and then runs their tasks, in
+  // order of expiry. The tasks may start and cancel timers; those they start
+  // run in a later Advance(). Returns the number of tasks run.
+  size_t Advance();
+
+  // Returns when Advance() should next be called: no later than the next
+  // timer expires, though possibly before if that timer is in an outer
+  // wheel. Null if there are no timers.
+  TimeTicks NextWakeupTime() const;
+
+  // The number of timers running.
+  size_t size() const { return size_; }
+
+  TimeDelta tick() const { return tick_; }
+
+ private:
+  enum {
+    kLevels = 5,
+    kRootBits = 8,
+    kRootSlots = 1 << kRootBits,
+    kLevelBits = 6,
+    kLevelSlots = 1 << kLevelBits,
+  };
+
+  typedef LinkedList<Timer> Slot;
+
+  // The first tick whose start is at or after |time|.
+  int64 TickAtOrAfter(TimeTicks time) const;
+
+  // Hashes |timer| into the slot for its expiry tick.
+  void AddTimer(Timer* timer);
+  void RemoveTimer(Timer* timer);
+
+  // Whether reaching |tick|, a multiple of kRootSlots, cascades any timers.
+  bool CascadesTimersAt(int64 tick) const;
+
+  // Moves the timers of the current slot of |level| into the inner wheels.
+  // Returns the index of the slot.
+  int Cascade(int level);
+
+  // Moves the timers expiring on |next_tick_| to |expired_|, and moves on
+  // to the tick after.
+  void ExpireNextTick();
+
+  TickClock* const tick_clock_;
+  const TimeDelta tick_;
+  // The start of tick zero.
+  const TimeTicks origin_;
+
+  // The first tick whose timers Advance() hasn't expired yet.
+  int64 next_tick_;
+
+  Slot root_[kRootSlots];
+  Slot levels_[kLevels - 1][kLevelSlots];
+  // The number of timers in each wheel.
+  size_t level_sizes_[kLevels];
+  size_t size_;
+
+  // The timers expired by Advance() whose tasks haven't run yet.
+  Slot expired_;
+
+  DISALLOW_COPY_AND_ASSIGN(TimerWheel);
+};
+
+}  // namespace base
+
+#endif  // BASE_TIMER_TIMER_WHEEL_H_
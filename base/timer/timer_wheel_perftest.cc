@@ -0,0 +1,216 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Throughput of TimerWheel against a binary heap of timers, which is what a
+// MessageLoop's delayed task queue amounts to, at starting, cancelling and
+// expiring many timers.
+
+#include <vector>
+
+#include "base/bind.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/rand_util.h"
+#include "base/strings/stringprintf.h"
+#include "base/test/perf_log.h"
+#include "base/test/simple_test_tick_clock.h"
+#include "base/time/time.h"
+#include "base/timer/timer_wheel.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+const int kTimers = 1000000;
+const int64 kTickMs = 10;
+// Delays up to ten minutes, like idle timeouts.
+const int64 kMaxDelayMs = 600000;
+
+void Count(int* count) {
+  ++(*count);
+}
+
+// A binary heap of timers, which keep their index in it so that they can be
+// cancelled in O(log n).
+class TimerHeap {
+ public:
+  class Timer {
+   public:
+    Timer() : index_(-1) {}
+
+    bool IsRunning() const { return index_ >= 0; }
+
+   private:
+    friend class TimerHeap;
+
+    TimeTicks deadline_;
+    Closure task_;
+    int index_;
+  };
+
+  explicit TimerHeap(TickClock* tick_clock) : tick_clock_(tick_clock) {}
+
+  void Start(Timer* timer, TimeDelta delay, const Closure& task) {
+    timer->task_ = task;
+    timer->deadline_ = tick_clock_->NowTicks() + delay;
+    if (timer->IsRunning()) {
+      Fix(timer->index_);
+      return;
+    }
+    timer->index_ = static_cast<int>(heap_.size());
+    heap_.push_back(timer);
+    SiftUp(timer->index_);
+  }
+
+  void Cancel(Timer* timer) {
+    if (!timer->IsRunning())
+      return;
+    const int index = timer->index_;
+    Timer* last = heap_.back();
+    heap_.pop_back();
+    timer->index_ = -1;
+    if (last != timer) {
+      Set(index, last);
+      Fix(index);
+    }
+  }
+
+  size_t Advance() {
+    const TimeTicks now = tick_clock_->NowTicks();
+    size_t tasks_run = 0;
+    while (!heap_.empty() && heap_[0]->deadline_ <= now) {
+      Timer* timer = heap_[0];
+      Cancel(timer);
+      timer->task_.Run();
+      ++tasks_run;
+    }
+    return tasks_run;
+  }
+
+ private:
+  void Set(int index, Timer* timer) {
+    heap_[index] = timer;
+    timer->index_ = index;
+  }
+
+  void Fix(int index) {
+    const int parent = (index - 1) / 2;
+    if (index > 0 && heap_[index]->deadline_ < heap_[parent]->deadline_)
+      SiftUp(index);
+    else
+      SiftDown(index);
+  }
+
+  void SiftUp(int index) {
+    Timer* timer = heap_[index];
+    while (index > 0) {
+      const int parent = (index - 1) / 2;
+      if (!(timer->deadline_ < heap_[parent]->deadline_))
+        break;
+      Set(index, heap_[parent]);
+      index = parent;
+    }
+    Set(index, timer);
+  }
+
+  void SiftDown(int index) {
+    Timer* timer = heap_[index];
+    const int size = static_cast<int>(heap_.size());
+    for (;;) {
+      int child = 2 * index + 1;
+      if (child >= size)
+        break;
+      if (child + 1 < size &&
+          heap_[child + 1]->deadline_ < heap_[child]->deadline_) {
+        ++child;
+      }
+      if (!(heap_[child]->deadline_ < timer->deadline_))
+        break;
+      Set(index, heap_[child]);
+      index = child;
+    }
+    Set(index, timer);
+  }
+
+  TickClock* const tick_clock_;
+  std::vector<Timer*> heap_;
+};
+
+// Adapts TimerWheel to the interface of TimerHeap.
+class Wheel {
+ public:
+  typedef TimerWheel::Timer Timer;
+
+  explicit Wheel(TickClock* tick_clock)
+      : wheel_(tick_clock, TimeDelta::FromMilliseconds(kTickMs)) {}
+
+  void Start(Timer* timer, TimeDelta delay, const Closure& task) {
+    wheel_.Start(timer, delay, task);
+  }
+  void Cancel(Timer* timer) { wheel_.Cancel(timer); }
+  size_t Advance() { return wheel_.Advance(); }
+
+ private:
+  TimerWheel wheel_;
+};
+
+void LogRate(const char* test, const char* name, TimeTicks start) {
+  const TimeDelta elapsed = TimeTicks::Now() - start;
+  LogPerfResult(StringPrintf("timers_%s_%s", test, name).c_str(),
+                kTimers / elapsed.InSecondsF(), "timers/s");
+}
+
+// Starts every timer, resets each once (as a connection seeing traffic
+// pushes back its idle timeout), cancels half, and expires the rest a tick
+// at a time.
+template <typename Queue>
+void RunTimers(const char* name, const std::vector<int64>& delays_ms) {
+  SimpleTestTickClock clock;
+  Queue queue(&clock);
+  scoped_ptr<typename Queue::Timer[]> timers(
+      new typename Queue::Timer[kTimers]);
+  int fired = 0;
+  const Closure task = Bind(&Count, &fired);
+
+  TimeTicks start = TimeTicks::Now();
+  for (int i = 0; i < kTimers; ++i)
+    queue.Start(&timers[i], TimeDelta::FromMilliseconds(delays_ms[i]), task);
+  LogRate("start", name, start);
+
+  start = TimeTicks::Now();
+  for (int i = 0; i < kTimers; ++i) {
+    queue.Start(&timers[i],
+                TimeDelta::FromMilliseconds(delays_ms[kTimers - 1 - i]), task);
+  }
+  LogRate("restart", name, start);
+
+  start = TimeTicks::Now();
+  for (int i = 0; i < kTimers; i += 2)
+    queue.Cancel(&timers[i]);
+  LogRate("cancel", name, start);
+
+  start = TimeTicks::Now();
+  size_t expired = 0;
+  for (int64 ms = 0; ms <= kMaxDelayMs; ms += kTickMs) {
+    expired += queue.Advance();
+    clock.Advance(TimeDelta::FromMilliseconds(kTickMs));
+  }
+  expired += queue.Advance();
+  LogRate("expire", name, start);
+
+  EXPECT_EQ(static_cast<size_t>(kTimers / 2), expired);
+  EXPECT_EQ(kTimers / 2, fired);
+}
+
+}  // namespace
+
+TEST(TimerWheelPerfTest, StartCancelExpire) {
+  std::vector<int64> delays_ms(kTimers);
+  for (int i = 0; i < kTimers; ++i)
+    delays_ms[i] = RandInt(1, kMaxDelayMs);
+  RunTimers<TimerHeap>("heap", delays_ms);
+  RunTimers<Wheel>("wheel", delays_ms);
+}
+
+}  // namespace base
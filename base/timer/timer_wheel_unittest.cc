@@ -0,0 +1,235 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/timer/timer_wheel.h"
+
+#include <vector>
+
+#include "base/bind.h"
+#include "base/test/simple_test_tick_clock.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+void Record(std::vector<int>* fired, int id) {
+  fired->push_back(id);
+}
+
+void CancelTimer(TimerWheel* wheel, TimerWheel::Timer* timer) {
+  wheel->Cancel(timer);
+}
+
+void StartTimer(TimerWheel* wheel, TimerWheel::Timer* timer,
+                const Closure& task) {
+  wheel->Start(timer, TimeDelta(), task);
+}
+
+class TimerWheelTest : public testing::Test {
+ protected:
+  TimerWheelTest() : wheel_(&clock_, TimeDelta::FromMilliseconds(10)) {}
+
+  void Start(TimerWheel::Timer* timer, int64 delay_ms, int id) {
+    wheel_.Start(timer, TimeDelta::FromMilliseconds(delay_ms),
+                 Bind(&Record, &fired_, id));
+  }
+
+  // Advances the clock by |ms| and then the wheel.
+  size_t AdvanceMs(int64 ms) {
+    clock_.Advance(TimeDelta::FromMilliseconds(ms));
+    return wheel_.Advance();
+  }
+
+  SimpleTestTickClock clock_;
+  TimerWheel wheel_;
+  std::vector<int> fired_;
+};
+
+}  // namespace
+
+TEST_F(TimerWheelTest, FiresOnTickAtOrAfterDelay) {
+  TimerWheel::Timer exact, rounded;
+  Start(&exact, 20, 1);
+  Start(&rounded, 25, 2);
+  EXPECT_EQ(2u, wheel_.size());
+  EXPECT_TRUE(exact.IsRunning());
+
+  EXPECT_EQ(0u, AdvanceMs(19));
+  EXPECT_EQ(1u, AdvanceMs(1));
+  ASSERT_EQ(1u, fired_.size());
+  EXPECT_EQ(1, fired_[0]);
+  EXPECT_FALSE(exact.IsRunning());
+
+  EXPECT_EQ(0u, AdvanceMs(9));
+  EXPECT_EQ(1u, AdvanceMs(1));
+  ASSERT_EQ(2u, fired_.size());
+  EXPECT_EQ(2, fired_[1]);
+  EXPECT_EQ(0u, wheel_.size());
+}
+
+TEST_F(TimerWheelTest, Cancel) {
+  TimerWheel::Timer timer;
+  Start(&timer, 50, 1);
+  wheel_.Cancel(&timer);
+  EXPECT_FALSE(timer.IsRunning());
+  EXPECT_EQ(0u, wheel_.size());
+  // Cancelling twice is fine.
+  wheel_.Cancel(&timer);
+  EXPECT_EQ(0u, AdvanceMs(100));
+  EXPECT_TRUE(fired_.empty());
+}
+
+TEST_F(TimerWheelTest, DestroyingTimerCancels) {
+  {
+    TimerWheel::Timer timer;
+    Start(&timer, 50, 1);
+  }
+  EXPECT_EQ(0u, wheel_.size());
+  EXPECT_EQ(0u, AdvanceMs(100));
+}
+
+TEST_F(TimerWheelTest, Reset) {
+  TimerWheel::Timer timer;
+  Start(&timer, 30, 1);
+  EXPECT_EQ(0u, AdvanceMs(20));
+  wheel_.Reset(&timer);
+  EXPECT_EQ(1u, wheel_.size());
+  EXPECT_EQ(0u, AdvanceMs(20));
+  EXPECT_EQ(1u, AdvanceMs(10));
+  ASSERT_EQ(1u, fired_.size());
+
+  // A timer which has fired can be reset too.
+  wheel_.Reset(&timer);
+  EXPECT_EQ(1u, AdvanceMs(30));
+  EXPECT_EQ(2u, fired_.size());
+}
+
+TEST_F(TimerWheelTest, Restart) {
+  TimerWheel::Timer timer;
+  Start(&timer, 30, 1);
+  Start(&timer, 100, 2);
+  EXPECT_EQ(1u, wheel_.size());
+  EXPECT_EQ(TimeDelta::FromMilliseconds(100), timer.delay());
+  EXPECT_EQ(0u, AdvanceMs(90));
+  EXPECT_EQ(1u, AdvanceMs(10));
+  ASSERT_EQ(1u, fired_.size());
+  EXPECT_EQ(2, fired_[0]);
+}
+
+// Timers in each of the outer wheels are cascaded in and fire on time.
+TEST_F(TimerWheelTest, LongDelays) {
+  const int64 kDelaysMs[] = {
+    2550, 2560, 2570, 163830, 163840, 10485760, 671088640, 1000000000,
+  };
+  TimerWheel::Timer timers[arraysize(kDelaysMs)];
+  for (size_t i = 0; i < arraysize(kDelaysMs); ++i)
+    Start(&timers[i], kDelaysMs[i], static_cast<int>(i));
+
+  int64 elapsed_ms = 0;
+  for (size_t i = 0; i < arraysize(kDelaysMs); ++i) {
+    EXPECT_EQ(0u, AdvanceMs(kDelaysMs[i] - elapsed_ms - 10));
+    EXPECT_EQ(1u, AdvanceMs(10)) << kDelaysMs[i];
+    elapsed_ms = kDelaysMs[i];
+    ASSERT_EQ(i + 1, fired_.size());
+    EXPECT_EQ(static_cast<int>(i), fired_[i]);
+  }
+  EXPECT_EQ(0u, wheel_.size());
+}
+
+// A single large Advance() expires everything due, in order of expiry.
+TEST_F(TimerWheelTest, BatchExpiry) {
+  const int64 kDelaysMs[] = { 70000, 10, 3000, 500, 40, 200000 };
+  TimerWheel::Timer timers[arraysize(kDelaysMs)];
+  for (size_t i = 0; i < arraysize(kDelaysMs); ++i)
+    Start(&timers[i], kDelaysMs[i], static_cast<int>(kDelaysMs[i]));
+
+  EXPECT_EQ(5u, AdvanceMs(100000));
+  ASSERT_EQ(5u, fired_.size());
+  EXPECT_EQ(10, fired_[0]);
+  EXPECT_EQ(40, fired_[1]);
+  EXPECT_EQ(500, fired_[2]);
+  EXPECT_EQ(3000, fired_[3]);
+  EXPECT_EQ(70000, fired_[4]);
+  EXPECT_EQ(1u, wheel_.size());
+  EXPECT_EQ(1u, AdvanceMs(100000));
+}
+
+TEST_F(TimerWheelTest, TaskCancelsExpiredTimer) {
+  TimerWheel::Timer first, second;
+  wheel_.Start(&first, TimeDelta::FromMilliseconds(10),
+               Bind(&CancelTimer, &wheel_, &second));
+  Start(&second, 20, 2);
+  EXPECT_EQ(1u, AdvanceMs(50));
+  EXPECT_FALSE(second.IsRunning());
+  EXPECT_TRUE(fired_.empty());
+}
+
+TEST_F(TimerWheelTest, TaskStartsTimer) {
+  TimerWheel::Timer first, second;
+  wheel_.Start(&first, TimeDelta::FromMilliseconds(10),
+               Bind(&StartTimer, &wheel_, &second,
+                    Bind(&Record, &fired_, 2)));
+  EXPECT_EQ(1u, AdvanceMs(10));
+  EXPECT_TRUE(second.IsRunning());
+  EXPECT_TRUE(fired_.empty());
+  EXPECT_EQ(1u, AdvanceMs(10));
+  ASSERT_EQ(1u, fired_.size());
+}
+
+TEST_F(TimerWheelTest, NextWakeupTime) {
+  EXPECT_TRUE(wheel_.NextWakeupTime().is_null());
+  const TimeTicks start = clock_.NowTicks();
+
+  TimerWheel::Timer soon, later;
+  Start(&soon, 45, 1);
+  Start(&later, 60000, 2);
+  EXPECT_EQ(start + TimeDelta::FromMilliseconds(50),
+            wheel_.NextWakeupTime());
+
+  EXPECT_EQ(1u, AdvanceMs(50));
+  // The later timer is in an outer wheel: wake up no later than it.
+  TimeTicks wakeup = wheel_.NextWakeupTime();
+  EXPECT_LE(wakeup, start + TimeDelta::FromMilliseconds(60000));
+  // Following the wake ups reaches it without firing early.
+  while (fired_.size() < 2u) {
+    ASSERT_FALSE(wakeup.is_null());
+    ASSERT_GT(wakeup, clock_.NowTicks());
+    clock_.Advance(wakeup - clock_.NowTicks());
+    wheel_.Advance();
+    wakeup = wheel_.NextWakeupTime();
+  }
+  EXPECT_EQ(start + TimeDelta::FromMilliseconds(60000), clock_.NowTicks());
+  EXPECT_TRUE(wakeup.is_null());
+}
+
+// A timer of the first wheel doesn't hide an earlier one in an outer wheel.
+TEST_F(TimerWheelTest, NextWakeupTimeAcrossWheels) {
+  // A millisecond tick, so that the first wheel spans 256 ms.
+  TimerWheel wheel(&clock_, TimeDelta::FromMilliseconds(1));
+  const TimeTicks start = clock_.NowTicks();
+
+  TimerWheel::Timer outer, inner;
+  wheel.Start(&outer, TimeDelta::FromMilliseconds(300),
+              Bind(&Record, &fired_, 1));
+  clock_.Advance(TimeDelta::FromMilliseconds(200));
+  EXPECT_EQ(0u, wheel.Advance());
+  wheel.Start(&inner, TimeDelta::FromMilliseconds(255),
+              Bind(&Record, &fired_, 2));
+
+  TimeTicks wakeup = wheel.NextWakeupTime();
+  EXPECT_LE(wakeup, start + TimeDelta::FromMilliseconds(300));
+  while (fired_.empty()) {
+    ASSERT_GT(wakeup, clock_.NowTicks());
+    clock_.Advance(wakeup - clock_.NowTicks());
+    wheel.Advance();
+    wakeup = wheel.NextWakeupTime();
+  }
+  EXPECT_EQ(start + TimeDelta::FromMilliseconds(300), clock_.NowTicks());
+  ASSERT_EQ(1u, fired_.size());
+  EXPECT_EQ(1, fired_[0]);
+  EXPECT_EQ(start + TimeDelta::FromMilliseconds(455), wakeup);
+}
+
+}  // namespace base